@@ -0,0 +1,311 @@
+/**
+@file   AsyncAudioCodecWorker.cpp
+@brief  A worker thread used to run audio codecs outside of the main thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncFdWatch.h>
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioCodecWorker.h"
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace Async;
+using namespace sigc;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioCodecWorker::AudioCodecWorker(size_t job_count)
+{
+  jobs.reserve(job_count);
+  free_jobs.reserve(job_count);
+  for (size_t i=0; i<job_count; ++i)
+  {
+    allocJob();
+  }
+} /* AudioCodecWorker::AudioCodecWorker */
+
+
+AudioCodecWorker::~AudioCodecWorker(void)
+{
+  if (worker.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cond.notify_one();
+    worker.join();
+  }
+  delete notify_watch;
+  if (notify_fd >= 0)
+  {
+    close(notify_fd);
+  }
+} /* AudioCodecWorker::~AudioCodecWorker */
+
+
+bool AudioCodecWorker::start(void)
+{
+  notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (notify_fd < 0)
+  {
+    std::cerr << "*** ERROR: Could not create eventfd for audio codec "
+                 "worker: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  notify_watch = new FdWatch(notify_fd, FdWatch::FD_WATCH_RD);
+  notify_watch->setName("AudioCodecWorker");
+  notify_watch->activity.connect(
+      mem_fun(*this, &AudioCodecWorker::resultsAvailable));
+
+  threaded = true;
+  worker = std::thread(&AudioCodecWorker::workerFunc, this);
+
+  return true;
+} /* AudioCodecWorker::start */
+
+
+AudioCodecJob *AudioCodecWorker::newJob(AudioCodecJob::Type type)
+{
+  AudioCodecJob *job = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_jobs.empty())
+    {
+      allocJob();
+    }
+    job = free_jobs.back();
+    free_jobs.pop_back();
+  }
+  job->type = type;
+  job->count = 0;
+  job->samples.clear();
+  job->data.clear();
+  return job;
+} /* AudioCodecWorker::newJob */
+
+
+void AudioCodecWorker::submit(AudioCodecJob *job)
+{
+  if (!threaded)
+  {
+    processJob(job);
+    std::lock_guard<std::mutex> lock(mutex);
+    free_jobs.push_back(job);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    in_queue.push_back(job);
+  }
+  cond.notify_one();
+} /* AudioCodecWorker::submit */
+
+
+void AudioCodecWorker::post(AudioCodecJob *job)
+{
+  if (!threaded)
+  {
+    jobDone(job);
+    std::lock_guard<std::mutex> lock(mutex);
+    free_jobs.push_back(job);
+    return;
+  }
+
+  bool was_empty = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    was_empty = out_queue.empty();
+    out_queue.push_back(job);
+  }
+
+    // Only wake the main thread up if it has handled the previous results
+  if (was_empty)
+  {
+    uint64_t cnt = 1;
+    if ((write(notify_fd, &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN))
+    {
+      std::cerr << "*** ERROR: Could not write to eventfd for audio codec "
+                   "worker: " << std::strerror(errno) << std::endl;
+    }
+  }
+} /* AudioCodecWorker::post */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+AudioCodecJob *AudioCodecWorker::allocJob(void)
+{
+    // Typical frame sizes fit without reallocation
+  std::unique_ptr<AudioCodecJob> job(new AudioCodecJob);
+  job->samples.reserve(1024);
+  job->data.reserve(512);
+  free_jobs.push_back(job.get());
+  jobs.push_back(std::move(job));
+  return free_jobs.back();
+} /* AudioCodecWorker::allocJob */
+
+
+void AudioCodecWorker::workerFunc(void)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;)
+  {
+    cond.wait(lock, [this] { return stop || !in_queue.empty(); });
+    if (stop)
+    {
+      break;
+    }
+    AudioCodecJob *job = in_queue.front();
+    in_queue.pop_front();
+    lock.unlock();
+    processJob(job);
+    lock.lock();
+    free_jobs.push_back(job);
+  }
+} /* AudioCodecWorker::workerFunc */
+
+
+void AudioCodecWorker::resultsAvailable(FdWatch *watch)
+{
+  uint64_t cnt;
+  if ((read(watch->fd(), &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN))
+  {
+    std::cerr << "*** ERROR: Could not read from eventfd for audio codec "
+                 "worker: " << std::strerror(errno) << std::endl;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done_queue.swap(out_queue);
+  }
+
+  while (!done_queue.empty())
+  {
+    AudioCodecJob *job = done_queue.front();
+    done_queue.pop_front();
+    jobDone(job);
+    std::lock_guard<std::mutex> lock(mutex);
+    free_jobs.push_back(job);
+  }
+} /* AudioCodecWorker::resultsAvailable */
+
+
+
+/*
+ * This file has not been truncated
+ */
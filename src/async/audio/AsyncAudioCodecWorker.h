@@ -0,0 +1,257 @@
+/**
+@file   AsyncAudioCodecWorker.h
+@brief  A worker thread used to run audio codecs outside of the main thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This file contains a class that run audio encoders and decoders in a
+separate thread. It is used by the AudioEncoderWorker and AudioDecoderWorker
+classes.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_CODEC_WORKER_INCLUDED
+#define ASYNC_AUDIO_CODEC_WORKER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class FdWatch;
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A job to be processed by, or a result from, an AudioCodecWorker
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+*/
+struct AudioCodecJob
+{
+  typedef enum
+  {
+    SAMPLES,      ///< Audio samples in the samples member
+    ENCODED,      ///< Encoded audio in the data member
+    FLUSH,        ///< Flush the codec
+    CONCEAL,      ///< Conceal count lost samples using optional data
+    OPTION,       ///< Set the codec option name to value
+    PRINT_PARAMS  ///< Print the codec parameters
+  } Type;
+
+  Type                  type = SAMPLES;
+  std::vector<float>    samples;
+  std::vector<uint8_t>  data;
+  int                   count = 0;
+  std::string           name;
+  std::string           value;
+};
+
+
+/**
+@brief	Run audio codec jobs in a separate thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class is used to run the processing of an audio encoder or decoder in a
+worker thread. The main thread submit jobs, like samples to encode or encoded
+audio to decode, which are processed in order by the processJob function in
+the worker thread. Results are posted back by the worker thread and are
+delivered in order in the main thread through the jobDone signal.
+
+The jobs are taken from a pool that is allocated when the worker is created.
+The pool is extended if all jobs are in use. The buffers in a job keep their
+capacity when the job is reused so no memory allocations are needed in the
+audio path once the pool has been warmed up.
+*/
+class AudioCodecWorker : public sigc::trackable
+{
+  public:
+    /**
+     * @brief   Constructor
+     * @param   job_count The number of jobs to preallocate
+     */
+    explicit AudioCodecWorker(size_t job_count=32);
+
+    /**
+     * @brief   Destructor
+     *
+     * The worker thread will be stopped. Jobs not yet processed are thrown
+     * away.
+     */
+    ~AudioCodecWorker(void);
+
+    /**
+     * @brief   Start the worker thread
+     * @return  Returns \em true on success or else \em false
+     *
+     * The processJob function must be set before calling this function. If
+     * the worker is not started, or fail to start, jobs are processed
+     * directly in the calling thread.
+     */
+    bool start(void);
+
+    /**
+     * @brief   Get a free job
+     * @param   type The type of the job
+     * @return  Returns a job object
+     *
+     * This function may be called from both the main thread and the worker
+     * thread. The job must be given to submit or post.
+     */
+    AudioCodecJob *newJob(AudioCodecJob::Type type);
+
+    /**
+     * @brief   Submit a job to the worker thread
+     * @param   job The job to process
+     *
+     * This function must only be called from the main thread.
+     */
+    void submit(AudioCodecJob *job);
+
+    /**
+     * @brief   Post a result to the main thread
+     * @param   job The result to deliver
+     *
+     * This function must only be called from the worker thread.
+     */
+    void post(AudioCodecJob *job);
+
+    /**
+     * @brief   The function that process jobs in the worker thread
+     */
+    std::function<void(AudioCodecJob*)> processJob;
+
+    /**
+     * @brief   A signal emitted in the main thread for each posted result
+     * @param   job The result
+     *
+     * The job object is reused after the signal handler returns. The worker
+     * object must not be deleted from the signal handler.
+     */
+    sigc::signal<void(AudioCodecJob*)> jobDone;
+
+  private:
+    std::vector<std::unique_ptr<AudioCodecJob>> jobs;
+    std::vector<AudioCodecJob*>                 free_jobs;
+    std::deque<AudioCodecJob*>                  in_queue;
+    std::deque<AudioCodecJob*>                  out_queue;
+    std::deque<AudioCodecJob*>                  done_queue;
+    std::mutex                                  mutex;
+    std::condition_variable                     cond;
+    std::thread                                 worker;
+    bool                                        stop = false;
+    bool                                        threaded = false;
+    int                                         notify_fd = -1;
+    FdWatch*                                    notify_watch = nullptr;
+
+    AudioCodecWorker(const AudioCodecWorker&);
+    AudioCodecWorker& operator=(const AudioCodecWorker&);
+    AudioCodecJob *allocJob(void);
+    void workerFunc(void);
+    void resultsAvailable(FdWatch *watch);
+
+};  /* class AudioCodecWorker */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_CODEC_WORKER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -33,6 +33,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 
 /****************************************************************************
@@ -73,6 +76,15 @@ using namespace Async;
 // DC offset to prevent denormal
 static const double DC_OFFSET = 1.0E-25;
 
+// DC offset to prevent denormal in the single precision envelope
+static const float DC_OFFSET_F = 1.0E-20f;
+
+// The number of samples processed in each block
+static const int BLOCK_SIZE = 64;
+
+// dB per octave, 20 * log10( 2 )
+static const double DB_PER_LOG2 = 6.0205999132796239042747778944899;
+
 
 
 
@@ -107,6 +119,89 @@ static inline double dB2lin( double dB )
   return exp( dB * DB_2_LOG );
 }
 
+namespace {
+  /*
+   * Fast log2 and exp2 approximations. The float is split into exponent and
+   * mantissa and a polynomial is used for the mantissa. The polynomials are
+   * least squares fits over one octave. There are no branches so the loops
+   * using them can be vectorized by the compiler.
+   */
+
+    // Branch free max/min. The compiler does not always vectorize loops
+    // where the result of std::max/std::min is used in further calculations.
+  inline float maxf(float a, float b) { return 0.5f * (a + b + fabsf(a - b)); }
+  inline float minf(float a, float b) { return 0.5f * (a + b - fabsf(a - b)); }
+
+    // Split x into exponent and a mantissa minus one, in [0, 1)
+  inline float log2Split(float x, float &m)
+  {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    float e = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+    bits = (bits & 0x007fffff) | 0x3f800000;
+    memcpy(&m, &bits, sizeof(m));
+    m -= 1.0f;
+    return e;
+  }
+
+    // Build 2^i * p where i is an integer and p is in [1, 2)
+  inline float exp2Join(float x, float &f)
+  {
+    x = maxf(-126.0f, minf(126.0f, x));
+    int32_t i = static_cast<int32_t>(x);
+    i -= (x < i) ? 1 : 0;   // Round towards minus infinity
+    f = x - i;
+    int32_t bits = (i + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return scale;
+  }
+
+  struct HighPrecisionMath
+  {
+      // Max error 1.4E-5 (8.7E-5dB)
+    static inline float log2(float x)
+    {
+      float m;
+      float e = log2Split(x, m);
+      return e + (1.43909287e-05f + m * (1.44159208f + m * (-0.707253434f +
+                  m * (0.411561483f + m * (-0.189832447f +
+                  m * 0.0439286282f)))));
+    }
+
+      // Max relative error 1.1E-7
+    static inline float exp2(float x)
+    {
+      float f;
+      float scale = exp2Join(x, f);
+      return scale * (0.999999896f + f * (0.69315462f + f * (0.240140768f +
+                      f * (0.0558632884f + f * (0.00894620827f +
+                      f * 0.00189510979f)))));
+    }
+  };
+
+  struct FastPrecisionMath
+  {
+      // Max error 7.3E-4 (4.4E-3dB)
+    static inline float log2(float x)
+    {
+      float m;
+      float e = log2Split(x, m);
+      return e + (0.000725274007f + m * (1.41729945f + m * (-0.572920597f +
+                  m * 0.155445855f)));
+    }
+
+      // Max relative error 1.1E-4 (9.6E-4dB)
+    static inline float exp2(float x)
+    {
+      float f;
+      float scale = exp2Join(x, f);
+      return scale * (0.999896691f + f * (0.696390547f + f * (0.224516344f +
+                      f * 0.0790857013f)));
+    }
+  };
+} /* namespace */
+
 
 
 /****************************************************************************
@@ -134,7 +229,7 @@ static inline double dB2lin( double dB )
 
 AudioCompressor::AudioCompressor(void)
   : threshdB_(0.0), ratio_(1.0), output_gain(1.0),att_(10.0), rel_(100.0),
-    envdB_(DC_OFFSET)
+    envdB_(DC_OFFSET), precision_(PRECISION_HIGH)
 {
 } /* AudioCompressor::AudioCompressor */
 
@@ -196,6 +291,31 @@ void AudioCompressor::reset(void)
 
 
 void AudioCompressor::processSamples(float *dest, const float *src, int count)
+{
+  switch (precision_)
+  {
+    case PRECISION_EXACT:
+      processSamplesExact(dest, src, count);
+      break;
+    case PRECISION_HIGH:
+      processSamplesBlock<HighPrecisionMath>(dest, src, count);
+      break;
+    case PRECISION_FAST:
+      processSamplesBlock<FastPrecisionMath>(dest, src, count);
+      break;
+  }
+} /* AudioCompressor::processSamples */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioCompressor::processSamplesExact(float *dest, const float *src,
+                                          int count)
 {
   //double max_sample = 0.0;
   for (int i=0; i<count; ++i)
@@ -250,15 +370,60 @@ void AudioCompressor::processSamples(float *dest, const float *src, int count)
   
   //cout << "max_sample=" << max_sample << endl;
   
-} /* AudioCompressor::writeSamples */
+} /* AudioCompressor::processSamplesExact */
+
+
+  /*
+   * The same calculation as in processSamplesExact but in single precision
+   * and in the log2 domain instead of in dB. The samples are processed in
+   * blocks in three passes. Only the envelope detector, which depend on the
+   * previous sample, is run sample by sample. The other two passes have no
+   * branches or dependencies between samples so they can be vectorized.
+   */
+template <class Math>
+void AudioCompressor::processSamplesBlock(float *dest, const float *src,
+                                          int count)
+{
+  const float thresh = threshdB_ / DB_PER_LOG2;
+  const float gr_factor = ratio_ - 1.0;
+  const float gain = output_gain;
+  const float att_coef = att_.getCoef();
+  const float rel_coef = rel_.getCoef();
+  float env = std::max(envdB_ / DB_PER_LOG2, 0.0) + DC_OFFSET_F;
+
+  float over[BLOCK_SIZE];
+  while (count > 0)
+  {
+    const int len = std::min(count, BLOCK_SIZE);
 
+      // Rectify, convert to log2 and apply the threshold
+    for (int i=0; i<len; ++i)
+    {
+      float key = Math::log2(fabsf(src[i]) + DC_OFFSET_F) - thresh;
+      over[i] = maxf(key, 0.0f) + DC_OFFSET_F;
+    }
 
+      // Attack/release
+    for (int i=0; i<len; ++i)
+    {
+      const float coef = (over[i] > env) ? att_coef : rel_coef;
+      env = over[i] + coef * (env - over[i]);
+      over[i] = env - DC_OFFSET_F;
+    }
 
-/****************************************************************************
- *
- * Private member functions
- *
- ****************************************************************************/
+      // Gain reduction and output gain
+    for (int i=0; i<len; ++i)
+    {
+      dest[i] = gain * src[i] * Math::exp2(over[i] * gr_factor);
+    }
+
+    src += len;
+    dest += len;
+    count -= len;
+  }
+
+  envdB_ = (env - DC_OFFSET_F) * DB_PER_LOG2 + DC_OFFSET;
+} /* AudioCompressor::processSamplesBlock */
 
 
 
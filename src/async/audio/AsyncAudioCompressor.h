@@ -132,6 +132,9 @@ class EnvelopeDetector
 
     virtual double getSampleRate( void ) { return sampleRate_; }
 
+    // runtime coefficient
+    virtual double getCoef( void ) { return coef_; }
+
     // runtime function
     inline void run( double in, double &state )
     {
@@ -165,10 +168,25 @@ compressed it can be amplified to get a more audible end result.
 
 This audio pipe component is mostly untested and is based on some ripped off
 code which I really have not checked how it performs or if it works at all...
+
+By default the audio is processed in blocks using single precision and fast
+polynomial approximations of log2 and exp2 instead of log and exp. The gain
+error compared to the exact, double precision, calculation is well below
+0.01dB. Use setPrecision to select the exact or an even faster calculation.
 */
 class AudioCompressor : public AudioProcessor
 {
   public:
+    /**
+     * @brief The precision used when calculating the gain
+     */
+    typedef enum
+    {
+      PRECISION_EXACT,  ///< Double precision per sample, using log/exp
+      PRECISION_HIGH,   ///< Fast log2/exp2, gain error < 0.001dB
+      PRECISION_FAST    ///< Faster log2/exp2, gain error < 0.01dB
+    } Precision;
+
     /**
      * @brief 	Default constuctor
      */
@@ -216,6 +234,18 @@ class AudioCompressor : public AudioProcessor
      */
     void setOutputGain(float gain);
   
+    /**
+     * @brief 	Set the precision used when calculating the gain
+     * @param 	precision The precision to use
+     */
+    void setPrecision(Precision precision) { precision_ = precision; }
+
+    /**
+     * @brief 	Get the precision used when calculating the gain
+     * @return	Returns the precision in use
+     */
+    Precision precision(void) const { return precision_; }
+
     /**
      * @brief 	Reset the compressor
      */
@@ -238,9 +268,13 @@ class AudioCompressor : public AudioProcessor
 
     // runtime variables
     double envdB_;			// over-threshold envelope (dB)
+    Precision precision_;
     
     AudioCompressor(const AudioCompressor&);
     AudioCompressor& operator=(const AudioCompressor&);
+    void processSamplesExact(float *dest, const float *src, int count);
+    template <class Math>
+    void processSamplesBlock(float *dest, const float *src, int count);
     
 };  /* class AudioCompressor */
 
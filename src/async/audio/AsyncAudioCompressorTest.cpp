@@ -0,0 +1,145 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+#include "AsyncAudioCompressor.h"
+
+using namespace std;
+using namespace Async;
+
+
+  /*
+   * Compare the gain of the fast AudioCompressor precision modes with the
+   * exact, double precision, calculation. The compressor and limiter
+   * configurations used by the transmitter and receiver code are run on a
+   * tone stepping through levels from -50dBFS to +6dBFS, on noise and on
+   * silence. The test fails if the gain error is larger than documented.
+   */
+
+class TestCompressor : public AudioCompressor
+{
+  public:
+    using AudioCompressor::processSamples;
+};
+
+
+namespace {
+const int BLOCK_SIZE = 256;
+
+struct Setup
+{
+  const char *name;
+  double      thresh;
+  double      ratio;
+  double      attack;
+  double      decay;
+  float       output_gain;
+};
+
+const Setup setups[] = {
+  { "compressor", -10.0, 0.25, 10.0, 100.0, 0.0 },
+  { "limiter",     -6.0, 0.1,   2.0,  20.0, 1.0 },
+  { "limiter_rx",  -1.0, 0.1,   2.0,  20.0, 1.0 }
+};
+
+
+vector<float> makeSignal(void)
+{
+  vector<float> signal;
+  for (int level=-50; level<=6; level+=4)
+  {
+    float amp = powf(10.0f, level / 20.0f);
+    for (int i=0; i<INTERNAL_SAMPLE_RATE/10; ++i)
+    {
+      signal.push_back(amp * sinf(2.0f * M_PI * 1000.0f * signal.size() /
+                                  INTERNAL_SAMPLE_RATE));
+    }
+  }
+  unsigned rnd = 1;
+  for (int i=0; i<INTERNAL_SAMPLE_RATE; ++i)
+  {
+    rnd = rnd * 1103515245 + 12345;
+    signal.push_back(static_cast<float>((rnd >> 8) & 0xffff) / 32768.0f - 1.0f);
+  }
+  signal.insert(signal.end(), INTERNAL_SAMPLE_RATE / 10, 0.0f);
+  return signal;
+}
+
+
+double process(const Setup& setup, AudioCompressor::Precision precision,
+               const vector<float>& in, vector<float>& out)
+{
+  TestCompressor comp;
+  comp.setThreshold(setup.thresh);
+  comp.setRatio(setup.ratio);
+  comp.setAttack(setup.attack);
+  comp.setDecay(setup.decay);
+  comp.setOutputGain(setup.output_gain);
+  comp.setPrecision(precision);
+
+  out.resize(in.size());
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (size_t pos=0; pos<in.size(); pos+=BLOCK_SIZE)
+  {
+    int count = min(static_cast<size_t>(BLOCK_SIZE), in.size() - pos);
+    comp.processSamples(&out[pos], &in[pos], count);
+  }
+  return chrono::duration<double, nano>(
+      chrono::steady_clock::now() - start).count() / in.size();
+}
+
+
+double maxGainError(const vector<float>& in, const vector<float>& ref,
+                    const vector<float>& out)
+{
+  double max_err = 0.0;
+  for (size_t i=0; i<in.size(); ++i)
+  {
+    if ((fabs(in[i]) < 1.0e-3) || (ref[i] == 0.0f))
+    {
+      if (out[i] != ref[i])
+      {
+        max_err = max(max_err, fabs(out[i] - ref[i]) / 1.0e-3);
+      }
+      continue;
+    }
+    max_err = max(max_err, fabs(20.0 * log10(out[i] / ref[i])));
+  }
+  return max_err;
+}
+};
+
+
+int main(void)
+{
+  vector<float> signal = makeSignal();
+  bool ok = true;
+  for (const Setup& setup : setups)
+  {
+    vector<float> ref, high, fast;
+    double ref_ns = process(setup, AudioCompressor::PRECISION_EXACT,
+                            signal, ref);
+    double high_ns = process(setup, AudioCompressor::PRECISION_HIGH,
+                             signal, high);
+    double fast_ns = process(setup, AudioCompressor::PRECISION_FAST,
+                             signal, fast);
+    double high_err = maxGainError(signal, ref, high);
+    double fast_err = maxGainError(signal, ref, fast);
+    cout << setw(12) << left << setup.name << right << fixed
+         << setprecision(5)
+         << " high: err=" << high_err << "dB"
+         << " fast: err=" << fast_err << "dB"
+         << setprecision(2)
+         << "  exact/high/fast=" << ref_ns << "/" << high_ns << "/"
+         << fast_ns << " ns/sample" << endl;
+    if ((high_err > 0.001) || (fast_err > 0.01))
+    {
+      cout << "*** ERROR: Gain error too large for " << setup.name << endl;
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
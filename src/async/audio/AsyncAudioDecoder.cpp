@@ -172,7 +172,22 @@ AudioDecoder *AudioDecoder::create(const std::string &name)
   {
     return 0;
   }
-}
+} /* AudioDecoder::create */
+
+
+void AudioDecoder::concealLostSamples(int count, const void*, int)
+{
+  if (count <= 0)
+  {
+    return;
+  }
+  float silence[count];
+  for (int i=0; i<count; ++i)
+  {
+    silence[i] = 0.0f;
+  }
+  sinkWriteSamples(silence, count);
+} /* AudioDecoder::concealLostSamples */
 
 
 /****************************************************************************
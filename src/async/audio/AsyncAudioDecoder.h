@@ -164,6 +164,28 @@ class AudioDecoder : public AudioSource, public sigc::trackable
      * @brief Call this function when all encoded samples have been received
      */
     virtual void flushEncodedSamples(void) { sinkFlushSamples(); }
+
+    /**
+     * @brief   Generate audio to cover up for lost encoded samples
+     * @param   count     The number of samples that was lost
+     * @param   next_buf  The packet following the lost one, if available
+     * @param   next_size The size of the next packet
+     *
+     * This function should be called when it is known that encoded audio has
+     * been lost on the way, e.g. when a gap in the sequence numbers of the
+     * received packets is detected. Decoders with support for packet loss
+     * concealment (PLC) will synthesize replacement audio to hide the gap.
+     * If the packet directly following the lost one has already been
+     * received, it can be given in the next_buf argument. Decoders with
+     * support for inband forward error correction (FEC) can then use it to
+     * recover the lost audio. The next packet must still be written using
+     * writeEncodedSamples afterwards.
+     * If count is zero, the duration of the last decoded frame is used, if
+     * the decoder knows about it.
+     * The default implementation will just write silence.
+     */
+    virtual void concealLostSamples(int count, const void *next_buf=nullptr,
+                                    int next_size=0);
     
     /**
      * @brief Resume audio output to the sink
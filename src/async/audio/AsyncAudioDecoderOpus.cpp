@@ -115,7 +115,7 @@ using namespace Async;
  ****************************************************************************/
 
 AudioDecoderOpus::AudioDecoderOpus(void)
-  : frame_size(0)
+  : frame_size(0), use_fec(true)
 {
   int error;
   dec = opus_decoder_create(INTERNAL_SAMPLE_RATE, 1, &error);
@@ -143,6 +143,11 @@ void AudioDecoderOpus::setOption(const std::string &name,
   }
   else
 #endif
+  if (name == "FEC")
+  {
+    enableFec(atoi(value.c_str()) != 0);
+  }
+  else
   {
     cerr << "*** WARNING AudioDecoderOpus: Unknown option \""
       	 << name << "\". Ignoring it.\n";
@@ -155,6 +160,7 @@ void AudioDecoderOpus::printCodecParams(void) const
 #if OPUS_MAJOR > 0
   cout << "------ Opus decoder parameters ------\n";
   cout << "Gain       = " << gain() << "dB\n";
+  cout << "Inband FEC = " << (fecEnabled() ? "YES" : "NO") << endl;
   cout << "--------------------------------------\n";
 #endif
 } /* AudioDecoderOpus::printCodecParams */
@@ -241,6 +247,47 @@ void AudioDecoderOpus::writeEncodedSamples(void *buf, int size)
 } /* AudioDecoderOpus::writeEncodedSamples */
 
 
+void AudioDecoderOpus::concealLostSamples(int count, const void *next_buf,
+                                          int next_size)
+{
+  if (count <= 0)
+  {
+    count = frame_size;
+  }
+
+    // The Opus decoder require that the PLC duration is a multiple of 2.5ms
+  const int plc_granularity = INTERNAL_SAMPLE_RATE / 400;
+  count -= count % plc_granularity;
+  if (count <= 0)
+  {
+    count = plc_granularity;
+  }
+  float samples[count];
+  int cnt = 0;
+  if (use_fec && (next_buf != nullptr) && (next_size > 0))
+  {
+      // Decode the FEC data in the next packet. If the packet do not
+      // contain any FEC data, the decoder will fall back to PLC.
+    cnt = opus_decode_float(dec,
+        reinterpret_cast<const unsigned char*>(next_buf), next_size,
+        samples, count, 1);
+  }
+  else
+  {
+    cnt = opus_decode_float(dec, NULL, 0, samples, count, 0);
+  }
+  if (cnt > 0)
+  {
+    sinkWriteSamples(samples, cnt);
+  }
+  else if (cnt < 0)
+  {
+    cerr << "**** ERROR: Opus decoder error: " << opus_strerror(cnt)
+         << endl;
+  }
+} /* AudioDecoderOpus::concealLostSamples */
+
+
 
 /****************************************************************************
  *
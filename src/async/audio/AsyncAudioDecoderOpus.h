@@ -166,6 +166,37 @@ class AudioDecoderOpus : public AudioDecoder
      * @param 	size The size of the buffer
      */
     virtual void writeEncodedSamples(void *buf, int size);
+
+    /**
+     * @brief   Enable or disable the use of inband FEC
+     * @param   enable Set to \em true to enable or \em false to disable
+     *
+     * When enabled, the inband forward error correction (FEC) data in the
+     * packet following a lost packet will be used to recover the lost audio.
+     * The remote encoder must have FEC enabled for this to have any effect.
+     * Use of FEC is enabled by default.
+     */
+    void enableFec(bool enable) { use_fec = enable; }
+
+    /**
+     * @brief   Find out if use of inband FEC is enabled
+     * @returns Returns \em true if inband FEC is used
+     */
+    bool fecEnabled(void) const { return use_fec; }
+
+    /**
+     * @brief   Generate audio to cover up for lost encoded samples
+     * @param   count     The number of samples that was lost
+     * @param   next_buf  The packet following the lost one, if available
+     * @param   next_size The size of the next packet
+     *
+     * If the next packet is available and FEC is enabled, the inband FEC data
+     * in that packet is used to recover the lost audio. Otherwise the Opus
+     * packet loss concealment (PLC) algorithm is used to synthesize audio for
+     * the lost samples.
+     */
+    virtual void concealLostSamples(int count, const void *next_buf=nullptr,
+                                    int next_size=0) override;
     
 
   protected:
@@ -173,6 +204,7 @@ class AudioDecoderOpus : public AudioDecoder
   private:
     OpusDecoder *dec;
     int         frame_size;
+    bool        use_fec;
     
     AudioDecoderOpus(const AudioDecoderOpus&);
     AudioDecoderOpus& operator=(const AudioDecoderOpus&);
@@ -0,0 +1,273 @@
+/**
+@file   AsyncAudioDecoderWorker.cpp
+@brief  An audio decoder that run another decoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSink.h>
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioCodecWorker.h"
+#include "AsyncAudioDecoderWorker.h"
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace Async;
+using namespace sigc;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+/*
+ * The sink connected to the wrapped decoder. It is called in the worker
+ * thread and pass the decoded audio on to the main thread.
+ */
+class AudioDecoderWorker::OutputSink : public AudioSink
+{
+  public:
+    explicit OutputSink(AudioCodecWorker *worker) : worker(worker) {}
+
+    virtual int writeSamples(const float *samples, int count)
+    {
+      auto job = worker->newJob(AudioCodecJob::SAMPLES);
+      job->samples.assign(samples, samples + count);
+      worker->post(job);
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      worker->post(worker->newJob(AudioCodecJob::FLUSH));
+      sourceAllSamplesFlushed();
+    }
+
+  private:
+    AudioCodecWorker *worker;
+};
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioDecoderWorker::AudioDecoderWorker(AudioDecoder *dec)
+  : dec(dec), output_sink(0), worker(new AudioCodecWorker)
+{
+  output_sink = new OutputSink(worker);
+  dec->registerSink(output_sink);
+
+  worker->processJob = [this](AudioCodecJob *job) { processJob(job); };
+  worker->jobDone.connect(mem_fun(*this, &AudioDecoderWorker::jobDone));
+  worker->start();
+} /* AudioDecoderWorker::AudioDecoderWorker */
+
+
+AudioDecoderWorker::~AudioDecoderWorker(void)
+{
+  delete worker;
+  dec->unregisterSink();
+  delete output_sink;
+  delete dec;
+} /* AudioDecoderWorker::~AudioDecoderWorker */
+
+
+void AudioDecoderWorker::setOption(const std::string &name,
+                                   const std::string &value)
+{
+  auto job = worker->newJob(AudioCodecJob::OPTION);
+  job->name = name;
+  job->value = value;
+  worker->submit(job);
+} /* AudioDecoderWorker::setOption */
+
+
+void AudioDecoderWorker::printCodecParams(void) const
+{
+  worker->submit(worker->newJob(AudioCodecJob::PRINT_PARAMS));
+} /* AudioDecoderWorker::printCodecParams */
+
+
+void AudioDecoderWorker::writeEncodedSamples(void *buf, int size)
+{
+  auto job = worker->newJob(AudioCodecJob::ENCODED);
+  const uint8_t *ptr = static_cast<const uint8_t*>(buf);
+  job->data.assign(ptr, ptr + size);
+  worker->submit(job);
+} /* AudioDecoderWorker::writeEncodedSamples */
+
+
+void AudioDecoderWorker::flushEncodedSamples(void)
+{
+  worker->submit(worker->newJob(AudioCodecJob::FLUSH));
+} /* AudioDecoderWorker::flushEncodedSamples */
+
+
+void AudioDecoderWorker::concealLostSamples(int count, const void *next_buf,
+                                            int next_size)
+{
+  auto job = worker->newJob(AudioCodecJob::CONCEAL);
+  job->count = count;
+  if ((next_buf != nullptr) && (next_size > 0))
+  {
+    const uint8_t *ptr = static_cast<const uint8_t*>(next_buf);
+    job->data.assign(ptr, ptr + next_size);
+  }
+  worker->submit(job);
+} /* AudioDecoderWorker::concealLostSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioDecoderWorker::processJob(AudioCodecJob *job)
+{
+  switch (job->type)
+  {
+    case AudioCodecJob::ENCODED:
+      dec->writeEncodedSamples(job->data.data(), job->data.size());
+      break;
+    case AudioCodecJob::FLUSH:
+      dec->flushEncodedSamples();
+      break;
+    case AudioCodecJob::CONCEAL:
+      if (job->data.empty())
+      {
+        dec->concealLostSamples(job->count);
+      }
+      else
+      {
+        dec->concealLostSamples(job->count, job->data.data(),
+                                job->data.size());
+      }
+      break;
+    case AudioCodecJob::OPTION:
+      dec->setOption(job->name, job->value);
+      break;
+    case AudioCodecJob::PRINT_PARAMS:
+      dec->printCodecParams();
+      break;
+    default:
+      break;
+  }
+} /* AudioDecoderWorker::processJob */
+
+
+void AudioDecoderWorker::jobDone(AudioCodecJob *job)
+{
+  switch (job->type)
+  {
+    case AudioCodecJob::SAMPLES:
+      sinkWriteSamples(job->samples.data(), job->samples.size());
+      break;
+    case AudioCodecJob::FLUSH:
+      sinkFlushSamples();
+      break;
+    default:
+      break;
+  }
+} /* AudioDecoderWorker::jobDone */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,203 @@
+/**
+@file   AsyncAudioDecoderWorker.h
+@brief  An audio decoder that run another decoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_DECODER_WORKER_INCLUDED
+#define ASYNC_AUDIO_DECODER_WORKER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioDecoder.h>
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class AudioCodecWorker;
+struct AudioCodecJob;
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	An audio decoder that run another decoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class wraps another audio decoder so that the decoding is done in a
+separate thread. It can be used in place of the wrapped decoder to move CPU
+heavy decoding out of the main thread. Encoded audio, packet loss concealment
+requests and flush requests are copied to preallocated buffers and handed
+over to the worker thread in order. The decoded audio is written to the sink
+of this object from the main thread. A flush is passed on to the sink when
+all audio written before it has been decoded and the allEncodedSamplesFlushed
+signal is emitted when the sink is done flushing, just like for any other
+decoder.
+
+Example:
+
+  AudioDecoder *dec = new AudioDecoderWorker(AudioDecoder::create("OPUS"));
+*/
+class AudioDecoderWorker : public AudioDecoder
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	dec The decoder to run in the worker thread
+     *
+     * The ownership of the given decoder is transferred to this object.
+     */
+    explicit AudioDecoderWorker(AudioDecoder *dec);
+  
+    /**
+     * @brief 	Destructor
+     */
+    virtual ~AudioDecoderWorker(void);
+  
+    /**
+     * @brief   Get the name of the codec
+     * @returns Return the name of the wrapped codec
+     */
+    virtual const char *name(void) const { return dec->name(); }
+  
+    /**
+     * @brief 	Set an option for the decoder
+     * @param 	name The name of the option
+     * @param 	value The value of the option
+     */
+    virtual void setOption(const std::string &name, const std::string &value);
+
+    /**
+     * @brief Print codec parameter settings
+     */
+    virtual void printCodecParams(void) const;
+    
+    /**
+     * @brief 	Write encoded samples into the decoder
+     * @param 	buf  Buffer containing encoded samples
+     * @param 	size The size of the buffer
+     */
+    virtual void writeEncodedSamples(void *buf, int size);
+    
+    /**
+     * @brief Call this function when all encoded samples have been received
+     */
+    virtual void flushEncodedSamples(void);
+
+    /**
+     * @brief   Generate audio to cover up for lost encoded samples
+     * @param   count     The number of samples that was lost
+     * @param   next_buf  The packet following the lost one, if available
+     * @param   next_size The size of the next packet
+     *
+     * See AudioDecoder::concealLostSamples for details.
+     */
+    virtual void concealLostSamples(int count, const void *next_buf=nullptr,
+                                    int next_size=0);
+    
+  private:
+    class OutputSink;
+
+    AudioDecoder      *dec;
+    OutputSink        *output_sink;
+    AudioCodecWorker  *worker;
+
+    AudioDecoderWorker(const AudioDecoderWorker&);
+    AudioDecoderWorker& operator=(const AudioDecoderWorker&);
+    void processJob(AudioCodecJob *job);
+    void jobDone(AudioCodecJob *job);
+
+};  /* class AudioDecoderWorker */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_DECODER_WORKER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
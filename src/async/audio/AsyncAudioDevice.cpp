@@ -77,6 +77,18 @@ using namespace Async;
  *
  ****************************************************************************/
 
+  // The sample conversion kernels are compiled for both the baseline
+  // instruction set and AVX2 when the toolchain support function multi
+  // versioning. The best version is chosen at load time.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__) && \
+    defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef SIMD_CLONES
+#define SIMD_CLONES
+#endif
 
 
 /****************************************************************************
@@ -93,6 +105,156 @@ using namespace Async;
  *
  ****************************************************************************/
 
+namespace {
+  /*
+   * The loops below are written so that the compiler can vectorize them.
+   * Number of channels is a template parameter for the common mono and
+   * stereo cases so that the interleaving can be done using vector
+   * shuffles. CH=0 means that the channel count is given at runtime.
+   */
+  inline float clampf(float x, float lo, float hi)
+  {
+    x = (x < lo) ? lo : x;
+    return (x > hi) ? hi : x;
+  }
+
+  template <typename T> struct Sample;
+
+  template <> struct Sample<int16_t>
+  {
+    static float toFloat(int16_t s) { return s * (1.0f / 32768.0f); }
+    static int16_t fromFloat(float s)
+    {
+      return static_cast<int16_t>(clampf(32767.0f * s, -32767.0f, 32767.0f));
+    }
+  };
+
+  template <> struct Sample<int32_t>
+  {
+    static float toFloat(int32_t s) { return s * (1.0f / 2147483648.0f); }
+    static int32_t fromFloat(float s)
+    {
+        // 2147483520 is the largest float that fit in an int32_t
+      return static_cast<int32_t>(
+          clampf(2147483648.0f * s, -2147483648.0f, 2147483520.0f));
+    }
+  };
+
+  template <> struct Sample<float>
+  {
+    static float toFloat(float s) { return s; }
+    static float fromFloat(float s) { return clampf(s, -1.0f, 1.0f); }
+  };
+
+  template <typename T, size_t CH>
+  SIMD_CLONES
+  void deinterleave(float *__restrict dst, const T *__restrict src,
+                    size_t channels, size_t cnt)
+  {
+    const size_t stride = (CH > 0) ? CH : channels;
+    for (size_t i=0; i<cnt; ++i)
+    {
+      dst[i] = Sample<T>::toFloat(src[i * stride]);
+    }
+  }
+
+  template <typename T>
+  void deinterleave(float *dst, const T *src, size_t channels, size_t ch,
+                    size_t cnt)
+  {
+    switch (channels)
+    {
+      case 1:
+        deinterleave<T, 1>(dst, src + ch, channels, cnt);
+        break;
+      case 2:
+        deinterleave<T, 2>(dst, src + ch, channels, cnt);
+        break;
+      default:
+        deinterleave<T, 0>(dst, src + ch, channels, cnt);
+        break;
+    }
+  }
+
+  template <typename T, size_t CH>
+  SIMD_CLONES
+  void interleave(T *__restrict dst, const float *__restrict src,
+                  size_t channels, size_t cnt)
+  {
+    const size_t stride = (CH > 0) ? CH : channels;
+    for (size_t i=0; i<cnt; ++i)
+    {
+      for (size_t ch=0; ch<stride; ++ch)
+      {
+        dst[i * stride + ch] = Sample<T>::fromFloat(src[ch * cnt + i]);
+      }
+    }
+  }
+
+  template <typename T>
+  void interleave(T *dst, const float *src, size_t channels, size_t cnt)
+  {
+    switch (channels)
+    {
+      case 1:
+        interleave<T, 1>(dst, src, channels, cnt);
+        break;
+      case 2:
+        interleave<T, 2>(dst, src, channels, cnt);
+        break;
+      default:
+        interleave<T, 0>(dst, src, channels, cnt);
+        break;
+    }
+  }
+
+  SIMD_CLONES
+  void mixSamples(float *__restrict dst, const float *__restrict src,
+                  size_t cnt)
+  {
+    for (size_t i=0; i<cnt; ++i)
+    {
+      dst[i] += src[i];
+    }
+  }
+
+    // Convert one channel of interleaved samples to float
+  void toFloat(float *dst, const void *src, AudioDevice::SampleFormat fmt,
+               size_t channels, size_t ch, size_t cnt)
+  {
+    switch (fmt)
+    {
+      case AudioDevice::FMT_S16:
+        deinterleave(dst, static_cast<const int16_t*>(src), channels, ch, cnt);
+        break;
+      case AudioDevice::FMT_S32:
+        deinterleave(dst, static_cast<const int32_t*>(src), channels, ch, cnt);
+        break;
+      case AudioDevice::FMT_FLOAT:
+        deinterleave(dst, static_cast<const float*>(src), channels, ch, cnt);
+        break;
+    }
+  }
+
+    // Convert one buffer per channel to interleaved, clipped samples
+  void fromFloat(void *dst, const float *src, AudioDevice::SampleFormat fmt,
+                 size_t channels, size_t cnt)
+  {
+    switch (fmt)
+    {
+      case AudioDevice::FMT_S16:
+        interleave(static_cast<int16_t*>(dst), src, channels, cnt);
+        break;
+      case AudioDevice::FMT_S32:
+        interleave(static_cast<int32_t*>(dst), src, channels, cnt);
+        break;
+      case AudioDevice::FMT_FLOAT:
+        interleave(static_cast<float*>(dst), src, channels, cnt);
+        break;
+    }
+  }
+} /* namespace */
+
 
 
 /****************************************************************************
@@ -115,6 +277,7 @@ int AudioDevice::sample_rate = DEFAULT_SAMPLE_RATE;
 size_t AudioDevice::block_size_hint = DEFAULT_BLOCK_SIZE_HINT;
 size_t AudioDevice::block_count_hint = DEFAULT_BLOCK_COUNT_HINT;
 size_t AudioDevice::channels = DEFAULT_CHANNELS;
+int AudioDevice::realtime_prio = 0;
 
 
 
@@ -266,22 +429,44 @@ AudioDevice::~AudioDevice(void)
 } /* AudioDevice::~AudioDevice */
 
 
-void AudioDevice::putBlocks(int16_t *buf, size_t frame_cnt)
+size_t AudioDevice::sampleSize(SampleFormat fmt)
+{
+  switch (fmt)
+  {
+    case FMT_S16:
+      return sizeof(int16_t);
+    case FMT_S32:
+      return sizeof(int32_t);
+    case FMT_FLOAT:
+      return sizeof(float);
+  }
+  return 0;
+} /* AudioDevice::sampleSize */
+
+
+void AudioDevice::putBlocks(const void *buf, size_t frame_cnt,
+                            SampleFormat fmt)
 {
   //printf("putBlocks: frame_cnt=%zu\n", frame_cnt);
-  float samples[frame_cnt];
+  if (in_buf.size() < frame_cnt)
+  {
+    in_buf.resize(frame_cnt);
+  }
+  float *samples = in_buf.data();
   for (size_t ch=0; ch<channels; ch++)
   {
-    for (size_t i=0; i<frame_cnt; i++)
-    {
-        // no divisions in index calculation (embedded system performance !!!)
-      samples[i] = static_cast<float>(buf[i * channels + ch]) / 32768.0;
-    }
+      // Only convert channels that someone is listening to
+    bool is_converted = false;
     list<AudioIO*>::iterator it;
     for (it=aios.begin(); it!=aios.end(); ++it)
     {
       if ((*it)->channel() == ch)
       {
+        if (!is_converted)
+        {
+          toFloat(samples, buf, fmt, channels, ch, frame_cnt);
+          is_converted = true;
+        }
         (*it)->audioRead(samples, frame_cnt);
       }
     }
@@ -289,11 +474,10 @@ void AudioDevice::putBlocks(int16_t *buf, size_t frame_cnt)
 } /* AudioDevice::putBlocks */
 
 
-size_t AudioDevice::getBlocks(int16_t *buf, size_t block_cnt)
+size_t AudioDevice::getBlocks(void *buf, size_t block_cnt, SampleFormat fmt)
 {
   size_t block_size = writeBlocksize();
   size_t frames_to_write = block_cnt * block_size;
-  memset(buf, 0, channels * frames_to_write * sizeof(*buf));
   
     // Loop through all AudioIO objects and find out if they have any
     // samples to write and how many. The non-flushing AudioIO object with
@@ -345,48 +529,41 @@ size_t AudioDevice::getBlocks(int16_t *buf, size_t block_cnt)
     // object to provide us with some.
   if (frames_to_write == 0)
   {
+    memset(buf, 0, channels * block_cnt * block_size * sampleSize(fmt));
     return 0;
   }
-  
-    // Fill the sample buffer with samples from the non-idle AudioIO objects.
+
+    // If flushing and the number of frames to write is not an even
+    // multiple of the frag size, round the number of frags to write
+    // up. The end of the mix buffer is zeroed out.
+  size_t frames_to_convert = frames_to_write;
+  if (do_flush && (frames_to_convert % block_size > 0))
+  {
+    frames_to_convert /= block_size;
+    frames_to_convert = (frames_to_convert + 1) * block_size;
+  }
+
+    // Mix the samples from the non-idle AudioIO objects into one buffer per
+    // channel. Clipping is done once when converting to the device format.
+  mix_buf.assign(channels * frames_to_convert, 0.0f);
+  if (out_buf.size() < frames_to_write)
+  {
+    out_buf.resize(frames_to_write);
+  }
   for (it=aios.begin(); it!=aios.end(); ++it)
   {
     if (!(*it)->isIdle())
     {
       size_t channel = (*it)->channel();
-      float tmp[frames_to_write];
-      int samples_read = (*it)->readSamples(tmp, frames_to_write);
+      int samples_read = (*it)->readSamples(out_buf.data(), frames_to_write);
       assert(samples_read >= 0);
-      for (size_t i=0; i<static_cast<size_t>(samples_read); ++i)
-      {
-	int buf_pos = i * channels + channel;
-	float sample = 32767.0 * tmp[i] + buf[buf_pos];
-	if (sample > 32767)
-	{
-	  buf[buf_pos] = 32767;
-	}
-	else if (sample < -32767)
-	{
-	  buf[buf_pos] = -32767;
-	}
-	else
-	{
-	  buf[buf_pos] = static_cast<int16_t>(sample);
-	}
-      }
+      mixSamples(mix_buf.data() + channel * frames_to_convert,
+                 out_buf.data(), samples_read);
     }
-  }  
-      
-    // If flushing and the number of frames to write is not an even
-    // multiple of the frag size, round the number of frags to write
-    // up. The end of the buffer is already zeroed out.
-  if (do_flush && (frames_to_write % block_size > 0))
-  {
-    frames_to_write /= block_size;
-    frames_to_write = (frames_to_write + 1) * block_size;
   }
-  
-  return frames_to_write / block_size;
+  fromFloat(buf, mix_buf.data(), fmt, channels, frames_to_convert);
+
+  return frames_to_convert / block_size;
   
 } /* AudioDevice::getBlocks */
 
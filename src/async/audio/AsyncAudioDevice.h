@@ -41,6 +41,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <string>
 #include <map>
 #include <list>
+#include <vector>
 
 
 /****************************************************************************
@@ -133,6 +134,25 @@ class AudioDevice : public sigc::trackable
       MODE_WR,	  ///< Write
       MODE_RDWR   ///< Both read and write
     } Mode;
+
+    /**
+     * @brief The sample formats that can be exchanged with a device
+     *
+     * All formats are interleaved and in native byte order.
+     */
+    typedef enum
+    {
+      FMT_S16,    ///< Signed 16 bit
+      FMT_S32,    ///< Signed 32 bit
+      FMT_FLOAT   ///< 32 bit float in the range -1.0 to 1.0
+    } SampleFormat;
+
+    /**
+     * @brief   Get the size of one sample in the given format
+     * @param   fmt The sample format
+     * @return  Returns the size in bytes of one sample
+     */
+    static size_t sampleSize(SampleFormat fmt);
   
     /**
      * @brief 	Register an AudioIO object with the given device name
@@ -234,6 +254,18 @@ class AudioDevice : public sigc::trackable
      */
     static size_t getChannels(void) { return channels; }
 
+    /**
+     * @brief   Set the real time priority of audio device threads
+     * @param   prio The SCHED_FIFO priority (1-99) or 0 to disable
+     *
+     * Audio device types that support it will do the device I/O in a
+     * separate thread running with the given real time priority. The
+     * samples are passed to and from the main thread through lock free
+     * buffers. This is a global setting so all sound cards will be affected.
+     * Already opened sound cards will not be affected.
+     */
+    static void setRealtimePriority(int prio) { realtime_prio = prio; }
+
     /**
      * @brief 	Check if the audio device has full duplex capability
      * @return	Returns \em true if the device has full duplex capability
@@ -300,6 +332,7 @@ class AudioDevice : public sigc::trackable
     static size_t       block_size_hint;
     static size_t       block_count_hint;
     static size_t       channels;
+    static int          realtime_prio;
 
     std::string       	dev_name;
     
@@ -330,20 +363,33 @@ class AudioDevice : public sigc::trackable
      * @brief   Write samples read from audio device to upper layers
      * @param   buf       Buffer containing frames of samples to write
      * @param   frame_cnt The number of frames of samples in the buffer
+     * @param   fmt       The format of the samples in the buffer
      *
      * This function is used by an audio device implementation to write audio
      * samples recorded from the actual audio device to the upper software
      * layers, for further processing. The number of samples is given as
      * frames. A frame contains one sample per channel starting with channel 0.
      * Frames are put in the buffer one after the other. Thus, the sample
-     * buffer should contain frame_cnt * channels samples.
+     * buffer should contain frame_cnt * channels samples. Only channels
+     * that have an AudioIO object associated are converted.
      */
-    void putBlocks(int16_t *buf, size_t frame_cnt);
+    void putBlocks(const void *buf, size_t frame_cnt, SampleFormat fmt);
+
+    /**
+     * @brief   Write 16 bit samples read from audio device to upper layers
+     * @param   buf       Buffer containing frames of samples to write
+     * @param   frame_cnt The number of frames of samples in the buffer
+     */
+    void putBlocks(int16_t *buf, size_t frame_cnt)
+    {
+      putBlocks(buf, frame_cnt, FMT_S16);
+    }
 
     /**
      * @brief   Read samples from upper layers to write to audio device
-     * @brief   buf       Buffer which will be filled with frames of samples
-     * @brief   block_cnt The size of the buffer counted in blocks
+     * @param   buf       Buffer which will be filled with frames of samples
+     * @param   block_cnt The size of the buffer counted in blocks
+     * @param   fmt       The format to store the samples in
      * @return  The number of blocks actually stored in the buffer
      *
      * This function is used by an audio device implementation to get samples
@@ -351,9 +397,22 @@ class AudioDevice : public sigc::trackable
      * given in blocks. The buffer must be able to store the number given in
      * block_cnt. Fewer blocks may be returned if the requested block count is
      * not available. The number of samples a block contain is
-     * ret_blocks * writeBlocksize() * channels.
+     * ret_blocks * writeBlocksize() * channels. The AudioIO objects are
+     * mixed in floating point and the result is clipped once when converted
+     * to the given format.
      */
-    size_t getBlocks(int16_t *buf, size_t block_cnt);
+    size_t getBlocks(void *buf, size_t block_cnt, SampleFormat fmt);
+
+    /**
+     * @brief   Read 16 bit samples from upper layers to write to audio device
+     * @param   buf       Buffer which will be filled with frames of samples
+     * @param   block_cnt The size of the buffer counted in blocks
+     * @return  The number of blocks actually stored in the buffer
+     */
+    size_t getBlocks(int16_t *buf, size_t block_cnt)
+    {
+      return getBlocks(buf, block_cnt, FMT_S16);
+    }
 
     /**
      * @brief   Called by the device object to indicate an error condition
@@ -372,6 +431,9 @@ class AudioDevice : public sigc::trackable
     size_t              use_count;
     std::list<AudioIO*> aios;
     Async::Timer        reopen_timer  {1000, Async::Timer::TYPE_PERIODIC};
+    std::vector<float>  in_buf;
+    std::vector<float>  out_buf;
+    std::vector<float>  mix_buf;
 
     void reopenDevice(void);
 
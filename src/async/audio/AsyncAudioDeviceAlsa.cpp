@@ -36,10 +36,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sigc++/sigc++.h>
 #include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <iostream>
 #include <sstream>
 #include <cmath>
 #include <cstring>
+#include <cerrno>
+#include <algorithm>
 
 
 /****************************************************************************
@@ -101,12 +107,14 @@ class AudioDeviceAlsa::AlsaWatch : public sigc::trackable
         if (pfds[i].events & POLLOUT)
         {
           FdWatch *watch = new FdWatch(pfds[i].fd, FdWatch::FD_WATCH_WR);
+          watch->setName("AudioDeviceAlsa::writeEvent");
           watch->activity.connect(mem_fun(*this, &AlsaWatch::writeEvent));
           watch_list.push_back(watch);
         }
         if (pfds[i].events & POLLIN)
         {
           FdWatch *watch = new FdWatch(pfds[i].fd, FdWatch::FD_WATCH_RD);
+          watch->setName("AudioDeviceAlsa::readEvent");
           watch->activity.connect(mem_fun(*this, &AlsaWatch::readEvent));
           watch_list.push_back(watch);
         }
@@ -159,12 +167,93 @@ class AudioDeviceAlsa::AlsaWatch : public sigc::trackable
 };
 
 
+/*
+ * A single producer, single consumer buffer of interleaved frames in the
+ * device sample format. The producer and consumer access contiguous regions
+ * of the buffer directly so that samples can be converted and transferred
+ * without extra copying. The size is a multiple of the block size so that
+ * regions stay block aligned as long as whole blocks are written.
+ */
+class AudioDeviceAlsa::FrameRing
+{
+  public:
+    FrameRing(size_t frames, size_t frame_size)
+      : buf(frames * frame_size), frames(frames), frame_size(frame_size),
+        head(0), tail(0)
+    {
+    }
+
+      // Number of frames available for reading
+    size_t fill(void) const
+    {
+      return head.load(std::memory_order_acquire) -
+             tail.load(std::memory_order_acquire);
+    }
+
+      // Producer: get the contiguous region free for writing
+    char *writePtr(size_t &cnt)
+    {
+      size_t h = head.load(std::memory_order_relaxed);
+      size_t t = tail.load(std::memory_order_acquire);
+      size_t pos = h % frames;
+      cnt = std::min(frames - (h - t), frames - pos);
+      return buf.data() + pos * frame_size;
+    }
+
+      // Producer: make frames written to the region visible to the consumer
+    void commitWrite(size_t cnt)
+    {
+      head.store(head.load(std::memory_order_relaxed) + cnt,
+                 std::memory_order_release);
+    }
+
+      // Consumer: get the contiguous region available for reading
+    const char *readPtr(size_t &cnt)
+    {
+      size_t t = tail.load(std::memory_order_relaxed);
+      size_t h = head.load(std::memory_order_acquire);
+      size_t pos = t % frames;
+      cnt = std::min(h - t, frames - pos);
+      return buf.data() + pos * frame_size;
+    }
+
+      // Consumer: release frames that have been read
+    void consume(size_t cnt)
+    {
+      tail.store(tail.load(std::memory_order_relaxed) + cnt,
+                 std::memory_order_release);
+    }
+
+  private:
+    std::vector<char>   buf;
+    const size_t        frames;
+    const size_t        frame_size;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+
 /****************************************************************************
  *
  * Prototypes
  *
  ****************************************************************************/
 
+namespace {
+  snd_pcm_format_t alsaFormat(AudioDevice::SampleFormat fmt)
+  {
+    switch (fmt)
+    {
+      case AudioDevice::FMT_S32:
+        return SND_PCM_FORMAT_S32;
+      case AudioDevice::FMT_FLOAT:
+        return SND_PCM_FORMAT_FLOAT;
+      default:
+        return SND_PCM_FORMAT_S16;
+    }
+  }
+} /* namespace */
+
 
 
 /****************************************************************************
@@ -195,7 +284,17 @@ AudioDeviceAlsa::AudioDeviceAlsa(const std::string& dev_name)
   : AudioDevice(dev_name), play_block_size(0), play_block_count(0),
     rec_block_size(0), rec_block_count(0), play_handle(0), 
     rec_handle(0), play_watch(0), rec_watch(0), duplex(false),
-    zerofill_on_underflow(true)
+    zerofill_on_underflow(true), formats{FMT_FLOAT, FMT_S32, FMT_S16},
+    play_format(FMT_S16), rec_format(FMT_S16), period_size(0),
+    period_count(0), use_mmap(false), play_mmap(false), rec_mmap(false),
+    tsched_interval(0), tsched_timer(0, Timer::TYPE_PERIODIC, false),
+    play_enabled(false), rec_enabled(false), play_idle(true), play_xruns(0),
+    rec_xruns(0), reported_play_xruns(0), reported_rec_xruns(0),
+    xrun_report_timer(60000, Timer::TYPE_PERIODIC, false), rt_prio(0),
+    play_ring(0), rec_ring(0), thread_running(false), thread_error(false),
+    notify_pending(false), play_active(false), play_delay(0), wake_fd(-1),
+    notify_fd(-1), notify_watch(0), play_misses(0), rec_misses(0),
+    reported_play_misses(0), reported_rec_misses(0)
 {
   assert(AudioDeviceAlsa_creator_registered);
 
@@ -205,6 +304,61 @@ AudioDeviceAlsa::AudioDeviceAlsa(const std::string& dev_name)
     istringstream(zerofill_str) >> zerofill_on_underflow;
   }
 
+  char *format_str = getenv("ASYNC_AUDIO_ALSA_FORMAT");
+  if (format_str != 0)
+  {
+    string format(format_str);
+    if (format == "S16")
+    {
+      formats = {FMT_S16};
+    }
+    else if (format == "S32")
+    {
+      formats = {FMT_S32};
+    }
+    else if (format == "FLOAT")
+    {
+      formats = {FMT_FLOAT};
+    }
+    else
+    {
+      cerr << "*** WARNING: Unknown sample format \"" << format
+           << "\" in environment variable ASYNC_AUDIO_ALSA_FORMAT. "
+           << "Valid formats are S16, S32 and FLOAT.\n";
+    }
+  }
+
+  char *period_size_str = getenv("ASYNC_AUDIO_ALSA_PERIOD_SIZE");
+  if (period_size_str != 0)
+  {
+    istringstream(period_size_str) >> period_size;
+  }
+
+  char *periods_str = getenv("ASYNC_AUDIO_ALSA_PERIODS");
+  if (periods_str != 0)
+  {
+    istringstream(periods_str) >> period_count;
+  }
+
+  char *mmap_str = getenv("ASYNC_AUDIO_ALSA_MMAP");
+  if (mmap_str != 0)
+  {
+    istringstream(mmap_str) >> use_mmap;
+  }
+
+  char *tsched_str = getenv("ASYNC_AUDIO_ALSA_TSCHED");
+  if (tsched_str != 0)
+  {
+    istringstream(tsched_str) >> tsched_interval;
+  }
+
+  tsched_timer.setName("AudioDeviceAlsa::tsched");
+  tsched_timer.expired.connect(
+      hide(mem_fun(*this, &AudioDeviceAlsa::tschedHandler)));
+  xrun_report_timer.setName("AudioDeviceAlsa::xrunReport");
+  xrun_report_timer.expired.connect(
+      hide(mem_fun(*this, &AudioDeviceAlsa::reportXruns)));
+
   snd_pcm_t *play, *capture;
 
     // Open the device to check its duplex capability
@@ -254,18 +408,28 @@ bool AudioDeviceAlsa::isFullDuplexCapable(void)
 void AudioDeviceAlsa::audioToWriteAvailable(void)
 {
   //printf("AudioDeviceAlsa::audioToWriteAvailable\n");
-  if (play_watch)
+  if (play_ring != 0)
   {
-    play_watch->setEnabled(true);
+    fillPlayRing();
+  }
+  else if (play_handle != 0)
+  {
+    setPlayEnabled(true);
   }
 } /* AudioDeviceAlsa::audioToWriteAvailable */
 
 
 void AudioDeviceAlsa::flushSamples(void)
 {
-  if (play_watch)
+    // In threaded mode the flushed samples are moved to the ring buffer
+    // right away so that samplesToWrite include them
+  if (play_ring != 0)
+  {
+    fillPlayRing();
+  }
+  else if (play_handle != 0)
   {
-    play_watch->setEnabled(true);
+    setPlayEnabled(true);
   }  
 } /* AudioDeviceAlsa::flushSamples */
 
@@ -277,6 +441,11 @@ int AudioDeviceAlsa::samplesToWrite(void) const
     return 0;
   }
 
+  if (play_ring != 0)
+  {
+    return play_ring->fill() + play_delay;
+  }
+
   int space_avail = snd_pcm_avail_update(play_handle);
   if (space_avail < 0)
   {
@@ -303,6 +472,8 @@ bool AudioDeviceAlsa::openDevice(Mode mode)
 {
   closeDevice();
 
+  rt_prio = realtime_prio;
+
   if ((mode == MODE_WR) || (mode == MODE_RDWR))
   {
     int err = snd_pcm_open(&play_handle, dev_name.c_str(),
@@ -315,7 +486,7 @@ bool AudioDeviceAlsa::openDevice(Mode mode)
       return false;
     }
 
-    if (!initParams(play_handle))
+    if (!initParams(play_handle, play_format, play_mmap))
     {
       closeDevice();
       return false;
@@ -327,10 +498,14 @@ bool AudioDeviceAlsa::openDevice(Mode mode)
       return false;
     }
 
-    play_watch = new AlsaWatch(play_handle);
-    play_watch->activity.connect(
-            mem_fun(*this, &AudioDeviceAlsa::writeSpaceAvailable));
-    play_watch->setEnabled(true);
+    if ((tsched_interval == 0) && (rt_prio <= 0))
+    {
+      play_watch = new AlsaWatch(play_handle);
+      play_watch->activity.connect(
+              mem_fun(*this, &AudioDeviceAlsa::writeSpaceAvailable));
+    }
+    play_idle = true;
+    setPlayEnabled(true);
 
     if (!startPlayback(play_handle))
     {
@@ -352,7 +527,7 @@ bool AudioDeviceAlsa::openDevice(Mode mode)
       return false;
     }
 
-    if (!initParams(rec_handle))
+    if (!initParams(rec_handle, rec_format, rec_mmap))
     {
       closeDevice();
       return false;
@@ -364,9 +539,13 @@ bool AudioDeviceAlsa::openDevice(Mode mode)
       return false;
     }
 
-    rec_watch = new AlsaWatch(rec_handle);
-    rec_watch->activity.connect(
-            mem_fun(*this, &AudioDeviceAlsa::audioReadHandler));
+    if ((tsched_interval == 0) && (rt_prio <= 0))
+    {
+      rec_watch = new AlsaWatch(rec_handle);
+      rec_watch->activity.connect(
+              mem_fun(*this, &AudioDeviceAlsa::audioReadHandler));
+    }
+    setRecEnabled(true);
 
     if (!startCapture(rec_handle))
     {
@@ -376,6 +555,21 @@ bool AudioDeviceAlsa::openDevice(Mode mode)
     }
   }
 
+  if (rt_prio > 0)
+  {
+    if (!startAudioThread())
+    {
+      closeDevice();
+      return false;
+    }
+  }
+  else if (tsched_interval > 0)
+  {
+    tsched_timer.setTimeout(tsched_interval);
+    tsched_timer.setEnable(true);
+  }
+  xrun_report_timer.setEnable(true);
+
   return true;
 
 } /* AudioDeviceAlsa::openDevice */
@@ -383,6 +577,13 @@ bool AudioDeviceAlsa::openDevice(Mode mode)
 
 void AudioDeviceAlsa::closeDevice(void)
 {
+  stopAudioThread();
+  tsched_timer.setEnable(false);
+  xrun_report_timer.setEnable(false);
+  reportXruns();
+  play_enabled = false;
+  rec_enabled = false;
+
   if (play_handle != 0)
   {
     snd_pcm_close(play_handle);
@@ -433,9 +634,10 @@ void AudioDeviceAlsa::audioReadHandler(FdWatch *watch, unsigned short revents)
   snd_pcm_sframes_t frames_avail = snd_pcm_avail_update(rec_handle);
   if (frames_avail < 0)
   {
+    countXrun(rec_handle, frames_avail);
     if (!startCapture(rec_handle))
     {
-      watch->setEnabled(false);
+      setRecEnabled(false);
     }
     return;
   }
@@ -447,22 +649,37 @@ void AudioDeviceAlsa::audioReadHandler(FdWatch *watch, unsigned short revents)
     frames_avail /= rec_block_size;
     frames_avail *= rec_block_size;
 
-    int16_t buf[frames_avail * channels];
-    memset(buf, 0, sizeof(buf));
+    snd_pcm_sframes_t frames_read = 0;
+    if (rec_mmap)
+    {
+      frames_read = readMmap(frames_avail);
+    }
+    else
+    {
+      const size_t buf_size =
+        frames_avail * channels * sampleSize(rec_format);
+      if (rec_buf.size() < buf_size)
+      {
+        rec_buf.resize(buf_size);
+      }
+      char *buf = rec_buf.data();
 
-    const auto frames_read = snd_pcm_readi(rec_handle, buf, frames_avail);
-    if (frames_read < 0)
+      frames_read = snd_pcm_readi(rec_handle, buf, frames_avail);
+      if (frames_read > 0)
+      {
+        assert(frames_read <= frames_avail);
+        putBlocks(buf, frames_read, rec_format);
+      }
+    }
+    if ((frames_read < 0) && (rec_handle != 0))
     {
+      countXrun(rec_handle, frames_read);
       if (!startCapture(rec_handle))
       {
         setDeviceError();
-        watch->setEnabled(false);
+        setRecEnabled(false);
       }
-      return;
     }
-    assert(frames_read <= frames_avail);
-
-    putBlocks(buf, frames_read);
   }
 } /* AudioDeviceAlsa::audioReadHandler */
 
@@ -495,10 +712,11 @@ void AudioDeviceAlsa::writeSpaceAvailable(FdWatch *watch, unsigned short revents
       // Bail out if there's an error
     if (space_avail < 0)
     {
+      countXrun(play_handle, space_avail);
       if (!startPlayback(play_handle))
       {
         setDeviceError();
-        watch->setEnabled(false);
+        setPlayEnabled(false);
         return;
       }
       continue;
@@ -511,34 +729,89 @@ void AudioDeviceAlsa::writeSpaceAvailable(FdWatch *watch, unsigned short revents
       return;
     }
 
-    int16_t buf[space_avail * channels];
-        
-    int blocks_avail = getBlocks(buf, blocks_to_read);
+    const size_t frame_size = channels * sampleSize(play_format);
+    char *buf = 0;
+    snd_pcm_uframes_t mmap_offset = 0;
+    if (play_mmap)
+    {
+        // Convert the samples directly into the device buffer
+      const snd_pcm_channel_area_t *areas;
+      snd_pcm_uframes_t frames = blocks_to_read * play_block_size;
+      int err = snd_pcm_mmap_begin(play_handle, &areas, &mmap_offset,
+                                   &frames);
+      if (err < 0)
+      {
+        countXrun(play_handle, err);
+        if (!startPlayback(play_handle))
+        {
+          setDeviceError();
+          setPlayEnabled(false);
+          return;
+        }
+        continue;
+      }
+      buf = static_cast<char*>(areas[0].addr) +
+            (areas[0].first + mmap_offset * areas[0].step) / 8;
+      blocks_to_read = frames / play_block_size;
+      if (blocks_to_read == 0)
+      {
+          // The end of the device buffer is not block aligned. Fill up to
+          // the end with silence to get aligned again.
+        memset(buf, 0, frames * frame_size);
+        snd_pcm_mmap_commit(play_handle, mmap_offset, frames);
+        continue;
+      }
+    }
+    else
+    {
+      if (play_buf.size() < space_avail * frame_size)
+      {
+        play_buf.resize(space_avail * frame_size);
+      }
+      buf = play_buf.data();
+    }
+
+    int blocks_avail = getBlocks(buf, blocks_to_read, play_format);
     if (blocks_avail == 0) 
     {
       if (zerofill_on_underflow)
       {
         blocks_avail = 1;
-        memset(buf, 0, blocks_avail * play_block_size);
+        memset(buf, 0, blocks_avail * play_block_size * frame_size);
       }
       else
       {
-        watch->setEnabled(false);
+        play_idle = true;
+        setPlayEnabled(false);
         return;
       }
     }
+    else
+    {
+      play_idle = false;
+    }
     
     int frames_to_write = blocks_avail * play_block_size;
-    int frames_written = snd_pcm_writei(play_handle, buf, frames_to_write);
+    int frames_written;
+    if (play_mmap)
+    {
+      frames_written = snd_pcm_mmap_commit(play_handle, mmap_offset,
+                                           frames_to_write);
+    }
+    else
+    {
+      frames_written = snd_pcm_writei(play_handle, buf, frames_to_write);
+    }
     //printf("frames_avail=%d  blocks_avail=%d  blocks_gotten=%d "
     //       "frames_written=%d\n", (int)frames_avail, blocks_avail,
     //       blocks_gotten, (int)frames_written);
     if (frames_written < 0)
     {
+      countXrun(play_handle, frames_written);
       if (!startPlayback(play_handle))
       {
         setDeviceError();
-        watch->setEnabled(false);
+        setPlayEnabled(false);
         return;
       }
       continue;
@@ -553,7 +826,10 @@ void AudioDeviceAlsa::writeSpaceAvailable(FdWatch *watch, unsigned short revents
       return;
     }
     
-    if (frames_to_write != space_avail)
+      // Return if there were not enough audio available to fill up all the
+      // space. With mmap access, the space may continue at the beginning of
+      // the device buffer.
+    if (static_cast<size_t>(blocks_avail) < blocks_to_read)
     {
       return;
     }
@@ -561,7 +837,8 @@ void AudioDeviceAlsa::writeSpaceAvailable(FdWatch *watch, unsigned short revents
 } /* AudioDeviceAlsa::writeSpaceAvailable */
 
 
-bool AudioDeviceAlsa::initParams(snd_pcm_t *pcm_handle)
+bool AudioDeviceAlsa::initParams(snd_pcm_t *pcm_handle, SampleFormat &fmt,
+                                 bool &mmap)
 {
   snd_pcm_hw_params_t* hw_params = nullptr;
 
@@ -584,8 +861,17 @@ bool AudioDeviceAlsa::initParams(snd_pcm_t *pcm_handle)
     return false;
   }
 
+  mmap = use_mmap && (rt_prio <= 0);
+  if (mmap && (snd_pcm_hw_params_test_access(pcm_handle, hw_params,
+                  SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0))
+  {
+    cerr << "*** WARNING: Alsa device \"" << dev_name << "\" does not "
+            "support memory mapped access. Falling back to read/write "
+            "access.\n";
+    mmap = false;
+  }
   err = snd_pcm_hw_params_set_access(pcm_handle, hw_params,
-				     SND_PCM_ACCESS_RW_INTERLEAVED);
+      mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED);
   if (err < 0)
   {
     cerr << "*** ERROR: Set access type failed: "
@@ -595,8 +881,19 @@ bool AudioDeviceAlsa::initParams(snd_pcm_t *pcm_handle)
     return false;
   }
 
-  err = snd_pcm_hw_params_set_format(pcm_handle, hw_params,
-				     SND_PCM_FORMAT_S16_LE);
+    // Use the first sample format in the list of preferred formats that the
+    // device support
+  fmt = formats.front();
+  for (const auto& f : formats)
+  {
+    if (snd_pcm_hw_params_test_format(pcm_handle, hw_params,
+                                      alsaFormat(f)) == 0)
+    {
+      fmt = f;
+      break;
+    }
+  }
+  err = snd_pcm_hw_params_set_format(pcm_handle, hw_params, alsaFormat(fmt));
   if (err < 0)
   {
     cerr << "*** ERROR: Set sample format failed: "
@@ -638,9 +935,28 @@ bool AudioDeviceAlsa::initParams(snd_pcm_t *pcm_handle)
     return false;
   }
 
-  snd_pcm_uframes_t period_size = block_size_hint;
+  if (mmap)
+  {
+      // Whole periods in the buffer keep the blocks aligned to the end of
+      // the memory mapped buffer
+    err = snd_pcm_hw_params_set_periods_integer(pcm_handle, hw_params);
+    if (err < 0)
+    {
+      cerr << "*** ERROR: Set integer number of periods failed: "
+           << snd_strerror(err)
+           << endl;
+      snd_pcm_hw_params_free (hw_params);
+      return false;
+    }
+  }
+
+  snd_pcm_uframes_t req_period_size =
+    (period_size > 0) ? period_size : block_size_hint;
+  snd_pcm_uframes_t req_period_count =
+    (period_count > 0) ? period_count : block_count_hint;
+  snd_pcm_uframes_t ret_period_size = req_period_size;
   err = snd_pcm_hw_params_set_period_size_near(pcm_handle, hw_params,
-					       &period_size, 0);
+					       &ret_period_size, 0);
   if (err < 0)
   {
     cerr << "*** ERROR: Set period size failed: "
@@ -650,7 +966,7 @@ bool AudioDeviceAlsa::initParams(snd_pcm_t *pcm_handle)
     return false;
   }
   
-  snd_pcm_uframes_t buffer_size = block_count_hint * block_size_hint;
+  snd_pcm_uframes_t buffer_size = req_period_count * req_period_size;
   err = snd_pcm_hw_params_set_buffer_size_near(pcm_handle, hw_params,
 					       &buffer_size);
   if (err < 0)
@@ -672,7 +988,7 @@ bool AudioDeviceAlsa::initParams(snd_pcm_t *pcm_handle)
     return false;
   }
 
-  snd_pcm_uframes_t ret_period_size, ret_buffer_size;
+  snd_pcm_uframes_t ret_buffer_size;
   snd_pcm_hw_params_get_period_size(hw_params, &ret_period_size, 0);
   snd_pcm_hw_params_get_buffer_size(hw_params, &ret_buffer_size);
 
@@ -820,6 +1136,510 @@ bool AudioDeviceAlsa::startCapture(snd_pcm_t *pcm_handle)
 } /* AudioDeviceAlsa::startCapture */
 
 
+void AudioDeviceAlsa::setPlayEnabled(bool enable)
+{
+  play_enabled = enable;
+  if (play_watch != 0)
+  {
+    play_watch->setEnabled(enable);
+  }
+} /* AudioDeviceAlsa::setPlayEnabled */
+
+
+void AudioDeviceAlsa::setRecEnabled(bool enable)
+{
+  rec_enabled = enable;
+  if (rec_watch != 0)
+  {
+    rec_watch->setEnabled(enable);
+  }
+} /* AudioDeviceAlsa::setRecEnabled */
+
+
+void AudioDeviceAlsa::countXrun(snd_pcm_t *pcm_handle, int err)
+{
+  if (err != -EPIPE)
+  {
+    return;
+  }
+
+    // The playback buffer is expected to run empty when there is no more
+    // audio to write and zero filling is disabled
+  if ((pcm_handle == play_handle) && !play_idle)
+  {
+    ++play_xruns;
+  }
+  else if (pcm_handle == rec_handle)
+  {
+    ++rec_xruns;
+  }
+} /* AudioDeviceAlsa::countXrun */
+
+
+snd_pcm_sframes_t AudioDeviceAlsa::readMmap(snd_pcm_uframes_t frames)
+{
+  snd_pcm_uframes_t frames_left = frames;
+  while (frames_left > 0)
+  {
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frame_cnt = frames_left;
+    int err = snd_pcm_mmap_begin(rec_handle, &areas, &offset, &frame_cnt);
+    if (err < 0)
+    {
+      return err;
+    }
+    if (frame_cnt == 0)
+    {
+      break;
+    }
+
+      // Convert the samples directly from the device buffer
+    const char *buf = static_cast<const char*>(areas[0].addr) +
+                      (areas[0].first + offset * areas[0].step) / 8;
+    putBlocks(buf, frame_cnt, rec_format);
+    if (rec_handle == 0)
+    {
+      return 0;
+    }
+
+    snd_pcm_sframes_t frames_committed =
+      snd_pcm_mmap_commit(rec_handle, offset, frame_cnt);
+    if (frames_committed < 0)
+    {
+      return frames_committed;
+    }
+    if (static_cast<snd_pcm_uframes_t>(frames_committed) != frame_cnt)
+    {
+      return -EPIPE;
+    }
+    frames_left -= frame_cnt;
+  }
+  return frames - frames_left;
+} /* AudioDeviceAlsa::readMmap */
+
+
+void AudioDeviceAlsa::tschedHandler(void)
+{
+  if ((rec_handle != 0) && rec_enabled)
+  {
+    audioReadHandler(0, POLLIN);
+  }
+  if ((play_handle != 0) && play_enabled)
+  {
+    writeSpaceAvailable(0, POLLOUT);
+  }
+} /* AudioDeviceAlsa::tschedHandler */
+
+
+void AudioDeviceAlsa::reportXruns(void)
+{
+  const unsigned play_xrun_cnt = play_xruns;
+  const unsigned rec_xrun_cnt = rec_xruns;
+  if ((play_xrun_cnt != reported_play_xruns) ||
+      (rec_xrun_cnt != reported_rec_xruns))
+  {
+    cerr << "*** WARNING: Alsa device \"" << dev_name << "\": "
+         << (play_xrun_cnt - reported_play_xruns) << " playback underruns and "
+         << (rec_xrun_cnt - reported_rec_xruns) << " capture overruns since "
+         << "the last report (" << play_xrun_cnt << " and " << rec_xrun_cnt
+         << " in total)" << endl;
+    reported_play_xruns = play_xrun_cnt;
+    reported_rec_xruns = rec_xrun_cnt;
+  }
+
+  const unsigned play_miss_cnt = play_misses;
+  const unsigned rec_miss_cnt = rec_misses;
+  if ((play_miss_cnt != reported_play_misses) ||
+      (rec_miss_cnt != reported_rec_misses))
+  {
+    cerr << "*** WARNING: Alsa device \"" << dev_name << "\": "
+         << (play_miss_cnt - reported_play_misses) << " playback and "
+         << (rec_miss_cnt - reported_rec_misses) << " capture deadline "
+         << "misses in the main thread since the last report ("
+         << play_miss_cnt << " and " << rec_miss_cnt << " in total)" << endl;
+    reported_play_misses = play_miss_cnt;
+    reported_rec_misses = rec_miss_cnt;
+  }
+} /* AudioDeviceAlsa::reportXruns */
+
+
+bool AudioDeviceAlsa::startAudioThread(void)
+{
+  wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if ((wake_fd < 0) || (notify_fd < 0))
+  {
+    cerr << "*** ERROR: Could not create eventfd for Alsa device \""
+         << dev_name << "\": " << strerror(errno) << endl;
+    return false;
+  }
+  notify_watch = new FdWatch(notify_fd, FdWatch::FD_WATCH_RD);
+  notify_watch->setName("AudioDeviceAlsa::threadNotified");
+  notify_watch->activity.connect(
+          mem_fun(*this, &AudioDeviceAlsa::threadNotified));
+
+  if (play_handle != 0)
+  {
+    const size_t frame_size = channels * sampleSize(play_format);
+    play_ring = new FrameRing(play_block_count * play_block_size, frame_size);
+    play_buf.assign(play_block_size * frame_size, 0);
+    play_active = false;
+    play_delay = 0;
+  }
+  if (rec_handle != 0)
+  {
+      // Make room for a couple of device buffers since it is only drained
+      // when the main thread is available
+    const size_t frame_size = channels * sampleSize(rec_format);
+    rec_ring = new FrameRing(4 * rec_block_count * rec_block_size,
+                             frame_size);
+    rec_buf.resize(rec_block_count * rec_block_size * frame_size);
+  }
+
+  thread_error = false;
+  notify_pending = false;
+  thread_running = true;
+  audio_thread = std::thread(&AudioDeviceAlsa::audioThreadFunc, this);
+
+  return true;
+} /* AudioDeviceAlsa::startAudioThread */
+
+
+void AudioDeviceAlsa::stopAudioThread(void)
+{
+  if (audio_thread.joinable())
+  {
+    thread_running = false;
+    uint64_t cnt = 1;
+    if (write(wake_fd, &cnt, sizeof(cnt)) < 0)
+    {
+      cerr << "*** ERROR: Could not write to eventfd for Alsa device \""
+           << dev_name << "\": " << strerror(errno) << endl;
+    }
+    audio_thread.join();
+  }
+
+  delete notify_watch;
+  notify_watch = 0;
+  if (notify_fd >= 0)
+  {
+    ::close(notify_fd);
+    notify_fd = -1;
+  }
+  if (wake_fd >= 0)
+  {
+    ::close(wake_fd);
+    wake_fd = -1;
+  }
+
+  delete play_ring;
+  play_ring = 0;
+  delete rec_ring;
+  rec_ring = 0;
+} /* AudioDeviceAlsa::stopAudioThread */
+
+
+void AudioDeviceAlsa::audioThreadFunc(void)
+{
+  sched_param param;
+  param.sched_priority = rt_prio;
+  int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (err != 0)
+  {
+    cerr << "*** WARNING: Could not set real time priority " << rt_prio
+         << " for the audio thread of Alsa device \"" << dev_name << "\": "
+         << strerror(err) << ". Running with normal priority." << endl;
+  }
+
+  int play_nfds = (play_handle != 0)
+    ? snd_pcm_poll_descriptors_count(play_handle) : 0;
+  int rec_nfds = (rec_handle != 0)
+    ? snd_pcm_poll_descriptors_count(rec_handle) : 0;
+  std::vector<pollfd> pfds(1 + play_nfds + rec_nfds);
+  pfds[0].fd = wake_fd;
+  pfds[0].events = POLLIN;
+  pollfd *play_pfds = &pfds[1];
+  pollfd *rec_pfds = &pfds[1 + play_nfds];
+  if (play_nfds > 0)
+  {
+    snd_pcm_poll_descriptors(play_handle, play_pfds, play_nfds);
+  }
+  if (rec_nfds > 0)
+  {
+    snd_pcm_poll_descriptors(rec_handle, rec_pfds, rec_nfds);
+  }
+
+  while (thread_running)
+  {
+    int ret = poll(pfds.data(), pfds.size(), 100);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      cerr << "*** ERROR: poll failed in the audio thread of Alsa device \""
+           << dev_name << "\": " << strerror(errno) << endl;
+      break;
+    }
+    if (!thread_running)
+    {
+      break;
+    }
+
+    bool ok = true;
+    unsigned short revents = 0;
+    if (rec_nfds > 0)
+    {
+      snd_pcm_poll_descriptors_revents(rec_handle, rec_pfds, rec_nfds,
+                                       &revents);
+      if (revents & (POLLIN | POLLERR))
+      {
+        ok = threadCapture();
+      }
+    }
+    if (ok && (play_nfds > 0))
+    {
+      snd_pcm_poll_descriptors_revents(play_handle, play_pfds, play_nfds,
+                                       &revents);
+      if (revents & (POLLOUT | POLLERR))
+      {
+        ok = threadPlayback();
+      }
+    }
+    if (!ok)
+    {
+      break;
+    }
+    if (ret > 0)
+    {
+      notifyMainThread();
+    }
+  }
+
+  if (thread_running)
+  {
+      // The thread stopped by itself so the device need to be reopened
+    thread_error = true;
+    notifyMainThread();
+  }
+} /* AudioDeviceAlsa::audioThreadFunc */
+
+
+bool AudioDeviceAlsa::threadCapture(void)
+{
+  const auto pcm_state = snd_pcm_state(rec_handle);
+  if ((pcm_state < 0) || (pcm_state == SND_PCM_STATE_DISCONNECTED))
+  {
+    return false;
+  }
+
+  snd_pcm_sframes_t frames_avail = snd_pcm_avail_update(rec_handle);
+  if (frames_avail < 0)
+  {
+    if (frames_avail == -EPIPE)
+    {
+      ++rec_xruns;
+    }
+    return startCapture(rec_handle);
+  }
+  frames_avail -= frames_avail % rec_block_size;
+
+  while (frames_avail > 0)
+  {
+    size_t frames = 0;
+    char *buf = rec_ring->writePtr(frames);
+    const bool drop = (frames == 0);
+    if (drop)
+    {
+        // The main thread has not emptied the buffer in time so the audio
+        // have to be thrown away
+      ++rec_misses;
+      buf = rec_buf.data();
+      frames = rec_block_count * rec_block_size;
+    }
+    frames = std::min(frames, static_cast<size_t>(frames_avail));
+
+    snd_pcm_sframes_t frames_read = snd_pcm_readi(rec_handle, buf, frames);
+    if (frames_read < 0)
+    {
+      if (frames_read == -EPIPE)
+      {
+        ++rec_xruns;
+      }
+      return startCapture(rec_handle);
+    }
+    if (!drop)
+    {
+      rec_ring->commitWrite(frames_read);
+    }
+    if (static_cast<size_t>(frames_read) < frames)
+    {
+      break;
+    }
+    frames_avail -= frames_read;
+  }
+
+  return true;
+} /* AudioDeviceAlsa::threadCapture */
+
+
+bool AudioDeviceAlsa::threadPlayback(void)
+{
+  const auto pcm_state = snd_pcm_state(play_handle);
+  if ((pcm_state < 0) || (pcm_state == SND_PCM_STATE_DISCONNECTED))
+  {
+    return false;
+  }
+
+  const size_t buffer_size = play_block_count * play_block_size;
+  while (1)
+  {
+    snd_pcm_sframes_t space_avail = snd_pcm_avail_update(play_handle);
+    if (space_avail < 0)
+    {
+      if ((space_avail == -EPIPE) && play_active)
+      {
+        ++play_xruns;
+      }
+      if (!startPlayback(play_handle))
+      {
+        return false;
+      }
+      continue;
+    }
+    play_delay = buffer_size - std::min(static_cast<size_t>(space_avail),
+                                        buffer_size);
+
+    size_t frames = space_avail - space_avail % play_block_size;
+    if (frames == 0)
+    {
+      return true;
+    }
+
+    size_t ring_frames = 0;
+    const char *buf = play_ring->readPtr(ring_frames);
+    const bool silence = (ring_frames == 0);
+    if (silence)
+    {
+        // Audio is counted as late if the main thread did not refill the
+        // buffer after the last notification
+      if (play_active && notify_pending)
+      {
+        ++play_misses;
+      }
+      buf = play_buf.data();
+      frames = play_block_size;
+    }
+    else
+    {
+      frames = std::min(frames, ring_frames);
+    }
+
+    snd_pcm_sframes_t frames_written =
+      snd_pcm_writei(play_handle, buf, frames);
+    if (frames_written < 0)
+    {
+      if ((frames_written == -EPIPE) && play_active)
+      {
+        ++play_xruns;
+      }
+      if (!startPlayback(play_handle))
+      {
+        return false;
+      }
+      continue;
+    }
+    play_delay = play_delay + frames_written;
+
+    if (silence)
+    {
+      return true;
+    }
+    play_ring->consume(frames_written);
+  }
+} /* AudioDeviceAlsa::threadPlayback */
+
+
+void AudioDeviceAlsa::notifyMainThread(void)
+{
+  notify_pending = true;
+  uint64_t cnt = 1;
+  if ((write(notify_fd, &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN))
+  {
+    cerr << "*** ERROR: Could not write to eventfd for Alsa device \""
+         << dev_name << "\": " << strerror(errno) << endl;
+  }
+} /* AudioDeviceAlsa::notifyMainThread */
+
+
+void AudioDeviceAlsa::threadNotified(FdWatch *watch)
+{
+  uint64_t cnt;
+  if ((read(watch->fd(), &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN))
+  {
+    cerr << "*** ERROR: Could not read from eventfd for Alsa device \""
+         << dev_name << "\": " << strerror(errno) << endl;
+  }
+  notify_pending = false;
+
+  if (thread_error)
+  {
+    setDeviceError();
+    return;
+  }
+
+    // Handle the captured audio. The device may be closed by a consumer of
+    // the audio so the ring must be checked after each write.
+  while (rec_ring != 0)
+  {
+    size_t frames = 0;
+    const char *buf = rec_ring->readPtr(frames);
+    if (frames == 0)
+    {
+      break;
+    }
+    putBlocks(buf, frames, rec_format);
+    if (rec_ring == 0)
+    {
+      return;
+    }
+    rec_ring->consume(frames);
+  }
+
+  fillPlayRing();
+} /* AudioDeviceAlsa::threadNotified */
+
+
+void AudioDeviceAlsa::fillPlayRing(void)
+{
+  bool got_audio = false;
+  while (play_ring != 0)
+  {
+    size_t frames = 0;
+    char *buf = play_ring->writePtr(frames);
+    const size_t blocks_to_read = frames / play_block_size;
+    if (blocks_to_read == 0)
+    {
+      break;
+    }
+    const size_t blocks_avail = getBlocks(buf, blocks_to_read, play_format);
+    if ((blocks_avail == 0) || (play_ring == 0))
+    {
+      break;
+    }
+    play_ring->commitWrite(blocks_avail * play_block_size);
+    got_audio = true;
+    if (blocks_avail < blocks_to_read)
+    {
+      break;
+    }
+  }
+  play_active = got_audio || ((play_ring != 0) && (play_ring->fill() > 0));
+} /* AudioDeviceAlsa::fillPlayRing */
+
+
 /*
  * This file has not been truncated
  */
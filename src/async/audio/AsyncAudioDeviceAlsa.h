@@ -38,6 +38,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <alsa/asoundlib.h>
 
+#include <vector>
+#include <atomic>
+#include <thread>
+
 
 /****************************************************************************
  *
@@ -45,6 +49,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncTimer.h>
 
 
 /****************************************************************************
@@ -113,6 +118,32 @@ This class implements the low level interface to an Alsa audio device. This
 class is not intended to be used by the end user of the Async library. It is
 used by the Async::AudioIO class, which is the Async API frontend for using
 audio in an application.
+
+The sample format used with the device is negotiated when it is opened. 32 bit
+float and signed 32 bit samples are preferred over signed 16 bit samples so
+that no precision is lost between the device and the floating point audio
+pipe. The format can be forced by setting the environment variable
+ASYNC_AUDIO_ALSA_FORMAT to S16, S32 or FLOAT.
+
+For low latency operation a couple of other environment variables can be
+used. ASYNC_AUDIO_ALSA_PERIOD_SIZE and ASYNC_AUDIO_ALSA_PERIODS override the
+period size in frames and the number of periods in the buffer.
+ASYNC_AUDIO_ALSA_MMAP=1 make samples be converted directly to and from the
+memory mapped device buffer. ASYNC_AUDIO_ALSA_TSCHED=<ms> make the device be
+serviced from a timer with the given interval instead of waiting for the
+period interrupts, which make it possible to use small periods without
+depending on the interrupt timing of the sound card. Buffer overruns and
+underruns are counted and reported once per minute when they occur.
+
+If a real time priority has been set using AudioDevice::setRealtimePriority,
+the device is read and written by a separate thread running with SCHED_FIFO
+scheduling. The audio processing is still done in the main thread. The
+samples are passed between the threads through one lock free buffer per
+direction so that a main thread that is busy for a while does not make the
+sound card run out of data. When the main thread does not keep up, it is
+counted as a deadline miss and reported together with the buffer overruns
+and underruns. Memory mapped access and timer scheduling are not used in this
+mode and silence is always written when there is no audio to play.
 */
 class AudioDeviceAlsa : public AudioDevice
 {
@@ -187,6 +218,7 @@ class AudioDeviceAlsa : public AudioDevice
 
   private:
     class       AlsaWatch;
+    class       FrameRing;
     size_t      play_block_size;
     size_t      play_block_count;
     size_t      rec_block_size;
@@ -197,16 +229,66 @@ class AudioDeviceAlsa : public AudioDevice
     AlsaWatch   *rec_watch;
     bool        duplex;
     bool        zerofill_on_underflow;
+    std::vector<SampleFormat> formats;
+    SampleFormat              play_format;
+    SampleFormat              rec_format;
+    std::vector<char>         play_buf;
+    std::vector<char>         rec_buf;
+    size_t                    period_size;
+    size_t                    period_count;
+    bool                      use_mmap;
+    bool                      play_mmap;
+    bool                      rec_mmap;
+    unsigned                  tsched_interval;
+    Async::Timer              tsched_timer;
+    bool                      play_enabled;
+    bool                      rec_enabled;
+    bool                      play_idle;
+    std::atomic<unsigned>     play_xruns;
+    std::atomic<unsigned>     rec_xruns;
+    unsigned                  reported_play_xruns;
+    unsigned                  reported_rec_xruns;
+    Async::Timer              xrun_report_timer;
+    int                       rt_prio;
+    FrameRing                 *play_ring;
+    FrameRing                 *rec_ring;
+    std::thread               audio_thread;
+    std::atomic<bool>         thread_running;
+    std::atomic<bool>         thread_error;
+    std::atomic<bool>         notify_pending;
+    std::atomic<bool>         play_active;
+    std::atomic<size_t>       play_delay;
+    int                       wake_fd;
+    int                       notify_fd;
+    FdWatch                   *notify_watch;
+    std::atomic<unsigned>     play_misses;
+    std::atomic<unsigned>     rec_misses;
+    unsigned                  reported_play_misses;
+    unsigned                  reported_rec_misses;
 
     AudioDeviceAlsa(const AudioDeviceAlsa&);
     AudioDeviceAlsa& operator=(const AudioDeviceAlsa&);
     void audioReadHandler(FdWatch *watch, unsigned short revents);
     void writeSpaceAvailable(FdWatch *watch, unsigned short revents);
-    bool initParams(snd_pcm_t *pcm_handle);
+    bool initParams(snd_pcm_t *pcm_handle, SampleFormat &fmt, bool &mmap);
     bool getBlockAttributes(snd_pcm_t *pcm_handle, size_t &block_size,
                             size_t &period_size);
     bool startPlayback(snd_pcm_t *pcm_handle);
     bool startCapture(snd_pcm_t *pcm_handle);
+    void setPlayEnabled(bool enable);
+    void setRecEnabled(bool enable);
+    void countXrun(snd_pcm_t *pcm_handle, int err);
+    snd_pcm_sframes_t readMmap(snd_pcm_uframes_t frames);
+    void tschedHandler(void);
+    void reportXruns(void);
+    bool startAudioThread(void);
+    void stopAudioThread(void);
+    void audioThreadFunc(void);
+    bool threadCapture(void);
+    bool threadPlayback(void);
+    void notifyMainThread(void);
+    void threadNotified(FdWatch *watch);
+    void fillPlayRing(void);
     
 };  /* class AudioDeviceAlsa */
 
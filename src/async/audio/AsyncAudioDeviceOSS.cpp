@@ -348,6 +348,7 @@ bool AudioDeviceOSS::openDevice(Mode mode)
   {
     read_watch = new FdWatch(fd, FdWatch::FD_WATCH_RD);
     assert(read_watch != 0);
+    read_watch->setName("AudioDeviceOSS::audioReadHandler");
     read_watch->activity.connect(
         mem_fun(*this, &AudioDeviceOSS::audioReadHandler));
     arg |= PCM_ENABLE_INPUT;
@@ -357,6 +358,7 @@ bool AudioDeviceOSS::openDevice(Mode mode)
   {
     write_watch = new FdWatch(fd, FdWatch::FD_WATCH_WR);
     assert(write_watch != 0);
+    write_watch->setName("AudioDeviceOSS::writeSpaceAvailable");
     write_watch->activity.connect(
       	mem_fun(*this, &AudioDeviceOSS::writeSpaceAvailable));
     arg |= PCM_ENABLE_OUTPUT;
@@ -115,7 +115,7 @@ using namespace Async;
  ****************************************************************************/
 
 AudioEncoderOpus::AudioEncoderOpus(void)
-  : enc(0), frame_size(0), sample_buf(0), buf_len(0)
+  : enc(0), frame_size(0), sample_buf(0), buf_len(0), dtx_enabled(false)
 {
   int error;
   enc = opus_encoder_create(INTERNAL_SAMPLE_RATE, 1, OPUS_APPLICATION_AUDIO,
@@ -181,6 +181,18 @@ void AudioEncoderOpus::setOption(const std::string &name,
   {
     enableConstrainedVbr(atoi(value.c_str()) != 0);
   }
+  else if (name == "FEC")
+  {
+    enableInbandFec(atoi(value.c_str()) != 0);
+  }
+  else if (name == "PACKET_LOSS_PERC")
+  {
+    setExpectedPacketLoss(atoi(value.c_str()));
+  }
+  else if (name == "DTX")
+  {
+    enableDtx(atoi(value.c_str()) != 0);
+  }
   else
   {
     cerr << "*** WARNING AudioEncoderOpus: Unknown option \""
@@ -508,7 +520,8 @@ bool AudioEncoderOpus::enableDtx(bool enable)
     cerr << "*** ERROR: Could not set Opus encoder DTX: "
          << opus_strerror(err) << endl;
   }
-  return dtxEnabled();
+  dtx_enabled = dtxEnabled();
+  return dtx_enabled;
 } /* AudioEncoderOpus::enableDtx */
 
 
@@ -642,7 +655,9 @@ int AudioEncoderOpus::writeSamples(const float *samples, int count)
       opus_int32 nbytes = opus_encode_float(enc, sample_buf, frame_size,
                                             output_buf, sizeof(output_buf));
       //cout << "### frame_size=" << frame_size << " nbytes=" << nbytes << endl;
-      if (nbytes > 0)
+        // When DTX is enabled, a packet of one or two bytes indicate that
+        // the frame does not need to be transmitted
+      if ((nbytes > 2) || ((nbytes > 0) && !dtx_enabled))
       {
         writeEncodedSamples(output_buf, nbytes);
       }
@@ -334,7 +334,9 @@ class AudioEncoderOpus : public AudioEncoder
      * @param   enable Set to \em true to enable or \em false to disable
      * @returns Returns if DTX is enabled or not
      *
-     * Discontinuous transmission (DTX) is disabled by default.
+     * Discontinuous transmission (DTX) is disabled by default. When enabled,
+     * frames that the encoder mark as not needing transmission during
+     * silence will not be emitted at all, saving bandwidth.
      */
     bool enableDtx(bool enable);
     
@@ -418,6 +420,7 @@ class AudioEncoderOpus : public AudioEncoder
     int       frame_size;
     float     *sample_buf;
     int       buf_len;
+    bool      dtx_enabled;
     //int       frames_per_packet;
     //int       frame_cnt;
     
@@ -0,0 +1,231 @@
+/**
+@file   AsyncAudioEncoderWorker.cpp
+@brief  An audio encoder that run another encoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioCodecWorker.h"
+#include "AsyncAudioEncoderWorker.h"
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace Async;
+using namespace sigc;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioEncoderWorker::AudioEncoderWorker(AudioEncoder *enc)
+  : enc(enc), worker(new AudioCodecWorker)
+{
+    // The signals from the wrapped encoder are emitted in the worker thread
+  enc->writeEncodedSamples.connect(
+      [this](const void *buf, int size)
+      {
+        auto job = worker->newJob(AudioCodecJob::ENCODED);
+        const uint8_t *ptr = static_cast<const uint8_t*>(buf);
+        job->data.assign(ptr, ptr + size);
+        worker->post(job);
+      });
+  enc->flushEncodedSamples.connect(
+      [this](void)
+      {
+        worker->post(worker->newJob(AudioCodecJob::FLUSH));
+      });
+
+  worker->processJob = [this](AudioCodecJob *job) { processJob(job); };
+  worker->jobDone.connect(mem_fun(*this, &AudioEncoderWorker::jobDone));
+  worker->start();
+} /* AudioEncoderWorker::AudioEncoderWorker */
+
+
+AudioEncoderWorker::~AudioEncoderWorker(void)
+{
+  delete worker;
+  delete enc;
+} /* AudioEncoderWorker::~AudioEncoderWorker */
+
+
+void AudioEncoderWorker::setOption(const std::string &name,
+                                   const std::string &value)
+{
+  auto job = worker->newJob(AudioCodecJob::OPTION);
+  job->name = name;
+  job->value = value;
+  worker->submit(job);
+} /* AudioEncoderWorker::setOption */
+
+
+void AudioEncoderWorker::printCodecParams(void)
+{
+  worker->submit(worker->newJob(AudioCodecJob::PRINT_PARAMS));
+} /* AudioEncoderWorker::printCodecParams */
+
+
+int AudioEncoderWorker::writeSamples(const float *samples, int count)
+{
+  auto job = worker->newJob(AudioCodecJob::SAMPLES);
+  job->samples.assign(samples, samples + count);
+  worker->submit(job);
+  return count;
+} /* AudioEncoderWorker::writeSamples */
+
+
+void AudioEncoderWorker::flushSamples(void)
+{
+  worker->submit(worker->newJob(AudioCodecJob::FLUSH));
+} /* AudioEncoderWorker::flushSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioEncoderWorker::processJob(AudioCodecJob *job)
+{
+  switch (job->type)
+  {
+    case AudioCodecJob::SAMPLES:
+      enc->writeSamples(job->samples.data(), job->samples.size());
+      break;
+    case AudioCodecJob::FLUSH:
+      enc->flushSamples();
+      break;
+    case AudioCodecJob::OPTION:
+      enc->setOption(job->name, job->value);
+      break;
+    case AudioCodecJob::PRINT_PARAMS:
+      enc->printCodecParams();
+      break;
+    default:
+      break;
+  }
+} /* AudioEncoderWorker::processJob */
+
+
+void AudioEncoderWorker::jobDone(AudioCodecJob *job)
+{
+  switch (job->type)
+  {
+    case AudioCodecJob::ENCODED:
+      writeEncodedSamples(job->data.data(), job->data.size());
+      break;
+    case AudioCodecJob::FLUSH:
+      flushEncodedSamples();
+      break;
+    default:
+      break;
+  }
+} /* AudioEncoderWorker::jobDone */
+
+
+
+/*
+ * This file has not been truncated
+ */
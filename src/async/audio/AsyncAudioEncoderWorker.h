@@ -0,0 +1,194 @@
+/**
+@file   AsyncAudioEncoderWorker.h
+@brief  An audio encoder that run another encoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_ENCODER_WORKER_INCLUDED
+#define ASYNC_AUDIO_ENCODER_WORKER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioEncoder.h>
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class AudioCodecWorker;
+struct AudioCodecJob;
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	An audio encoder that run another encoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class wraps another audio encoder so that the encoding is done in a
+separate thread. It can be used in place of the wrapped encoder to move CPU
+heavy encoding, like Opus at high complexity, out of the main thread. Audio
+written to this object is copied to preallocated buffers and handed over to
+the worker thread. The encoded audio and flush requests are emitted, in the
+same order as they were produced by the wrapped encoder, from the main thread
+through the usual AudioEncoder signals.
+
+Options and printCodecParams are also passed through the worker thread so
+that they are applied in order with the audio.
+
+Example:
+
+  AudioEncoder *enc = new AudioEncoderWorker(AudioEncoder::create("OPUS"));
+*/
+class AudioEncoderWorker : public AudioEncoder
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	enc The encoder to run in the worker thread
+     *
+     * The ownership of the given encoder is transferred to this object.
+     */
+    explicit AudioEncoderWorker(AudioEncoder *enc);
+  
+    /**
+     * @brief 	Destructor
+     */
+    ~AudioEncoderWorker(void);
+  
+    /**
+     * @brief   Get the name of the codec
+     * @returns Return the name of the wrapped codec
+     */
+    virtual const char *name(void) const { return enc->name(); }
+  
+    /**
+     * @brief 	Set an option for the encoder
+     * @param 	name The name of the option
+     * @param 	value The value of the option
+     */
+    virtual void setOption(const std::string &name, const std::string &value);
+
+    /**
+     * @brief Print codec parameter settings
+     */
+    virtual void printCodecParams(void);
+  
+    /**
+     * @brief 	Write samples into this audio sink
+     * @param 	samples The buffer containing the samples
+     * @param 	count The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     */
+    virtual int writeSamples(const float *samples, int count);
+    
+    /**
+     * @brief 	Tell the sink to flush the previously written samples
+     *
+     * The flushEncodedSamples signal is emitted when all previously written
+     * samples have been encoded.
+     */
+    virtual void flushSamples(void);
+    
+  private:
+    AudioEncoder      *enc;
+    AudioCodecWorker  *worker;
+
+    AudioEncoderWorker(const AudioEncoderWorker&);
+    AudioEncoderWorker& operator=(const AudioEncoderWorker&);
+    void processJob(AudioCodecJob *job);
+    void jobDone(AudioCodecJob *job);
+
+};  /* class AudioEncoderWorker */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_ENCODER_WORKER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
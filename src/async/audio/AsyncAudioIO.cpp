@@ -268,6 +268,12 @@ void AudioIO::setChannels(size_t channels)
 } /* AudioIO::setBufferCount */
 
 
+void AudioIO::setRealtimePriority(int prio)
+{
+  AudioDevice::setRealtimePriority(prio);
+} /* AudioIO::setRealtimePriority */
+
+
 
 AudioIO::AudioIO(const string& dev_name, size_t channel)
   : io_mode(MODE_NONE), audio_dev(0),
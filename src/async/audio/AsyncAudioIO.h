@@ -207,6 +207,19 @@ class AudioIO : public Async::AudioSource, public Async::AudioSink
      * opened sound cards will not be affected.
      */
     static void setChannels(size_t channels);
+
+    /**
+     * @brief   Set the real time priority of audio device threads
+     * @param   prio The SCHED_FIFO priority (1-99) or 0 to disable
+     *
+     * Use this function to make audio devices do their I/O in a separate
+     * thread running with real time priority. This keeps the sound card
+     * serviced even if the main thread is busy for a while. Only Alsa
+     * devices support this at the moment.
+     * This is a global setting so all sound cards will be affected. Already
+     * opened sound cards will not be affected.
+     */
+    static void setRealtimePriority(int prio);
     
     /**
      * @brief Constructor
@@ -0,0 +1,358 @@
+/**
+@file   AsyncAudioLatencyProbe.cpp
+@brief  Measure latency and processing time in an audio pipe
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioLatencyProbe.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace Async;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Static class variables
+ *
+ ****************************************************************************/
+
+bool AudioLatencyProbe::enabled = false;
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+namespace {
+
+
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+std::vector<AudioLatencyProbe*>& probes(void)
+{
+  static std::vector<AudioLatencyProbe*> probe_list;
+  return probe_list;
+} /* probes */
+
+
+}; /* End of anonymous namespace */
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioLatencyProbe *AudioLatencyProbe::insert(AudioSource *&src,
+                                             const std::string& name,
+                                             AudioLatencyProbe *stage_start,
+                                             MeasureMode mode)
+{
+  if (!enabled)
+  {
+    return 0;
+  }
+  assert(src != 0);
+  AudioLatencyProbe *probe = new AudioLatencyProbe(name, stage_start, mode);
+  src->registerSink(probe, true);
+  src = probe;
+  return probe;
+} /* AudioLatencyProbe::insert */
+
+
+void AudioLatencyProbe::printAllStats(std::ostream& os)
+{
+  if (probes().empty())
+  {
+    os << "No audio latency probes. Set GLOBAL/AUDIO_LATENCY_STATS=1 to "
+          "enable them.\n";
+    return;
+  }
+  for (const auto& probe : probes())
+  {
+    probe->printStats(os);
+  }
+} /* AudioLatencyProbe::printAllStats */
+
+
+void AudioLatencyProbe::resetAllStats(void)
+{
+  for (auto& probe : probes())
+  {
+    probe->resetStats();
+  }
+} /* AudioLatencyProbe::resetAllStats */
+
+
+AudioLatencyProbe::AudioLatencyProbe(const std::string& name,
+                                     AudioLatencyProbe *stage_start,
+                                     MeasureMode mode)
+  : m_name(name), m_stage_start(stage_start), m_mode(mode)
+{
+  if (m_stage_start != 0)
+  {
+    assert(m_stage_start->m_stage_end == 0);
+    m_stage_start->m_stage_end = this;
+  }
+  probes().push_back(this);
+} /* AudioLatencyProbe::AudioLatencyProbe */
+
+
+AudioLatencyProbe::~AudioLatencyProbe(void)
+{
+  if (m_stage_start != 0)
+  {
+    m_stage_start->m_stage_end = 0;
+  }
+  if (m_stage_end != 0)
+  {
+    m_stage_end->m_stage_start = 0;
+  }
+  auto& probe_list = probes();
+  probe_list.erase(std::remove(probe_list.begin(), probe_list.end(), this),
+                   probe_list.end());
+} /* AudioLatencyProbe::~AudioLatencyProbe */
+
+
+void AudioLatencyProbe::printStats(std::ostream& os) const
+{
+  os << m_name << ": samples=" << m_sample_cnt << " writes=" << m_write_cnt
+     << "\n";
+  os << "  Processing time: ";
+  m_proc_hist.print(os, "    ");
+  if (m_stage_start != 0)
+  {
+    if (m_mode == MEASURE_SAMPLES)
+    {
+      os << "  Buffered samples: current=" << (m_in_pos - m_out_pos)
+         << " max=" << m_max_buffered << "\n";
+      os << "  Latency from " << m_stage_start->name() << ": ";
+    }
+    else
+    {
+      os << "  Onset latency from " << m_stage_start->name() << ": ";
+    }
+    m_stage_hist.print(os, "    ");
+  }
+} /* AudioLatencyProbe::printStats */
+
+
+void AudioLatencyProbe::resetStats(void)
+{
+  m_sample_cnt = 0;
+  m_write_cnt = 0;
+  m_max_buffered = m_in_pos - m_out_pos;
+  m_proc_hist.reset();
+  m_stage_hist.reset();
+} /* AudioLatencyProbe::resetStats */
+
+
+int AudioLatencyProbe::writeSamples(const float *samples, int count)
+{
+  Clock::time_point now = Clock::now();
+  if (!m_active && (count > 0))
+  {
+    m_active = true;
+    if (m_stage_end != 0)
+    {
+      m_stage_end->stageInputStarted(now);
+    }
+    if ((m_stage_start != 0) && m_onset_pending)
+    {
+      m_onset_pending = false;
+      m_stage_hist.add(now - m_onset_time);
+    }
+  }
+
+    // The stage input must be recorded before the samples are passed on
+    // since they may pass right through the stage to the end probe.
+  if (m_stage_end != 0)
+  {
+    m_stage_end->stageInputWrite(count, now);
+  }
+
+  int ret = sinkWriteSamples(samples, count);
+  m_proc_hist.add(Clock::now() - now);
+  m_sample_cnt += ret;
+  ++m_write_cnt;
+
+  if ((m_stage_end != 0) && (ret < count))
+  {
+    m_stage_end->stageInputWrite(ret - count, now);
+  }
+  if (m_stage_start != 0)
+  {
+    stageOutputWrite(ret, now);
+  }
+
+  return ret;
+} /* AudioLatencyProbe::writeSamples */
+
+
+void AudioLatencyProbe::flushSamples(void)
+{
+  m_active = false;
+  if (m_stage_end != 0)
+  {
+      // The audio never reached the end of the stage
+    m_stage_end->m_onset_pending = false;
+  }
+  sinkFlushSamples();
+} /* AudioLatencyProbe::flushSamples */
+
+
+void AudioLatencyProbe::resumeOutput(void)
+{
+  sourceResumeOutput();
+} /* AudioLatencyProbe::resumeOutput */
+
+
+void AudioLatencyProbe::allSamplesFlushed(void)
+{
+  if (m_stage_start != 0)
+  {
+      // Everything written into the stage has now left it, or has been
+      // thrown away, so resynchronize the sample positions.
+    m_out_pos = m_in_pos;
+    m_markers.clear();
+  }
+  sourceAllSamplesFlushed();
+} /* AudioLatencyProbe::allSamplesFlushed */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioLatencyProbe::stageInputWrite(int64_t count, Clock::time_point now)
+{
+  if (m_mode != MEASURE_SAMPLES)
+  {
+    return;
+  }
+
+  m_in_pos += count;
+  if (count < 0)
+  {
+      // Some samples was not accepted by the stage so adjust the marker
+      // that was added before the write
+    if (!m_markers.empty() && (m_markers.back().pos > m_in_pos))
+    {
+      m_markers.back().pos = m_in_pos;
+    }
+    return;
+  }
+  if ((count > 0) && (m_markers.size() < MAX_MARKERS))
+  {
+    m_markers.push_back({m_in_pos, now});
+  }
+  m_max_buffered = std::max(m_max_buffered, m_in_pos - m_out_pos);
+} /* AudioLatencyProbe::stageInputWrite */
+
+
+void AudioLatencyProbe::stageInputStarted(Clock::time_point now)
+{
+  if (m_mode == MEASURE_ONSET)
+  {
+    m_onset_pending = true;
+    m_onset_time = now;
+  }
+} /* AudioLatencyProbe::stageInputStarted */
+
+
+void AudioLatencyProbe::stageOutputWrite(uint64_t count, Clock::time_point now)
+{
+  if (m_mode != MEASURE_SAMPLES)
+  {
+    return;
+  }
+
+  m_out_pos = std::min(m_out_pos + count, m_in_pos);
+  while (!m_markers.empty() && (m_markers.front().pos <= m_out_pos))
+  {
+    m_stage_hist.add(now - m_markers.front().time);
+    m_markers.pop_front();
+  }
+} /* AudioLatencyProbe::stageOutputWrite */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,315 @@
+/**
+@file   AsyncAudioLatencyProbe.h
+@brief  Measure latency and processing time in an audio pipe
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This file contains a pass-through audio element that can be inserted into an
+audio pipe to measure how long audio is buffered in a stage of the pipe and
+how much time is spent processing it.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_LATENCY_PROBE_INCLUDED
+#define ASYNC_AUDIO_LATENCY_PROBE_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <chrono>
+#include <deque>
+#include <ostream>
+#include <string>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSink.h>
+#include <AsyncLatencyHistogram.h>
+#include <AsyncAudioSource.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief  Measure latency and processing time in an audio pipe
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class is a pass-through audio element that collect timing statistics for
+the audio passing through it. Each probe measure the time spent in the
+writeSamples call of the sink connected to it, that is the processing time
+of the rest of the synchronous audio pipe.
+
+Two probes can be combined to measure a stage of the audio pipe, for example
+a FIFO. The second probe is then given a pointer to the first one. For each
+write at the stage input, the position in the sample stream is recorded
+together with a timestamp. When that sample position leave the stage, the
+time it spent in the stage is added to a latency histogram. The number of
+samples currently buffered in the stage is also tracked. This only work for
+stages that do not add or remove samples, like FIFOs or pacers.
+
+For stages that do not preserve the number of samples, for example when
+audio pass through valves and selectors, the probes can be set up to only
+measure the onset latency. That is the time from when audio starts to flow
+into the first probe until audio start to flow out of the second probe.
+
+All probes are registered in a global list so that the statistics for all of
+them can be printed in one go. Probes are normally only created when the
+latency instrumentation has been enabled using the setEnabled function, so
+that there is no cost at all when not in use. The insert function make that
+easy.
+
+  AudioSource *prev_src = ...;
+  AudioLatencyProbe *fifo_in = AudioLatencyProbe::insert(prev_src, "in");
+  AudioFifo *fifo = new AudioFifo(1024);
+  prev_src->registerSink(fifo, true);
+  prev_src = fifo;
+  AudioLatencyProbe::insert(prev_src, "fifo", fifo_in);
+*/
+class AudioLatencyProbe : public AudioSink, public AudioSource
+{
+  public:
+    using Clock     = std::chrono::steady_clock;
+    using Duration  = Clock::duration;
+
+    /**
+     * @brief The type of measurement to do for a stage
+     */
+    typedef enum
+    {
+      MEASURE_SAMPLES,  ///< Track individual samples through the stage
+      MEASURE_ONSET     ///< Only measure the latency at audio stream start
+    } MeasureMode;
+
+    /**
+     * @brief   Enable or disable creation of probes using insert
+     * @param   enable Set to \em true to enable the instrumentation
+     */
+    static void setEnabled(bool enable) { enabled = enable; }
+
+    /**
+     * @brief   Check if the latency instrumentation is enabled
+     * @return  Returns \em true if the instrumentation is enabled
+     */
+    static bool isEnabled(void) { return enabled; }
+
+    /**
+     * @brief   Insert a probe after the given source, if enabled
+     * @param   src         The source to insert the probe after. It will be
+     *                      updated to point at the new probe.
+     * @param   name        The name of the probe
+     * @param   stage_start The probe at the start of the stage, or 0
+     * @param   mode        The type of stage measurement to do
+     * @return  Returns the new probe or 0 if instrumentation is disabled
+     *
+     * A new probe is created and registered as a managed sink of the given
+     * source so it will be deleted together with the audio pipe. If the
+     * instrumentation is not enabled, nothing is done.
+     */
+    static AudioLatencyProbe *insert(AudioSource *&src,
+                                     const std::string& name,
+                                     AudioLatencyProbe *stage_start=0,
+                                     MeasureMode mode=MEASURE_SAMPLES);
+
+    /**
+     * @brief   Print the statistics for all probes
+     * @param   os The stream to print to
+     */
+    static void printAllStats(std::ostream& os);
+
+    /**
+     * @brief   Reset the statistics for all probes
+     */
+    static void resetAllStats(void);
+
+    /**
+     * @brief   Constructor
+     * @param   name        The name of the probe
+     * @param   stage_start The probe at the start of the stage, or 0
+     * @param   mode        The type of stage measurement to do
+     */
+    explicit AudioLatencyProbe(const std::string& name,
+                               AudioLatencyProbe *stage_start=0,
+                               MeasureMode mode=MEASURE_SAMPLES);
+
+    /**
+     * @brief   Disallow copy construction
+     */
+    AudioLatencyProbe(const AudioLatencyProbe&) = delete;
+
+    /**
+     * @brief   Disallow copy assignment
+     */
+    AudioLatencyProbe& operator=(const AudioLatencyProbe&) = delete;
+
+    /**
+     * @brief   Destructor
+     */
+    virtual ~AudioLatencyProbe(void);
+
+    /**
+     * @brief   Get the name of this probe
+     * @return  Returns the name of the probe
+     */
+    const std::string& name(void) const { return m_name; }
+
+    /**
+     * @brief   Print the statistics for this probe
+     * @param   os The stream to print to
+     */
+    void printStats(std::ostream& os) const;
+
+    /**
+     * @brief   Reset the statistics for this probe
+     */
+    void resetStats(void);
+
+    /**
+     * @brief   Write samples into this audio sink
+     * @param   samples The buffer containing the samples
+     * @param   count   The number of samples in the buffer
+     * @return  Returns the number of samples that has been taken care of
+     */
+    virtual int writeSamples(const float *samples, int count) override;
+
+    /**
+     * @brief   Tell the sink to flush the previously written samples
+     */
+    virtual void flushSamples(void) override;
+
+    /**
+     * @brief   Resume audio output to the sink
+     */
+    virtual void resumeOutput(void) override;
+
+    /**
+     * @brief   The registered sink has flushed all samples
+     */
+    virtual void allSamplesFlushed(void) override;
+
+  private:
+    struct Marker
+    {
+      uint64_t          pos;
+      Clock::time_point time;
+    };
+
+    static const size_t MAX_MARKERS = 256;
+
+    static bool enabled;
+
+    std::string         m_name;
+    AudioLatencyProbe*  m_stage_start;
+    AudioLatencyProbe*  m_stage_end     = 0;
+    MeasureMode         m_mode;
+    bool                m_active        = false;
+    uint64_t            m_sample_cnt    = 0;
+    uint64_t            m_write_cnt     = 0;
+    LatencyHistogram    m_proc_hist;
+
+      // Stage statistics, only used in the probe at the end of a stage
+    uint64_t            m_in_pos        = 0;
+    uint64_t            m_out_pos       = 0;
+    uint64_t            m_max_buffered  = 0;
+    std::deque<Marker>  m_markers;
+    bool                m_onset_pending = false;
+    Clock::time_point   m_onset_time;
+    LatencyHistogram    m_stage_hist;
+
+    void stageInputWrite(int64_t count, Clock::time_point now);
+    void stageInputStarted(Clock::time_point now);
+    void stageOutputWrite(uint64_t count, Clock::time_point now);
+
+};  /* class AudioLatencyProbe */
+
+
+} /* namespace Async */
+
+#endif /* ASYNC_AUDIO_LATENCY_PROBE_INCLUDED */
+
+/*
+ * This file has not been truncated
+ */
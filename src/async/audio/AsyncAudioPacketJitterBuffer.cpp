@@ -0,0 +1,524 @@
+/**
+@file   AsyncAudioPacketJitterBuffer.cpp
+@brief  An adaptive jitter buffer for encoded audio packets
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioDecoder.h"
+#include "AsyncAudioPacketJitterBuffer.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace Async;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Static class variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+namespace {
+
+
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+std::chrono::microseconds samplesToDuration(int samples)
+{
+  return std::chrono::microseconds(
+      static_cast<int64_t>(samples) * 1000000 / INTERNAL_SAMPLE_RATE);
+} /* samplesToDuration */
+
+
+}; /* End of anonymous namespace */
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+std::ostream& Async::operator<<(std::ostream& os,
+                                const AudioPacketJitterBuffer::Stats& stats)
+{
+  os << "received=" << stats.received
+     << " played=" << stats.played
+     << " lost=" << stats.lost
+     << " late=" << stats.late
+     << " dup=" << stats.duplicates
+     << " concealed=" << stats.concealed
+     << " fec=" << stats.recovered
+     << " underruns=" << stats.underruns
+     << " compressed=" << stats.compressed
+     << " stretched=" << stats.stretched
+     << " jitter=" << stats.jitter_ms << "ms"
+     << " target=" << stats.target_ms << "ms"
+     << " buffered=" << stats.buffered_ms << "ms"
+     << " max_buffered=" << stats.max_buffered_ms << "ms";
+  return os;
+} /* operator<< */
+
+
+AudioPacketJitterBuffer::AudioPacketJitterBuffer(void)
+  : m_playout_timer(PLAYOUT_TIMER_MS, Timer::TYPE_PERIODIC, false)
+{
+  m_playout_timer.expired.connect(
+      sigc::mem_fun(*this, &AudioPacketJitterBuffer::playoutTimerExpired));
+} /* AudioPacketJitterBuffer::AudioPacketJitterBuffer */
+
+
+AudioPacketJitterBuffer::~AudioPacketJitterBuffer(void)
+{
+} /* AudioPacketJitterBuffer::~AudioPacketJitterBuffer */
+
+
+void AudioPacketJitterBuffer::setDecoder(AudioDecoder *dec)
+{
+  m_dec = dec;
+} /* AudioPacketJitterBuffer::setDecoder */
+
+
+void AudioPacketJitterBuffer::setDelayLimits(unsigned min_ms, unsigned max_ms)
+{
+  m_min_delay = min_ms;
+  m_max_delay = std::max(min_ms, max_ms);
+} /* AudioPacketJitterBuffer::setDelayLimits */
+
+
+void AudioPacketJitterBuffer::writeEncodedSamples(uint64_t seq,
+                                                  const void *buf, int size)
+{
+  assert(m_dec != nullptr);
+
+  ++m_stats.received;
+  const auto now = Clock::now();
+
+  if (m_state == STATE_IDLE)
+  {
+    startPlayout(seq);
+  }
+  else if (seq < m_next_seq)
+  {
+    if (m_next_seq - seq <= MAX_SEQ_JUMP)
+    {
+      updateJitter(seq, now);
+      ++m_stats.late;
+      return;
+    }
+      // The sender has probably restarted its sequence numbering
+    m_packets.clear();
+    startPlayout(seq);
+  }
+  else if (seq - m_next_seq > MAX_SEQ_JUMP)
+  {
+    m_packets.clear();
+    startPlayout(seq);
+  }
+  else if (m_state == STATE_STALLED)
+  {
+    m_next_seq = seq;
+    m_next_playout = now + std::chrono::milliseconds(targetDelay());
+    m_state = STATE_PLAYING;
+  }
+
+  updateJitter(seq, now);
+
+  const uint8_t *ptr = reinterpret_cast<const uint8_t*>(buf);
+  if (!m_packets.emplace(seq, Packet(ptr, ptr+size)).second)
+  {
+    ++m_stats.duplicates;
+  }
+  m_stats.max_buffered_ms = std::max(m_stats.max_buffered_ms,
+                                     bufferedDelay());
+} /* AudioPacketJitterBuffer::writeEncodedSamples */
+
+
+void AudioPacketJitterBuffer::skipSequenceNumber(uint64_t seq)
+{
+  if ((m_state != STATE_IDLE) && (seq >= m_next_seq) &&
+      (seq - m_next_seq <= MAX_SEQ_JUMP))
+  {
+    m_packets.emplace(seq, Packet());
+  }
+} /* AudioPacketJitterBuffer::skipSequenceNumber */
+
+
+void AudioPacketJitterBuffer::flushEncodedSamples(void)
+{
+  assert(m_dec != nullptr);
+
+  if ((m_state == STATE_IDLE) || (m_state == STATE_STALLED))
+  {
+    stopPlayout();
+    m_dec->flushEncodedSamples();
+    return;
+  }
+  m_flush_pending = true;
+} /* AudioPacketJitterBuffer::flushEncodedSamples */
+
+
+void AudioPacketJitterBuffer::reset(void)
+{
+  const bool was_active = (m_state != STATE_IDLE);
+  stopPlayout();
+  if (was_active && (m_dec != nullptr))
+  {
+    m_dec->flushEncodedSamples();
+  }
+} /* AudioPacketJitterBuffer::reset */
+
+
+const AudioPacketJitterBuffer::Stats& AudioPacketJitterBuffer::stats(void) const
+{
+  m_stats.jitter_ms = static_cast<unsigned>(std::lround(m_jitter));
+  m_stats.target_ms = targetDelay();
+  m_stats.buffered_ms = bufferedDelay();
+  return m_stats;
+} /* AudioPacketJitterBuffer::stats */
+
+
+void AudioPacketJitterBuffer::resetStats(void)
+{
+  m_stats = Stats();
+} /* AudioPacketJitterBuffer::resetStats */
+
+
+int AudioPacketJitterBuffer::writeSamples(const float *samples, int count)
+{
+  assert(count > 0);
+
+  m_frame_in_cnt += count;
+
+    // Length of the crossfade used when compressing or stretching a frame
+  const int xlen = std::min(count / 2, INTERNAL_SAMPLE_RATE / 200);
+
+  if ((m_stretch < 0) && (xlen > 0))
+  {
+      // Shorten the frame by xlen samples by crossfading the segment just
+      // before the last xlen samples into the last xlen samples.
+    const int keep = count - 2 * xlen;
+    float out[count - xlen];
+    std::copy(samples, samples + keep, out);
+    for (int i=0; i<xlen; ++i)
+    {
+      const float w = static_cast<float>(i) / xlen;
+      out[keep+i] = (1.0f - w) * samples[keep+i] + w * samples[keep+xlen+i];
+    }
+    ++m_stats.compressed;
+    m_frame_out_cnt += count - xlen;
+    sinkWriteSamples(out, count - xlen);
+  }
+  else if ((m_stretch > 0) && (xlen > 0))
+  {
+      // Lengthen the frame by xlen samples by repeating the second to last
+      // xlen segment, crossfading it in over the last segment.
+    const int keep = count - xlen;
+    float out[count + xlen];
+    std::copy(samples, samples + keep, out);
+    for (int i=0; i<xlen; ++i)
+    {
+      const float w = static_cast<float>(i) / xlen;
+      out[keep+i] = (1.0f - w) * samples[keep+i] + w * samples[keep-xlen+i];
+    }
+    std::copy(samples + keep, samples + count, out + count);
+    ++m_stats.stretched;
+    m_frame_out_cnt += count + xlen;
+    sinkWriteSamples(out, count + xlen);
+  }
+  else
+  {
+    m_frame_out_cnt += count;
+    sinkWriteSamples(samples, count);
+  }
+  m_stretch = 0;
+
+  return count;
+} /* AudioPacketJitterBuffer::writeSamples */
+
+
+void AudioPacketJitterBuffer::flushSamples(void)
+{
+  sinkFlushSamples();
+} /* AudioPacketJitterBuffer::flushSamples */
+
+
+void AudioPacketJitterBuffer::allSamplesFlushed(void)
+{
+  sourceAllSamplesFlushed();
+} /* AudioPacketJitterBuffer::allSamplesFlushed */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioPacketJitterBuffer::playoutTimerExpired(Timer *t)
+{
+  const auto now = Clock::now();
+
+    // If we have fallen far behind, e.g. due to the event loop being blocked,
+    // there is no point in trying to catch up
+  if (now - m_next_playout > std::chrono::milliseconds(m_max_delay))
+  {
+    m_next_playout = now;
+  }
+
+  while ((m_state == STATE_PLAYING) && (now >= m_next_playout))
+  {
+    playNextFrame();
+  }
+} /* AudioPacketJitterBuffer::playoutTimerExpired */
+
+
+void AudioPacketJitterBuffer::playNextFrame(void)
+{
+    // Remove sequence numbers that have been marked as not being audio
+  auto it = m_packets.begin();
+  while ((it != m_packets.end()) && (it->first <= m_next_seq) &&
+         it->second.empty())
+  {
+    m_next_seq = std::max(m_next_seq, it->first + 1);
+    it = m_packets.erase(it);
+  }
+
+  if ((it != m_packets.end()) && (it->first == m_next_seq))
+  {
+    const unsigned frame_ms = samplesToMs(m_frame_size);
+    const unsigned target = targetDelay();
+    const unsigned buffered = bufferedDelay();
+    if (buffered > target + frame_ms)
+    {
+      m_stretch = -1;
+    }
+    else if (buffered + frame_ms < target)
+    {
+      m_stretch = 1;
+    }
+
+    Packet pkt(std::move(it->second));
+    m_packets.erase(it);
+    ++m_next_seq;
+    ++m_stats.played;
+    m_conceal_cnt = 0;
+    m_frame_in_cnt = 0;
+    m_frame_out_cnt = 0;
+    m_dec->writeEncodedSamples(pkt.data(), pkt.size());
+    m_stretch = 0;
+    if (m_frame_in_cnt > 0)
+    {
+      m_frame_size = m_frame_in_cnt;
+    }
+    m_next_playout += samplesToDuration(
+        (m_frame_out_cnt > 0) ? m_frame_out_cnt : m_frame_size);
+  }
+  else if ((it != m_packets.end()) && (m_conceal_cnt >= MAX_CONCEAL_FRAMES))
+  {
+      // Do not conceal a long gap. Skip to the next available packet and
+      // play it right away.
+    m_stats.lost += it->first - m_next_seq;
+    m_next_seq = it->first;
+    m_conceal_cnt = 0;
+    m_next_playout = Clock::now();
+  }
+  else if (it != m_packets.end())
+  {
+      // There are packets in the buffer but the next one is missing. If the
+      // packet following the lost one is available, the decoder may be able
+      // to use it to recover the lost audio (FEC).
+    ++m_stats.lost;
+    ++m_next_seq;
+    if ((it->first == m_next_seq) && !it->second.empty())
+    {
+      ++m_stats.recovered;
+      concealFrame(&it->second);
+    }
+    else
+    {
+      concealFrame();
+    }
+  }
+  else if (m_flush_pending)
+  {
+    stopPlayout();
+    m_dec->flushEncodedSamples();
+  }
+  else
+  {
+    if (m_conceal_cnt == 0)
+    {
+      ++m_stats.underruns;
+    }
+    if (m_conceal_cnt < MAX_CONCEAL_FRAMES)
+    {
+      ++m_next_seq;
+      concealFrame();
+    }
+    else
+    {
+      m_state = STATE_STALLED;
+    }
+  }
+} /* AudioPacketJitterBuffer::playNextFrame */
+
+
+void AudioPacketJitterBuffer::concealFrame(const Packet *next)
+{
+  ++m_stats.concealed;
+  ++m_conceal_cnt;
+  m_frame_out_cnt = 0;
+  if (next != nullptr)
+  {
+    m_dec->concealLostSamples(m_frame_size, next->data(), next->size());
+  }
+  else
+  {
+    m_dec->concealLostSamples(m_frame_size);
+  }
+  m_next_playout += samplesToDuration(
+      (m_frame_out_cnt > 0) ? m_frame_out_cnt : m_frame_size);
+} /* AudioPacketJitterBuffer::concealFrame */
+
+
+void AudioPacketJitterBuffer::startPlayout(uint64_t seq)
+{
+  m_state = STATE_PLAYING;
+  m_next_seq = seq;
+  m_conceal_cnt = 0;
+  m_flush_pending = false;
+  m_have_transit = false;
+  m_next_playout = Clock::now() + std::chrono::milliseconds(targetDelay());
+  m_playout_timer.setEnable(true);
+} /* AudioPacketJitterBuffer::startPlayout */
+
+
+void AudioPacketJitterBuffer::stopPlayout(void)
+{
+  m_playout_timer.setEnable(false);
+  m_packets.clear();
+  m_flush_pending = false;
+  m_state = STATE_IDLE;
+} /* AudioPacketJitterBuffer::stopPlayout */
+
+
+void AudioPacketJitterBuffer::updateJitter(uint64_t seq, Clock::time_point now)
+{
+    // Calculate the interarrival jitter in the same way as described in
+    // RFC 3550, section 6.4.1.
+  const double arrival = std::chrono::duration<double, std::milli>(
+      now.time_since_epoch()).count();
+  const double transit = arrival -
+    static_cast<double>(seq) * 1000.0 * m_frame_size / INTERNAL_SAMPLE_RATE;
+  if (m_have_transit)
+  {
+    const double d = std::fabs(transit - m_prev_transit);
+    m_jitter += (d - m_jitter) / 16.0;
+  }
+  m_prev_transit = transit;
+  m_have_transit = true;
+} /* AudioPacketJitterBuffer::updateJitter */
+
+
+unsigned AudioPacketJitterBuffer::targetDelay(void) const
+{
+  const double delay = samplesToMs(m_frame_size) + 4.0 * m_jitter;
+  return std::min(m_max_delay,
+                  std::max(m_min_delay, static_cast<unsigned>(delay)));
+} /* AudioPacketJitterBuffer::targetDelay */
+
+
+unsigned AudioPacketJitterBuffer::bufferedDelay(void) const
+{
+  if (m_packets.empty() || (m_packets.rbegin()->first < m_next_seq))
+  {
+    return 0;
+  }
+  const uint64_t frame_cnt = m_packets.rbegin()->first - m_next_seq + 1;
+  return frame_cnt * samplesToMs(m_frame_size);
+} /* AudioPacketJitterBuffer::bufferedDelay */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,354 @@
+/**
+@file   AsyncAudioPacketJitterBuffer.h
+@brief  An adaptive jitter buffer for encoded audio packets
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This file contains an adaptive jitter buffer that sort incoming encoded audio
+packets by sequence number and release them to an audio decoder at a steady
+pace. The buffering delay is adapted to the measured network jitter.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_PACKET_JITTER_BUFFER_INCLUDED
+#define ASYNC_AUDIO_PACKET_JITTER_BUFFER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <map>
+#include <vector>
+#include <ostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSink.h>
+#include <AsyncAudioSource.h>
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class AudioDecoder;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief  An adaptive jitter buffer for encoded audio packets
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class implement a jitter buffer that operate on encoded audio packets
+rather than on decoded samples. Each packet is tagged with a sequence number
+when written to the buffer. Packets are sorted on sequence number and are
+handed over to the associated audio decoder at the pace given by the duration
+of the decoded audio. The decoded audio is then passed back through this
+object, which is why it is both an audio sink and an audio source. Set it up
+like this:
+
+  AudioDecoder -> AudioPacketJitterBuffer -> ...
+
+The buffering delay is continuously estimated from the variation in packet
+inter-arrival time, in the same way as the interarrival jitter is calculated
+for RTP (RFC 3550). When the amount of buffered audio deviates from the
+target delay, the playout rate is adjusted by time compressing or stretching
+the decoded audio frames a little. A missing packet will be concealed using
+the packet loss concealment (PLC) of the decoder, if available. If the packet
+following the missing one already is in the buffer, it is handed to the
+decoder so that inband forward error correction (FEC) data can be used.
+*/
+class AudioPacketJitterBuffer : public AudioSink, public AudioSource,
+                                public sigc::trackable
+{
+  public:
+    /**
+     * @brief The maximum number of consecutive lost frames to conceal
+     */
+    static constexpr unsigned MAX_CONCEAL_FRAMES = 5;
+
+    /**
+     * @brief Statistics for the jitter buffer
+     */
+    struct Stats
+    {
+      uint64_t  received      = 0;  ///< Number of received packets
+      uint64_t  played        = 0;  ///< Number of decoded packets
+      uint64_t  lost          = 0;  ///< Number of packets never received
+      uint64_t  late          = 0;  ///< Packets received after playout time
+      uint64_t  duplicates    = 0;  ///< Number of duplicate packets
+      uint64_t  concealed     = 0;  ///< Number of concealed frames
+      uint64_t  recovered     = 0;  ///< Concealed frames with next packet
+      uint64_t  underruns     = 0;  ///< Number of buffer underruns
+      uint64_t  compressed    = 0;  ///< Number of time compressed frames
+      uint64_t  stretched     = 0;  ///< Number of time stretched frames
+      unsigned  jitter_ms     = 0;  ///< Current interarrival jitter estimate
+      unsigned  target_ms     = 0;  ///< Current target buffering delay
+      unsigned  buffered_ms   = 0;  ///< Currently buffered audio
+      unsigned  max_buffered_ms = 0; ///< Max buffered audio
+    };
+
+    /**
+     * @brief   Default constructor
+     */
+    AudioPacketJitterBuffer(void);
+
+    /**
+     * @brief   Disallow copy construction
+     */
+    AudioPacketJitterBuffer(const AudioPacketJitterBuffer&) = delete;
+
+    /**
+     * @brief   Disallow copy assignment
+     */
+    AudioPacketJitterBuffer& operator=(const AudioPacketJitterBuffer&) = delete;
+
+    /**
+     * @brief   Destructor
+     */
+    virtual ~AudioPacketJitterBuffer(void);
+
+    /**
+     * @brief   Set the decoder to feed packets to
+     * @param   dec The decoder object
+     *
+     * The decoder output must be connected to the sink of this object. This
+     * function must be called again if the decoder object is replaced.
+     */
+    void setDecoder(AudioDecoder *dec);
+
+    /**
+     * @brief   Set the limits for the adaptive buffering delay
+     * @param   min_ms The minimum delay in milliseconds
+     * @param   max_ms The maximum delay in milliseconds
+     */
+    void setDelayLimits(unsigned min_ms, unsigned max_ms);
+
+    /**
+     * @brief   Write an encoded audio packet into the jitter buffer
+     * @param   seq   The sequence number of the packet
+     * @param   buf   Buffer containing encoded samples
+     * @param   size  The size of the buffer
+     */
+    void writeEncodedSamples(uint64_t seq, const void *buf, int size);
+
+    /**
+     * @brief   Tell the jitter buffer that a sequence number is not audio
+     * @param   seq The sequence number
+     *
+     * Use this function if the sequence number space is shared with other
+     * kinds of packets. The sequence number will then be skipped without
+     * being treated as a lost audio packet.
+     */
+    void skipSequenceNumber(uint64_t seq);
+
+    /**
+     * @brief   Call this function when the end of a talk spurt is received
+     *
+     * When all buffered packets have been played, the flushEncodedSamples
+     * function will be called in the decoder.
+     */
+    void flushEncodedSamples(void);
+
+    /**
+     * @brief   Throw away all buffered packets and go to idle state
+     *
+     * The decoder will be flushed if a talk spurt was ongoing.
+     */
+    void reset(void);
+
+    /**
+     * @brief   Check if a talk spurt is currently being played
+     * @return  Returns \em true if the jitter buffer is idle
+     */
+    bool isIdle(void) const { return m_state == STATE_IDLE; }
+
+    /**
+     * @brief   Get jitter buffer statistics
+     * @return  Returns the statistics collected since the last reset
+     */
+    const Stats& stats(void) const;
+
+    /**
+     * @brief   Reset the statistics counters
+     */
+    void resetStats(void);
+
+    /**
+     * @brief   Write samples into this audio sink
+     * @param   samples The buffer containing the samples
+     * @param   count   The number of samples in the buffer
+     * @return  Returns the number of samples that has been taken care of
+     *
+     * This function is normally only called from the connected decoder.
+     */
+    virtual int writeSamples(const float *samples, int count) override;
+
+    /**
+     * @brief   Tell the sink to flush the previously written samples
+     *
+     * This function is normally only called from the connected decoder.
+     */
+    virtual void flushSamples(void) override;
+
+    /**
+     * @brief   Resume audio output to the sink
+     *
+     * This function is normally only called from a connected sink object.
+     */
+    virtual void resumeOutput(void) override {}
+
+    /**
+     * @brief   The registered sink has flushed all samples
+     *
+     * This function is normally only called from a connected sink object.
+     */
+    virtual void allSamplesFlushed(void) override;
+
+  protected:
+
+  private:
+    using Clock     = std::chrono::steady_clock;
+    using Packet    = std::vector<uint8_t>;
+    using PacketMap = std::map<uint64_t, Packet>;
+
+    enum State { STATE_IDLE, STATE_PLAYING, STATE_STALLED };
+
+    static constexpr unsigned DEFAULT_MIN_DELAY   = 40;
+    static constexpr unsigned DEFAULT_MAX_DELAY   = 500;
+    static constexpr unsigned MAX_SEQ_JUMP        = 100;
+    static constexpr int      PLAYOUT_TIMER_MS    = 5;
+
+    AudioDecoder*     m_dec                 = nullptr;
+    PacketMap         m_packets;
+    State             m_state               = STATE_IDLE;
+    uint64_t          m_next_seq            = 0;
+    Clock::time_point m_next_playout;
+    Timer             m_playout_timer;
+    unsigned          m_min_delay           = DEFAULT_MIN_DELAY;
+    unsigned          m_max_delay           = DEFAULT_MAX_DELAY;
+    int               m_frame_size          = INTERNAL_SAMPLE_RATE / 50;
+    int               m_stretch             = 0;
+    int               m_frame_in_cnt        = 0;
+    int               m_frame_out_cnt       = 0;
+    unsigned          m_conceal_cnt         = 0;
+    bool              m_flush_pending       = false;
+    bool              m_have_transit        = false;
+    double            m_prev_transit        = 0.0;
+    double            m_jitter              = 0.0;
+    mutable Stats     m_stats;
+
+    void playoutTimerExpired(Timer *t);
+    void playNextFrame(void);
+    void concealFrame(const Packet *next=nullptr);
+    void startPlayout(uint64_t seq);
+    void stopPlayout(void);
+    void updateJitter(uint64_t seq, Clock::time_point now);
+    unsigned targetDelay(void) const;
+    unsigned bufferedDelay(void) const;
+    unsigned samplesToMs(int samples) const
+    {
+      return 1000U * samples / INTERNAL_SAMPLE_RATE;
+    }
+
+};  /* class AudioPacketJitterBuffer */
+
+
+/**
+ * @brief   Print jitter buffer statistics to a stream
+ * @param   os    The output stream
+ * @param   stats The statistics to print
+ * @return  Returns the output stream
+ */
+std::ostream& operator<<(std::ostream& os,
+                         const AudioPacketJitterBuffer::Stats& stats);
+
+
+} /* namespace Async */
+
+#endif /* ASYNC_AUDIO_PACKET_JITTER_BUFFER_INCLUDED */
+
+/*
+ * This file has not been truncated
+ */
@@ -121,13 +121,15 @@ using namespace Async;
 AudioRecorder::AudioRecorder(const string& filename,
       	      	      	     AudioRecorder::Format fmt,
 			     int sample_rate)
-  : filename(filename), file(NULL), samples_written(0), format(fmt),
+  : filename(filename), samples_written(0), format(fmt),
     sample_rate(sample_rate), max_samples(0), high_water_mark(0),
     high_water_mark_reached(false)
 {
   timerclear(&begin_timestamp);
   timerclear(&end_timestamp);
 
+  file.fileClosed.connect(sigc::mem_fun(*this, &AudioRecorder::onFileClosed));
+
   if (format == FMT_AUTO)
   {
     format = FMT_RAW;
@@ -153,23 +155,23 @@ AudioRecorder::~AudioRecorder(void)
 
 bool AudioRecorder::initialize(void)
 {
-  assert(file == NULL);
+  assert(!file.isOpen());
   
-  file = fopen(filename.c_str(), "w");
-  if (file == NULL)
+  if (!file.open(filename))
   {
-    setErrMsgFromErrno("fopen");
+    setErrMsgFromErrno("open");
     return false;
   }
   
   if (format == FMT_WAV)
   {
       // Leave room for the wave file header
-    if (fseek(file, WAVE_HEADER_SIZE, SEEK_SET) != 0)
+    char header[WAVE_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    if (!file.write(header, sizeof(header)))
     {
-      setErrMsgFromErrno("fseek");
-      fclose(file);
-      file = NULL;
+      errmsg = "Could not write WAV header placeholder";
+      file.close();
       return false;
     }
   }
@@ -195,18 +197,17 @@ void AudioRecorder::setMaxRecordingTime(unsigned time_ms, unsigned hw_time_ms)
 bool AudioRecorder::closeFile(void)
 {
   bool success = true;
-  if (file != NULL)
+  if (file.isOpen())
   {
     if (format == FMT_WAV)
     {
       success = writeWaveHeader();
     }
-    if (fclose(file) != 0)
+    if (!file.close())
     {
-      setErrMsgFromErrno("fclose");
+      setErrMsgFromWriter();
       success = false;
     }
-    file = NULL;
   }
   return success;
 } /* AudioRecorder::closeFile */
@@ -216,7 +217,7 @@ int AudioRecorder::writeSamples(const float *samples, int count)
 {
   assert(count > 0);
 
-  if (file == NULL)
+  if (!file.isOpen())
   {
     return count;
   }
@@ -256,14 +257,19 @@ int AudioRecorder::writeSamples(const float *samples, int count)
     }
   }
   
-  int written = fwrite(buf, sizeof(*buf), count, file);
-  if ((written != count) && ferror(file))
+  if (!file.write(buf, count * sizeof(*buf)))
   {
-    setErrMsgFromErrno("fwrite");
-    errorOccurred();
-    closeFile();
+    if (file.error() != 0)
+    {
+      setErrMsgFromWriter();
+      errorOccurred();
+      closeFile();
+    }
+      // The samples are thrown away if the writer queue is full since
+      // blocking the audio pipe is worse than a gap in the recording
     return count;
   }
+  int written = count;
   
   samples_written += written;
   
@@ -319,8 +325,6 @@ void AudioRecorder::flushSamples(void)
 
 bool AudioRecorder::writeWaveHeader(void)
 {
-  rewind(file);
- 
   char buf[WAVE_HEADER_SIZE];
   char *ptr = buf;
   
@@ -369,9 +373,9 @@ bool AudioRecorder::writeWaveHeader(void)
   
   assert(ptr - buf == WAVE_HEADER_SIZE);
 
-  if (fwrite(buf, 1, WAVE_HEADER_SIZE, file) != WAVE_HEADER_SIZE)
+  if (!file.writeAt(buf, WAVE_HEADER_SIZE, 0))
   {
-    setErrMsgFromErrno("fwrite");
+    setErrMsgFromWriter();
     return false;
   }
   return true;
@@ -408,6 +412,26 @@ void AudioRecorder::setErrMsgFromErrno(const std::string &fname)
 } /* AudioRecorder::setErrMsgFromErrno */
 
 
+void AudioRecorder::setErrMsgFromWriter(void)
+{
+  ostringstream ss;
+  ss << "write: " << strerror(file.error());
+  errmsg = ss.str();
+} /* AudioRecorder::setErrMsgFromWriter */
+
+
+void AudioRecorder::onFileClosed(int err)
+{
+  if (err != 0)
+  {
+    ostringstream ss;
+    ss << "write: " << strerror(err);
+    errmsg = ss.str();
+  }
+  fileClosed(err == 0);
+} /* AudioRecorder::onFileClosed */
+
+
 
 /*
  * This file has not been truncated
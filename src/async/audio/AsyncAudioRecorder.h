@@ -50,6 +50,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncFileWriter.h>
 
 
 /****************************************************************************
@@ -115,6 +116,13 @@ namespace Async
 
 Use this class to stream audio into a file. The audio is stored in raw format,
 (only samples no header) or WAV format.
+
+The file is written by a background thread (@see Async::FileWriter) so that
+slow storage does not block audio processing. If the storage cannot keep up,
+samples are thrown away rather than blocking the audio pipe. Use the
+writerStats function to check for dropped data. Since the file is written in
+the background, it is not complete when closeFile returns. Wait for the
+fileClosed signal before using the file.
 */
 class AudioRecorder : public Async::AudioSink
 {
@@ -171,9 +179,17 @@ class AudioRecorder : public Async::AudioSink
      * been closed, all samples coming in after that will be discarded.
      * If an error occurr, this function will return \em false. The error
      * message can be retrieved using the errorMsg function.
+     * The file is finalized and closed by a background thread. The
+     * fileClosed signal is emitted when that is done.
      */
     bool closeFile(void);
 
+    /**
+     * @brief   Check if the file is being finalized in the background
+     * @return  Returns \em true if the fileClosed signal is still to come
+     */
+    bool isClosing(void) const { return file.isClosing(); }
+
     /**
      * @brief   Find out how many samples that have been written so far
      * @return  Returns the number of samples written so far
@@ -192,6 +208,12 @@ class AudioRecorder : public Async::AudioSink
      */
     const struct timeval &endTimestamp(void) const { return end_timestamp; }
 
+    /**
+     * @brief   Get statistics for the background file writer
+     * @return  Returns the number of written, queued and dropped bytes
+     */
+    FileWriter::Stats writerStats(void) const { return file.stats(); }
+
     /**
      * @brief 	Write samples into this audio sink
      * @param 	samples The buffer containing the samples
@@ -245,9 +267,21 @@ class AudioRecorder : public Async::AudioSink
      */
     sigc::signal<void()> errorOccurred;
 
+    /**
+     * @brief   A signal that is emitted when a file has been closed
+     * @param   success \em true if all data was successfully written
+     *
+     * This signal is emitted when the background thread has written all data
+     * and closed the file, after closeFile has been called or the file has
+     * been closed due to a recording time limit or an error. If writing
+     * failed, the error message can be retrieved using the errorMsg function.
+     * Do not delete the audio recorder from a slot connected to this signal.
+     */
+    sigc::signal<void(bool)> fileClosed;
+
   private:
     std::string     filename;
-    FILE      	    *file;
+    FileWriter      file;
     unsigned        samples_written;
     Format    	    format;
     int       	    sample_rate;
@@ -264,6 +298,8 @@ class AudioRecorder : public Async::AudioSink
     int store32bitValue(char *ptr, uint32_t val);
     int store16bitValue(char *ptr, uint16_t val);
     void setErrMsgFromErrno(const std::string &fname);
+    void setErrMsgFromWriter(void);
+    void onFileClosed(int err);
 
 };  /* class AudioRecorder */
 
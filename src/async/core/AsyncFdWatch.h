@@ -44,6 +44,8 @@ An example of how to use the  Async::FdWatch class
 
 #include <sigc++/sigc++.h>
 
+#include <string>
+
 
 /****************************************************************************
  *
@@ -200,6 +202,23 @@ class FdWatch : public sigc::trackable
      */
     void setFd(int fd, FdWatchType type);
 
+    /**
+     * @brief Set a name for this watch
+     * @param name The name to set
+     *
+     * The name is only used to identify the watch, for example in the
+     * report printed by the main loop profiler. A good practice is to use
+     * the name of the owning class, e.g. "UdpSocket". The name is not
+     * affected by the move operator.
+     */
+    void setName(const std::string& name) { m_name = name; }
+
+    /**
+     * @brief Get the name of this watch
+     * @return Returns the name set using setName or an empty string
+     */
+    const std::string& name(void) const { return m_name; }
+
     /**
      * @brief Signal to indicate that the descriptor is active
      * @param watch Pointer to the watch object
@@ -213,6 +232,7 @@ class FdWatch : public sigc::trackable
     int       	m_fd;
     FdWatchType m_type;
     bool      	m_enabled;
+    std::string m_name;
   
 };  /* class FdWatch */
 
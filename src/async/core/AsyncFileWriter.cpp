@@ -0,0 +1,459 @@
+/**
+@file   AsyncFileWriter.cpp
+@brief  Write to a file from a background thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncFileWriter.h"
+#include "AsyncFdWatch.h"
+#include "AsyncApplication.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace Async;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Static class variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+struct FileWriter::Request
+{
+  enum Type { WRITE, WRITE_AT, CLOSE };
+
+  Type              type;
+  int               fd;
+  unsigned          gen;
+  off_t             offset;
+  std::vector<char> data;
+};
+
+
+  // The state shared with the background thread. It is kept alive by the
+  // thread after the FileWriter object has been deleted.
+struct FileWriter::State
+{
+  std::mutex              mutex;
+  std::condition_variable cond;
+  std::condition_variable idle_cond;
+  std::deque<Request>     queue;
+  bool                    busy        = false;
+  bool                    quit        = false;
+  unsigned                error_gen   = 0;
+  int                     error       = 0;
+  Stats                   stats;
+  std::deque<int>         closed;
+  int                     notify_fd   = -1;
+
+  ~State(void)
+  {
+    if (notify_fd >= 0)
+    {
+      ::close(notify_fd);
+    }
+  }
+
+  int writeAll(const Request& req);
+  void notifyClosed(void);
+};
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+FileWriter::FileWriter(size_t max_queued)
+  : m_max_queued(max_queued), m_state(std::make_shared<State>())
+{
+  m_state->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_state->notify_fd >= 0)
+  {
+    m_notify_watch = new FdWatch(m_state->notify_fd, FdWatch::FD_WATCH_RD);
+    m_notify_watch->setName("FileWriter");
+    m_notify_watch->activity.connect(
+        mem_fun(*this, &FileWriter::closedNotified));
+  }
+  else
+  {
+    std::cerr << "*** WARNING: Could not create eventfd for file writer: "
+              << std::strerror(errno) << std::endl;
+  }
+  std::thread(&FileWriter::workerFunc, m_state).detach();
+} /* FileWriter::FileWriter */
+
+
+FileWriter::~FileWriter(void)
+{
+    // Do not wait for the file to be written. The background thread will
+    // finish the queued requests on its own and then free the shared state.
+  if (m_fd != -1)
+  {
+    queueRequest(Request::CLOSE, 0, 0, 0, false);
+  }
+  delete m_notify_watch;
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->quit = true;
+  }
+  m_state->cond.notify_one();
+} /* FileWriter::~FileWriter */
+
+
+bool FileWriter::open(const std::string& name, int flags, mode_t mode)
+{
+  close();
+
+  int fd = ::open(name.c_str(), flags, mode);
+  if (fd == -1)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_state->mutex);
+  m_fd = fd;
+  ++m_gen;
+  return true;
+} /* FileWriter::open */
+
+
+bool FileWriter::write(const void *buf, size_t len)
+{
+  return queueRequest(Request::WRITE, buf, len, 0, true);
+} /* FileWriter::write */
+
+
+bool FileWriter::writeAt(const void *buf, size_t len, off_t offset)
+{
+  return queueRequest(Request::WRITE_AT, buf, len, offset, false);
+} /* FileWriter::writeAt */
+
+
+bool FileWriter::close(void)
+{
+  if (m_fd == -1)
+  {
+    return true;
+  }
+  bool success = queueRequest(Request::CLOSE, 0, 0, 0, false);
+  m_fd = -1;
+  ++m_close_pending;
+  if (m_notify_watch == nullptr)
+  {
+      // Without an eventfd we cannot be notified by the background thread
+      // so wait for the file to be closed and emit the signal from the main
+      // loop instead
+    sync();
+    Application::app().runTask(mem_fun(*this, &FileWriter::emitClosed));
+  }
+  return success;
+} /* FileWriter::close */
+
+
+void FileWriter::sync(void)
+{
+  std::unique_lock<std::mutex> lock(m_state->mutex);
+  m_state->idle_cond.wait(lock,
+      [this]{ return m_state->queue.empty() && !m_state->busy; });
+} /* FileWriter::sync */
+
+
+int FileWriter::error(void) const
+{
+  std::lock_guard<std::mutex> lock(m_state->mutex);
+  return (m_state->error_gen == m_gen) ? m_state->error : 0;
+} /* FileWriter::error */
+
+
+bool FileWriter::isCongested(void) const
+{
+  std::lock_guard<std::mutex> lock(m_state->mutex);
+  return m_state->stats.queued > m_max_queued / 2;
+} /* FileWriter::isCongested */
+
+
+FileWriter::Stats FileWriter::stats(void) const
+{
+  std::lock_guard<std::mutex> lock(m_state->mutex);
+  return m_state->stats;
+} /* FileWriter::stats */
+
+
+void FileWriter::resetStats(void)
+{
+  std::lock_guard<std::mutex> lock(m_state->mutex);
+  uint64_t queued = m_state->stats.queued;
+  m_state->stats = Stats();
+  m_state->stats.queued = queued;
+  m_state->stats.max_queued = queued;
+} /* FileWriter::resetStats */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+bool FileWriter::queueRequest(int type, const void *buf, size_t len,
+                              off_t offset, bool may_drop)
+{
+  if (m_fd == -1)
+  {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    if ((m_state->error_gen == m_gen) && (m_state->error != 0) &&
+        (type != Request::CLOSE))
+    {
+      return false;
+    }
+    if (may_drop && (m_state->stats.queued + len > m_max_queued))
+    {
+      m_state->stats.dropped += len;
+      m_state->stats.drop_cnt += 1;
+      return false;
+    }
+
+    Request req;
+    req.type = static_cast<Request::Type>(type);
+    req.fd = m_fd;
+    req.gen = m_gen;
+    req.offset = offset;
+    const char *ptr = static_cast<const char *>(buf);
+    req.data.assign(ptr, ptr + len);
+    m_state->queue.push_back(std::move(req));
+    m_state->stats.queued += len;
+    m_state->stats.max_queued =
+      std::max(m_state->stats.max_queued, m_state->stats.queued);
+  }
+  m_state->cond.notify_one();
+
+  return (type != Request::CLOSE) || (error() == 0);
+} /* FileWriter::queueRequest */
+
+
+void FileWriter::workerFunc(std::shared_ptr<State> state)
+{
+  std::unique_lock<std::mutex> lock(state->mutex);
+  for (;;)
+  {
+    state->cond.wait(lock, [&]{ return !state->queue.empty() || state->quit; });
+    if (state->queue.empty())
+    {
+      break;
+    }
+
+    Request req = std::move(state->queue.front());
+    state->queue.pop_front();
+    bool failed = (state->error_gen == req.gen) && (state->error != 0);
+    state->busy = true;
+    lock.unlock();
+
+      // Do the file operation without holding the lock so that the main
+      // thread can go on queueing data
+    int err = 0;
+    if (req.type == Request::CLOSE)
+    {
+      if ((::close(req.fd) != 0) && !failed)
+      {
+        err = errno;
+      }
+    }
+    else if (!failed)
+    {
+      err = state->writeAll(req);
+    }
+
+    lock.lock();
+    state->busy = false;
+    state->stats.queued -= req.data.size();
+    if (!failed && (err == 0))
+    {
+      state->stats.written += req.data.size();
+    }
+    if (err != 0)
+    {
+      state->error_gen = req.gen;
+      state->error = err;
+    }
+    if (req.type == Request::CLOSE)
+    {
+      state->closed.push_back((state->error_gen == req.gen) ? state->error : 0);
+      state->notifyClosed();
+    }
+    if (state->queue.empty())
+    {
+      state->idle_cond.notify_all();
+    }
+  }
+} /* FileWriter::workerFunc */
+
+
+int FileWriter::State::writeAll(const Request& req)
+{
+  size_t pos = 0;
+  while (pos < req.data.size())
+  {
+    ssize_t ret;
+    if (req.type == Request::WRITE_AT)
+    {
+      ret = ::pwrite(req.fd, req.data.data() + pos, req.data.size() - pos,
+                     req.offset + pos);
+    }
+    else
+    {
+      ret = ::write(req.fd, req.data.data() + pos, req.data.size() - pos);
+    }
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return errno;
+    }
+    pos += ret;
+  }
+  return 0;
+} /* FileWriter::State::writeAll */
+
+
+void FileWriter::State::notifyClosed(void)
+{
+  if (notify_fd < 0)
+  {
+    return;
+  }
+  uint64_t cnt = 1;
+  if (::write(notify_fd, &cnt, sizeof(cnt)) < 0)
+  {
+    std::cerr << "*** ERROR: Could not write to eventfd for file writer: "
+              << std::strerror(errno) << std::endl;
+  }
+} /* FileWriter::State::notifyClosed */
+
+
+void FileWriter::closedNotified(FdWatch *watch)
+{
+  uint64_t cnt;
+  if ((::read(watch->fd(), &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN))
+  {
+    std::cerr << "*** ERROR: Could not read from eventfd for file writer: "
+              << std::strerror(errno) << std::endl;
+  }
+  emitClosed();
+} /* FileWriter::closedNotified */
+
+
+void FileWriter::emitClosed(void)
+{
+  std::deque<int> closed;
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    closed.swap(m_state->closed);
+  }
+  for (int err : closed)
+  {
+    assert(m_close_pending > 0);
+    --m_close_pending;
+    fileClosed(err);
+  }
+} /* FileWriter::emitClosed */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,317 @@
+/**
+@file   AsyncFileWriter.h
+@brief  Write to a file from a background thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This file contains a class that queue data to be written to a file and do
+the actual writing in a background thread so that slow storage does not
+block the main loop.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_FILE_WRITER_INCLUDED
+#define ASYNC_FILE_WRITER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sigc++/sigc++.h>
+
+#include <memory>
+#include <string>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class FdWatch;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief  Write to a file from a background thread
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class is used to write data to a file without blocking the main loop.
+The file is opened in the calling thread but all writes, and the final close,
+are queued and executed in a background thread owned by the object. The
+background thread outlives the object until it has finished all queued work
+so that deleting the object never blocks the main loop.
+
+The amount of queued data is bounded. When the queue is full, the data given
+to the write function is thrown away and the drop counters are updated. The
+isCongested function can be used to find out if the queue is more than half
+full, so that the caller can back off if possible.
+
+Write errors are detected in the background thread. They are reported the
+next time write is called, or can be checked using the error function. All
+writes for a file after an error are discarded.
+
+It is possible to open a new file directly after closing the previous one.
+Queued data for the previous file will still be written before the new file
+is written to. The fileClosed signal is emitted in the main thread when the
+background thread has finished writing and closing a file. Wait for that
+signal before doing anything that require the file to be complete, like
+renaming it or handing it over to another process.
+*/
+class FileWriter : public sigc::trackable
+{
+  public:
+    /**
+     * @brief Statistics for a file writer
+     */
+    struct Stats
+    {
+      uint64_t  written     = 0;  ///< Number of bytes written to file
+      uint64_t  dropped     = 0;  ///< Number of bytes dropped on full queue
+      uint64_t  drop_cnt    = 0;  ///< Number of dropped write requests
+      uint64_t  max_queued  = 0;  ///< Max number of queued bytes
+      uint64_t  queued      = 0;  ///< Number of currently queued bytes
+    };
+
+    /**
+     * @brief The default max number of queued bytes
+     */
+    static const size_t DEFAULT_MAX_QUEUED = 1024 * 1024;
+
+    /**
+     * @brief   Constructor
+     * @param   max_queued The max number of bytes to queue for writing
+     */
+    explicit FileWriter(size_t max_queued=DEFAULT_MAX_QUEUED);
+
+    /**
+     * @brief   Disallow copy construction
+     */
+    FileWriter(const FileWriter&) = delete;
+
+    /**
+     * @brief   Disallow copy assignment
+     */
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    /**
+     * @brief   Destructor
+     *
+     * An open file is closed but the destructor does not wait for queued
+     * data to be written. The background thread is left running until all
+     * queued data has been written and the file has been closed. The
+     * fileClosed signal is not emitted for a file closed by the destructor.
+     */
+    ~FileWriter(void);
+
+    /**
+     * @brief   Open a file for writing
+     * @param   name  The name of the file to open
+     * @param   flags The open flags, @see open(2)
+     * @param   mode  The mode to create the file with, @see open(2)
+     * @return  Returns \em true on success or else \em false
+     *
+     * On failure, errno is set by the open system call. If a file is already
+     * open it will be closed first.
+     */
+    bool open(const std::string& name,
+              int flags=O_WRONLY | O_CREAT | O_TRUNC, mode_t mode=0666);
+
+    /**
+     * @brief   Check if a file is open
+     * @return  Returns \em true if a file is open
+     */
+    bool isOpen(void) const { return m_fd != -1; }
+
+    /**
+     * @brief   Queue data to be written at the current file position
+     * @param   buf The data to write
+     * @param   len The number of bytes to write
+     * @return  Returns \em true if the data was queued or \em false if it
+     *          was dropped or if a write error has occurred
+     */
+    bool write(const void *buf, size_t len);
+
+    /**
+     * @brief   Queue data to be written at the given file position
+     * @param   buf     The data to write
+     * @param   len     The number of bytes to write
+     * @param   offset  The file position to write the data at
+     * @return  Returns \em true if the data was queued or \em false if a
+     *          write error has occurred
+     *
+     * Positioned writes are never dropped since they are typically used for
+     * file headers. The current file position is not changed.
+     */
+    bool writeAt(const void *buf, size_t len, off_t offset);
+
+    /**
+     * @brief   Close the file
+     * @return  Returns \em false if a write error has been detected
+     *
+     * The file is closed in the background thread after all queued data has
+     * been written. The fileClosed signal is emitted when that is done.
+     */
+    bool close(void);
+
+    /**
+     * @brief   Check if there are files waiting to be closed
+     * @return  Returns \em true if a close is pending
+     *
+     * This function return \em true from the call to close until the
+     * fileClosed signal has been emitted for that file.
+     */
+    bool isClosing(void) const { return m_close_pending > 0; }
+
+    /**
+     * @brief   Wait for all queued data to be written
+     *
+     * This function will block until the background thread is idle.
+     */
+    void sync(void);
+
+    /**
+     * @brief   Get the error number for the first failed write
+     * @return  Returns the errno value or 0 if no error has occurred
+     *
+     * Only errors for the currently open, or last opened, file is reported.
+     */
+    int error(void) const;
+
+    /**
+     * @brief   Check if the write queue is more than half full
+     * @return  Returns \em true if the queue is congested
+     */
+    bool isCongested(void) const;
+
+    /**
+     * @brief   Get the write statistics
+     * @return  Returns a copy of the current statistics
+     */
+    Stats stats(void) const;
+
+    /**
+     * @brief   Reset the statistics counters
+     */
+    void resetStats(void);
+
+    /**
+     * @brief   A signal that is emitted when a file has been closed
+     * @param   err The errno value for the first failed operation on the
+     *              file or 0 if all data was successfully written
+     *
+     * This signal is emitted in the main thread, from the main loop, when the
+     * background thread has written all queued data and closed the file.
+     * Do not delete the FileWriter object from a slot connected to this
+     * signal.
+     */
+    sigc::signal<void(int)> fileClosed;
+
+  private:
+    struct Request;
+    struct State;
+
+    size_t                  m_max_queued;
+    int                     m_fd          = -1;
+    unsigned                m_gen         = 0;
+    unsigned                m_close_pending = 0;
+    FdWatch*                m_notify_watch = nullptr;
+    std::shared_ptr<State>  m_state;
+
+    bool queueRequest(int type, const void *buf, size_t len, off_t offset,
+                      bool may_drop);
+    void closedNotified(FdWatch *watch);
+    void emitClosed(void);
+    static void workerFunc(std::shared_ptr<State> state);
+
+};  /* class FileWriter */
+
+
+} /* namespace Async */
+
+#endif /* ASYNC_FILE_WRITER_INCLUDED */
+
+/*
+ * This file has not been truncated
+ */
@@ -41,6 +41,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <iostream>
+#include <functional>
+#include <cstdint>
 
 
 /****************************************************************************
@@ -265,6 +267,23 @@ std::istream& operator>>(std::istream& is, IpAddress& ip);
 } /* namespace */
 
 
+namespace std
+{
+  /**
+   * @brief Hash function making it possible to use an IpAddress as the key
+   *        in unordered containers like std::unordered_map
+   */
+  template <>
+  struct hash<Async::IpAddress>
+  {
+    size_t operator()(const Async::IpAddress& ip) const
+    {
+      return hash<uint32_t>()(ip.ip4Addr().s_addr);
+    }
+  };
+} /* namespace std */
+
+
 #endif /* ASYNC_IP_ADDRESS_INCLUDED */
 
 
@@ -0,0 +1,169 @@
+/**
+@file   AsyncLatencyHistogram.cpp
+@brief  A logarithmic latency histogram
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <algorithm>
+#include <iomanip>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncLatencyHistogram.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+void LatencyHistogram::add(Duration latency)
+{
+  uint64_t us =
+    std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  unsigned bucket = 0;
+  while ((bucket < BUCKET_CNT - 1) && ((us >> bucket) > 0))
+  {
+    ++bucket;
+  }
+  ++m_buckets[bucket];
+  ++m_count;
+  m_sum_us += us;
+  m_max_us = std::max(m_max_us, us);
+} /* LatencyHistogram::add */
+
+
+void LatencyHistogram::reset(void)
+{
+  m_buckets.fill(0);
+  m_count = 0;
+  m_sum_us = 0;
+  m_max_us = 0;
+} /* LatencyHistogram::reset */
+
+
+void LatencyHistogram::print(std::ostream& os,
+                             const std::string& indent) const
+{
+  os << "count=" << m_count;
+  if (m_count > 0)
+  {
+    os << " avg=" << (m_sum_us / m_count) << "us max=" << m_max_us << "us";
+  }
+  os << "\n";
+  for (unsigned bucket=0; bucket<BUCKET_CNT; ++bucket)
+  {
+    if (m_buckets[bucket] == 0)
+    {
+      continue;
+    }
+    if (bucket < BUCKET_CNT - 1)
+    {
+      os << indent << "<  " << std::setw(8) << (1ULL << bucket);
+    }
+    else
+    {
+      os << indent << ">= " << std::setw(8) << (1ULL << (bucket - 1));
+    }
+    os << "us: " << m_buckets[bucket] << "\n";
+  }
+} /* LatencyHistogram::print */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,173 @@
+/**
+@file   AsyncLatencyHistogram.h
+@brief  A logarithmic latency histogram
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This file contains a class used to collect latency measurements in a
+histogram with logarithmic buckets.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_LATENCY_HISTOGRAM_INCLUDED
+#define ASYNC_LATENCY_HISTOGRAM_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief  A logarithmic latency histogram
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class collect latency measurements in a histogram with logarithmic
+buckets. Bucket n hold latencies in the range [2^(n-1), 2^n) microseconds.
+The last bucket also hold all latencies longer than that. The average and
+maximum latency is also tracked.
+*/
+class LatencyHistogram
+{
+  public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    /**
+     * @brief   Add a latency measurement to the histogram
+     * @param   latency The measured latency
+     */
+    void add(Duration latency);
+
+    /**
+     * @brief   Clear all measurements
+     */
+    void reset(void);
+
+    /**
+     * @brief   Get the number of measurements in the histogram
+     * @return  Returns the number of measurements
+     */
+    uint64_t count(void) const { return m_count; }
+
+    /**
+     * @brief   Print the histogram
+     * @param   os      The stream to print to
+     * @param   indent  The indentation to use for the bucket rows
+     *
+     * A summary line is first printed, without indentation, followed by one
+     * line for each non-empty bucket.
+     */
+    void print(std::ostream& os, const std::string& indent) const;
+
+  private:
+    static constexpr unsigned BUCKET_CNT = 24;
+
+    std::array<uint64_t, BUCKET_CNT> m_buckets {};
+    uint64_t                         m_count   = 0;
+    uint64_t                         m_sum_us  = 0;
+    uint64_t                         m_max_us  = 0;
+
+};  /* class LatencyHistogram */
+
+
+} /* namespace */
+
+#endif /* ASYNC_LATENCY_HISTOGRAM_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
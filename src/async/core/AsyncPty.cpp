@@ -124,6 +124,7 @@ Pty::Pty(const std::string &slave_link)
   : m_slave_link(slave_link),
     m_pollhup_timer(POLLHUP_CHECK_INTERVAL, Timer::TYPE_PERIODIC)
 {
+  m_watch.setName("Pty::charactersReceived");
   m_watch.activity.connect(
       sigc::hide(sigc::mem_fun(*this, &Pty::charactersReceived)));
   m_pollhup_timer.setEnable(false);
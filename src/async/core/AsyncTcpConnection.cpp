@@ -164,6 +164,8 @@ TcpConnection::TcpConnection(int sock, const IpAddress& remote_addr,
   : remote_addr(remote_addr), remote_port(remote_port), sock(sock)
 {
   m_recv_buf.reserve(recv_buf_len);
+  rd_watch.setName("TcpConnection::recvHandler");
+  m_wr_watch.setName("TcpConnection::onWriteSpaceAvailable");
   rd_watch.activity.connect(
       mem_fun(*this, &TcpConnection::recvHandler));
   m_wr_watch.activity.connect(
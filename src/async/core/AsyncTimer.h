@@ -46,6 +46,7 @@ An example of how to use the Async::Timer class
 
 #include <sigc++/sigc++.h>
 
+#include <string>
 
 
 /****************************************************************************
@@ -198,6 +199,21 @@ class Timer : public sigc::trackable
      * If the timer is disabled, this function will do nothing.
      */
     void reset(void);
+
+    /**
+     * @brief   Set a name for this timer
+     * @param   name The name to set
+     *
+     * The name is only used to identify the timer, for example in the
+     * report printed by the main loop profiler.
+     */
+    void setName(const std::string& name) { m_name = name; }
+
+    /**
+     * @brief   Get the name of this timer
+     * @return  Returns the name set using setName or an empty string
+     */
+    const std::string& name(void) const { return m_name; }
     
     /**
      * @brief 	A signal that is emitted when the timer expires
@@ -216,6 +232,7 @@ class Timer : public sigc::trackable
     Type  m_type;
     int   m_timeout_ms;
     bool  m_is_enabled;
+    std::string m_name;
   
 };  /* class Timer */
 
@@ -45,6 +45,10 @@
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <iostream>
 
 
 /****************************************************************************
@@ -54,6 +58,7 @@
  ****************************************************************************/
 
 #include <AsyncFdWatch.h>
+#include <AsyncApplication.h>
 
 
 /****************************************************************************
@@ -109,6 +114,56 @@ class UdpPacket
 };
 
 
+class UdpRecvBatch
+{
+  public:
+    std::vector<char>               buf;
+    std::vector<struct mmsghdr>     msgs;
+    std::vector<struct iovec>       iovs;
+    std::vector<struct sockaddr_in> addrs;
+
+    UdpRecvBatch(unsigned cnt, size_t max_size)
+      : buf(cnt * max_size), msgs(cnt), iovs(cnt), addrs(cnt)
+    {
+      memset(&msgs[0], 0, cnt * sizeof(msgs[0]));
+      for (unsigned i=0; i<cnt; ++i)
+      {
+        iovs[i].iov_base = &buf[i * max_size];
+        iovs[i].iov_len = max_size;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+      }
+    }
+};
+
+
+class UdpSendQueue
+{
+  public:
+    static constexpr size_t MAX_QUEUED = 1024;
+    static constexpr size_t MAX_BATCH = 64;
+
+    struct Datagram
+    {
+      struct sockaddr_in  addr;
+      std::vector<char>   data;
+    };
+
+    std::deque<Datagram>        datagrams;
+    std::vector<struct mmsghdr> msgs;
+    std::vector<struct iovec>   iovs;
+    bool                        flush_pending;
+    bool                        is_full;
+
+    UdpSendQueue(void)
+      : msgs(MAX_BATCH), iovs(MAX_BATCH), flush_pending(false),
+        is_full(false)
+    {
+    }
+};
+
+
 /****************************************************************************
  *
  * Prototypes
@@ -154,7 +209,8 @@ class UdpPacket
  *------------------------------------------------------------------------
  */
 UdpSocket::UdpSocket(uint16_t local_port, const IpAddress &bind_ip)
-  : sock(-1), rd_watch(0), wr_watch(0), send_buf(0)
+  : sock(-1), rd_watch(0), wr_watch(0), send_buf(0), recv_batch(0),
+    send_queue(0), deleted(0)
 {
     // Create UDP socket
   sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -200,12 +256,14 @@ UdpSocket::UdpSocket(uint16_t local_port, const IpAddress &bind_ip)
     // Setup a watch for incoming data
   rd_watch = new FdWatch(sock, FdWatch::FD_WATCH_RD);
   assert(rd_watch != 0);
+  rd_watch->setName("UdpSocket::handleInput");
   rd_watch->activity.connect(mem_fun(*this, &UdpSocket::handleInput));
 
     // Setup a watch for outgoing data (signals activity when a buffer full
     // condition occurs)
   wr_watch = new FdWatch(sock, FdWatch::FD_WATCH_WR);
   assert(wr_watch != 0);
+  wr_watch->setName("UdpSocket::sendRest");
   wr_watch->activity.connect(mem_fun(*this, &UdpSocket::sendRest));
   wr_watch->setEnabled(false);
   
@@ -214,6 +272,14 @@ UdpSocket::UdpSocket(uint16_t local_port, const IpAddress &bind_ip)
 
 UdpSocket::~UdpSocket(void)
 {
+  if (deleted != 0)
+  {
+    *deleted = true;
+  }
+    // Try to send queued datagrams so that e.g. a goodbye message written
+    // just before the socket is deleted is not lost
+  sendBufferFull.clear();
+  flushWrites();
   cleanup();
 } /* UdpSocket::~UdpSocket */
 
@@ -261,9 +327,30 @@ bool UdpSocket::write(const IpAddress& remote_ip, int remote_port,
   }
   
   struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
   addr.sin_family = AF_INET;
   addr.sin_port = htons(remote_port);
   addr.sin_addr = remote_ip.ip4Addr();
+
+  if (send_queue != 0)
+  {
+    if (send_queue->datagrams.size() >= UdpSendQueue::MAX_QUEUED)
+    {
+      return false;
+    }
+    send_queue->datagrams.push_back(UdpSendQueue::Datagram());
+    UdpSendQueue::Datagram& datagram = send_queue->datagrams.back();
+    datagram.addr = addr;
+    const char *ptr = static_cast<const char *>(buf);
+    datagram.data.assign(ptr, ptr + count);
+    if (!send_queue->is_full && !send_queue->flush_pending)
+    {
+      send_queue->flush_pending = true;
+      Application::app().runTask(mem_fun(*this, &UdpSocket::flushWrites));
+    }
+    return true;
+  }
+
   int ret = sendto(sock, buf, count, 0,
       reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
   if (ret == -1)
@@ -288,6 +375,91 @@ bool UdpSocket::write(const IpAddress& remote_ip, int remote_port,
 } /* UdpSocket::write */
 
 
+void UdpSocket::setRecvBatchSize(unsigned max_datagrams, size_t max_size)
+{
+  delete recv_batch;
+  recv_batch = 0;
+  if (max_datagrams > 1)
+  {
+    recv_batch = new UdpRecvBatch(max_datagrams, max_size);
+  }
+} /* UdpSocket::setRecvBatchSize */
+
+
+void UdpSocket::setSendBatching(bool enable)
+{
+  if (enable && (send_queue == 0))
+  {
+    send_queue = new UdpSendQueue;
+  }
+  else if (!enable && (send_queue != 0))
+  {
+    flushWrites();
+    if (send_queue->is_full)
+    {
+      wr_watch->setEnabled(false);
+      sendBufferFull(false);
+    }
+    delete send_queue;
+    send_queue = 0;
+  }
+} /* UdpSocket::setSendBatching */
+
+
+void UdpSocket::flushWrites(void)
+{
+  if (send_queue == 0)
+  {
+    return;
+  }
+  send_queue->flush_pending = false;
+
+  while (!send_queue->datagrams.empty())
+  {
+    size_t cnt = min(send_queue->datagrams.size(), UdpSendQueue::MAX_BATCH);
+    for (size_t i=0; i<cnt; ++i)
+    {
+      UdpSendQueue::Datagram& datagram = send_queue->datagrams[i];
+      struct iovec& iov = send_queue->iovs[i];
+      iov.iov_base = &datagram.data[0];
+      iov.iov_len = datagram.data.size();
+      struct mmsghdr& msg = send_queue->msgs[i];
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_hdr.msg_name = &datagram.addr;
+      msg.msg_hdr.msg_namelen = sizeof(datagram.addr);
+      msg.msg_hdr.msg_iov = &iov;
+      msg.msg_hdr.msg_iovlen = 1;
+    }
+    int ret = sendmmsg(sock, &send_queue->msgs[0], cnt, 0);
+    if (ret == -1)
+    {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      {
+        if (!send_queue->is_full)
+        {
+          send_queue->is_full = true;
+          wr_watch->setEnabled(true);
+          sendBufferFull(true);
+        }
+        return;
+      }
+        // Drop the datagram that could not be sent and go on with the rest
+      perror("sendmmsg in UdpSocket::flushWrites");
+      ret = 1;
+    }
+    send_queue->datagrams.erase(send_queue->datagrams.begin(),
+                                send_queue->datagrams.begin() + ret);
+  }
+
+  if (send_queue->is_full)
+  {
+    send_queue->is_full = false;
+    wr_watch->setEnabled(false);
+    sendBufferFull(false);
+  }
+} /* UdpSocket::flushWrites */
+
+
 
 /****************************************************************************
  *
@@ -331,6 +503,12 @@ void UdpSocket::cleanup(void)
   
   delete send_buf;
   send_buf = 0;
+
+  delete recv_batch;
+  recv_batch = 0;
+
+  delete send_queue;
+  send_queue = 0;
   
   if (sock != -1)
   {
@@ -345,6 +523,12 @@ void UdpSocket::cleanup(void)
 
 void UdpSocket::handleInput(FdWatch *watch)
 {
+  if (recv_batch != 0)
+  {
+    handleInputBatch();
+    return;
+  }
+
   char buf[65536];
   struct sockaddr_in addr;
   socklen_t addr_len = sizeof(addr);
@@ -361,8 +545,58 @@ void UdpSocket::handleInput(FdWatch *watch)
 } /* UdpSocket::handleInput */
 
 
+void UdpSocket::handleInputBatch(void)
+{
+  for (size_t i=0; i<recv_batch->msgs.size(); ++i)
+  {
+    recv_batch->msgs[i].msg_hdr.msg_namelen = sizeof(recv_batch->addrs[i]);
+    recv_batch->msgs[i].msg_hdr.msg_flags = 0;
+  }
+  int cnt = recvmmsg(sock, &recv_batch->msgs[0], recv_batch->msgs.size(),
+                     0, 0);
+  if (cnt == -1)
+  {
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+    {
+      perror("recvmmsg in UdpSocket::handleInputBatch");
+    }
+    return;
+  }
+
+    // A receive handler may delete this socket so we must check for that
+    // before handling the next datagram
+  bool is_deleted = false;
+  deleted = &is_deleted;
+  for (int i=0; i<cnt; ++i)
+  {
+    const struct mmsghdr& msg = recv_batch->msgs[i];
+    const struct sockaddr_in& addr = recv_batch->addrs[i];
+    if ((msg.msg_hdr.msg_flags & MSG_TRUNC) != 0)
+    {
+      cerr << "*** WARNING: Dropping too large UDP datagram received from "
+           << IpAddress(addr.sin_addr) << ":" << ntohs(addr.sin_port)
+           << endl;
+      continue;
+    }
+    onDataReceived(IpAddress(addr.sin_addr), ntohs(addr.sin_port),
+                   msg.msg_hdr.msg_iov->iov_base, msg.msg_len);
+    if (is_deleted)
+    {
+      return;
+    }
+  }
+  deleted = 0;
+} /* UdpSocket::handleInputBatch */
+
+
 void UdpSocket::sendRest(FdWatch *watch)
 {
+  if (send_buf == 0)
+  {
+    flushWrites();
+    return;
+  }
+
   struct sockaddr_in addr;
   addr.sin_family = AF_INET;
   addr.sin_port = htons(send_buf->port);
@@ -394,6 +628,11 @@ void UdpSocket::sendRest(FdWatch *watch)
   delete send_buf;
   send_buf = 0;
   wr_watch->setEnabled(false);
+
+  if ((send_queue != 0) && !send_queue->datagrams.empty())
+  {
+    flushWrites();
+  }
   
 } /* UdpSocket::sendRest */
 
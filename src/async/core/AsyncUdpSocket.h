@@ -69,6 +69,8 @@ An example of how to use the Async::UdpSocket class
  ****************************************************************************/
 
 class UdpPacket;
+class UdpRecvBatch;
+class UdpSendQueue;
 
 
 /****************************************************************************
@@ -171,6 +173,47 @@ class UdpSocket : public sigc::trackable
     virtual bool write(const IpAddress& remote_ip, int remote_port,
         const void *buf, int count);
 
+    /**
+     * @brief   Set the maximum number of datagrams to read in one go
+     * @param   max_datagrams The maximum number of datagrams to read each
+     *                        time the socket becomes readable
+     * @param   max_size      The maximum size of a received datagram
+     *
+     * Normally one datagram is read each time the socket becomes readable.
+     * On a busy socket it is more efficient to read a number of datagrams
+     * using a single system call. The dataReceived signal is still emitted
+     * once for each datagram. Received datagrams larger than max_size are
+     * dropped so it must be set to the largest datagram the application
+     * protocol may send. Setting max_datagrams to one restore the default
+     * behaviour. This function must not be called from a dataReceived
+     * handler.
+     */
+    void setRecvBatchSize(unsigned max_datagrams, size_t max_size=65536);
+
+    /**
+     * @brief   Enable or disable batching of outgoing datagrams
+     * @param   enable Set to \em true to enable batching
+     *
+     * When batching is enabled, datagrams written using the write function
+     * are queued and then sent using as few system calls as possible when
+     * control is returned to the main loop, or when the flushWrites function
+     * is called. This is more efficient when many datagrams are sent in
+     * response to one event, e.g. when audio is distributed to many remote
+     * hosts. Queued datagrams are sent before batching is disabled and when
+     * the socket is deleted, as long as there is room in the send buffer.
+     */
+    void setSendBatching(bool enable);
+
+    /**
+     * @brief   Send all queued datagrams
+     *
+     * When send batching is enabled, call this function to send all queued
+     * datagrams immediately instead of waiting for control to return to the
+     * main loop. If the send buffer becomes full, the rest of the datagrams
+     * will be sent when there is room.
+     */
+    void flushWrites(void);
+
     /**
      * @brief   Get the file descriptor for the UDP socket
      * @return  Returns the file descriptor associated with the socket or
@@ -199,13 +242,17 @@ class UdpSocket : public sigc::trackable
         int count);
 
   private:
-    int       	sock;
-    FdWatch * 	rd_watch;
-    FdWatch * 	wr_watch;
-    UdpPacket * send_buf;
-    
+    int             sock;
+    FdWatch *       rd_watch;
+    FdWatch *       wr_watch;
+    UdpPacket *     send_buf;
+    UdpRecvBatch *  recv_batch;
+    UdpSendQueue *  send_queue;
+    bool *          deleted;
+
     void cleanup(void);
     void handleInput(FdWatch *watch);
+    void handleInputBatch(void);
     void sendRest(FdWatch *watch);
 
 };  /* class UdpSocket */
@@ -45,6 +45,10 @@
 #include <cerrno>
 #include <cassert>
 #include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
 
 
 /****************************************************************************
@@ -123,6 +127,9 @@ using namespace Async;
  *
  ****************************************************************************/
 
+static int64_t timespecDiffNs(const struct timespec& t1,
+                              const struct timespec& t2);
+
 
 
 /****************************************************************************
@@ -162,7 +169,9 @@ int CppApplication::sighandler_pipe[2];
  *------------------------------------------------------------------------
  */
 CppApplication::CppApplication(void)
-  : do_quit(false), max_desc(0), unix_signal_recv(-1), unix_signal_recv_cnt(0)
+  : do_quit(false), max_desc(0), unix_signal_recv(-1), unix_signal_recv_cnt(0),
+    prof_enabled(false), prof_report_interval(0),
+    prof_top_cnt(DEFAULT_PROFILING_TOP_CNT), prof_wakeups(0), prof_wait_ns(0)
 {
   FD_ZERO(&rd_set);
   FD_ZERO(&wr_set);
@@ -185,6 +194,7 @@ void CppApplication::exec(void)
   }
 
   FdWatch watch(sighandler_pipe[0], FdWatch::FD_WATCH_RD);
+  watch.setName("CppApplication::handleUnixSignal");
   watch.activity.connect(
       hide(mem_fun(*this, &CppApplication::handleUnixSignal)));
 
@@ -232,8 +242,20 @@ void CppApplication::exec(void)
     
     fd_set local_rd_set = rd_set;
     fd_set local_wr_set = wr_set;
+    struct timespec wait_start;
+    if (prof_enabled)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &wait_start);
+    }
     int dcnt = pselect(max_desc, &local_rd_set, &local_wr_set, NULL,
 	timeout_ptr, NULL);
+    struct timespec wakeup_time = {0, 0};
+    if (prof_enabled)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &wakeup_time);
+      prof_wait_ns += timespecDiffNs(wakeup_time, wait_start);
+      ++prof_wakeups;
+    }
     if (dcnt == -1)
     {
       if ((errno == EINTR) || (errno == EAGAIN))
@@ -253,7 +275,22 @@ void CppApplication::exec(void)
            )
        )
     {
-      titer->second->expired(titer->second);
+      if (prof_enabled)
+      {
+          // The label must be created before the callback is called since
+          // the timer may be deleted by the callback
+        std::string label = profilingLabel(titer->second);
+        int64_t late_ns = std::max(timespecDiffNs(wakeup_time, titer->first),
+                                   int64_t(0));
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        titer->second->expired(titer->second);
+        profileCallback(label, start, late_ns);
+      }
+      else
+      {
+        titer->second->expired(titer->second);
+      }
       if ((titer->second != 0) &&
 	  (titer->second->type() == Timer::TYPE_PERIODIC))
       {
@@ -272,7 +309,15 @@ void CppApplication::exec(void)
       ++next_witer;
       if (FD_ISSET(witer->first, &local_rd_set))
       {
-	if (witer->second != 0)
+	if ((witer->second != 0) && prof_enabled)
+	{
+          std::string label = profilingLabel(witer->second);
+          struct timespec start;
+          clock_gettime(CLOCK_MONOTONIC, &start);
+	  witer->second->activity(witer->second);
+          profileCallback(label, start);
+	}
+	else if (witer->second != 0)
 	{
 	  witer->second->activity(witer->second);
 	}
@@ -293,7 +338,15 @@ void CppApplication::exec(void)
       ++next_witer;
       if (FD_ISSET(witer->first, &local_wr_set))
       {
-	if (witer->second != 0)
+	if ((witer->second != 0) && prof_enabled)
+	{
+          std::string label = profilingLabel(witer->second);
+          struct timespec start;
+          clock_gettime(CLOCK_MONOTONIC, &start);
+	  witer->second->activity(witer->second);
+          profileCallback(label, start);
+	}
+	else if (witer->second != 0)
 	{
 	  witer->second->activity(witer->second);
 	}
@@ -307,6 +360,11 @@ void CppApplication::exec(void)
     }
     
     assert(dcnt == 0);
+
+    if (prof_enabled)
+    {
+      checkProfilingReport();
+    }
   }
 
   for (UnixSignalMap::const_iterator it = unix_signals.begin();
@@ -378,6 +436,79 @@ void CppApplication::uncatchUnixSignal(int signum)
 } /* CppApplication::uncatchUnixSignal */
 
 
+void CppApplication::enableProfiling(unsigned report_interval_ms,
+                                     unsigned top_cnt)
+{
+  prof_enabled = true;
+  prof_report_interval = report_interval_ms;
+  prof_top_cnt = top_cnt;
+  prof_map.clear();
+  prof_wakeups = 0;
+  prof_wait_ns = 0;
+  clock_gettime(CLOCK_MONOTONIC, &prof_start);
+} /* CppApplication::enableProfiling */
+
+
+void CppApplication::disableProfiling(void)
+{
+  prof_enabled = false;
+  prof_map.clear();
+} /* CppApplication::disableProfiling */
+
+
+void CppApplication::printProfilingReport(std::ostream& os) const
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t period_ns = std::max(timespecDiffNs(now, prof_start), int64_t(1));
+  int64_t busy_ns = std::max(period_ns - prof_wait_ns, int64_t(0));
+
+  std::vector<ProfMap::const_iterator> entries;
+  for (ProfMap::const_iterator it=prof_map.begin(); it!=prof_map.end(); ++it)
+  {
+    entries.push_back(it);
+  }
+  std::sort(entries.begin(), entries.end(),
+      [](ProfMap::const_iterator a, ProfMap::const_iterator b)
+      {
+        return a->second.total_ns > b->second.total_ns;
+      });
+  if (entries.size() > prof_top_cnt)
+  {
+    entries.resize(prof_top_cnt);
+  }
+
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  ss << "Main loop profile for the last " << (period_ns / 1e9) << "s: "
+     << "wakeups=" << prof_wakeups
+     << " busy=" << (100.0 * busy_ns / period_ns) << "%\n";
+  ss << "  " << std::setw(10) << "total[ms]" << std::setw(9) << "count"
+     << std::setw(10) << "avg[us]" << std::setw(10) << "max[us]"
+     << std::setw(11) << "late[ms]" << std::setw(11) << "maxlt[ms]"
+     << "  name\n";
+  for (const auto& it : entries)
+  {
+    const ProfEntry& e = it->second;
+    ss << "  " << std::setw(10) << (e.total_ns / 1e6)
+       << std::setw(9) << e.count
+       << std::setw(10) << (e.total_ns / 1e3 / e.count)
+       << std::setw(10) << (e.max_ns / 1e3);
+    if (e.late_count > 0)
+    {
+      ss << std::setw(11) << (e.total_late_ns / 1e6 / e.late_count)
+         << std::setw(11) << (e.max_late_ns / 1e6);
+    }
+    else
+    {
+      ss << std::setw(11) << "-" << std::setw(11) << "-";
+    }
+    ss << "  " << it->first << "\n";
+  }
+  os << ss.str() << std::flush;
+} /* CppApplication::printProfilingReport */
+
+
 
 /****************************************************************************
  *
@@ -560,6 +691,79 @@ void CppApplication::handleUnixSignal(void)
 } /* CppApplication::handleUnixSignal */
 
 
+void CppApplication::profileCallback(const std::string& label,
+                                     const struct timespec& start,
+                                     int64_t late_ns)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t duration_ns = timespecDiffNs(now, start);
+  ProfEntry& e = prof_map[label];
+  e.count += 1;
+  e.total_ns += duration_ns;
+  e.max_ns = std::max(e.max_ns, duration_ns);
+  if (late_ns >= 0)
+  {
+    e.late_count += 1;
+    e.total_late_ns += late_ns;
+    e.max_late_ns = std::max(e.max_late_ns, late_ns);
+  }
+} /* CppApplication::profileCallback */
+
+
+void CppApplication::checkProfilingReport(void)
+{
+  if (prof_report_interval == 0)
+  {
+    return;
+  }
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (timespecDiffNs(now, prof_start) >=
+      int64_t(prof_report_interval) * 1000000)
+  {
+    printProfilingReport(std::cout);
+    prof_map.clear();
+    prof_wakeups = 0;
+    prof_wait_ns = 0;
+    prof_start = now;
+  }
+} /* CppApplication::checkProfilingReport */
+
+
+std::string CppApplication::profilingLabel(const FdWatch *watch) const
+{
+  if (!watch->name().empty())
+  {
+    return watch->name();
+  }
+  std::ostringstream ss;
+  ss << "FdWatch(fd=" << watch->fd()
+     << (watch->type() == FdWatch::FD_WATCH_RD ? ",rd)" : ",wr)");
+  return ss.str();
+} /* CppApplication::profilingLabel */
+
+
+std::string CppApplication::profilingLabel(const Timer *timer) const
+{
+  if (!timer->name().empty())
+  {
+    return timer->name();
+  }
+  std::ostringstream ss;
+  ss << "Timer(" << timer->timeout() << "ms)";
+  return ss.str();
+} /* CppApplication::profilingLabel */
+
+
+static int64_t timespecDiffNs(const struct timespec& t1,
+                              const struct timespec& t2)
+{
+  return (static_cast<int64_t>(t1.tv_sec) - t2.tv_sec) * 1000000000 +
+         (t1.tv_nsec - t2.tv_nsec);
+} /* timespecDiffNs */
+
+
 
 /*
  * This file has not been truncated
@@ -45,7 +45,10 @@
 #include <sigc++/sigc++.h>
 
 #include <map>
+#include <string>
+#include <ostream>
 #include <utility>
+#include <stdint.h>
 
 
 /****************************************************************************
@@ -174,6 +177,46 @@ class CppApplication : public Application
      */
     void quit(void);
 
+    /**
+     * @brief   Enable the main loop profiler
+     * @param   report_interval_ms  How often to print a report
+     * @param   top_cnt             The number of entries to print
+     *
+     * When the profiler is enabled, the time spent in each FdWatch and Timer
+     * callback is measured. Callbacks are identified by the name set using
+     * the setName function in FdWatch and Timer. Unnamed watches are
+     * identified by file descriptor and unnamed timers by timeout value.
+     * For timers, the lateness, that is how long after the expiration time
+     * that the callback was called, is also measured. The number of main
+     * loop wakeups and the time spent waiting for events are counted too.
+     *
+     * Every report_interval_ms milliseconds a report listing the top_cnt
+     * callbacks that consumed the most time is printed to standard output.
+     * The statistics are then reset.
+     */
+    void enableProfiling(unsigned report_interval_ms,
+                         unsigned top_cnt=DEFAULT_PROFILING_TOP_CNT);
+
+    /**
+     * @brief   Disable the main loop profiler
+     */
+    void disableProfiling(void);
+
+    /**
+     * @brief   Check if the main loop profiler is enabled
+     * @return  Returns \em true if the profiler is enabled
+     */
+    bool profilingEnabled(void) const { return prof_enabled; }
+
+    /**
+     * @brief   Print a main loop profiling report
+     * @param   os The stream to print the report to
+     *
+     * Print a report for the profiling data collected since the last report
+     * was printed. The statistics are not reset by this function.
+     */
+    void printProfilingReport(std::ostream& os) const;
+
     /**
      * @brief   A signal that is emitted when a monitored UNIX signal is caught
      * @param   signum The signal number that was caught
@@ -187,6 +230,8 @@ class CppApplication : public Application
   protected:
     
   private:
+    static const unsigned DEFAULT_PROFILING_TOP_CNT = 10;
+
     struct lttimespec
     {
       bool operator()(const struct timespec& t1, const struct timespec& t2) const
@@ -199,6 +244,16 @@ class CppApplication : public Application
     typedef std::map<int, FdWatch*>   	      	      	        WatchMap;
     typedef std::multimap<struct timespec, Timer *, lttimespec> TimerMap;
     typedef std::map<int, struct sigaction>                     UnixSignalMap;
+    struct ProfEntry
+    {
+      uint64_t  count         = 0;
+      int64_t   total_ns      = 0;
+      int64_t   max_ns        = 0;
+      uint64_t  late_count    = 0;
+      int64_t   total_late_ns = 0;
+      int64_t   max_late_ns   = 0;
+    };
+    typedef std::map<std::string, ProfEntry>                    ProfMap;
     
     static int          sighandler_pipe[2];
 
@@ -212,6 +267,13 @@ class CppApplication : public Application
     UnixSignalMap       unix_signals;
     int                 unix_signal_recv;
     size_t              unix_signal_recv_cnt;
+    bool                prof_enabled;
+    unsigned            prof_report_interval;
+    unsigned            prof_top_cnt;
+    struct timespec     prof_start;
+    ProfMap             prof_map;
+    uint64_t            prof_wakeups;
+    int64_t             prof_wait_ns;
     
     static void unixSignalHandler(int signum);
 
@@ -222,6 +284,11 @@ class CppApplication : public Application
     void delTimer(Timer *timer);    
     DnsLookupWorker *newDnsLookupWorker(const DnsLookup& lookup);
     void handleUnixSignal(void);
+    void profileCallback(const std::string& label,
+                         const struct timespec& start, int64_t late_ns=-1);
+    void checkProfilingReport(void);
+    std::string profilingLabel(const FdWatch *watch) const;
+    std::string profilingLabel(const Timer *timer) const;
     
 };  /* class CppApplication */
 
@@ -47,6 +47,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cctype>
 #include <cassert>
 #include <cstring>
+#include <iterator>
 
 
 /****************************************************************************
@@ -127,6 +128,16 @@ struct Cmd
  *
  ****************************************************************************/
 
+namespace {
+  bool stationDataEq(const StationData& lhs, const StationData& rhs)
+  {
+    return (lhs.id() == rhs.id()) && (lhs.status() == rhs.status()) &&
+           (lhs.time() == rhs.time()) &&
+           (lhs.description() == rhs.description()) &&
+           (lhs.ip() == rhs.ip());
+  } /* stationDataEq */
+};
+
 
 
 /****************************************************************************
@@ -144,7 +155,7 @@ Directory::Directory(const vector<string>& servers, const string& callsign,
     ctrl_con(0),
     the_status(StationData::STAT_OFFLINE),    reg_refresh_timer(0),
     current_status(StationData::STAT_OFFLINE),server_changed(false),
-    cmd_timer(0), bind_ip(bind_ip)
+    cmd_timer(0), bind_ip(bind_ip), refresh_gen(0)
 {
   the_callsign.resize(callsign.size());
   transform(callsign.begin(), callsign.end(), the_callsign.begin(), ::toupper);
@@ -207,10 +218,7 @@ void Directory::getCalls(void)
   }
   else
   {
-    the_links.clear();
-    the_repeaters.clear();
-    the_conferences.clear();
-    the_stations.clear();
+    clearStationList();
     error("Trying to update the directory list while not registered with the "
       	  "directory server");
     //stationListUpdated();
@@ -251,140 +259,54 @@ void Directory::setDescription(const string& description)
 
 const StationData *Directory::findCall(const string& call)
 {
-  list<StationData> calls;
-  list<StationData>::const_iterator iter;
-  
-  for (iter=the_links.begin(); iter!=the_links.end(); ++iter)
+  CallIndex::const_iterator it = call_index.find(call);
+  if (it != call_index.end())
   {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
+    return &(*it->second.it);
   }
-  
-  for (iter=the_repeaters.begin(); iter!=the_repeaters.end(); ++iter)
-  {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_conferences.begin(); iter!=the_conferences.end(); ++iter)
-  {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_stations.begin(); iter!=the_stations.end(); ++iter)
-  {
-    if (iter->callsign() == call)
-    {
-      return &(*iter);
-    }
-  }
-  
   return 0;
-  
 } /* Directory::findCall */
 
 
 const StationData *Directory::findStation(int id)
 {
-  list<StationData> calls;
-  list<StationData>::const_iterator iter;
-  
-  for (iter=the_links.begin(); iter!=the_links.end(); ++iter)
-  {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_repeaters.begin(); iter!=the_repeaters.end(); ++iter)
+  IdIndex::const_iterator it = id_index.find(id);
+  if (it != id_index.end())
   {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
-  }
-  
-  for (iter=the_conferences.begin(); iter!=the_conferences.end(); ++iter)
-  {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
+    return it->second;
   }
-  
-  for (iter=the_stations.begin(); iter!=the_stations.end(); ++iter)
-  {
-    if (iter->id() == id)
-    {
-      return &(*iter);
-    }
-  }
-  
   return 0;
-  
 } /* Directory::findStation */
 
 
-bool Directory::stationCodeEq(const StationData& stn, string code, bool exact)
-{
-  if (exact)
-  {
-    return (stn.code() == code);
-  }
-  else
-  {
-    return (stn.code().find(code) == 0);
-  }
-} /* Directory::stationCodeEq  */
-
-
 void Directory::findStationsByCode(vector<StationData> &stns,
 		const string& code, bool exact)
 {
-  list<StationData>::const_iterator iter;
-  
   stns.clear();
 
-  for (iter=the_links.begin(); iter!=the_links.end(); ++iter)
-  {
-    if (stationCodeEq(*iter, code, exact))
-    {
-      stns.push_back(*iter);
-    }
-  }
-  
-  for (iter=the_repeaters.begin(); iter!=the_repeaters.end(); ++iter)
-  {
-    if (stationCodeEq(*iter, code, exact))
-    {
-      stns.push_back(*iter);
-    }
-  }
-  
-  for (iter=the_conferences.begin(); iter!=the_conferences.end(); ++iter)
+  if (exact)
   {
-    if (stationCodeEq(*iter, code, exact))
+    pair<CodeIndex::const_iterator, CodeIndex::const_iterator> range =
+        code_index.equal_range(code);
+    for (CodeIndex::const_iterator it=range.first; it!=range.second; ++it)
     {
-      stns.push_back(*iter);
+      stns.push_back(*it->second);
     }
   }
-  
-  for (iter=the_stations.begin(); iter!=the_stations.end(); ++iter)
+  else
   {
-    if (stationCodeEq(*iter, code, exact))
+      // The code index is sorted so all codes starting with the given
+      // prefix will be found in a contiguous range
+    CodeIndex::const_iterator it;
+    for (it=code_index.lower_bound(code); it!=code_index.end(); ++it)
     {
-      stns.push_back(*iter);
+      if (it->first.compare(0, code.size(), code) != 0)
+      {
+        break;
+      }
+      stns.push_back(*it->second);
     }
   }
-
 } /* Directory::findStationsByCode  */
 
 
@@ -495,9 +417,13 @@ int Directory::handleCallList(char *buf, int len)
 	buf[read_len-1] = 0;
 	get_call_cnt = atoi(buf);
 	//printf("Number of calls to get: %d\n", get_call_cnt);
+	  // The received stations are staged and only applied to the station
+	  // lists when the whole list has been received. An aborted transfer
+	  // then leaves the previous list untouched.
+	received_stations.clear();
+	received_stations.reserve(call_index.size());
 	if (get_call_cnt > 0)
 	{
-	  get_call_list.clear();
 	  the_message = "";
 	  com_state = CS_WAITING_FOR_CALL;
 	}
@@ -585,7 +511,7 @@ int Directory::handleCallList(char *buf, int len)
 	}
 	else
 	{
-      	  get_call_list.push_back(get_call_entry);
+	  received_stations.push_back(get_call_entry);
 	}
 
 	if (--get_call_cnt <= 0)
@@ -607,32 +533,7 @@ int Directory::handleCallList(char *buf, int len)
 	if (memcmp(buf, "+++", 3) == 0)
 	{
 	  //printf("End received!\n");
-	  the_links.clear();
-	  the_repeaters.clear();
-	  the_conferences.clear();
-	  the_stations.clear();
-	  list<StationData>::const_iterator it;
-	  for (it = get_call_list.begin(); it != get_call_list.end(); ++it)
-	  {
-	    const string &callsign = it->callsign();
-	    if (callsign.rfind("-L") == callsign.size()-2)
-	    {
-	      the_links.push_back(*it);
-	    }
-	    else if (callsign.rfind("-R") == callsign.size()-2)
-	    {
-	      the_repeaters.push_back(*it);
-	    }
-	    else if (callsign.find("*") == 0)
-	    {
-	      the_conferences.push_back(*it);
-	    }
-	    else
-	    {
-	      the_stations.push_back(*it);
-	    }
-	  }
-	  get_call_list.clear();
+	  commitStationList();
 	  com_state = CS_IDLE;
 	  read_len = 3;
 
@@ -645,6 +546,7 @@ int Directory::handleCallList(char *buf, int len)
 	else
 	{
 	  fprintf(stderr, "Error in call list format (+++ expected).\n");
+	  received_stations.clear();
 	  com_state = CS_IDLE;
 	}
       }
@@ -980,6 +882,141 @@ void Directory::onRefreshRegistration(Timer *timer)
 } /* Directory::onRefreshRegistration */
 
 
+Directory::Category Directory::stationCategory(const string& callsign)
+{
+  if (callsign.rfind("-L") == callsign.size()-2)
+  {
+    return CAT_LINK;
+  }
+  else if (callsign.rfind("-R") == callsign.size()-2)
+  {
+    return CAT_REPEATER;
+  }
+  else if (callsign.find("*") == 0)
+  {
+    return CAT_CONFERENCE;
+  }
+  return CAT_STATION;
+} /* Directory::stationCategory */
+
+
+void Directory::beginStationListUpdate(void)
+{
+    // Only the entries that have been added, changed or removed since the
+    // last refresh are touched. Unchanged entries stay where they are so
+    // pointers to them, and the indexes, remain valid. New entries are
+    // inserted after the previous entry received from the server so that
+    // the server sort order is kept.
+  ++refresh_gen;
+  insert_pos[CAT_LINK] = the_links.begin();
+  insert_pos[CAT_REPEATER] = the_repeaters.begin();
+  insert_pos[CAT_CONFERENCE] = the_conferences.begin();
+  insert_pos[CAT_STATION] = the_stations.begin();
+} /* Directory::beginStationListUpdate */
+
+
+void Directory::stationReceived(const StationData& stn)
+{
+  Category cat = stationCategory(stn.callsign());
+  CallIndex::iterator ref_it = call_index.find(stn.callsign());
+  if (ref_it == call_index.end())
+  {
+    list<StationData> *lists[CAT_CNT] =
+    {
+      &the_links, &the_repeaters, &the_conferences, &the_stations
+    };
+    list<StationData>::iterator stn_it =
+        lists[cat]->insert(insert_pos[cat], stn);
+    StationRef ref;
+    ref.list = lists[cat];
+    ref.it = stn_it;
+    ref.code_it = code_index.insert(make_pair(stn_it->code(), &(*stn_it)));
+    ref.refresh_gen = refresh_gen;
+    call_index.insert(make_pair(stn_it->callsign(), ref));
+    id_index[stn_it->id()] = &(*stn_it);
+    insert_pos[cat] = next(stn_it);
+    return;
+  }
+
+  StationRef &ref = ref_it->second;
+  if (ref.refresh_gen == refresh_gen)
+  {
+    return; // Duplicate entry in the list from the server
+  }
+  ref.refresh_gen = refresh_gen;
+  if (!stationDataEq(*ref.it, stn))
+  {
+    if (ref.it->id() != stn.id())
+    {
+      removeFromIdIndex(*ref.it);
+      id_index[stn.id()] = &(*ref.it);
+    }
+    *ref.it = stn;
+  }
+  insert_pos[cat] = next(ref.it);
+} /* Directory::stationReceived */
+
+
+void Directory::endStationListUpdate(void)
+{
+    // Remove all stations that was not present in the new list
+  CallIndex::iterator ref_it = call_index.begin();
+  while (ref_it != call_index.end())
+  {
+    StationRef &ref = ref_it->second;
+    if (ref.refresh_gen != refresh_gen)
+    {
+      removeFromIdIndex(*ref.it);
+      code_index.erase(ref.code_it);
+      ref.list->erase(ref.it);
+      ref_it = call_index.erase(ref_it);
+    }
+    else
+    {
+      ++ref_it;
+    }
+  }
+} /* Directory::endStationListUpdate */
+
+
+void Directory::commitStationList(void)
+{
+  beginStationListUpdate();
+  for (const StationData& stn : received_stations)
+  {
+    stationReceived(stn);
+  }
+  endStationListUpdate();
+  received_stations.clear();
+} /* Directory::commitStationList */
+
+
+void Directory::clearStationList(void)
+{
+  call_index.clear();
+  id_index.clear();
+  code_index.clear();
+  the_links.clear();
+  the_repeaters.clear();
+  the_conferences.clear();
+  the_stations.clear();
+  insert_pos[CAT_LINK] = the_links.begin();
+  insert_pos[CAT_REPEATER] = the_repeaters.begin();
+  insert_pos[CAT_CONFERENCE] = the_conferences.begin();
+  insert_pos[CAT_STATION] = the_stations.begin();
+} /* Directory::clearStationList */
+
+
+void Directory::removeFromIdIndex(const StationData& stn)
+{
+  IdIndex::iterator it = id_index.find(stn.id());
+  if ((it != id_index.end()) && (it->second == &stn))
+  {
+    id_index.erase(it);
+  }
+} /* Directory::removeFromIdIndex */
+
+
 void Directory::onCmdTimeout(Timer *timer)
 {
   error("Command timeout while communicating to the directory server");
@@ -48,6 +48,8 @@ An example of how to use the EchoLink::Directory class
 #include <string>
 #include <list>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <iostream>
 
 
@@ -205,6 +207,11 @@ class Directory : public sigc::trackable
      *
      * After the transfer is done. There may be a server message to read. Get
      * this message by using the Directory::message function.
+     *
+     * The station lists are updated incrementally while the list is being
+     * received, so each received station is parsed and merged into the
+     * current station lists directly as it arrives. Stations that are not
+     * present in the new list are removed when the transfer is complete.
      */
     void getCalls(void);
     
@@ -318,6 +325,10 @@ class Directory : public sigc::trackable
      * @param 	call  The callsign to find
      * @return	Returns a pointer to a StationData object if the callsign was
      *	      	found. Otherwise a NULL-pointer is returned.
+     *
+     * The lookup is done using a hash index so it is cheap to call. The
+     * returned pointer is valid until the station disappear from the station
+     * list. The object pointed to is updated in place on list refresh.
      */
     const StationData *findCall(const std::string& call);
     
@@ -338,6 +349,8 @@ class Directory : public sigc::trackable
      *
      * Find stations matching the given code. For a description of how the
      * callsign to code mapping is done see @see EchoLink::StationData::code.
+     * The stations are returned sorted on code. A non exact search is a
+     * prefix search in a sorted code index.
      */
     void findStationsByCode(std::vector<StationData> &stns,
 		    const std::string& code, bool exact=true);
@@ -369,6 +382,22 @@ class Directory : public sigc::trackable
       CS_WAITING_FOR_END,   CS_IDLE,  	      	  CS_WAITING_FOR_OK
     } ComState;
     
+    typedef enum
+    {
+      CAT_LINK, CAT_REPEATER, CAT_CONFERENCE, CAT_STATION, CAT_CNT
+    } Category;
+
+    typedef std::multimap<std::string, const StationData*> CodeIndex;
+    struct StationRef
+    {
+      std::list<StationData>*           list;
+      std::list<StationData>::iterator  it;
+      CodeIndex::iterator               code_it;
+      unsigned                          refresh_gen;
+    };
+    typedef std::unordered_map<std::string, StationRef> CallIndex;
+    typedef std::unordered_map<int, const StationData*> IdIndex;
+
     static const int DIRECTORY_SERVER_PORT    	= 5200;
     static const int REGISTRATION_REFRESH_TIME  = 5 * 60 * 1000; // 5 minutes
     static const int CMD_TIMEOUT                = 120 * 1000; // 2 minutes
@@ -387,7 +416,7 @@ class Directory : public sigc::trackable
     
     int       	      	      get_call_cnt;
     StationData       	      get_call_entry;
-    std::list<StationData>    get_call_list;
+    std::vector<StationData>  received_stations;
     
     DirectoryCon *            ctrl_con;
     std::list<Cmd>    	      cmd_queue;
@@ -397,6 +426,11 @@ class Directory : public sigc::trackable
     bool      	      	      server_changed;
     Async::Timer *            cmd_timer;
     Async::IpAddress          bind_ip;
+    CallIndex                 call_index;
+    IdIndex                   id_index;
+    CodeIndex                 code_index;
+    unsigned                  refresh_gen;
+    std::list<StationData>::iterator insert_pos[CAT_CNT];
     
     Directory(const Directory&);
     Directory& operator =(const Directory&);
@@ -414,7 +448,13 @@ class Directory : public sigc::trackable
     void createClientObject(void);
     void onRefreshRegistration(Async::Timer *timer);
     void onCmdTimeout(Async::Timer *timer);
-    bool stationCodeEq(const StationData& stn, std::string code, bool exact);
+    static Category stationCategory(const std::string& callsign);
+    void beginStationListUpdate(void);
+    void stationReceived(const StationData& stn);
+    void endStationListUpdate(void);
+    void commitStationList(void);
+    void clearStationList(void);
+    void removeFromIdIndex(const StationData& stn);
 
 };  /* class Directory */
 
@@ -185,6 +185,18 @@ Dispatcher::~Dispatcher(void)
 } /* Dispatcher::~Dispatcher */
 
 
+bool Dispatcher::peerStats(const IpAddress& ip, PeerStats& stats) const
+{
+  ConMap::const_iterator iter = con_map.find(ip);
+  if (iter == con_map.end())
+  {
+    return false;
+  }
+  stats = iter->second.stats;
+  return true;
+} /* Dispatcher::peerStats */
+
+
 bool Dispatcher::registerConnection(Qso *con, CtrlInputHandler cih,
 	AudioInputHandler aih)
 {
@@ -215,30 +227,66 @@ void Dispatcher::unregisterConnection(Qso *con)
 
 bool Dispatcher::sendCtrlMsg(const IpAddress& to, const void *buf, int len)
 {
+  bool success;
   Proxy *proxy = Proxy::instance();
   if (proxy == 0)
   {
-    return ctrl_sock->write(to, CTRL_PORT, buf, len);
+    success = ctrl_sock->write(to, CTRL_PORT, buf, len);
   }
   else
   {
-    return proxy->udpCtrl(to, buf, len);
+    success = proxy->udpCtrl(to, buf, len);
   }
+
+  ConMap::iterator iter = con_map.find(to);
+  if (iter != con_map.end())
+  {
+    PeerStats& stats = iter->second.stats;
+    if (success)
+    {
+      stats.ctrl_tx_packets += 1;
+      stats.ctrl_tx_bytes += len;
+    }
+    else
+    {
+      stats.tx_errors += 1;
+    }
+  }
+
+  return success;
 } /* Dispatcher::sendCtrlMsg */
 
 
 bool Dispatcher::sendAudioMsg(const IpAddress& to, const void *buf, int len)
 {
+  bool success;
   Proxy *proxy = Proxy::instance();
   if (proxy == 0)
   {
-    return audio_sock->write(to, AUDIO_PORT, buf, len);
+    success = audio_sock->write(to, AUDIO_PORT, buf, len);
   }
   else
   {
-    return proxy->udpData(to, buf, len);
+    success = proxy->udpData(to, buf, len);
   }
-} /* Dispatcher::sendCtrlMsg */
+
+  ConMap::iterator iter = con_map.find(to);
+  if (iter != con_map.end())
+  {
+    PeerStats& stats = iter->second.stats;
+    if (success)
+    {
+      stats.audio_tx_packets += 1;
+      stats.audio_tx_bytes += len;
+    }
+    else
+    {
+      stats.tx_errors += 1;
+    }
+  }
+
+  return success;
+} /* Dispatcher::sendAudioMsg */
 
 
 
@@ -275,7 +323,7 @@ bool Dispatcher::sendAudioMsg(const IpAddress& to, const void *buf, int len)
 
 
 Dispatcher::Dispatcher(void)
-  : ctrl_sock(0), audio_sock(0)
+  : ctrl_sock(0), audio_sock(0), spurious_packets(0)
 {
   Proxy *proxy = Proxy::instance();
   if (proxy == 0)
@@ -290,6 +338,14 @@ Dispatcher::Dispatcher(void)
       audio_sock = 0;
       return;
     }
+
+      // With many simultaneous connections, like on a conference server,
+      // a lot of datagrams arrive and are sent on each socket. Read and
+      // write them in batches to save system calls.
+    ctrl_sock->setRecvBatchSize(RECV_BATCH_SIZE, MAX_DATAGRAM_SIZE);
+    ctrl_sock->setSendBatching(true);
+    audio_sock->setRecvBatchSize(RECV_BATCH_SIZE, MAX_DATAGRAM_SIZE);
+    audio_sock->setSendBatching(true);
     
     ctrl_sock->dataReceived.connect(
         mem_fun(*this, &Dispatcher::ctrlDataReceived));
@@ -327,6 +383,8 @@ void Dispatcher::ctrlDataReceived(const IpAddress& ip, uint16_t port,
   iter = con_map.find(ip);
   if (iter != con_map.end())
   {
+    iter->second.stats.ctrl_rx_packets += 1;
+    iter->second.stats.ctrl_rx_bytes += len;
     ((iter->second.con)->*(iter->second.cih))(recv_buf, len);
   }
   else
@@ -355,6 +413,7 @@ void Dispatcher::ctrlDataReceived(const IpAddress& ip, uint16_t port,
     }
     else
     {
+      ++spurious_packets;
       cerr << "Spurious ctrl packet received from " << ip << endl;
     }
   }
@@ -371,10 +430,13 @@ void Dispatcher::audioDataReceived(const IpAddress& ip, uint16_t port,
   iter = con_map.find(ip);
   if (iter != con_map.end())
   {
+    iter->second.stats.audio_rx_packets += 1;
+    iter->second.stats.audio_rx_bytes += len;
     ((iter->second.con)->*(iter->second.aih))(recv_buf, len);
   }
   else
   {
+    ++spurious_packets;
     cerr << "Spurious audio packet received from " << ip << endl;
   }
 } /* Dispatcher::audioDataReceived */
@@ -45,8 +45,9 @@ An example of how to use the EchoLink::Dispatcher class
  ****************************************************************************/
 
 #include <sigc++/sigc++.h>
+#include <stdint.h>
 
-#include <map>
+#include <unordered_map>
 
 
 /****************************************************************************
@@ -144,6 +145,29 @@ your application would be something like the code below.
 class Dispatcher : public sigc::trackable
 {
   public:
+    /**
+     * @brief   Packet counters for one remote station
+     */
+    struct PeerStats
+    {
+      uint64_t ctrl_rx_packets;   //!< Received control packets
+      uint64_t ctrl_rx_bytes;     //!< Received control bytes
+      uint64_t audio_rx_packets;  //!< Received audio/info/chat packets
+      uint64_t audio_rx_bytes;    //!< Received audio/info/chat bytes
+      uint64_t ctrl_tx_packets;   //!< Sent control packets
+      uint64_t ctrl_tx_bytes;     //!< Sent control bytes
+      uint64_t audio_tx_packets;  //!< Sent audio/info/chat packets
+      uint64_t audio_tx_bytes;    //!< Sent audio/info/chat bytes
+      uint64_t tx_errors;         //!< Packets that could not be sent
+
+      PeerStats(void)
+        : ctrl_rx_packets(0), ctrl_rx_bytes(0), audio_rx_packets(0),
+          audio_rx_bytes(0), ctrl_tx_packets(0), ctrl_tx_bytes(0),
+          audio_tx_packets(0), audio_tx_bytes(0), tx_errors(0)
+      {
+      }
+    };
+
     /**
      * @brief 	Set the port base for the two UDP ports
      * @param 	base The port base to use
@@ -196,6 +220,26 @@ class Dispatcher : public sigc::trackable
      * @brief 	Destructor
      */
     ~Dispatcher(void);
+
+    /**
+     * @brief   Get the packet counters for a connected remote station
+     * @param   ip    The IP address of the remote station
+     * @param   stats The object to store the counters in
+     * @return  Returns \em true on success or \em false if there is no
+     *          connection to the given remote station
+     *
+     * The counters are kept for as long as the connection object (Qso) for
+     * the remote station exist.
+     */
+    bool peerStats(const Async::IpAddress& ip, PeerStats& stats) const;
+
+    /**
+     * @brief   Get the number of packets received from unknown stations
+     * @return  Returns the number of packets that could not be dispatched
+     *
+     * Incoming connection requests are not counted.
+     */
+    uint64_t spuriousPackets(void) const { return spurious_packets; }
     
     /**
      * @brief 	A signal that is emitted when someone is trying to connect
@@ -222,10 +266,13 @@ class Dispatcher : public sigc::trackable
       Qso *      	con;
       CtrlInputHandler	cih;
       AudioInputHandler aih;
+      PeerStats         stats;
     } ConData;
-    typedef std::map<Async::IpAddress, ConData> ConMap;
+    typedef std::unordered_map<Async::IpAddress, ConData> ConMap;
     
     static const int  	DEFAULT_PORT_BASE = 5198;
+    static const unsigned RECV_BATCH_SIZE = 16;
+    static const size_t   MAX_DATAGRAM_SIZE = 16384;
     
     static int	      	    port_base;
     static Async::IpAddress bind_ip;
@@ -234,6 +281,7 @@ class Dispatcher : public sigc::trackable
     ConMap    	      	    con_map;
     Async::UdpSocket * 	    ctrl_sock;
     Async::UdpSocket * 	    audio_sock;
+    uint64_t                spurious_packets;
     
     bool registerConnection(Qso *con, CtrlInputHandler cih,
 	AudioInputHandler aih);
@@ -118,7 +118,7 @@ using namespace EchoLink;
  ****************************************************************************/
 
 EchoLinkDirectoryModel::EchoLinkDirectoryModel(QObject *parent)
-  : QAbstractItemModel(parent)
+  : QAbstractItemModel(parent), old_pos(0), is_updating(false)
 {
   
 } /* EchoLinkDirectoryModel::EchoLinkDirectoryModel */
@@ -141,82 +141,90 @@ void EchoLinkDirectoryModel::updateStationList(
       QList<StationData>::fromStdList(stn_list);
   qStableSort(updated_stations);
 #endif
-  
-  //cout << "### updated_stations=" << updated_stations.count() << endl;  
-  
-  int row = 0;
-  while (!updated_stations.isEmpty() && (row < stations.count()))
+
+    // Merge the sorted old and new lists. The rows that have been processed
+    // are moved to merged_stations while the rest of the old rows remain in
+    // stations, starting at old_pos. Consecutive removed, inserted or
+    // changed rows are reported to the views as one range each.
+  merged_stations.clear();
+  merged_stations.reserve(updated_stations.count());
+  old_pos = 0;
+  is_updating = true;
+  int new_pos = 0;
+  while ((old_pos < stations.count()) ||
+         (new_pos < updated_stations.count()))
   {
-    const StationData &updated_stn = updated_stations.first();
-    StationData &stn = stations[row];
-    if (updated_stn.callsign() == stn.callsign())
+    int remove_cnt = 0;
+    while ((old_pos + remove_cnt < stations.count()) &&
+           ((new_pos == updated_stations.count()) ||
+            (stations.at(old_pos + remove_cnt) <
+             updated_stations.at(new_pos))))
     {
-      if (updated_stn.description() != stn.description())
-      {
-	QModelIndex stn_index = index(row, 1);
-	stn.setDescription(updated_stn.description());
-	dataChanged(stn_index, stn_index);
-      }
-      if (updated_stn.status() != stn.status())
-      {
-	QModelIndex stn_index = index(row, 2);
-	stn.setStatus(updated_stn.status());
-	dataChanged(stn_index, stn_index);
-      }
-      if (updated_stn.time() != stn.time())
+      ++remove_cnt;
+    }
+    if (remove_cnt > 0)
+    {
+      int row = merged_stations.count();
+      beginRemoveRows(QModelIndex(), row, row + remove_cnt - 1);
+      old_pos += remove_cnt;
+      endRemoveRows();
+      continue;
+    }
+
+    int insert_cnt = 0;
+    while ((new_pos + insert_cnt < updated_stations.count()) &&
+           ((old_pos == stations.count()) ||
+            (updated_stations.at(new_pos + insert_cnt) <
+             stations.at(old_pos))))
+    {
+      ++insert_cnt;
+    }
+    if (insert_cnt > 0)
+    {
+      int row = merged_stations.count();
+      beginInsertRows(QModelIndex(), row, row + insert_cnt - 1);
+      for (int i=0; i<insert_cnt; ++i)
       {
-	QModelIndex stn_index = index(row, 3);
-	stn.setTime(updated_stn.time());
-	dataChanged(stn_index, stn_index);
+        merged_stations.append(updated_stations.at(new_pos++));
       }
-      if (updated_stn.id() != stn.id())
+      endInsertRows();
+      continue;
+    }
+
+    int first_changed = -1;
+    while ((old_pos < stations.count()) &&
+           (new_pos < updated_stations.count()) &&
+           (stations.at(old_pos).callsign() ==
+            updated_stations.at(new_pos).callsign()))
+    {
+      int row = merged_stations.count();
+      bool is_changed = stationChanged(stations.at(old_pos),
+                                       updated_stations.at(new_pos));
+      merged_stations.append(updated_stations.at(new_pos++));
+      ++old_pos;
+      if (is_changed && (first_changed < 0))
       {
-	QModelIndex stn_index = index(row, 4);
-	stn.setId(updated_stn.id());
-	dataChanged(stn_index, stn_index);
+        first_changed = row;
       }
-      if (updated_stn.ip() != stn.ip())
+      else if (!is_changed && (first_changed >= 0))
       {
-	QModelIndex stn_index = index(row, 5);
-	stn.setIp(updated_stn.ip());
-	dataChanged(stn_index, stn_index);
+        dataChanged(index(first_changed, 1),
+                    index(row - 1, columnCount() - 1));
+        first_changed = -1;
       }
-      row += 1;
-      updated_stations.removeFirst();
-    }
-    else if (updated_stn.callsign() < stn.callsign())
-    {
-      //cout << "### Inserting 1 row starting at row " << row << endl;
-      beginInsertRows(QModelIndex(), row, row);
-      stations.insert(row, updated_stn);
-      endInsertRows();
-      row += 1;
-      updated_stations.removeFirst();
     }
-    else
+    if (first_changed >= 0)
     {
-      removeRows(row, 1);
+      dataChanged(index(first_changed, 1),
+                  index(merged_stations.count() - 1, columnCount() - 1));
     }
   }
-  
-  if (!updated_stations.isEmpty())
-  {
-    int first = stations.count();
-    int last = stations.count()+updated_stations.count()-1;
-    //cout << "### Inserting " << last-first+1 << " rows starting at row " << row << endl;
-    beginInsertRows(QModelIndex(), first, last);
-    //stations.append(updated_stations);
-    copy(updated_stations.begin(), updated_stations.end(),
-         back_inserter(stations));
-    endInsertRows();
-  }
-  else if (row < stations.count())
-  {
-    removeRows(row, stations.count()-row);
-  }
-  
-  //cout << "### stations=" << rowCount() << endl;
-  
+
+  stations.swap(merged_stations);
+  merged_stations.clear();
+  old_pos = 0;
+  is_updating = false;
+
 } /* EchoLinkDirectoryModel::updateStationList */
 
 
@@ -247,7 +255,11 @@ int EchoLinkDirectoryModel::rowCount(const QModelIndex &parent) const
   {
     return 0;
   }
-  
+
+  if (is_updating)
+  {
+    return merged_stations.count() + stations.count() - old_pos;
+  }
   return stations.count();
 } /* EchoLinkDirectoryModel::rowCount */
 
@@ -297,7 +309,7 @@ QVariant EchoLinkDirectoryModel::data(const QModelIndex &index, int role) const
   
   if (role == Qt::DisplayRole)
   {
-    const StationData &stn = stations.at(index.row());
+    const StationData &stn = stationAt(index.row());
     switch (index.column())
     {
       case 0:
@@ -362,6 +374,29 @@ bool EchoLinkDirectoryModel::removeRows(int row, int count,
  *
  ****************************************************************************/
 
+const StationData &EchoLinkDirectoryModel::stationAt(int row) const
+{
+  if (is_updating)
+  {
+    if (row < merged_stations.count())
+    {
+      return merged_stations.at(row);
+    }
+    return stations.at(old_pos + row - merged_stations.count());
+  }
+  return stations.at(row);
+} /* EchoLinkDirectoryModel::stationAt */
+
+
+bool EchoLinkDirectoryModel::stationChanged(const StationData &stn,
+                                            const StationData &updated_stn)
+{
+  return (updated_stn.description() != stn.description()) ||
+         (updated_stn.status() != stn.status()) ||
+         (updated_stn.time() != stn.time()) ||
+         (updated_stn.id() != stn.id()) ||
+         (updated_stn.ip() != stn.ip());
+} /* EchoLinkDirectoryModel::stationChanged */
 
 
 /*
@@ -135,9 +135,12 @@ class EchoLinkDirectoryModel : public QAbstractItemModel
     ~EchoLinkDirectoryModel(void);
   
     /**
-     * @brief 	A_brief_member_function_description
-     * @param 	param1 Description_of_param1
-     * @return	Return_value_of_this_member_function
+     * @brief 	Update the model with a new station list
+     * @param 	stn_list The new list of stations
+     *
+     * The new list is sorted and merged with the current rows. Consecutive
+     * rows that have been removed, inserted or changed are reported to the
+     * views as one range each so that views are not updated once per row.
      */
     void updateStationList(const std::list<EchoLink::StationData> &stn_list);
     
@@ -159,9 +162,15 @@ class EchoLinkDirectoryModel : public QAbstractItemModel
     
   private:
     QList<EchoLink::StationData> stations;
-    
+    QList<EchoLink::StationData> merged_stations;
+    int                          old_pos;
+    bool                         is_updating;
+
     EchoLinkDirectoryModel(const EchoLinkDirectoryModel&);
     EchoLinkDirectoryModel& operator=(const EchoLinkDirectoryModel&);
+    const EchoLink::StationData &stationAt(int row) const;
+    static bool stationChanged(const EchoLink::StationData &stn,
+                               const EchoLink::StationData &updated_stn);
     
 };  /* class EchoLinkDirectoryModel */
 
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <iomanip>
+#include <list>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+#include <QElapsedTimer>
+
+#include <EchoLinkStationData.h>
+
+#include "EchoLinkDirectoryModel.h"
+
+using namespace std;
+using namespace EchoLink;
+
+
+namespace {
+const int STATION_CNT = 20000;
+const int REFRESH_CNT = 20;
+
+int inserted_rows = 0;
+int removed_rows = 0;
+int changed_rows = 0;
+int insert_signals = 0;
+int remove_signals = 0;
+int change_signals = 0;
+
+StationData makeStation(int num, int desc_rev)
+{
+  char callsign[16];
+  sprintf(callsign, "SM%05d", num);
+  StationData stn;
+  stn.setCallsign(callsign);
+  stn.setStatus(StationData::STAT_ONLINE);
+  stn.setTime("12:00");
+  stn.setDescription("Station " + to_string(num) + " rev " +
+                     to_string(desc_rev));
+  stn.setId(100000 + num);
+  return stn;
+}
+
+void resetCounters(void)
+{
+  inserted_rows = removed_rows = changed_rows = 0;
+  insert_signals = remove_signals = change_signals = 0;
+}
+
+void printCounters(const char *label, qint64 nsec)
+{
+  cout << setw(12) << left << label << right
+       << " time=" << setw(8) << (nsec / 1000) << "us"
+       << " ins=" << inserted_rows << "/" << insert_signals
+       << " rem=" << removed_rows << "/" << remove_signals
+       << " chg=" << changed_rows << "/" << change_signals
+       << endl;
+}
+};
+
+
+int main(void)
+{
+  EchoLinkDirectoryModel model;
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+      [](const QModelIndex&, int first, int last)
+      {
+        inserted_rows += last - first + 1;
+        ++insert_signals;
+      });
+  QObject::connect(&model, &QAbstractItemModel::rowsRemoved,
+      [](const QModelIndex&, int first, int last)
+      {
+        removed_rows += last - first + 1;
+        ++remove_signals;
+      });
+  QObject::connect(&model, &QAbstractItemModel::dataChanged,
+      [](const QModelIndex& top_left, const QModelIndex& bottom_right)
+      {
+        changed_rows += bottom_right.row() - top_left.row() + 1;
+        ++change_signals;
+      });
+
+  srand(1);
+
+    // The directory server list is already sorted but in reverse order
+    // compared to the model
+  list<StationData> stn_list;
+  for (int i=0; i<STATION_CNT; ++i)
+  {
+    stn_list.push_front(makeStation(i * 2, 0));
+  }
+
+  QElapsedTimer timer;
+  resetCounters();
+  timer.start();
+  model.updateStationList(stn_list);
+  printCounters("initial", timer.nsecsElapsed());
+
+  resetCounters();
+  timer.start();
+  model.updateStationList(stn_list);
+  printCounters("unchanged", timer.nsecsElapsed());
+
+    // Each refresh changes the description of about one percent of the
+    // stations and lets some stations go offline while others come online
+  qint64 total_nsec = 0;
+  for (int refresh=1; refresh<=REFRESH_CNT; ++refresh)
+  {
+    stn_list.clear();
+    for (int i=0; i<STATION_CNT; ++i)
+    {
+      int num = i * 2 + ((rand() % 200 == 0) ? 1 : 0);
+      int desc_rev = (rand() % 100 == 0) ? refresh : 0;
+      stn_list.push_front(makeStation(num, desc_rev));
+    }
+    resetCounters();
+    timer.start();
+    model.updateStationList(stn_list);
+    qint64 nsec = timer.nsecsElapsed();
+    total_nsec += nsec;
+    printCounters(("refresh " + to_string(refresh)).c_str(), nsec);
+  }
+
+  cout << "Average refresh time: " << (total_nsec / REFRESH_CNT / 1000)
+       << "us for " << model.rowCount() << " rows" << endl;
+
+  return 0;
+}
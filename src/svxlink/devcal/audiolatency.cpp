@@ -0,0 +1,503 @@
+/**
+@file	 audiolatency.cpp
+@brief   A utility to measure the audio loopback latency of a sound card
+@author  Tobias Blomberg / SM0SVX
+@date	 2025-10-18
+
+The audio input is used as the clock for the audio output, in the same way
+as audio flow through a repeater. A tone burst is written to the output and
+the number of input samples until the burst is detected in the input is
+counted. The output must be connected to the input using a loopback cable
+or, for a repeater, by transmitting on the repeater input and receiving the
+repeater output.
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <signal.h>
+#include <popt.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncCppApplication.h>
+#include <AsyncAudioIO.h>
+#include <AsyncAudioSink.h>
+#include <AsyncAudioSource.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "version/DEVCAL.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+#define PROGRAM_NAME          "audiolatency"
+#define DEFAULT_AUDIO_DEV     "alsa:default"
+#define DEFAULT_COUNT         10
+#define DEFAULT_LEVEL_DB      -6.0f
+#define DEFAULT_THRESH_DB     -30.0f
+#define DEFAULT_CARD_RATE     48000
+#define BURST_FQ              1000.0f
+#define BURST_LEN_MS          20
+#define INTERVAL_MS           500
+#define TIMEOUT_MS            2000
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+/**
+ * Sit between the audio input and the audio output and measure the number
+ * of samples it take for a tone burst written to the output to show up in
+ * the input.
+ */
+class LoopbackMeter : public Async::AudioSink, public Async::AudioSource
+{
+  public:
+    sigc::signal<void()> done;
+
+    LoopbackMeter(unsigned sample_rate, unsigned meas_cnt, float level,
+                  float threshold)
+      : sample_rate(sample_rate), meas_cnt(meas_cnt), level(level),
+        threshold(threshold), burst_len(sample_rate * BURST_LEN_MS / 1000),
+        state(STATE_WAIT), pos(0), burst_pos(0), burst_left(0),
+        wait_left(sample_rate), lost_cnt(0), dropped_cnt(0)
+    {
+    }
+
+    virtual int writeSamples(const float *samples, int count)
+    {
+      if (out_buf.size() < static_cast<size_t>(count))
+      {
+        out_buf.resize(count);
+      }
+
+      for (int i=0; i<count; ++i)
+      {
+        if (state == STATE_DETECT)
+        {
+          if (fabsf(samples[i]) >= threshold)
+          {
+            latencies.push_back(pos - burst_pos);
+            cout << "Latency: " << sampleToMs(pos - burst_pos) << "ms"
+                 << endl;
+            startWait();
+          }
+          else if (pos - burst_pos > sample_rate * TIMEOUT_MS / 1000)
+          {
+            ++lost_cnt;
+            cout << "Tone burst not detected" << endl;
+            startWait();
+          }
+        }
+        else if ((state == STATE_WAIT) && (--wait_left == 0))
+        {
+          state = STATE_DETECT;
+          burst_pos = pos;
+          burst_left = burst_len;
+        }
+
+        out_buf[i] = 0.0f;
+        if (burst_left > 0)
+        {
+          unsigned n = burst_len - burst_left;
+          out_buf[i] = level * sinf(2.0f * M_PI * BURST_FQ * n / sample_rate);
+          --burst_left;
+        }
+        ++pos;
+      }
+
+      int written = sinkWriteSamples(out_buf.data(), count);
+      dropped_cnt += count - written;
+
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      sourceAllSamplesFlushed();
+    }
+
+    virtual void resumeOutput(void) {}
+    virtual void allSamplesFlushed(void) {}
+
+    void printStats(void)
+    {
+      cout << "\n--- Measurements  : " << latencies.size() << endl;
+      cout << "--- Lost bursts    : " << lost_cnt << endl;
+      cout << "--- Dropped samples: " << dropped_cnt << endl;
+      if (latencies.empty())
+      {
+        return;
+      }
+      double sum = 0.0;
+      double sqsum = 0.0;
+      for (auto latency : latencies)
+      {
+        sum += latency;
+        sqsum += static_cast<double>(latency) * latency;
+      }
+      double avg = sum / latencies.size();
+      double stddev = sqrt(max(0.0, sqsum / latencies.size() - avg * avg));
+      cout << "--- Latency min    : "
+           << sampleToMs(*min_element(latencies.begin(), latencies.end()))
+           << "ms" << endl;
+      cout << "--- Latency avg    : " << sampleToMs(avg) << "ms" << endl;
+      cout << "--- Latency max    : "
+           << sampleToMs(*max_element(latencies.begin(), latencies.end()))
+           << "ms" << endl;
+      cout << "--- Latency stddev : " << sampleToMs(stddev) << "ms" << endl;
+    }
+
+  private:
+    typedef enum
+    {
+      STATE_WAIT, STATE_DETECT, STATE_DONE
+    } State;
+
+    const unsigned      sample_rate;
+    const unsigned      meas_cnt;
+    const float         level;
+    const float         threshold;
+    const unsigned      burst_len;
+    State               state;
+    uint64_t            pos;
+    uint64_t            burst_pos;
+    unsigned            burst_left;
+    unsigned            wait_left;
+    unsigned            lost_cnt;
+    unsigned            dropped_cnt;
+    vector<uint64_t>    latencies;
+    vector<float>       out_buf;
+
+    double sampleToMs(double samples) const
+    {
+      return 1000.0 * samples / sample_rate;
+    }
+
+    void startWait(void)
+    {
+      state = STATE_WAIT;
+      wait_left = sample_rate * INTERVAL_MS / 1000;
+      if (latencies.size() + lost_cnt >= meas_cnt)
+      {
+        state = STATE_DONE;
+        done();
+      }
+    }
+};
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+static void parse_arguments(int argc, const char **argv);
+static void sigterm_handler(int signal);
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+static const char *tx_dev = DEFAULT_AUDIO_DEV;
+static const char *rx_dev = 0;
+static int tx_ch = 0;
+static int rx_ch = 0;
+static int meas_cnt = DEFAULT_COUNT;
+static float level_db = DEFAULT_LEVEL_DB;
+static float thresh_db = DEFAULT_THRESH_DB;
+static int card_rate = DEFAULT_CARD_RATE;
+
+
+/****************************************************************************
+ *
+ * MAIN
+ *
+ ****************************************************************************/
+
+int main(int argc, const char *argv[])
+{
+  setlocale(LC_ALL, "");
+
+  CppApplication app;
+  app.catchUnixSignal(SIGINT);
+  app.catchUnixSignal(SIGTERM);
+  app.unixSignalCaught.connect(sigc::ptr_fun(&sigterm_handler));
+
+  parse_arguments(argc, const_cast<const char **>(argv));
+
+  cout << PROGRAM_NAME " v" DEVCAL_VERSION
+          " Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX\n\n";
+  cout << PROGRAM_NAME " comes with ABSOLUTELY NO WARRANTY. "
+          "This is free software, and you\n";
+  cout << "are welcome to redistribute it in accordance with the "
+          "terms and conditions in\n";
+  cout << "the GNU GPL (General Public License) version 2 or later.\n\n";
+
+  if (card_rate == 48000)
+  {
+    AudioIO::setBlocksize(1024);
+    AudioIO::setBlockCount(4);
+  }
+  else if (card_rate == 16000)
+  {
+    AudioIO::setBlocksize(512);
+    AudioIO::setBlockCount(2);
+  }
+  #if INTERNAL_SAMPLE_RATE <= 8000
+  else if (card_rate == 8000)
+  {
+    AudioIO::setBlocksize(256);
+    AudioIO::setBlockCount(2);
+  }
+  #endif
+  else
+  {
+    cerr << "*** ERROR: Illegal sound card sample rate specified. "
+            "Valid rates are "
+            #if INTERNAL_SAMPLE_RATE <= 8000
+            "8000, "
+            #endif
+            "16000 and 48000\n";
+    exit(1);
+  }
+  AudioIO::setSampleRate(card_rate);
+
+  cout << "--- Output device [channel] : " << tx_dev << " [" << tx_ch << "]\n";
+  cout << "--- Input device [channel]  : " << rx_dev << " [" << rx_ch << "]\n";
+  cout << "--- Sound card sample rate  : " << card_rate << "Hz\n";
+  cout << "--- Tone burst level        : " << level_db << "dBFS\n";
+  cout << "--- Detection threshold     : " << thresh_db << "dBFS\n";
+  cout << endl;
+
+  AudioIO tx_io(tx_dev, tx_ch);
+  AudioIO rx_io(rx_dev, rx_ch);
+  LoopbackMeter meter(rx_io.sampleRate(), meas_cnt,
+                      powf(10.0f, level_db / 20.0f),
+                      powf(10.0f, thresh_db / 20.0f));
+  meter.done.connect(sigc::mem_fun(app, &CppApplication::quit));
+  rx_io.registerSink(&meter);
+  meter.registerSink(&tx_io);
+
+  if (!tx_io.open(AudioIO::MODE_WR))
+  {
+    cerr << "*** ERROR: Could not open audio output device \""
+         << tx_dev << "\"\n";
+    exit(1);
+  }
+  if (!rx_io.open(AudioIO::MODE_RD))
+  {
+    cerr << "*** ERROR: Could not open audio input device \""
+         << rx_dev << "\"\n";
+    exit(1);
+  }
+
+  app.exec();
+
+  rx_io.close();
+  tx_io.close();
+
+  meter.printStats();
+
+  return 0;
+}
+
+
+
+/****************************************************************************
+ *
+ * Functions
+ *
+ ****************************************************************************/
+
+/*
+ *----------------------------------------------------------------------------
+ * Function:  parse_arguments
+ * Purpose:   Parse the command line arguments.
+ * Input:     argc  - Number of arguments in the command line
+ *    	      argv  - Array of strings with the arguments
+ * Output:    Returns 0 if all is ok, otherwise -1.
+ * Author:    Tobias Blomberg, SM0SVX
+ * Created:   2025-10-18
+ * Remarks:
+ * Bugs:
+ *----------------------------------------------------------------------------
+ */
+static void parse_arguments(int argc, const char **argv)
+{
+  int print_version = 0;
+
+  poptContext optCon;
+  const struct poptOption optionsTable[] =
+  {
+    POPT_AUTOHELP
+    {"audiodev", 'a', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+            &tx_dev, 0,
+	    "The audio device to use for audio output", "<type:dev>"},
+    {"rxdev", 'i', POPT_ARG_STRING, &rx_dev, 0,
+	    "The audio device to use for audio input if it differs from the "
+            "output device", "<type:dev>"},
+    {"txch", 0, POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT, &tx_ch, 0,
+	    "The audio output channel", "<channel>"},
+    {"rxch", 0, POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT, &rx_ch, 0,
+	    "The audio input channel", "<channel>"},
+    {"count", 'c', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT, &meas_cnt, 0,
+	    "The number of measurements to make", "<count>"},
+    {"level", 'l', POPT_ARG_FLOAT | POPT_ARGFLAG_SHOW_DEFAULT, &level_db, 0,
+	    "The peak level of the tone burst", "<dBFS>"},
+    {"threshold", 't', POPT_ARG_FLOAT | POPT_ARGFLAG_SHOW_DEFAULT,
+            &thresh_db, 0,
+	    "The input level needed to detect the tone burst", "<dBFS>"},
+    {"rate", 'r', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT, &card_rate, 0,
+	    "The sound card sample rate", "<8000|16000|48000>"},
+    {"version", 0, POPT_ARG_NONE, &print_version, 0,
+	    "Print the application version string", NULL},
+    {NULL, 0, 0, NULL, 0}
+  };
+  int err;
+
+  optCon = poptGetContext(PROGRAM_NAME, argc, argv, optionsTable, 0);
+  poptReadDefaultConfig(optCon, 0);
+
+  err = poptGetNextOpt(optCon);
+  if (err != -1)
+  {
+    cerr << "*** ERROR: " << poptBadOption(optCon, POPT_BADOPTION_NOALIAS)
+         << ": " << poptStrerror(err) << endl;
+    poptPrintUsage(optCon, stderr, 0);
+    exit(1);
+  }
+
+  if (poptGetArg(optCon) != NULL)
+  {
+    cerr << "*** ERROR: Too many command line arguments\n";
+    poptPrintUsage(optCon, stderr, 0);
+    exit(1);
+  }
+
+  if (print_version)
+  {
+    std::cout << DEVCAL_VERSION << std::endl;
+    exit(0);
+  }
+
+  if (meas_cnt <= 0)
+  {
+    cerr << "*** ERROR: The measurement count must be larger than zero\n";
+    exit(1);
+  }
+
+  if (thresh_db >= level_db)
+  {
+    cerr << "*** ERROR: The detection threshold must be lower than the "
+            "tone burst level\n";
+    exit(1);
+  }
+
+  if (rx_dev == 0)
+  {
+    rx_dev = tx_dev;
+  }
+
+  poptFreeContext(optCon);
+
+} /* parse_arguments */
+
+
+static void sigterm_handler(int signal)
+{
+  const char *signame = 0;
+  switch (signal)
+  {
+    case SIGTERM:
+      signame = "SIGTERM";
+      break;
+    case SIGINT:
+      signame = "SIGINT";
+      break;
+    default:
+      signame = "???";
+      break;
+  }
+  string msg("\n");
+  msg += signame;
+  msg += " received. Shutting down application...\n";
+  cout << msg;
+  Application::app().quit();
+} /* sigterm_handler */
+
+
+/*
+ * This file has not been truncated
+ */
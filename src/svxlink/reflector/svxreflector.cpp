@@ -374,6 +374,13 @@ int main(int argc, const char *argv[])
 
   cout << "\nUsing configuration file: " << main_cfg_filename << endl;
 
+  unsigned main_loop_profiling = 0;
+  cfg.getValue("GLOBAL", "MAIN_LOOP_PROFILING", main_loop_profiling);
+  if (main_loop_profiling > 0)
+  {
+    app.enableProfiling(1000 * main_loop_profiling);
+  }
+
   struct termios org_termios = {0};
   if (logfile_name == 0)
   {
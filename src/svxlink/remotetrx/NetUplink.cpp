@@ -33,6 +33,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <iostream>
+#include <sstream>
+#include <vector>
 #include <cstring>
 #include <cerrno>
 
@@ -52,6 +54,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioSplitter.h>
 #include <AsyncAudioSelector.h>
 #include <AsyncAudioPassthrough.h>
+#include <AsyncAudioPacketJitterBuffer.h>
+#include <AsyncEncryptedUdpSocket.h>
+#include <NetTrxUdpChannel.h>
 
 
 /****************************************************************************
@@ -90,6 +95,52 @@ using namespace NetTrxMsg;
  *
  ****************************************************************************/
 
+class NetUplink::Client
+{
+  public:
+    typedef enum
+    {
+      STATE_CON_SETUP, STATE_READY, STATE_DISC_CLEANUP
+    } State;
+
+    Client(TcpConnection *con)
+      : con(con), state(STATE_CON_SETUP), last_msg_timestamp(),
+        rx_mute_state(Rx::MUTE_ALL), encoder(0), audio_dec(0),
+        jitter_buf(0), tx_ctrl_mode(Tx::TX_OFF), ctcss_enabled(false),
+        udp_chan(0), tx_prio(0), audio_over_tcp(false)
+    {
+      gettimeofday(&last_msg_timestamp, NULL);
+    }
+
+    TcpConnection           *con;
+    State                   state;
+    struct timeval          last_msg_timestamp;
+    unsigned char           auth_challenge[MsgAuthChallenge::CHALLENGE_LEN];
+    Rx::MuteState           rx_mute_state;
+    Encoder                 *encoder;
+    AudioDecoder            *audio_dec;
+    AudioPacketJitterBuffer *jitter_buf;
+    AudioPassthrough        tx_out;
+    Tx::TxCtrlMode          tx_ctrl_mode;
+    bool                    ctcss_enabled;
+    NetTrxUdpChannel        *udp_chan;
+    int                     tx_prio;
+    bool                    audio_over_tcp;
+
+  private:
+    Client(const Client&);
+    Client& operator=(const Client&);
+
+}; /* class NetUplink::Client */
+
+
+struct NetUplink::Encoder
+{
+  AudioEncoder      *enc;
+  std::string       key;
+  std::set<Client*> clients;
+}; /* struct NetUplink::Encoder */
+
 
 
 /****************************************************************************
@@ -125,13 +176,12 @@ using namespace NetTrxMsg;
 
 NetUplink::NetUplink(Config &cfg, const string &name, Rx *rx, Tx *tx,
       	      	     const string& port_str)
-  : server(0), con(0), recv_cnt(0), recv_exp(0), rx(rx), tx(tx), fifo(0),
-    cfg(cfg), name(name), last_msg_timestamp(), heartbeat_timer(0),
-    audio_enc(0), audio_dec(0), loopback_con(0), rx_splitter(0),
-    tx_selector(0), state(STATE_DISC), mute_tx_timer(0), tx_muted(false),
-    fallback_enabled(false), tx_ctrl_mode(Tx::TX_OFF)
+  : server(0), max_clients(1), rx(rx), tx(tx), fifo(0), cfg(cfg), name(name),
+    heartbeat_timer(0), loopback_con(0), rx_splitter(0), tx_selector(0),
+    tx_client_selector(0), mute_tx_timer(0), tx_muted(false),
+    fallback_enabled(false), udp_sock(0), udp_rx_client(0), udp_rx_seq(0)
 {
-  heartbeat_timer = new Timer(10000);
+  heartbeat_timer = new Timer(10000, Timer::TYPE_PERIODIC);
   heartbeat_timer->setEnable(false);
   heartbeat_timer->expired.connect(mem_fun(*this, &NetUplink::heartbeat));
 
@@ -146,10 +196,20 @@ NetUplink::NetUplink(Config &cfg, const string &name, Rx *rx, Tx *tx,
 
 NetUplink::~NetUplink(void)
 {
-  delete audio_enc;
-  delete audio_dec;
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    Client *client = (*it).second;
+    deleteUdpChannel(client);
+    releaseEncoder(client);
+    deleteDecoder(client);
+    delete client->jitter_buf;
+    delete client;
+  }
+  clients.clear();
+  delete udp_sock;
   delete fifo;
   delete tx_selector;
+  delete tx_client_selector;
   delete rx_splitter;
   delete loopback_con;
   delete server;
@@ -194,6 +254,20 @@ bool NetUplink::initialize(void)
   cfg.getValue(name, "FALLBACK_REPEATER", fallback_enabled, true);
   cfg.getValue(name, "AUTH_KEY", auth_key);
 
+  if (!cfg.getValue(name, "MAX_CLIENTS", 1U, 100U, max_clients, true))
+  {
+    std::cerr << "*** ERROR: Configuration variable " << name
+              << "/MAX_CLIENTS must be in the range 1 to 100." << std::endl;
+    return false;
+  }
+
+  vector<string> prio_hosts;
+  cfg.getValue(name, "TX_PRIORITY_HOSTS", prio_hosts);
+  for (size_t i=0; i<prio_hosts.size(); ++i)
+  {
+    tx_prio_hosts[prio_hosts[i]] = prio_hosts.size() - i;
+  }
+
   int mute_tx_on_rx = -1;
   cfg.getValue(name, "MUTE_TX_ON_RX", mute_tx_on_rx, true);
   if (mute_tx_on_rx >= 0)
@@ -207,6 +281,28 @@ bool NetUplink::initialize(void)
   server->clientConnected.connect(mem_fun(*this, &NetUplink::clientConnected));
   server->clientDisconnected.connect(
       mem_fun(*this, &NetUplink::clientDisconnected));
+
+  bool udp_audio = false;
+  cfg.getValue(name, "UDP_AUDIO", udp_audio);
+  if (udp_audio)
+  {
+    udp_sock = new EncryptedUdpSocket(atoi(listen_port.c_str()));
+    if (NetTrxUdpChannel::setupSocket(udp_sock))
+    {
+      udp_sock->cipherDataReceived.connect(
+          mem_fun(*this, &NetUplink::udpCipherDataReceived));
+      udp_sock->dataReceived.connect(
+          mem_fun(*this, &NetUplink::udpDatagramReceived));
+    }
+    else
+    {
+      std::cerr << "*** WARNING: Could not open UDP port " << listen_port
+                << " for audio in NetUplink " << name
+                << ". Using TCP for audio." << std::endl;
+      delete udp_sock;
+      udp_sock = 0;
+    }
+  }
   
   rx->reset();
   rx->squelchOpen.connect(mem_fun(*this, &NetUplink::squelchOpen));
@@ -237,6 +333,11 @@ bool NetUplink::initialize(void)
   tx_selector->addSource(fifo);
   tx_selector->selectSource(fifo);
 
+    // The TX audio from all clients pass through this selector. The client
+    // that start sending audio first get the transmitter.
+  tx_client_selector = new AudioSelector;
+  tx_client_selector->registerSink(fifo);
+
   tx_selector->registerSink(tx);
   
   if (fallback_enabled)
@@ -271,47 +372,53 @@ bool NetUplink::initialize(void)
 
 void NetUplink::handleIncomingConnection(TcpConnection *incoming_con)
 {
-  assert(con == 0);
-  rx->reset();
-  if (fallback_enabled) // Deactivate fallback repeater mode
+  if (clients.empty())
   {
-    setFallbackActive(false);
+    rx->reset();
+    tone_detectors.clear();
+    if (fallback_enabled) // Deactivate fallback repeater mode
+    {
+      setFallbackActive(false);
+    }
+    heartbeat_timer->setEnable(true);
   }
-  
-  if (audio_enc != 0)
+
+  Client *client = new Client(incoming_con);
+  clients[incoming_con] = client;
+  TxPrioHosts::const_iterator pit =
+      tx_prio_hosts.find(incoming_con->remoteHost().toString());
+  if (pit != tx_prio_hosts.end())
   {
-    rx_splitter->removeSink(audio_enc);
-    delete audio_enc;
-    audio_enc = 0;
+    client->tx_prio = (*pit).second;
+  }
+  tx_client_selector->addSource(&client->tx_out);
+  tx_client_selector->enableAutoSelect(&client->tx_out, client->tx_prio);
+  if (udp_sock != 0)
+  {
+      // Audio received over UDP may be reordered or lost so a jitter buffer
+      // is put between the decoder and the TX audio selector
+    client->jitter_buf = new AudioPacketJitterBuffer;
+    client->jitter_buf->registerSink(&client->tx_out);
   }
-  
-  delete audio_dec;
-  audio_dec = 0;
-  
-  con = incoming_con;
-  con->dataReceived.connect(mem_fun(*this, &NetUplink::tcpDataReceived));
-  recv_exp = sizeof(Msg);
-  recv_cnt = 0;
-  heartbeat_timer->setEnable(true);
-  gettimeofday(&last_msg_timestamp, NULL);
-  
-  setState(STATE_CON_SETUP);
+
+  incoming_con->dataReceived.connect(
+      mem_fun(*this, &NetUplink::tcpDataReceived));
 
   MsgProtoVer *ver_msg = new MsgProtoVer;
-  sendMsg(ver_msg);
+  sendMsg(client, ver_msg);
   
   if (auth_key.empty())
   {
     MsgAuthOk *auth_msg = new MsgAuthOk;
-    sendMsg(auth_msg);
-    setState(STATE_READY);
+    sendMsg(client, auth_msg);
+    client->state = Client::STATE_READY;
   }
   else
   {
     MsgAuthChallenge *auth_msg = new MsgAuthChallenge;
-    memcpy(auth_challenge, auth_msg->challenge(),
+    memcpy(client->auth_challenge, auth_msg->challenge(),
            MsgAuthChallenge::CHALLENGE_LEN);
-    sendMsg(auth_msg);
+    sendMsg(client, auth_msg);
   }
 } /* NetUplink::handleIncomingConnection */
 
@@ -322,36 +429,53 @@ void NetUplink::clientConnected(TcpConnection *incoming_con)
             << incoming_con->remoteHost() << ":"
             << incoming_con->remotePort() << std::endl;
 
-  switch (state)
+  if (clients.size() >= max_clients)
   {
-    case STATE_DISC:
-      handleIncomingConnection(incoming_con);
-      break;
-    case STATE_CON_SETUP:
-    case STATE_READY:
+    if (max_clients == 1)
+    {
       std::cout << name << ": Only one client allowed. Disconnecting..."
                 << std::endl;
-      // Fall through
-    case STATE_DISC_CLEANUP:
-      incoming_con->disconnect();
-      break;
+    }
+    else
+    {
+      std::cout << name << ": Only " << max_clients
+                << " clients allowed. Disconnecting..." << std::endl;
+    }
+    incoming_con->disconnect();
+    return;
   }
+
+  handleIncomingConnection(incoming_con);
 } /* NetUplink::clientConnected */
 
 
-void NetUplink::disconnectCleanup(void)
+void NetUplink::disconnectCleanup(Client *client)
 {
-  con = 0;
-  recv_exp = 0;
-  setState(STATE_DISC);
+  flushTxAudio(client);
+  deleteUdpChannel(client);
+  releaseEncoder(client);
+  deleteDecoder(client);
+  delete client->jitter_buf;
+  client->jitter_buf = 0;
+  tx_client_selector->removeSource(&client->tx_out);
+  clients.erase(client->con);
+  delete client;
+
+  if (!clients.empty())
+  {
+    updateRxMuteState();
+    tx->enableCtcss(ctcssEnabled());
+    if (!tx_muted)
+    {
+      tx->setTxCtrlMode(txCtrlMode());
+    }
+    return;
+  }
 
   rx->reset();
+  tone_detectors.clear();
   tx->enableCtcss(false);
   fifo->clear();
-  if (audio_dec != 0)
-  {
-    audio_dec->flushEncodedSamples();
-  }
   tx->setTxCtrlMode(Tx::TX_OFF);
   heartbeat_timer->setEnable(false);
 
@@ -361,7 +485,6 @@ void NetUplink::disconnectCleanup(void)
   }
 
   tx_muted = false;
-  tx_ctrl_mode = Tx::TX_OFF;
     
   if (fallback_enabled)
   {
@@ -377,15 +500,26 @@ void NetUplink::disconnectCleanup(void)
 void NetUplink::clientDisconnected(TcpConnection *the_con,
                                    TcpConnection::DisconnectReason reason)
 {
+  Clients::iterator it = clients.find(the_con);
+  if (it == clients.end())
+  {
+    return;
+  }
+  Client *client = (*it).second;
+  if (client->state == Client::STATE_DISC_CLEANUP)
+  {
+    return;
+  }
+
   std::cout << "NOTICE[" << name << "]: Client disconnected: "
             << the_con->remoteHost() << ":"
             << the_con->remotePort() << ": "
             << TcpConnection::disconnectReasonStr(reason)
             << std::endl;
 
-  con = 0;
-  setState(STATE_DISC_CLEANUP);
-  Application::app().runTask(mem_fun(*this, &NetUplink::disconnectCleanup));
+  client->state = Client::STATE_DISC_CLEANUP;
+  Application::app().runTask(
+      sigc::bind(mem_fun(*this, &NetUplink::disconnectCleanup), client));
 } /* NetUplink::clientDisconnected */
 
 
@@ -398,115 +532,77 @@ int NetUplink::tcpDataReceived(TcpConnection *con, void *data, int size)
   //     << " and size " << msg->size() << endl;
   
     // Discard data if we are not in one of the "connected" states
-  if ((state != STATE_CON_SETUP) && (state != STATE_READY))
+  Clients::iterator it = clients.find(con);
+  if ((it == clients.end()) ||
+      ((*it).second->state == Client::STATE_DISC_CLEANUP))
   {
     return size;
   }
+  Client *client = (*it).second;
 
-  if (recv_exp == 0)
+    // Messages are handled directly in the receive buffer of the connection.
+    // A partial message is left in the buffer until the rest of it arrives.
+  int processed = parseMsgs(data, size,
+      [this, client](Msg *msg)
+      {
+        handleMsg(client, msg);
+        return client->state != Client::STATE_DISC_CLEANUP;
+      });
+  if (processed < 0)
   {
-    std::cerr << "*** ERROR: Unexpected TCP data received in NetUplink "
-              << name << ". Throwing it away..." << std::endl;
+    std::cerr << "*** ERROR: Illegal message header received in "
+              << "NetUplink " << name << ". Disconnecting..." << std::endl;
+    forceDisconnect(client);
     return size;
   }
-  
-  int orig_size = size;
-  
-  char *buf = static_cast<char*>(data);
-  while (size > 0)
+  if (client->state == Client::STATE_DISC_CLEANUP)
   {
-    unsigned read_cnt = min(static_cast<unsigned>(size), recv_exp-recv_cnt);
-    if (recv_cnt+read_cnt > sizeof(recv_buf))
-    {
-      std::cerr << "*** ERROR: TCP receive buffer overflow in NetUplink "
-                << name << ". Disconnecting..." << std::endl;
-      forceDisconnect();
-      return orig_size;
-    }
-    memcpy(recv_buf+recv_cnt, buf, read_cnt);
-    size -= read_cnt;
-    recv_cnt += read_cnt;
-    buf += read_cnt;
-    
-    if (recv_cnt == recv_exp)
-    {
-      if (recv_exp == sizeof(Msg))
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	if (msg->size() == sizeof(Msg))
-	{
-	  handleMsg(msg);
-	  recv_cnt = 0;
-	  recv_exp = sizeof(Msg);
-	}
-	else if (msg->size() > sizeof(Msg))
-	{
-      	  recv_exp = msg->size();
-	}
-	else
-	{
-          std::cerr << "*** ERROR: Illegal message header received in "
-                    << "NetUplink " << name << ". Header length too small ("
-                    << msg->size() << ")" << std::endl;
-          forceDisconnect();
-	  return orig_size;
-	}
-      }
-      else
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-      	handleMsg(msg);
-	recv_cnt = 0;
-	recv_exp = sizeof(Msg);
-      }
-    }
+    return size;
   }
-  
-  return orig_size;
+  return processed;
   
 } /* NetUplink::tcpDataReceived */
 
 
-void NetUplink::handleMsg(Msg *msg)
+void NetUplink::handleMsg(Client *client, Msg *msg)
 {
-  switch (state)
+  switch (client->state)
   {
-    case STATE_DISC:
-    case STATE_DISC_CLEANUP:
+    case Client::STATE_DISC_CLEANUP:
       return;
       
-    case STATE_CON_SETUP:
+    case Client::STATE_CON_SETUP:
       if (msg->type() == MsgAuthResponse::TYPE &&
           msg->size() == sizeof(MsgAuthResponse))
       {
         MsgAuthResponse *resp_msg = reinterpret_cast<MsgAuthResponse *>(msg);
-        if (!resp_msg->verify(auth_key, auth_challenge))
+        if (!resp_msg->verify(auth_key, client->auth_challenge))
         {
           std::cerr << "*** ERROR: Authentication error in NetUplink "
                     << name << "." << std::endl;
-          forceDisconnect();
+          forceDisconnect(client);
           return;
         }
         else
         {
           MsgAuthOk *ok_msg = new MsgAuthOk;
-          sendMsg(ok_msg);
+          sendMsg(client, ok_msg);
         }
-        setState(STATE_READY);
+        client->state = Client::STATE_READY;
       }
       else
       {
         std::cerr << "*** ERROR: Protocol error in NetUplink " << name << "."
                   << std::endl;
-        forceDisconnect();
+        forceDisconnect(client);
       }
       return;
     
-    case STATE_READY:
+    case Client::STATE_READY:
       break;
   }
   
-  gettimeofday(&last_msg_timestamp, NULL);
+  gettimeofday(&client->last_msg_timestamp, NULL);
   
   switch (msg->type())
   {
@@ -514,10 +610,34 @@ void NetUplink::handleMsg(Msg *msg)
     {
       break;
     }
+
+    case MsgUdpAudioSetup::TYPE:
+    {
+      if (msg->size() != sizeof(MsgUdpAudioSetup))
+      {
+        std::cerr << "*** ERROR: Protocol error. Wrong length of "
+                     "MsgUdpAudioSetup message in NetUplink " << name
+                  << "." << std::endl;
+        forceDisconnect(client);
+        return;
+      }
+      handleUdpAudioSetup(client, reinterpret_cast<MsgUdpAudioSetup*>(msg));
+      break;
+    }
     
     case MsgReset::TYPE:
     {
-      rx->reset();
+        // The receiver is only reset if no other client is using it
+      client->rx_mute_state = Rx::MUTE_ALL;
+      if (clients.size() == 1)
+      {
+        rx->reset();
+        tone_detectors.clear();
+      }
+      else
+      {
+        updateRxMuteState();
+      }
       break;
     }
     
@@ -546,7 +666,8 @@ void NetUplink::handleMsg(Msg *msg)
       std::cout << rx->name() << ": SetMuteState("
                 << Rx::muteStateToString(mute_msg->muteState())
                 << ")" << std::endl;
-      rx->setMuteState(mute_msg->muteState());
+      client->rx_mute_state = mute_msg->muteState();
+      updateRxMuteState();
       break;
     }
     
@@ -556,18 +677,27 @@ void NetUplink::handleMsg(Msg *msg)
       std::cout << rx->name() << ": AddToneDetector(" << atd->fq()
                 << ", " << atd->bw()
                 << ", " << atd->requiredDuration() << ")" << std::endl;
-      rx->addToneDetector(atd->fq(), atd->bw(), atd->thresh(),
-      	      	      	  atd->requiredDuration());
+
+        // Many clients may ask for the same tone detector. Only add it once
+        // so that each detected tone is only reported once.
+      ostringstream ss;
+      ss << atd->fq() << "/" << atd->bw() << "/" << atd->thresh() << "/"
+         << atd->requiredDuration();
+      if (tone_detectors.insert(ss.str()).second)
+      {
+        rx->addToneDetector(atd->fq(), atd->bw(), atd->thresh(),
+                            atd->requiredDuration());
+      }
       break;
     }
     
     case MsgSetTxCtrlMode::TYPE:
     {
       MsgSetTxCtrlMode *mode_msg = reinterpret_cast<MsgSetTxCtrlMode *>(msg);
-      tx_ctrl_mode = mode_msg->mode();
+      client->tx_ctrl_mode = mode_msg->mode();
       if (!tx_muted)
       {
-	tx->setTxCtrlMode(tx_ctrl_mode);
+	tx->setTxCtrlMode(txCtrlMode());
       }
       break;
     }
@@ -575,7 +705,8 @@ void NetUplink::handleMsg(Msg *msg)
     case MsgEnableCtcss::TYPE:
     {
       MsgEnableCtcss *ctcss_msg = reinterpret_cast<MsgEnableCtcss *>(msg);
-      tx->enableCtcss(ctcss_msg->enable());
+      client->ctcss_enabled = ctcss_msg->enable();
+      tx->enableCtcss(ctcssEnabled());
       break;
     }
      
@@ -588,91 +719,44 @@ void NetUplink::handleMsg(Msg *msg)
     
     case MsgRxAudioCodecSelect::TYPE:
     {
-      MsgRxAudioCodecSelect *codec_msg = 
-          reinterpret_cast<MsgRxAudioCodecSelect *>(msg);
-      if (audio_enc != 0)
-      {
-	rx_splitter->removeSink(audio_enc);
-	delete audio_enc;
-      }
-      audio_enc = AudioEncoder::create(codec_msg->name());
-      if (audio_enc != 0)
-      {
-        audio_enc->writeEncodedSamples.connect(
-                mem_fun(*this, &NetUplink::writeEncodedSamples));
-        audio_enc->flushEncodedSamples.connect(
-                mem_fun(*audio_enc, &AudioEncoder::allEncodedSamplesFlushed));
-        //audio_enc->registerSource(rx);
-	rx_splitter->addSink(audio_enc);
-        std::cout << name << ": Using CODEC \"" << audio_enc->name()
-                  << "\" to encode RX audio" << std::endl;
-	
-	MsgRxAudioCodecSelect::Opts opts;
-	codec_msg->options(opts);
-	MsgRxAudioCodecSelect::Opts::const_iterator it;
-	for (it=opts.begin(); it!=opts.end(); ++it)
-	{
-	  audio_enc->setOption((*it).first, (*it).second);
-	}
-	audio_enc->printCodecParams();
-      }
-      else
-      {
-        std::cerr << "*** ERROR: Received request for unknown RX audio codec ("
-                  << codec_msg->name() << ") in NetUplink " << name
-                  << std::endl;
-      }
+      selectRxCodec(client, reinterpret_cast<MsgRxAudioCodecSelect *>(msg));
       break;
     }
     
     case MsgTxAudioCodecSelect::TYPE:
     {
-      MsgTxAudioCodecSelect *codec_msg = 
-          reinterpret_cast<MsgTxAudioCodecSelect *>(msg);
-      delete audio_dec;
-      audio_dec = AudioDecoder::create(codec_msg->name());
-      if (audio_dec != 0)
-      {
-        audio_dec->registerSink(fifo);
-        audio_dec->allEncodedSamplesFlushed.connect(
-            mem_fun(*this, &NetUplink::allEncodedSamplesFlushed));
-        std::cout << name << ": Using CODEC \"" << audio_dec->name()
-                  << "\" to decode TX audio" << std::endl;
-	
-	MsgRxAudioCodecSelect::Opts opts;
-	codec_msg->options(opts);
-	MsgTxAudioCodecSelect::Opts::const_iterator it;
-	for (it=opts.begin(); it!=opts.end(); ++it)
-	{
-	  audio_dec->setOption((*it).first, (*it).second);
-	}
-	audio_dec->printCodecParams();
-      }
-      else
-      {
-        std::cerr << "*** ERROR: Received request for unknown TX audio codec ("
-                  << codec_msg->name() << ") in NetUplink " << name
-                  << std::endl;
-      }
+      selectTxCodec(client, reinterpret_cast<MsgTxAudioCodecSelect *>(msg));
       break;
     }
     
     case MsgAudio::TYPE:
     {
       //cout << "NetUplink [MsgAudio]\n";
-      if (!tx_muted && (audio_dec != 0))
+      MsgAudio *audio_msg = reinterpret_cast<MsgAudio*>(msg);
+      if (!audio_msg->isValid())
+      {
+        std::cerr << "*** ERROR: Malformed MsgAudio received in NetUplink "
+                  << name << ". Disconnecting..." << std::endl;
+        forceDisconnect(client);
+        return;
+      }
+      if (!tx_muted && (client->audio_dec != 0))
       {
-        MsgAudio *audio_msg = reinterpret_cast<MsgAudio*>(msg);
-        audio_dec->writeEncodedSamples(audio_msg->buf(), audio_msg->size());
+        client->audio_dec->writeEncodedSamples(audio_msg->buf(),
+                                               audio_msg->size());
       }
       break;
     }
     
     case MsgFlush::TYPE:
     {
-      if (audio_dec != 0)
+      if (client->audio_dec != 0)
+      {
+        flushTxAudio(client);
+      }
+      else
       {
-        audio_dec->flushEncodedSamples();
+        sendMsg(client, new MsgAllSamplesFlushed);
       }
       break;
     } 
@@ -715,23 +799,12 @@ void NetUplink::handleMsg(Msg *msg)
 } /* NetUplink::handleMsg */
 
 
-void NetUplink::sendMsg(Msg *msg)
+void NetUplink::sendMsg(Client *client, Msg *msg)
 {
-  if ((state == STATE_CON_SETUP) || (state == STATE_READY))
+  if ((client->state == Client::STATE_CON_SETUP) ||
+      (client->state == Client::STATE_READY))
   {
-    int written = con->write(msg, msg->size());
-    if (written == -1)
-    {
-      std::cerr << "*** ERROR: TCP transmit error in NetUplink \"" << name
-                << "\": " << strerror(errno) << "." << std::endl;
-      forceDisconnect();
-    }
-    else if (written != static_cast<int>(msg->size()))
-    {
-      std::cerr << "*** ERROR: TCP transmit buffer overflow in NetUplink "
-                << name << "." << std::endl;
-      forceDisconnect();
-    }
+    writeMsg(client, msg);
   }
   
   delete msg;
@@ -739,6 +812,41 @@ void NetUplink::sendMsg(Msg *msg)
 } /* NetUplink::sendMsg */
 
 
+void NetUplink::broadcastMsg(Msg *msg)
+{
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    Client *client = (*it).second;
+    if (client->state == Client::STATE_READY)
+    {
+      writeMsg(client, msg);
+    }
+  }
+  delete msg;
+} /* NetUplink::broadcastMsg */
+
+
+bool NetUplink::writeMsg(Client *client, const Msg *msg)
+{
+  int written = client->con->write(msg, msg->size());
+  if (written == -1)
+  {
+    std::cerr << "*** ERROR: TCP transmit error in NetUplink \"" << name
+              << "\": " << strerror(errno) << "." << std::endl;
+    forceDisconnect(client);
+    return false;
+  }
+  else if (written != static_cast<int>(msg->size()))
+  {
+    std::cerr << "*** ERROR: TCP transmit buffer overflow in NetUplink "
+              << name << "." << std::endl;
+    forceDisconnect(client);
+    return false;
+  }
+  return true;
+} /* NetUplink::writeMsg */
+
+
 void NetUplink::squelchOpen(bool is_open)
 {
   if (mute_tx_timer != 0)
@@ -756,7 +864,7 @@ void NetUplink::squelchOpen(bool is_open)
 
   MsgSquelch *msg = new MsgSquelch(is_open, rx->signalStrength(),
                                    rx->sqlRxId(), rx->squelchActivityInfo());
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::squelchOpen */
 
 
@@ -765,7 +873,7 @@ void NetUplink::dtmfDigitDetected(char digit, int duration)
   cout << name << ": DTMF digit detected: " << digit << " with duration " << duration
        << " milliseconds" << endl;
   MsgDtmf *msg = new MsgDtmf(digit, duration);
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::dtmfDigitDetected */
 
 
@@ -773,7 +881,7 @@ void NetUplink::toneDetected(float tone_fq)
 {
   cout << name << ": Tone detected: " << tone_fq << endl;
   MsgTone *msg = new MsgTone(tone_fq);
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::toneDetected */
 
 
@@ -781,20 +889,53 @@ void NetUplink::selcallSequenceDetected(std::string sequence)
 {
   // cout "Sel5 sequence detected: " << sequence << endl;
   MsgSel5 *msg = new MsgSel5(sequence);
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::selcallSequenceDetected */
 
 
-void NetUplink::writeEncodedSamples(const void *buf, int size)
+void NetUplink::writeEncodedSamples(Encoder *enc, const void *buf, int size)
 {
   //cout << "NetUplink::writeEncodedSamples: size=" << size << endl;
+  bool tcp_needed = false;
+  for (std::set<Client*>::iterator it=enc->clients.begin();
+       it!=enc->clients.end(); ++it)
+  {
+    Client *client = *it;
+    client->audio_over_tcp = false;
+    if (client->state != Client::STATE_READY)
+    {
+      continue;
+    }
+    if ((client->udp_chan != 0) && client->udp_chan->isActive() &&
+        client->udp_chan->sendAudio(buf, size))
+    {
+      continue;
+    }
+    client->audio_over_tcp = true;
+    tcp_needed = true;
+  }
+  if (!tcp_needed)
+  {
+    return;
+  }
+
+    // Each audio message is built once and then written to all clients
+    // that receive their audio over the TCP connection
   const char *ptr = reinterpret_cast<const char *>(buf);
   while (size > 0)
   {
     const int bufsize = MsgAudio::BUFSIZE;
     int len = min(size, bufsize);
-    MsgAudio *msg = new MsgAudio(ptr, len);
-    sendMsg(msg);
+    MsgAudio msg(ptr, len);
+    for (std::set<Client*>::iterator it=enc->clients.begin();
+         it!=enc->clients.end(); ++it)
+    {
+      Client *client = *it;
+      if (client->audio_over_tcp && (client->state == Client::STATE_READY))
+      {
+        writeMsg(client, &msg);
+      }
+    }
     size -= len;
     ptr += len;
   }
@@ -804,7 +945,7 @@ void NetUplink::writeEncodedSamples(const void *buf, int size)
 void NetUplink::txTimeout(void)
 {
   MsgTxTimeout *msg = new MsgTxTimeout;
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::txTimeout */
 
 
@@ -812,37 +953,42 @@ void NetUplink::transmitterStateChange(bool is_transmitting)
 {
   MsgTransmitterStateChange *msg =
       new MsgTransmitterStateChange(is_transmitting);
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::transmitterStateChange */
 
 
-void NetUplink::allEncodedSamplesFlushed(void)
+void NetUplink::allEncodedSamplesFlushed(Client *client)
 {
   MsgAllSamplesFlushed *msg = new MsgAllSamplesFlushed;
-  sendMsg(msg);
+  sendMsg(client, msg);
 } /* NetUplink::allEncodedSamplesFlushed */
 
 
 void NetUplink::heartbeat(Timer *t)
 {
   MsgHeartbeat *msg = new MsgHeartbeat;
-  sendMsg(msg);
+  broadcastMsg(msg);
   
-  struct timeval diff_tv;
   struct timeval now;
   gettimeofday(&now, NULL);
-  timersub(&now, &last_msg_timestamp, &diff_tv);
-  int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
-  
-  if (diff_ms > 15000)
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
   {
-    std::cerr << "*** ERROR: Heartbeat timeout in NetUplink " << name
-              << std::endl;
-    forceDisconnect();
+    Client *client = (*it).second;
+    if (client->state == Client::STATE_DISC_CLEANUP)
+    {
+      continue;
+    }
+    struct timeval diff_tv;
+    timersub(&now, &client->last_msg_timestamp, &diff_tv);
+    int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
+    if (diff_ms > 15000)
+    {
+      std::cerr << "*** ERROR: Heartbeat timeout in NetUplink " << name
+                << std::endl;
+      forceDisconnect(client);
+    }
   }
   
-  t->reset();
-  
 } /* NetTrxTcpClient::heartbeat */
 
 
@@ -858,7 +1004,7 @@ void NetUplink::unmuteTx(Timer *t)
 {
   mute_tx_timer->setEnable(false);
   tx_muted = false;
-  tx->setTxCtrlMode(tx_ctrl_mode);
+  tx->setTxCtrlMode(txCtrlMode());
 } /* NetUplink::unmuteTx */
 
 
@@ -885,17 +1031,326 @@ void NetUplink::signalLevelUpdated(float siglev)
 {
   MsgSiglevUpdate *msg = new MsgSiglevUpdate(rx->signalStrength(),
 					     rx->sqlRxId());
-  sendMsg(msg);  
+  broadcastMsg(msg);
 } /* NetUplink::signalLevelUpdated */
 
 
-void NetUplink::forceDisconnect(void)
+void NetUplink::forceDisconnect(Client *client)
 {
+  TcpConnection *con = client->con;
   con->disconnect();
   clientDisconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
 } /* NetUplink::forceDisconnect */
 
 
+void NetUplink::selectRxCodec(Client *client, MsgRxAudioCodecSelect *codec_msg)
+{
+  releaseEncoder(client);
+
+    // Clients asking for the same codec with the same options share one
+    // encoder so that the audio only has to be encoded once
+  MsgRxAudioCodecSelect::Opts opts;
+  codec_msg->options(opts);
+  string key(codec_msg->name());
+  MsgRxAudioCodecSelect::Opts::const_iterator it;
+  for (it=opts.begin(); it!=opts.end(); ++it)
+  {
+    key += " " + (*it).first + "=" + (*it).second;
+  }
+
+  Encoders::iterator eit = encoders.find(key);
+  if (eit != encoders.end())
+  {
+    client->encoder = (*eit).second;
+    client->encoder->clients.insert(client);
+    std::cout << name << ": Using shared CODEC \""
+              << client->encoder->enc->name()
+              << "\" to encode RX audio" << std::endl;
+    return;
+  }
+
+  AudioEncoder *audio_enc = AudioEncoder::create(codec_msg->name());
+  if (audio_enc == 0)
+  {
+    std::cerr << "*** ERROR: Received request for unknown RX audio codec ("
+              << codec_msg->name() << ") in NetUplink " << name
+              << std::endl;
+    return;
+  }
+
+  Encoder *enc = new Encoder;
+  enc->enc = audio_enc;
+  enc->key = key;
+  enc->clients.insert(client);
+  encoders[key] = enc;
+  client->encoder = enc;
+
+  audio_enc->writeEncodedSamples.connect(
+          sigc::bind<0>(mem_fun(*this, &NetUplink::writeEncodedSamples), enc));
+  audio_enc->flushEncodedSamples.connect(
+          mem_fun(*audio_enc, &AudioEncoder::allEncodedSamplesFlushed));
+  //audio_enc->registerSource(rx);
+  std::cout << name << ": Using CODEC \"" << audio_enc->name()
+            << "\" to encode RX audio" << std::endl;
+  for (it=opts.begin(); it!=opts.end(); ++it)
+  {
+    audio_enc->setOption((*it).first, (*it).second);
+  }
+  audio_enc->printCodecParams();
+  rx_splitter->addSink(audio_enc);
+} /* NetUplink::selectRxCodec */
+
+
+void NetUplink::releaseEncoder(Client *client)
+{
+  Encoder *enc = client->encoder;
+  if (enc == 0)
+  {
+    return;
+  }
+  client->encoder = 0;
+  enc->clients.erase(client);
+  if (enc->clients.empty())
+  {
+    encoders.erase(enc->key);
+    rx_splitter->removeSink(enc->enc);
+    delete enc->enc;
+    delete enc;
+  }
+} /* NetUplink::releaseEncoder */
+
+
+void NetUplink::selectTxCodec(Client *client, MsgTxAudioCodecSelect *codec_msg)
+{
+  deleteDecoder(client);
+  AudioDecoder *audio_dec = AudioDecoder::create(codec_msg->name());
+  if (audio_dec == 0)
+  {
+    std::cerr << "*** ERROR: Received request for unknown TX audio codec ("
+              << codec_msg->name() << ") in NetUplink " << name
+              << std::endl;
+    return;
+  }
+
+  client->audio_dec = audio_dec;
+  if (client->jitter_buf != 0)
+  {
+    audio_dec->registerSink(client->jitter_buf);
+    client->jitter_buf->setDecoder(audio_dec);
+  }
+  else
+  {
+    audio_dec->registerSink(&client->tx_out);
+  }
+  audio_dec->allEncodedSamplesFlushed.connect(
+      sigc::bind(mem_fun(*this, &NetUplink::allEncodedSamplesFlushed),
+                 client));
+  std::cout << name << ": Using CODEC \"" << audio_dec->name()
+            << "\" to decode TX audio" << std::endl;
+
+  MsgTxAudioCodecSelect::Opts opts;
+  codec_msg->options(opts);
+  MsgTxAudioCodecSelect::Opts::const_iterator it;
+  for (it=opts.begin(); it!=opts.end(); ++it)
+  {
+    audio_dec->setOption((*it).first, (*it).second);
+  }
+  audio_dec->printCodecParams();
+} /* NetUplink::selectTxCodec */
+
+
+void NetUplink::deleteDecoder(Client *client)
+{
+  if (client->jitter_buf != 0)
+  {
+    client->jitter_buf->reset();
+    client->jitter_buf->setDecoder(0);
+  }
+  delete client->audio_dec;
+  client->audio_dec = 0;
+} /* NetUplink::deleteDecoder */
+
+
+void NetUplink::updateRxMuteState(void)
+{
+  Rx::MuteState mute_state = Rx::MUTE_ALL;
+  for (Clients::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    Client *client = (*it).second;
+    if ((client->state == Client::STATE_READY) &&
+        (client->rx_mute_state < mute_state))
+    {
+      mute_state = client->rx_mute_state;
+    }
+  }
+  rx->setMuteState(mute_state);
+} /* NetUplink::updateRxMuteState */
+
+
+Tx::TxCtrlMode NetUplink::txCtrlMode(void) const
+{
+    // The transmitter is forced on if any client want it on. Otherwise it is
+    // set in auto mode if any client use auto mode.
+  Tx::TxCtrlMode mode = Tx::TX_OFF;
+  for (Clients::const_iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    const Client *client = (*it).second;
+    if (client->state != Client::STATE_READY)
+    {
+      continue;
+    }
+    if (client->tx_ctrl_mode == Tx::TX_ON)
+    {
+      return Tx::TX_ON;
+    }
+    if (client->tx_ctrl_mode == Tx::TX_AUTO)
+    {
+      mode = Tx::TX_AUTO;
+    }
+  }
+  return mode;
+} /* NetUplink::txCtrlMode */
+
+
+bool NetUplink::ctcssEnabled(void) const
+{
+  for (Clients::const_iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    const Client *client = (*it).second;
+    if ((client->state == Client::STATE_READY) && client->ctcss_enabled)
+    {
+      return true;
+    }
+  }
+  return false;
+} /* NetUplink::ctcssEnabled */
+
+
+void NetUplink::handleUdpAudioSetup(Client *client, MsgUdpAudioSetup *msg)
+{
+  if (udp_sock == 0)
+  {
+      // UDP audio is not enabled. The client will use TCP for audio since
+      // no acknowledge is sent.
+    return;
+  }
+
+  deleteUdpChannel(client);
+  MsgUdpAudioSetupAck *ack_msg = new MsgUdpAudioSetupAck;
+  while (udp_sessions.find(ack_msg->sessionId()) != udp_sessions.end())
+  {
+    delete ack_msg;
+    ack_msg = new MsgUdpAudioSetupAck;
+  }
+  NetTrxUdpChannel *udp_chan = new NetTrxUdpChannel(
+      udp_sock, auth_key, msg->nonce(), MsgUdpAudioSetup::NONCE_LEN,
+      ack_msg->salt(), msg->salt(), ack_msg->sessionId());
+  if (!udp_chan->initOk())
+  {
+    delete udp_chan;
+    delete ack_msg;
+    return;
+  }
+  client->udp_chan = udp_chan;
+  udp_sessions[udp_chan->sessionId()] = client;
+  udp_chan->audioReceived.connect(
+      sigc::bind<0>(mem_fun(*this, &NetUplink::udpAudioReceived), client));
+  udp_chan->sequenceSkipped.connect(
+      sigc::bind<0>(mem_fun(*this, &NetUplink::udpSequenceSkipped), client));
+  udp_chan->flushReceived.connect(
+      sigc::bind(mem_fun(*this, &NetUplink::flushTxAudio), client));
+  TcpConnection *con = client->con;
+  udp_chan->activeStateChanged.connect(
+      [this, con](bool is_active)
+      {
+        std::cout << name << ": Audio to/from " << con->remoteHost() << ":"
+                  << con->remotePort() << " is now sent over "
+                  << (is_active ? "UDP" : "TCP") << std::endl;
+      });
+  sendMsg(client, ack_msg);
+} /* NetUplink::handleUdpAudioSetup */
+
+
+void NetUplink::deleteUdpChannel(Client *client)
+{
+  if (client->udp_chan == 0)
+  {
+    return;
+  }
+  udp_sessions.erase(client->udp_chan->sessionId());
+  delete client->udp_chan;
+  client->udp_chan = 0;
+  if (udp_rx_client == client)
+  {
+    udp_rx_client = 0;
+  }
+} /* NetUplink::deleteUdpChannel */
+
+
+bool NetUplink::udpCipherDataReceived(const IpAddress& ip, uint16_t port,
+                                      void *buf, int count)
+{
+  udp_rx_client = 0;
+  uint32_t session_id = 0;
+  if (!NetTrxUdpChannel::parseAad(buf, count, session_id, udp_rx_seq))
+  {
+    return true;
+  }
+  UdpSessions::iterator it = udp_sessions.find(session_id);
+  if ((it == udp_sessions.end()) ||
+      ((*it).second->state != Client::STATE_READY))
+  {
+    return true;
+  }
+  udp_rx_client = (*it).second;
+  return !udp_rx_client->udp_chan->prepareDecrypt(udp_rx_seq);
+} /* NetUplink::udpCipherDataReceived */
+
+
+void NetUplink::udpDatagramReceived(const IpAddress& ip, uint16_t port,
+                                    void *aad, void *buf, int count)
+{
+  if (udp_rx_client != 0)
+  {
+    udp_rx_client->udp_chan->handleDatagram(ip, port, udp_rx_seq, buf,
+                                            count);
+  }
+} /* NetUplink::udpDatagramReceived */
+
+
+void NetUplink::udpAudioReceived(Client *client, uint32_t seq,
+                                 const void *buf, int size)
+{
+  if (!tx_muted && (client->audio_dec != 0))
+  {
+    client->jitter_buf->writeEncodedSamples(seq, buf, size);
+  }
+} /* NetUplink::udpAudioReceived */
+
+
+void NetUplink::udpSequenceSkipped(Client *client, uint32_t seq)
+{
+  client->jitter_buf->skipSequenceNumber(seq);
+} /* NetUplink::udpSequenceSkipped */
+
+
+void NetUplink::flushTxAudio(Client *client)
+{
+  if (client->audio_dec == 0)
+  {
+    return;
+  }
+  if (client->jitter_buf != 0)
+  {
+    client->jitter_buf->flushEncodedSamples();
+  }
+  else
+  {
+    client->audio_dec->flushEncodedSamples();
+  }
+} /* NetUplink::flushTxAudio */
+
+
 /*
  * This file has not been truncated
  */
@@ -38,6 +38,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <sys/time.h>
 
 #include <string>
+#include <map>
+#include <set>
 
 
 /****************************************************************************
@@ -77,13 +79,19 @@ namespace Async
   class AudioSplitter;
   class AudioSelector;
   class AudioPassthrough;
+  class AudioPacketJitterBuffer;
+  class EncryptedUdpSocket;
+  class IpAddress;
 };
 
 namespace NetTrxMsg
 {
   class Msg;
+  class MsgUdpAudioSetup;
 };
 
+class NetTrxUdpChannel;
+
 /****************************************************************************
  *
  * Namespace
@@ -130,6 +138,21 @@ namespace NetTrxMsg
 @date   2006-04-14
 
 This class implements a remote transceiver uplink via an IP network.
+
+Up to MAX_CLIENTS clients may be connected at the same time, e.g. a primary
+and a standby SvxLink server or a voter and a recorder. All clients share the
+same receiver and transmitter. Receiver audio is encoded once for each
+distinct codec configuration and the encoded frames are sent to all clients
+using that configuration. Receiver events, like squelch and DTMF, are sent to
+all clients. The receiver is muted only as much as the least muted client
+want it to be.
+
+Only one client at a time may send audio to the transmitter. The first
+client to start sending audio get the transmitter until its audio has been
+flushed. Audio from other clients is discarded in the meantime and their
+flush requests are acknowledged right away. Clients connecting from a host
+listed in TX_PRIORITY_HOSTS may take the transmitter from clients with lower
+priority. The transmitter is keyed if any client request it to be on.
 */
 class NetUplink : public Uplink
 {
@@ -160,47 +183,51 @@ class NetUplink : public Uplink
   protected:
     
   private:
-    typedef enum
-    {
-      STATE_DISC, STATE_CON_SETUP, STATE_READY, STATE_DISC_CLEANUP
-    } State;
-    
+    class Client;
+    struct Encoder;
+    typedef std::map<Async::TcpConnection*, Client*>  Clients;
+    typedef std::map<uint32_t, Client*>               UdpSessions;
+    typedef std::map<std::string, Encoder*>           Encoders;
+    typedef std::map<std::string, int>                TxPrioHosts;
+
     Async::TcpServer<Async::TcpConnection>*  server;
-    Async::TcpConnection    *con;
-    char      	      	    recv_buf[4096];
-    unsigned       	    recv_cnt;
-    unsigned       	    recv_exp;
+    Clients                 clients;
+    unsigned                max_clients;
     Rx	      	      	    *rx;
     Tx	      	      	    *tx;
     Async::AudioFifo  	    *fifo;
     Async::Config     	    &cfg;
     std::string       	    name;
-    struct timeval    	    last_msg_timestamp;
     Async::Timer      	    *heartbeat_timer;
-    Async::AudioEncoder     *audio_enc;
-    Async::AudioDecoder     *audio_dec;
+    Encoders                encoders;
     Async::AudioPassthrough *loopback_con;
     Async::AudioSplitter    *rx_splitter;
     Async::AudioSelector    *tx_selector;
-    State                   state;
+    Async::AudioSelector    *tx_client_selector;
     std::string             auth_key;
-    unsigned char           auth_challenge[NetTrxMsg::MsgAuthChallenge::CHALLENGE_LEN];
     //Async::Timer      	    *siglev_check_timer;
     Async::Timer	    *mute_tx_timer;
     bool		    tx_muted;
     bool                    fallback_enabled;
-    Tx::TxCtrlMode	    tx_ctrl_mode;
+    Async::EncryptedUdpSocket *udp_sock;
+    UdpSessions             udp_sessions;
+    Client                  *udp_rx_client;
+    uint32_t                udp_rx_seq;
+    TxPrioHosts             tx_prio_hosts;
+    std::set<std::string>   tone_detectors;
     
     NetUplink(const NetUplink&);
     NetUplink& operator=(const NetUplink&);
     void handleIncomingConnection(Async::TcpConnection *incoming_con);
     void clientConnected(Async::TcpConnection *con);
-    void disconnectCleanup(void);
+    void disconnectCleanup(Client *client);
     void clientDisconnected(Async::TcpConnection *con,
       	      	      	    Async::TcpConnection::DisconnectReason reason);
     int tcpDataReceived(Async::TcpConnection *con, void *data, int size);
-    void handleMsg(NetTrxMsg::Msg *msg);
-    void sendMsg(NetTrxMsg::Msg *msg);
+    void handleMsg(Client *client, NetTrxMsg::Msg *msg);
+    void sendMsg(Client *client, NetTrxMsg::Msg *msg);
+    void broadcastMsg(NetTrxMsg::Msg *msg);
+    bool writeMsg(Client *client, const NetTrxMsg::Msg *msg);
 
     /**
      * @brief 	Set squelch state to open/closed
@@ -227,17 +254,36 @@ class NetUplink : public Uplink
     void selcallSequenceDetected(std::string sequence);
 
 
-    void writeEncodedSamples(const void *buf, int size);
+    void writeEncodedSamples(Encoder *enc, const void *buf, int size);
     void txTimeout(void);
     void transmitterStateChange(bool is_transmitting);
-    void allEncodedSamplesFlushed(void);
+    void allEncodedSamplesFlushed(Client *client);
     void heartbeat(Async::Timer *t);
     //void checkSiglev(Async::Timer *t);
     void unmuteTx(Async::Timer *t);
     void setFallbackActive(bool activate);
     void signalLevelUpdated(float siglev);
-    void forceDisconnect(void);
-    void setState(State new_state) { state = new_state; }
+    void forceDisconnect(Client *client);
+    void selectRxCodec(Client *client,
+                       NetTrxMsg::MsgRxAudioCodecSelect *codec_msg);
+    void releaseEncoder(Client *client);
+    void selectTxCodec(Client *client,
+                       NetTrxMsg::MsgTxAudioCodecSelect *codec_msg);
+    void deleteDecoder(Client *client);
+    void updateRxMuteState(void);
+    Tx::TxCtrlMode txCtrlMode(void) const;
+    bool ctcssEnabled(void) const;
+    void handleUdpAudioSetup(Client *client,
+                             NetTrxMsg::MsgUdpAudioSetup *msg);
+    void deleteUdpChannel(Client *client);
+    bool udpCipherDataReceived(const Async::IpAddress& ip, uint16_t port,
+                               void *buf, int count);
+    void udpDatagramReceived(const Async::IpAddress& ip, uint16_t port,
+                             void *aad, void *buf, int count);
+    void udpAudioReceived(Client *client, uint32_t seq, const void *buf,
+                          int size);
+    void udpSequenceSkipped(Client *client, uint32_t seq);
+    void flushTxAudio(Client *client);
 
 };  /* class NetUplink */
 
@@ -475,6 +475,10 @@ int main(int argc, char **argv)
   cfg.getValue("GLOBAL", "CARD_CHANNELS", card_channels);
   AudioIO::setChannels(card_channels);
 
+  int audio_thread_prio = 0;
+  cfg.getValue("GLOBAL", "AUDIO_THREAD_PRIO", audio_thread_prio);
+  AudioIO::setRealtimePriority(audio_thread_prio);
+
   struct termios org_termios = {0};
   if (logfile_name == 0)
   {
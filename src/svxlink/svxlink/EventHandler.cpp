@@ -33,9 +33,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <iostream>
+#include <iomanip>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 
 
 /****************************************************************************
@@ -66,6 +68,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 using namespace std;
+using namespace std::chrono;
 using namespace Async;
 
 
@@ -162,6 +165,12 @@ EventHandler::EventHandler(const string& event_script, const string& logic_name)
 
 EventHandler::~EventHandler(void)
 {
+  for (auto& cmd_obj : cmd_objs)
+  {
+    Tcl_DecrRefCount(cmd_obj.second);
+  }
+  cmd_objs.clear();
+
   if (interp != 0)
   {
     Tcl_Preserve(interp);
@@ -230,23 +239,106 @@ bool EventHandler::processEvent(const string& event)
   {
     return false;
   }
-  
-  bool success = true;
-  Tcl_Preserve(interp);
-  if (Tcl_Eval(interp, (event + ";").c_str()) != TCL_OK)
+
+    // Handle queued events first to keep the order of events
+  processQueuedEvents();
+
+  return evalEvent(event);
+} /* EventHandler::processEvent */
+
+
+bool EventHandler::processEvent(const std::string& cmd,
+                                const std::vector<std::string>& args)
+{
+  if (interp == 0)
   {
-    const char *trace = Tcl_GetVar(interp, "errorInfo", TCL_GLOBAL_ONLY); 
-    std::cerr << "*** ERROR[" << logic_name << "]: Unable to handle event "
-              << "\"" << event << "\"\n" << trace << std::endl;
-    success = false;
+    return false;
   }
-  Tcl_Release(interp);
-  
-  return success;
-  
+
+  processQueuedEvents();
+
+  std::vector<const char*> argv;
+  argv.reserve(args.size() + 1);
+  argv.push_back(cmd.c_str());
+  for (const auto& arg : args)
+  {
+    argv.push_back(arg.c_str());
+  }
+  return evalObjv(cmd, argv.size(), argv.data(), cmd);
 } /* EventHandler::processEvent */
 
 
+void EventHandler::queueEvent(const std::string& key,
+                              std::function<void()> handler)
+{
+  auto it = std::find_if(event_queue.begin(), event_queue.end(),
+      [&](const QueuedEvent& qe) { return qe.key == key; });
+  if (it != event_queue.end())
+  {
+    it->handler = std::move(handler);
+  }
+  else
+  {
+    event_queue.push_back({key, std::move(handler)});
+  }
+
+  if (!queue_task_pending)
+  {
+    queue_task_pending = true;
+    Application::app().runTask(mem_fun(*this, &EventHandler::queueTask));
+  }
+} /* EventHandler::queueEvent */
+
+
+void EventHandler::processQueuedEvents(void)
+{
+    // The handlers call processEvent, which must not process events queued
+    // after the one being handled first
+  if (processing_queue)
+  {
+    return;
+  }
+  processing_queue = true;
+  while (!event_queue.empty())
+  {
+    std::function<void()> handler(std::move(event_queue.front().handler));
+    event_queue.pop_front();
+    handler();
+  }
+  processing_queue = false;
+} /* EventHandler::processQueuedEvents */
+
+
+void EventHandler::printEventStats(std::ostream& os) const
+{
+  std::vector<std::pair<std::string, EventStats>> stats(
+      event_stats.begin(), event_stats.end());
+  std::sort(stats.begin(), stats.end(),
+      [](const std::pair<std::string, EventStats>& a,
+         const std::pair<std::string, EventStats>& b)
+      {
+        return a.second.total > b.second.total;
+      });
+
+  os << "Event handler statistics for logic " << logic_name << ":\n";
+  os << std::setw(10) << "Calls" << std::setw(12) << "Avg(ms)"
+     << std::setw(12) << "Max(ms)" << std::setw(12) << "Total(ms)"
+     << "  Event\n";
+  os << std::fixed << std::setprecision(3);
+  for (const auto& stat : stats)
+  {
+    const EventStats& s = stat.second;
+    double total_ms = duration<double, std::milli>(s.total).count();
+    os << std::setw(10) << s.count
+       << std::setw(12) << (total_ms / s.count)
+       << std::setw(12) << duration<double, std::milli>(s.max).count()
+       << std::setw(12) << total_ms
+       << "  " << stat.first << "\n";
+  }
+  os << std::defaultfloat;
+} /* EventHandler::printEventStats */
+
+
 const string EventHandler::eventResult(void) const
 {
   if (interp == 0)
@@ -290,6 +382,123 @@ const string EventHandler::eventResult(void) const
  *
  ****************************************************************************/
 
+bool EventHandler::evalEvent(const std::string& event)
+{
+    // Simple function calls are split into words and called directly. If
+    // the event contain characters that would cause substitutions or
+    // multiple commands, it has to be evaluated as a script.
+  if (!event.empty() && (event[0] != '#') &&
+      (event.find_first_of("$[]\\;\n\r") == std::string::npos) &&
+      (event.find("{*}") == std::string::npos))
+  {
+    int argc = 0;
+    const char **argv = 0;
+    if ((Tcl_SplitList(0, event.c_str(), &argc, &argv) == TCL_OK) &&
+        (argc > 0))
+    {
+      bool success = evalObjv(argv[0], argc, argv, event);
+      Tcl_Free(reinterpret_cast<char*>(argv));
+      return success;
+    }
+    if (argv != 0)
+    {
+      Tcl_Free(reinterpret_cast<char*>(argv));
+    }
+  }
+
+  bool success = true;
+  auto start = steady_clock::now();
+  Tcl_Preserve(interp);
+  if (Tcl_EvalEx(interp, event.c_str(), event.size(), 0) != TCL_OK)
+  {
+    const char *trace = Tcl_GetVar(interp, "errorInfo", TCL_GLOBAL_ONLY); 
+    std::cerr << "*** ERROR[" << logic_name << "]: Unable to handle event "
+              << "\"" << event << "\"\n" << trace << std::endl;
+    success = false;
+  }
+  Tcl_Release(interp);
+  updateEventStats(event.substr(0, event.find_first_of(" \t")),
+                   steady_clock::now() - start);
+
+  return success;
+} /* EventHandler::evalEvent */
+
+
+bool EventHandler::evalObjv(const std::string& cmd, int argc,
+                            const char *argv[], const std::string& event)
+{
+  Tcl_Obj *cmd_obj = 0;
+  auto it = cmd_objs.find(cmd);
+  if (it != cmd_objs.end())
+  {
+    cmd_obj = it->second;
+  }
+  else
+  {
+      // The command lookup is cached in the object by TCL
+    cmd_obj = Tcl_NewStringObj(cmd.c_str(), cmd.size());
+    Tcl_IncrRefCount(cmd_obj);
+    cmd_objs[cmd] = cmd_obj;
+  }
+
+  std::vector<Tcl_Obj*> objv(argc);
+  objv[0] = cmd_obj;
+  Tcl_IncrRefCount(cmd_obj);
+  for (int i=1; i<argc; ++i)
+  {
+    objv[i] = Tcl_NewStringObj(argv[i], -1);
+    Tcl_IncrRefCount(objv[i]);
+  }
+
+  bool success = true;
+  auto start = steady_clock::now();
+  Tcl_Preserve(interp);
+  if (Tcl_EvalObjv(interp, argc, objv.data(), 0) != TCL_OK)
+  {
+    const char *trace = Tcl_GetVar(interp, "errorInfo", TCL_GLOBAL_ONLY);
+    std::cerr << "*** ERROR[" << logic_name << "]: Unable to handle event "
+              << "\"" << event << "\"\n" << trace << std::endl;
+    success = false;
+  }
+  Tcl_Release(interp);
+  updateEventStats(cmd, steady_clock::now() - start);
+
+  for (auto obj : objv)
+  {
+    Tcl_DecrRefCount(obj);
+  }
+
+  return success;
+} /* EventHandler::evalObjv */
+
+
+void EventHandler::updateEventStats(const std::string& cmd,
+                                    steady_clock::duration dt)
+{
+  EventStats& stats = event_stats[cmd];
+  ++stats.count;
+  stats.total += dt;
+  stats.max = std::max(stats.max, duration_cast<nanoseconds>(dt));
+
+  if ((warn_time > 0) && (dt > milliseconds(warn_time)))
+  {
+    std::cerr << "*** WARNING[" << logic_name << "]: The event handler for \""
+              << cmd << "\" took "
+              << duration_cast<milliseconds>(dt).count() << "ms" << std::endl;
+  }
+} /* EventHandler::updateEventStats */
+
+
+void EventHandler::queueTask(void)
+{
+  queue_task_pending = false;
+  if (interp != 0)
+  {
+    processQueuedEvents();
+  }
+} /* EventHandler::queueTask */
+
+
 int EventHandler::playFileHandler(ClientData cdata, Tcl_Interp *irp, int argc,
       	      	      	   const char *argv[])
 {
@@ -40,6 +40,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <string>
 #include <sstream>
 #include <functional>
+#include <vector>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <ostream>
 
 
 /****************************************************************************
@@ -110,6 +115,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 @brief	Manage the TCL interpreter and call TCL functions for different events.
 @author Tobias Blomberg
 @date   2005-04-09
+
+Events that are simple TCL function calls, without substitutions, are split
+into words and called using Tcl_EvalObjv. The TCL object for each function
+name is cached so that the command lookup is only done once. Other events are
+evaluated as TCL scripts.
+
+The time spent in each event handler is measured and the statistics can be
+printed using the printEventStats function. A warning is printed for event
+handlers that run for longer than the time set using setWarnTime.
 */
 class EventHandler : public sigc::trackable
 {
@@ -180,6 +194,61 @@ class EventHandler : public sigc::trackable
      * @return	Returns \em true on success or else \em false
      */
     bool processEvent(const std::string& event);
+
+    /**
+     * @brief 	Process the given event
+     * @param 	cmd   The name of the TCL function to call
+     * @param 	args  The arguments to the TCL function
+     * @return	Returns \em true on success or else \em false
+     *
+     * The TCL function is called directly with the arguments as TCL objects
+     * so the event does not have to be built as a string and parsed again.
+     * No quoting of the arguments is needed.
+     */
+    bool processEvent(const std::string& cmd,
+                      const std::vector<std::string>& args);
+
+    /**
+     * @brief   Queue an event for later processing
+     * @param   key     Queued events with the same key replace each other
+     * @param   handler The function to call to process the event
+     *
+     * Queued events are processed from the main loop or before the next
+     * event is processed using the processEvent function so the order of
+     * events is kept. The handler normally call one of the processEvent
+     * functions. If an event with the same key is already queued, it is
+     * replaced by the new event. That way a state event that change fast is
+     * only handled for the latest state. The result from queued events is
+     * not available so only use this function for events where the return
+     * value is not needed.
+     */
+    void queueEvent(const std::string& key, std::function<void()> handler);
+
+    /**
+     * @brief   Process all queued events right away
+     */
+    void processQueuedEvents(void);
+
+    /**
+     * @brief   Set the event handler run time that cause a warning
+     * @param   warn_time The time in milliseconds (0 to disable)
+     */
+    void setWarnTime(unsigned warn_time) { this->warn_time = warn_time; }
+
+    /**
+     * @brief   Print event handler timing statistics
+     * @param   os The stream to print the statistics to
+     *
+     * For each event handler the number of calls and the average, maximum
+     * and total run time is printed. The event handlers are sorted on the
+     * total run time with the most time consuming first.
+     */
+    void printEventStats(std::ostream& os) const;
+
+    /**
+     * @brief   Reset the event handler timing statistics
+     */
+    void resetEventStats(void) { event_stats.clear(); }
   
     /**
      * @brief 	Return the event result from the last call
@@ -278,9 +347,34 @@ class EventHandler : public sigc::trackable
   protected:
 
   private:
-    std::string   event_script;
-    std::string   logic_name;
-    Tcl_Interp *  interp;
+    struct EventStats
+    {
+      unsigned                  count = 0;
+      std::chrono::nanoseconds  total {0};
+      std::chrono::nanoseconds  max {0};
+    };
+    struct QueuedEvent
+    {
+      std::string           key;
+      std::function<void()> handler;
+    };
+
+    std::string                       event_script;
+    std::string                       logic_name;
+    Tcl_Interp *                      interp;
+    std::map<std::string, Tcl_Obj*>   cmd_objs;
+    std::deque<QueuedEvent>           event_queue;
+    bool                              queue_task_pending = false;
+    bool                              processing_queue = false;
+    std::map<std::string, EventStats> event_stats;
+    unsigned                          warn_time = 0;
+
+    bool evalEvent(const std::string& event);
+    bool evalObjv(const std::string& cmd, int argc, const char *argv[],
+                  const std::string& event);
+    void updateEventStats(const std::string& cmd,
+                          std::chrono::steady_clock::duration dt);
+    void queueTask(void);
 
     static int playFileHandler(ClientData cdata, Tcl_Interp *irp,
       	      	    int argc, const char *argv[]);
@@ -71,6 +71,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioFifo.h>
 #include <AsyncAudioStreamStateDetector.h>
 #include <AsyncAudioPacer.h>
+#include <AsyncAudioLatencyProbe.h>
 #include <AsyncAudioDebugger.h>
 #include <AsyncAudioRecorder.h>
 #include <common.h>
@@ -447,6 +448,8 @@ bool Logic::initialize(Async::Config& cfgobj, const std::string& logic_name)
   rx_valve->setOpen(false);
   prev_rx_src->registerSink(rx_valve, true);
   prev_rx_src = rx_valve;
+  AudioLatencyProbe *rx_probe =
+      AudioLatencyProbe::insert(prev_rx_src, name() + ":rx");
 
     // Split the RX audio stream to multiple sinks
   rx_splitter = new AudioSplitter;
@@ -574,16 +577,23 @@ bool Logic::initialize(Async::Config& cfgobj, const std::string& logic_name)
   prev_tx_src = state_det;
 
     // Add a pre-buffered FIFO to avoid underrun
+  AudioLatencyProbe *tx_fifo_probe =
+      AudioLatencyProbe::insert(prev_tx_src, name() + ":tx_audio");
   AudioFifo *tx_fifo = new AudioFifo(1024 * INTERNAL_SAMPLE_RATE / 8000);
   tx_fifo->setPrebufSamples(512 * INTERNAL_SAMPLE_RATE / 8000);
   prev_tx_src->registerSink(tx_fifo, true);
   prev_tx_src = tx_fifo;
+  AudioLatencyProbe::insert(prev_tx_src, name() + ":tx_fifo", tx_fifo_probe);
 
     // Create the TX audio mixer
   tx_audio_mixer = new AudioMixer;
   tx_audio_mixer->addSource(prev_tx_src);
   prev_tx_src = tx_audio_mixer;
 
+    // Measure the time from RX audio start until audio reach the TX
+  AudioLatencyProbe::insert(prev_tx_src, name() + ":rx_to_tx", rx_probe,
+                            AudioLatencyProbe::MEASURE_ONSET);
+
     // Create the TX object
   std::cout << name() << ": Loading TX \"" << tx_name << "\"" << endl;
   m_tx = TxFactory::createNamedTx(cfg(), tx_name);
@@ -604,6 +614,18 @@ bool Logic::initialize(Async::Config& cfgobj, const std::string& logic_name)
     // Create the message handler
   msg_handler = new MsgHandler(INTERNAL_SAMPLE_RATE);
   msg_handler->allMsgsWritten.connect(mem_fun(*this, &Logic::allMsgsWritten));
+  if (MsgHandler::clipCacheSize() > 0)
+  {
+      // Preload the announcement clips for the configured language
+    std::string sounds_dir(event_handler_str);
+    std::string::size_type slash = sounds_dir.rfind('/');
+    sounds_dir = (slash != std::string::npos)
+      ? sounds_dir.substr(0, slash) + "/sounds" : std::string("sounds");
+    std::string lang("en_US");
+    cfg().getValue(name(), "DEFAULT_LANG", lang);
+    MsgHandler::warmClipCache(sounds_dir + "/local");
+    MsgHandler::warmClipCache(sounds_dir + "/" + lang);
+  }
   prev_tx_src = msg_handler;
 
     // This gain control is used to reduce the audio volume of effects
@@ -614,13 +636,20 @@ bool Logic::initialize(Async::Config& cfgobj, const std::string& logic_name)
   prev_tx_src = fx_gain_ctrl;
 
     // Pace the audio so that we don't fill up the audio output pipe.
+  AudioLatencyProbe *msg_probe =
+      AudioLatencyProbe::insert(prev_tx_src, name() + ":msg");
   AudioPacer *msg_pacer = new AudioPacer(INTERNAL_SAMPLE_RATE,
       	      	      	      	      	 256 * INTERNAL_SAMPLE_RATE / 8000, 0);
   prev_tx_src->registerSink(msg_pacer, true);
-  tx_audio_mixer->addSource(msg_pacer);
+  prev_tx_src = msg_pacer;
+  AudioLatencyProbe::insert(prev_tx_src, name() + ":msg_pacer", msg_probe);
+  tx_audio_mixer->addSource(prev_tx_src);
   prev_tx_src = 0;
 
   event_handler = new EventHandler(event_handler_str, name());
+  unsigned event_warn_time = 0;
+  cfg().getValue(name(), "EVENT_HANDLER_WARN_TIME", event_warn_time);
+  event_handler->setWarnTime(event_warn_time);
   event_handler->playFile.connect(mem_fun(*this, &Logic::playFile));
   event_handler->playSilence.connect(mem_fun(*this, &Logic::playSilence));
   event_handler->playTone.connect(mem_fun(*this, &Logic::playTone));
@@ -773,6 +802,21 @@ void Logic::processEvent(const string& event, const Module *module)
 } /* Logic::processEvent */
 
 
+void Logic::processEvent(const string& event, const vector<string>& args,
+                         const Module *module)
+{
+  string cmd(name() + "::");
+  if (module != 0)
+  {
+    cmd += module->name() + "::";
+  }
+  cmd += event;
+  msg_handler->begin();
+  event_handler->processEvent(cmd, args);
+  msg_handler->end();
+} /* Logic::processEvent */
+
+
 void Logic::setEventVariable(const string& varname, const string& value)
 {
   std::string fullname(varname);
@@ -1081,9 +1125,8 @@ void Logic::squelchOpen(bool is_open)
   }
 
   signalLevelUpdated(rx().signalStrength());
-  stringstream ss;
-  ss << "squelch_open " << rx().sqlRxId() << " " << (is_open ? "1" : "0");
-  processEvent(ss.str());
+  processEvent("squelch_open",
+               {string(1, rx().sqlRxId()), (is_open ? "1" : "0")});
 
   if (is_open)
   {
@@ -1135,9 +1178,7 @@ void Logic::transmitterStateChange(bool is_transmitting)
     LocationInfo::instance()->setTransmitting(name(), is_transmitting);
   }
 
-  stringstream ss;
-  ss << "transmit " << (is_transmitting ? "1" : "0");
-  processEvent(ss.str());
+  processEvent("transmit", {(is_transmitting ? "1" : "0")});
 } /* Logic::transmitterStateChange */
 
 
@@ -1204,11 +1245,43 @@ void Logic::commandPtyCmdReceived(const void *buf, size_t count)
       processEvent(event);
     }
   }
+  else if (cmd == "AUDIO_STATS")
+  {
+    std::string arg;
+    ss >> arg;
+    if (arg == "RESET")
+    {
+      AudioLatencyProbe::resetAllStats();
+      MsgHandler::resetClipCacheStats();
+      std::cout << name() << ": Audio latency statistics reset" << std::endl;
+      return;
+    }
+    std::ostringstream os;
+    AudioLatencyProbe::printAllStats(os);
+    MsgHandler::printClipCacheStats(os);
+    std::cout << os.str() << std::flush;
+    command_pty->write(os.str());
+  }
+  else if (cmd == "EVENT_STATS")
+  {
+    std::string arg;
+    ss >> arg;
+    if (arg == "RESET")
+    {
+      event_handler->resetEventStats();
+      std::cout << name() << ": Event handler statistics reset" << std::endl;
+      return;
+    }
+    std::ostringstream os;
+    event_handler->printEventStats(os);
+    std::cout << os.str() << std::flush;
+    command_pty->write(os.str());
+  }
   else
   {
     std::cerr << "*** ERROR: Unknown PTY command in logic "
               << name() << ": \"" << cmdline << "\". "
-              << "Valid commands are: CFG, EVENT"
+              << "Valid commands are: CFG, EVENT, AUDIO_STATS, EVENT_STATS"
               << std::endl;
   }
 } /* Logic::commandPtyCmdReceived */
@@ -1493,9 +1566,7 @@ void Logic::processCommandQueue(void)
     string cmd(cmd_queue.front());
     cmd_queue.pop_front();
 
-    stringstream ss;
-    ss << "dtmf_cmd_received \"" << cmd << "\"";
-    processEvent(ss.str());
+    processEvent("dtmf_cmd_received", {cmd});
     if (atoi(event_handler->eventResult().c_str()) != 0)
     {
       continue;
@@ -1719,9 +1790,8 @@ void Logic::dtmfDigitDetectedP(char digit, int duration)
     return;
   }
 
-  stringstream ss;
-  ss << "dtmf_digit_received " << digit << " " << duration;
-  processEvent(ss.str());
+  processEvent("dtmf_digit_received",
+               {string(1, digit), to_string(duration)});
   if (atoi(event_handler->eventResult().c_str()) != 0)
   {
     return;
@@ -1875,9 +1945,15 @@ bool Logic::getConfigValue(const std::string& section, const std::string& tag,
 
 void Logic::signalLevelUpdated(float siglev)
 {
-  std::ostringstream ss;
-  ss << "siglev_updated " << rx().sqlRxId() << " " << siglev;
-  processEvent(ss.str());
+    // The signal level may be updated often so the event is queued. Only
+    // the latest signal level for each receiver is handled if the main loop
+    // is busy.
+  std::ostringstream siglev_str;
+  siglev_str << siglev;
+  std::vector<std::string> args {std::string(1, rx().sqlRxId()),
+                                 siglev_str.str()};
+  event_handler->queueEvent(name() + "::siglev_updated " + args[0],
+      [this, args]{ processEvent("siglev_updated", args); });
 } /* Logic::signalLevelUpdated */
 
 
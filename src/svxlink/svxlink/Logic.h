@@ -168,6 +168,9 @@ class Logic : public LogicBase
                             const std::string& plugin_name) override;
 
     virtual void processEvent(const std::string& event, const Module *module=0);
+    void processEvent(const std::string& event,
+                      const std::vector<std::string>& args,
+                      const Module *module=0);
     void setEventVariable(const std::string& name, const std::string& value);
     virtual void playFile(const std::string& path);
     virtual void playSilence(int length);
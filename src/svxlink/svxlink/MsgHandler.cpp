@@ -36,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -52,6 +53,16 @@ extern "C" {
 #include <cstring>
 #include <fstream>
 #include <cerrno>
+#include <memory>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
 
 
 
@@ -242,6 +253,159 @@ class WavFileQueueItem : public QueueItem
     int read16bitValue(uint8_t *ptr, uint16_t *val);
 };
 
+typedef shared_ptr<const vector<float> > Clip;
+
+class ClipQueueItem : public QueueItem
+{
+  public:
+    ClipQueueItem(Clip clip, bool idle_marked)
+      : QueueItem(idle_marked), clip(clip), pos(0) {}
+    ClipQueueItem(const string& path, shared_future<Clip> pending_clip,
+                  bool idle_marked)
+      : QueueItem(idle_marked), path(path), pending_clip(pending_clip),
+        pos(0) {}
+    bool initialize(void);
+    int readSamples(float *samples, int len);
+    void unreadSamples(int len);
+
+  private:
+    string              path;
+    shared_future<Clip> pending_clip;
+    Clip                clip;
+    size_t              pos;
+
+};
+
+struct FileStream
+{
+  string                  path;
+  QueueItem*              reader = nullptr;
+  deque<vector<float> >   chunks;
+  size_t                  buffered = 0;
+  bool                    opened = false;
+  bool                    failed = false;
+  bool                    eof = false;
+  bool                    closed = false;
+};
+
+class StreamQueueItem : public QueueItem
+{
+  public:
+    StreamQueueItem(shared_ptr<FileStream> stream, bool idle_marked)
+      : QueueItem(idle_marked), stream(stream), pos(0) {}
+    ~StreamQueueItem(void);
+    bool initialize(void);
+    int readSamples(float *samples, int len);
+    void unreadSamples(int len);
+
+  private:
+    shared_ptr<FileStream>  stream;
+    vector<float>           chunk;
+    size_t                  pos;
+
+};
+
+class FileLoader
+{
+  public:
+    static FileLoader& instance(void)
+    {
+      static FileLoader loader;
+      return loader;
+    }
+
+    FileLoader(void)
+      : quit(false), loaded(0), streamed(0), waits(0), drops(0) {}
+    ~FileLoader(void);
+    shared_future<Clip> load(const string& path);
+    shared_ptr<FileStream> stream(const string& path);
+    bool readChunk(FileStream& stream, vector<float>& chunk);
+    void closeStream(FileStream& stream);
+    void countWait(void) { ++waits; }
+    void printStats(ostream& os) const;
+    void resetStats(void);
+
+  private:
+    static const size_t MAX_QUEUED = 64;
+    static const size_t MAX_STREAMS = 64;
+    static const size_t STREAM_CHUNK_SIZE = 2048;
+    static const size_t STREAM_BUFFER_SIZE = 4 * STREAM_CHUNK_SIZE;
+
+    struct Job
+    {
+      string        path;
+      promise<Clip> result;
+    };
+
+    mutex                         jobs_mutex;
+    condition_variable            jobs_cond;
+    condition_variable            data_cond;
+    deque<Job>                    jobs;
+    list<shared_ptr<FileStream> > streams;
+    bool                          quit;
+    thread                        worker;
+    uint64_t                      loaded;
+    uint64_t                      streamed;
+    uint64_t                      waits;
+    uint64_t                      drops;
+
+    void startWorker(void);
+    void workerFunc(void);
+    shared_ptr<FileStream> nextStream(void);
+    void fillStream(FileStream& stream, bool closed);
+};
+
+class ClipCache
+{
+  public:
+    static ClipCache& instance(void)
+    {
+      static ClipCache cache;
+      return cache;
+    }
+
+    ClipCache(void)
+      : max_size(0), size(0), hits(0), misses(0), evictions(0),
+        uncacheable(0), stale(0) {}
+    void setMaxSize(size_t max_bytes);
+    size_t maxSize(void) const { return max_size; }
+    Clip find(const string& path);
+    void add(const string& path, Clip clip);
+    void warm(const string& dir);
+    void printStats(ostream& os) const;
+    void resetStats(void);
+
+  private:
+    struct Entry
+    {
+      Clip                    clip;
+      struct timespec         mtime;
+      off_t                   fsize;
+      chrono::steady_clock::time_point checked;
+      list<string>::iterator  lru_it;
+    };
+    typedef unordered_map<string, Entry> EntryMap;
+
+    size_t        max_size;
+    size_t        size;
+    EntryMap      entries;
+    list<string>  lru;
+    uint64_t      hits;
+    uint64_t      misses;
+    uint64_t      evictions;
+    uint64_t      uncacheable;
+    uint64_t      stale;
+
+    static size_t clipSize(const Clip& clip)
+    {
+      return clip->size() * sizeof(float);
+    }
+    bool insert(const string& path, Clip clip, const struct stat& st);
+    void remove(EntryMap::iterator it);
+    void evict(size_t needed);
+    bool warmDir(const string& dir);
+};
+
 
 
 /****************************************************************************
@@ -250,6 +414,8 @@ class WavFileQueueItem : public QueueItem
  *
  ****************************************************************************/
 
+static QueueItem *createFileQueueItem(const string& path, bool idle_marked);
+static Clip decodeFile(const string& path);
 
 
 /****************************************************************************
@@ -267,6 +433,8 @@ class WavFileQueueItem : public QueueItem
  *
  ****************************************************************************/
 
+  // Minimum time between checks if a cached clip file has been changed
+static const chrono::seconds clip_revalidate_interval(2);
 
 
 /****************************************************************************
@@ -289,21 +457,74 @@ MsgHandler::~MsgHandler(void)
 } /* MsgHandler::~MsgHandler */
 
 
+void MsgHandler::setClipCacheSize(size_t max_bytes)
+{
+  ClipCache::instance().setMaxSize(max_bytes);
+} /* MsgHandler::setClipCacheSize */
+
+
+size_t MsgHandler::clipCacheSize(void)
+{
+  return ClipCache::instance().maxSize();
+} /* MsgHandler::clipCacheSize */
+
+
+void MsgHandler::warmClipCache(const std::string& dir)
+{
+  ClipCache::instance().warm(dir);
+} /* MsgHandler::warmClipCache */
+
+
+void MsgHandler::printClipCacheStats(std::ostream& os)
+{
+  ClipCache::instance().printStats(os);
+  FileLoader::instance().printStats(os);
+} /* MsgHandler::printClipCacheStats */
+
+
+void MsgHandler::resetClipCacheStats(void)
+{
+  ClipCache::instance().resetStats();
+  FileLoader::instance().resetStats();
+} /* MsgHandler::resetClipCacheStats */
+
+
 void MsgHandler::playFile(const string& path, bool idle_marked)
 {
   QueueItem *item = 0;
-  const char *ext = strrchr(path.c_str(), '.');
-  if (strcmp(ext, ".gsm") == 0)
+  Clip clip = ClipCache::instance().find(path);
+  if (clip)
   {
-    item = new GsmFileQueueItem(path, idle_marked);
+    item = new ClipQueueItem(clip, idle_marked);
   }
-  else if (strcmp(ext, ".wav") == 0)
+  else if (ClipCache::instance().maxSize() > 0)
   {
-    item = new WavFileQueueItem(path, idle_marked);
+      // Read and decode the file in the background while the items before
+      // it in the queue are played. Fall back to reading the file when it
+      // is played if the loader queue is full.
+    shared_future<Clip> pending_clip = FileLoader::instance().load(path);
+    if (pending_clip.valid())
+    {
+      item = new ClipQueueItem(path, pending_clip, idle_marked);
+    }
+    else
+    {
+      item = createFileQueueItem(path, idle_marked);
+    }
   }
   else
   {
-    item = new RawFileQueueItem(path, idle_marked);
+      // Without a cache, stream the file from the loader thread so that
+      // the main loop does not have to do any file access
+    shared_ptr<FileStream> stream = FileLoader::instance().stream(path);
+    if (stream)
+    {
+      item = new StreamQueueItem(stream, idle_marked);
+    }
+    else
+    {
+      item = createFileQueueItem(path, idle_marked);
+    }
   }
   addItemToQueue(item);
 } /* MsgHandler::playFile */
@@ -551,6 +772,567 @@ void MsgHandler::clearP(void)
 
 
 
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+static QueueItem *createFileQueueItem(const string& path, bool idle_marked)
+{
+  const char *ext = strrchr(path.c_str(), '.');
+  if ((ext != 0) && (strcmp(ext, ".gsm") == 0))
+  {
+    return new GsmFileQueueItem(path, idle_marked);
+  }
+  else if ((ext != 0) && (strcmp(ext, ".wav") == 0))
+  {
+    return new WavFileQueueItem(path, idle_marked);
+  }
+  return new RawFileQueueItem(path, idle_marked);
+} /* createFileQueueItem */
+
+
+static Clip decodeFile(const string& path)
+{
+  QueueItem *item = createFileQueueItem(path, false);
+  if (!item->initialize())
+  {
+    delete item;
+    return Clip();
+  }
+
+  shared_ptr<vector<float> > samples(new vector<float>);
+  float buf[WRITE_BLOCK_SIZE];
+  int read_cnt;
+  while ((read_cnt = item->readSamples(buf, WRITE_BLOCK_SIZE)) > 0)
+  {
+    samples->insert(samples->end(), buf, buf + read_cnt);
+  }
+  delete item;
+  samples->shrink_to_fit();
+
+  return samples;
+} /* decodeFile */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions for class ClipCache
+ *
+ ****************************************************************************/
+
+void ClipCache::setMaxSize(size_t max_bytes)
+{
+  max_size = max_bytes;
+  evict(0);
+} /* ClipCache::setMaxSize */
+
+
+Clip ClipCache::find(const string& path)
+{
+  if (max_size == 0)
+  {
+    return Clip();
+  }
+
+  EntryMap::iterator it = entries.find(path);
+  if (it == entries.end())
+  {
+    ++misses;
+    return Clip();
+  }
+
+    // The file may have been rewritten since it was cached, e.g. a newly
+    // recorded identification or regenerated speech output. To not have to
+    // access the file system on every playback, the check is only done if
+    // some time has passed since the last check.
+  Entry& entry = it->second;
+  const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  if (now - entry.checked >= clip_revalidate_interval)
+  {
+    struct stat st;
+    if ((stat(path.c_str(), &st) == -1) ||
+        (st.st_mtim.tv_sec != entry.mtime.tv_sec) ||
+        (st.st_mtim.tv_nsec != entry.mtime.tv_nsec) ||
+        (st.st_size != entry.fsize))
+    {
+      remove(it);
+      ++stale;
+      ++misses;
+      return Clip();
+    }
+    entry.checked = now;
+  }
+
+  ++hits;
+  lru.splice(lru.begin(), lru, it->second.lru_it);
+  return it->second.clip;
+} /* ClipCache::find */
+
+
+void ClipCache::add(const string& path, Clip clip)
+{
+  if ((max_size == 0) || (entries.find(path) != entries.end()))
+  {
+    return;
+  }
+  if (clipSize(clip) > max_size)
+  {
+      // Do not let a huge clip push everything else out of the cache
+    ++uncacheable;
+    return;
+  }
+  struct stat st;
+  if (stat(path.c_str(), &st) == -1)
+  {
+    return;
+  }
+  evict(clipSize(clip));
+  insert(path, clip, st);
+} /* ClipCache::add */
+
+
+void ClipCache::warm(const string& dir)
+{
+  if (max_size == 0)
+  {
+    return;
+  }
+  if (!warmDir(dir))
+  {
+    cout << "Message clip cache full (" << (size / 1024)
+         << "kB) while warming from " << dir << endl;
+  }
+} /* ClipCache::warm */
+
+
+void ClipCache::printStats(ostream& os) const
+{
+  os << "Message clip cache: clips=" << entries.size()
+     << " size=" << (size / 1024) << "/" << (max_size / 1024) << "kB"
+     << " hits=" << hits << " misses=" << misses
+     << " evictions=" << evictions << " uncacheable=" << uncacheable
+     << " stale=" << stale << "\n";
+} /* ClipCache::printStats */
+
+
+void ClipCache::resetStats(void)
+{
+  hits = 0;
+  misses = 0;
+  evictions = 0;
+  uncacheable = 0;
+  stale = 0;
+} /* ClipCache::resetStats */
+
+
+bool ClipCache::insert(const string& path, Clip clip, const struct stat& st)
+{
+  if (size + clipSize(clip) > max_size)
+  {
+    return false;
+  }
+  lru.push_front(path);
+  Entry& entry = entries[path];
+  entry.clip = clip;
+  entry.mtime = st.st_mtim;
+  entry.fsize = st.st_size;
+  entry.checked = chrono::steady_clock::now();
+  entry.lru_it = lru.begin();
+  size += clipSize(clip);
+  return true;
+} /* ClipCache::insert */
+
+
+void ClipCache::remove(EntryMap::iterator it)
+{
+  size -= clipSize(it->second.clip);
+  lru.erase(it->second.lru_it);
+  entries.erase(it);
+} /* ClipCache::remove */
+
+
+void ClipCache::evict(size_t needed)
+{
+    // Clips that are currently being played are kept alive by the queue
+    // item that is playing them so it is safe to drop them from the cache
+  while (!lru.empty() && (size + needed > max_size))
+  {
+    EntryMap::iterator it = entries.find(lru.back());
+    assert(it != entries.end());
+    remove(it);
+    ++evictions;
+  }
+} /* ClipCache::evict */
+
+
+bool ClipCache::warmDir(const string& dir)
+{
+  DIR *dirp = opendir(dir.c_str());
+  if (dirp == NULL)
+  {
+    return true;
+  }
+
+  bool cache_full = false;
+  struct dirent *dirent;
+  while (!cache_full && ((dirent = readdir(dirp)) != NULL))
+  {
+    if (dirent->d_name[0] == '.')
+    {
+      continue;
+    }
+    string path = dir + "/" + dirent->d_name;
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1)
+    {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode))
+    {
+      cache_full = !warmDir(path);
+      continue;
+    }
+    const char *dot = strrchr(dirent->d_name, '.');
+    if (!S_ISREG(st.st_mode) || (dot == NULL) ||
+        ((strcmp(dot, ".wav") != 0) && (strcmp(dot, ".raw") != 0) &&
+         (strcmp(dot, ".gsm") != 0)))
+    {
+      continue;
+    }
+    if (entries.find(path) != entries.end())
+    {
+      continue;
+    }
+    Clip clip = decodeFile(path);
+    if (clip)
+    {
+      cache_full = !insert(path, clip, st);
+    }
+  }
+  closedir(dirp);
+
+  return !cache_full;
+} /* ClipCache::warmDir */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions for class FileLoader
+ *
+ ****************************************************************************/
+
+FileLoader::~FileLoader(void)
+{
+  if (worker.joinable())
+  {
+    {
+      lock_guard<mutex> lock(jobs_mutex);
+      quit = true;
+    }
+    jobs_cond.notify_one();
+    worker.join();
+  }
+  for (shared_ptr<FileStream>& stream : streams)
+  {
+    delete stream->reader;
+    stream->reader = nullptr;
+  }
+} /* FileLoader::~FileLoader */
+
+
+shared_future<Clip> FileLoader::load(const string& path)
+{
+  shared_future<Clip> result;
+  {
+    lock_guard<mutex> lock(jobs_mutex);
+    if (jobs.size() >= MAX_QUEUED)
+    {
+      ++drops;
+      return result;
+    }
+    startWorker();
+    jobs.push_back(Job());
+    jobs.back().path = path;
+    result = jobs.back().result.get_future().share();
+    ++loaded;
+  }
+  jobs_cond.notify_one();
+  return result;
+} /* FileLoader::load */
+
+
+shared_ptr<FileStream> FileLoader::stream(const string& path)
+{
+  shared_ptr<FileStream> stream;
+  {
+    lock_guard<mutex> lock(jobs_mutex);
+    if (streams.size() >= MAX_STREAMS)
+    {
+      ++drops;
+      return stream;
+    }
+    startWorker();
+    stream = make_shared<FileStream>();
+    stream->path = path;
+    streams.push_back(stream);
+    ++streamed;
+  }
+  jobs_cond.notify_one();
+  return stream;
+} /* FileLoader::stream */
+
+
+bool FileLoader::readChunk(FileStream& stream, vector<float>& chunk)
+{
+  unique_lock<mutex> lock(jobs_mutex);
+  if (stream.chunks.empty() && !stream.eof)
+  {
+      // The file could not be read ahead in time so we have to wait
+    ++waits;
+    jobs_cond.notify_one();
+    data_cond.wait(lock, [&]{ return !stream.chunks.empty() || stream.eof; });
+  }
+  if (stream.chunks.empty())
+  {
+    return false;
+  }
+  chunk.swap(stream.chunks.front());
+  stream.chunks.pop_front();
+  stream.buffered -= chunk.size();
+  if (!stream.eof && (stream.buffered < STREAM_BUFFER_SIZE / 2))
+  {
+    jobs_cond.notify_one();
+  }
+  return true;
+} /* FileLoader::readChunk */
+
+
+void FileLoader::closeStream(FileStream& stream)
+{
+  {
+    lock_guard<mutex> lock(jobs_mutex);
+    stream.closed = true;
+  }
+  jobs_cond.notify_one();
+} /* FileLoader::closeStream */
+
+
+void FileLoader::printStats(ostream& os) const
+{
+  os << "Message file loader: loaded=" << loaded << " streamed=" << streamed
+     << " waits=" << waits << " drops=" << drops << "\n";
+} /* FileLoader::printStats */
+
+
+void FileLoader::resetStats(void)
+{
+  loaded = 0;
+  streamed = 0;
+  waits = 0;
+  drops = 0;
+} /* FileLoader::resetStats */
+
+
+void FileLoader::startWorker(void)
+{
+  if (!worker.joinable())
+  {
+    worker = thread(&FileLoader::workerFunc, this);
+  }
+} /* FileLoader::startWorker */
+
+
+void FileLoader::workerFunc(void)
+{
+  unique_lock<mutex> lock(jobs_mutex);
+  for (;;)
+  {
+    shared_ptr<FileStream> stream;
+    jobs_cond.wait(lock, [&]{
+        return quit || ((stream = nextStream()) != nullptr) || !jobs.empty();
+      });
+    if (quit)
+    {
+      break;
+    }
+      // Streams are served first since they are being played
+    if (stream)
+    {
+      bool closed = stream->closed;
+      lock.unlock();
+      fillStream(*stream, closed);
+      lock.lock();
+      continue;
+    }
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+    lock.unlock();
+    job.result.set_value(decodeFile(job.path));
+    lock.lock();
+  }
+} /* FileLoader::workerFunc */
+
+
+shared_ptr<FileStream> FileLoader::nextStream(void)
+{
+  for (list<shared_ptr<FileStream> >::iterator it = streams.begin();
+       it != streams.end(); ++it)
+  {
+    shared_ptr<FileStream> stream = *it;
+    if (stream->closed || stream->eof)
+    {
+        // Closed streams are returned once more to release the reader
+      streams.erase(it);
+      return stream;
+    }
+    if (stream->buffered < STREAM_BUFFER_SIZE)
+    {
+        // Move the stream last so that all streams get served
+      streams.splice(streams.end(), streams, it);
+      return stream;
+    }
+  }
+  return nullptr;
+} /* FileLoader::nextStream */
+
+
+void FileLoader::fillStream(FileStream& stream, bool closed)
+{
+    // The reader is only used by the worker thread
+  if (closed || stream.eof)
+  {
+    delete stream.reader;
+    stream.reader = nullptr;
+    return;
+  }
+
+  bool failed = false;
+  if (stream.reader == nullptr)
+  {
+    stream.reader = createFileQueueItem(stream.path, false);
+    failed = !stream.reader->initialize();
+  }
+
+  vector<float> chunk;
+  if (!failed)
+  {
+    chunk.resize(STREAM_CHUNK_SIZE);
+    size_t cnt = 0;
+    int read_cnt;
+    while ((cnt < chunk.size()) &&
+           ((read_cnt = stream.reader->readSamples(chunk.data() + cnt,
+                                                   chunk.size() - cnt)) > 0))
+    {
+      cnt += read_cnt;
+    }
+    chunk.resize(cnt);
+  }
+
+  {
+    lock_guard<mutex> lock(jobs_mutex);
+    stream.opened = true;
+    stream.failed = failed;
+    stream.eof = failed || (chunk.size() < STREAM_CHUNK_SIZE);
+    if (!chunk.empty())
+    {
+      stream.buffered += chunk.size();
+      stream.chunks.push_back(std::move(chunk));
+    }
+  }
+  data_cond.notify_all();
+} /* FileLoader::fillStream */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions for class StreamQueueItem
+ *
+ ****************************************************************************/
+
+StreamQueueItem::~StreamQueueItem(void)
+{
+  FileLoader::instance().closeStream(*stream);
+} /* StreamQueueItem::~StreamQueueItem */
+
+
+bool StreamQueueItem::initialize(void)
+{
+    // Get the first chunk to find out if the file could be opened
+  return FileLoader::instance().readChunk(*stream, chunk);
+} /* StreamQueueItem::initialize */
+
+
+int StreamQueueItem::readSamples(float *samples, int len)
+{
+  if (pos == chunk.size())
+  {
+    if (!FileLoader::instance().readChunk(*stream, chunk))
+    {
+      return 0;
+    }
+    pos = 0;
+  }
+  int read_cnt = min(static_cast<size_t>(len), chunk.size() - pos);
+  memcpy(samples, chunk.data() + pos, read_cnt * sizeof(*samples));
+  pos += read_cnt;
+  return read_cnt;
+} /* StreamQueueItem::readSamples */
+
+
+void StreamQueueItem::unreadSamples(int len)
+{
+  pos -= min(static_cast<size_t>(len), pos);
+} /* StreamQueueItem::unreadSamples */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions for class ClipQueueItem
+ *
+ ****************************************************************************/
+
+bool ClipQueueItem::initialize(void)
+{
+  if (!clip && pending_clip.valid())
+  {
+    if (pending_clip.wait_for(chrono::seconds(0)) != future_status::ready)
+    {
+        // The file could not be read ahead in time so we have to wait
+      FileLoader::instance().countWait();
+    }
+    clip = pending_clip.get();
+    if (clip)
+    {
+      ClipCache::instance().add(path, clip);
+    }
+  }
+  return bool(clip);
+} /* ClipQueueItem::initialize */
+
+
+
+int ClipQueueItem::readSamples(float *samples, int len)
+{
+  int read_cnt = min(static_cast<size_t>(len), clip->size() - pos);
+  memcpy(samples, clip->data() + pos, read_cnt * sizeof(*samples));
+  pos += read_cnt;
+  return read_cnt;
+} /* ClipQueueItem::readSamples */
+
+
+void ClipQueueItem::unreadSamples(int len)
+{
+  pos -= min(static_cast<size_t>(len), pos);
+} /* ClipQueueItem::unreadSamples */
+
+
+
 /****************************************************************************
  *
  * Private member functions for class FileQueueItem
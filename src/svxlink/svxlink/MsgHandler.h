@@ -41,6 +41,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <string>
 #include <list>
 #include <map>
+#include <ostream>
 
 #include <sigc++/sigc++.h>
 
@@ -119,6 +120,21 @@ class QueueItem;
 @date   2005-10-22
 
 This class handles the playback of audio clips.
+
+Audio files can optionally be played from a clip cache that is shared between
+all message handlers. The files are then decoded to samples at the internal
+sample rate the first time they are played, or when the cache is warmed at
+startup, so that no file access is needed on the next playback. The least
+recently used clips are evicted when the cache size limit is reached. A clip
+is dropped from the cache if the modification time or size of its file has
+changed since it was cached. To avoid file system access on every playback,
+each file is checked at most once every two seconds.
+
+When the cache is enabled, audio files that are not found in the cache are
+read and decoded by a background thread as soon as they are queued, so that
+the main loop does not have to block on file access while the preceding queue
+items are played. With the cache disabled, the background thread instead
+streams the files in small chunks, reading a bit ahead of the playback.
 */
 class MsgHandler : public sigc::trackable, public Async::AudioSource
 {
@@ -133,6 +149,38 @@ class MsgHandler : public sigc::trackable, public Async::AudioSource
      * @brief 	Destructor
      */
     ~MsgHandler(void);
+
+    /**
+     * @brief   Set the maximum size of the shared audio clip cache
+     * @param   max_bytes The maximum size in bytes. Zero disable the cache.
+     */
+    static void setClipCacheSize(size_t max_bytes);
+
+    /**
+     * @brief   Get the maximum size of the shared audio clip cache
+     * @return  Returns the maximum size in bytes
+     */
+    static size_t clipCacheSize(void);
+
+    /**
+     * @brief   Preload all audio files in a directory into the clip cache
+     * @param   dir The directory to scan recursively for audio files
+     *
+     * Loading stops when the cache is full. Nothing is done if the clip
+     * cache is disabled.
+     */
+    static void warmClipCache(const std::string& dir);
+
+    /**
+     * @brief   Print clip cache and background file loader statistics
+     * @param   os The stream to print to
+     */
+    static void printClipCacheStats(std::ostream& os);
+
+    /**
+     * @brief   Reset the clip cache statistics counters
+     */
+    static void resetClipCacheStats(void);
     
     /**
      * @brief 	Play a file
@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <cassert>
 #include <ctime>
 #include <cstdio>
 #include <iostream>
@@ -50,6 +51,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncApplication.h>
 #include <AsyncAudioSelector.h>
 #include <AsyncAudioRecorder.h>
 #include <AsyncConfig.h>
@@ -151,6 +153,17 @@ QsoRecorder::QsoRecorder(Logic *logic)
 QsoRecorder::~QsoRecorder(void)
 {
   setEnabled(false);
+  for (ClosingMap::value_type& closing : closing_recorders)
+  {
+      // Deleting the recorder does not wait for the file to be completely
+      // written so the encoder cannot be started for the file
+    delete closing.first;
+    if (!closing.second.empty())
+    {
+      cout << logic->name() << ": Not encoding QSO recorder file "
+           << closing.second << ".wav since it is still being written\n";
+    }
+  }
   delete selector;
   delete tmo_timer;
   delete qso_tmo_timer;
@@ -310,11 +323,18 @@ void QsoRecorder::closeFile(void)
            << endl;
     }
 
-    if (recorder->samplesWritten() > min_samples)
+      // The file is finished in the background so detach the recorder from
+      // the audio pipe and keep it until the file has been closed
+    AudioRecorder *rec = recorder;
+    recorder = 0;
+    selector->unregisterSink();
+
+    string basename;
+    if (rec->samplesWritten() > min_samples)
     {
-      string basename("qsorec_" + logic->name() + "_");
+      basename = "qsorec_" + logic->name() + "_";
 
-      const struct timeval &begin_time = recorder->beginTimestamp();
+      const struct timeval &begin_time = rec->beginTimestamp();
       struct tm tm;
       localtime_r(&begin_time.tv_sec, &tm);
       char timestamp[256];
@@ -323,47 +343,18 @@ void QsoRecorder::closeFile(void)
 
       basename += "_";
 
-      const struct timeval &end_time = recorder->endTimestamp();
+      const struct timeval &end_time = rec->endTimestamp();
       localtime_r(&end_time.tv_sec, &tm);
       strftime(timestamp, sizeof(timestamp), "%Y-%m-%d_%H%M%S", &tm);
       basename += timestamp;
+
+        // Renaming is safe while the file is still being written. It must be
+        // done now since the next recording will use the same temporary name.
       string newpath = rec_dir + "/" + basename + ".wav";
       if (rename(oldpath.c_str(), newpath.c_str()) != 0)
       {
         perror("QsoRecorder rename");
       }
-
-      cout << logic->name() << ": Wrote QSO recorder file "
-           << basename << ".wav\n";
-
-        // Execute external audio file handler (e.g. encoder) if configured
-      if (!encoder_cmd.empty())
-      {
-        cout << logic->name() << ": Starting encoding for file "
-             << basename << ".wav\n";
-        const char *shell = getenv("SHELL");
-        if (shell == NULL)
-        {
-          shell = "/bin/sh";
-        }
-        FileEncoder *enc = new FileEncoder(shell, basename);
-        enc->appendArgument("-c");
-        string cmdline(encoder_cmd);
-        replace_all(cmdline, "%f", newpath);
-        replace_all(cmdline, "%d", rec_dir);
-        replace_all(cmdline, "%b", basename);
-        replace_all(cmdline, "%n", basename + ".wav");
-        enc->appendArgument(cmdline);
-        enc->stdoutData.connect(
-            mem_fun(*this, &QsoRecorder::handleEncoderPrintouts));
-        enc->stderrData.connect(
-            mem_fun(*this, &QsoRecorder::handleEncoderPrintouts));
-        enc->exited.connect(
-            sigc::bind(mem_fun(*this, &QsoRecorder::encoderExited), enc));
-        enc->nice();
-        enc->setTimeout(60*60); // One hour timeout
-        enc->run();
-      }
     }
     else
     {
@@ -373,14 +364,81 @@ void QsoRecorder::closeFile(void)
       }
     }
 
-    delete recorder;
-    recorder = 0;
-
-    cleanupDirectory();
+    closing_recorders[rec] = basename;
+    if (rec->isClosing())
+    {
+      rec->fileClosed.connect(
+          sigc::bind(mem_fun(*this, &QsoRecorder::fileClosed), rec));
+    }
+    else
+    {
+      fileClosed(true, rec);
+    }
   }
 } /* QsoRecorder::closeFile */
 
 
+void QsoRecorder::fileClosed(bool success, AudioRecorder *rec)
+{
+  ClosingMap::iterator it = closing_recorders.find(rec);
+  assert(it != closing_recorders.end());
+  string basename(it->second);
+  closing_recorders.erase(it);
+
+  if (!success)
+  {
+    cerr << "*** ERROR: Failed to write QsoRecorder file in logic "
+         << logic->name() << ": " << rec->errorMsg() << endl;
+  }
+
+    // The recorder cannot be deleted from its own signal
+  Application::app().runTask([rec]{ delete rec; });
+
+  if (!basename.empty())
+  {
+    fileDone(basename);
+  }
+
+  cleanupDirectory();
+} /* QsoRecorder::fileClosed */
+
+
+void QsoRecorder::fileDone(const string& basename)
+{
+  cout << logic->name() << ": Wrote QSO recorder file "
+       << basename << ".wav\n";
+
+    // Execute external audio file handler (e.g. encoder) if configured
+  if (!encoder_cmd.empty())
+  {
+    cout << logic->name() << ": Starting encoding for file "
+         << basename << ".wav\n";
+    const char *shell = getenv("SHELL");
+    if (shell == NULL)
+    {
+      shell = "/bin/sh";
+    }
+    FileEncoder *enc = new FileEncoder(shell, basename);
+    enc->appendArgument("-c");
+    string cmdline(encoder_cmd);
+    replace_all(cmdline, "%f", rec_dir + "/" + basename + ".wav");
+    replace_all(cmdline, "%d", rec_dir);
+    replace_all(cmdline, "%b", basename);
+    replace_all(cmdline, "%n", basename + ".wav");
+    enc->appendArgument(cmdline);
+    enc->stdoutData.connect(
+        mem_fun(*this, &QsoRecorder::handleEncoderPrintouts));
+    enc->stderrData.connect(
+        mem_fun(*this, &QsoRecorder::handleEncoderPrintouts));
+    enc->exited.connect(
+        sigc::bind(mem_fun(*this, &QsoRecorder::encoderExited), enc));
+    enc->nice();
+    enc->setTimeout(60*60); // One hour timeout
+    enc->run();
+  }
+} /* QsoRecorder::fileDone */
+
+
 void QsoRecorder::cleanupDirectory(void)
 {
   if (max_dirsize == 0)
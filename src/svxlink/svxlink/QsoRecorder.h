@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <string>
+#include <map>
 
 
 /****************************************************************************
@@ -178,6 +179,7 @@ class QsoRecorder
 
   private:
     class FileEncoder;
+    typedef std::map<Async::AudioRecorder*, std::string> ClosingMap;
 
     Async::AudioSelector  *selector;
     Async::AudioRecorder  *recorder;
@@ -191,12 +193,15 @@ class QsoRecorder
     Async::Timer          *qso_tmo_timer;
     unsigned              min_samples;
     std::string           encoder_cmd;
+    ClosingMap            closing_recorders;
 
     QsoRecorder(const QsoRecorder&);
     QsoRecorder& operator=(const QsoRecorder&);
     void openNewFile(void);
     void openFile(void);
     void closeFile(void);
+    void fileClosed(bool success, Async::AudioRecorder *rec);
+    void fileDone(const std::string& basename);
     void cleanupDirectory(void);
     void timerExpired(void);
     void checkTimeoutTimers(void);
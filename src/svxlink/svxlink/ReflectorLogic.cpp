@@ -59,6 +59,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncIpAddress.h>
 #include <AsyncAudioPassthrough.h>
 #include <AsyncAudioValve.h>
+#include <AsyncAudioPacketJitterBuffer.h>
+#include <AsyncAudioLatencyProbe.h>
+#include <AsyncAudioEncoderWorker.h>
+#include <AsyncAudioDecoderWorker.h>
 #include <version/SVXLINK.h>
 #include <config.h>
 
@@ -237,6 +241,7 @@ bool ReflectorLogic::initialize(Async::Config& cfgobj, const std::string& logic_
   }
 
   cfg().getValue(name(), "VERBOSE", m_verbose);
+  cfg().getValue(name(), "CODEC_THREAD", m_codec_thread);
 
   std::vector<std::string> hosts;
   if (cfg().getValue(name(), "HOST", hosts))
@@ -522,7 +527,40 @@ bool ReflectorLogic::initialize(Async::Config& cfgobj, const std::string& logic_
   if (!setAudioCodec("DUMMY")) { return false; }
   prev_src = m_dec;
 
+    // Create the adaptive jitter buffer if configured
+  bool adaptive_jitter_buffer = false;
+  cfg().getValue(name(), "ADAPTIVE_JITTER_BUFFER", adaptive_jitter_buffer);
+  if (adaptive_jitter_buffer)
+  {
+    unsigned min_delay = DEFAULT_JITTER_BUFFER_MIN_DELAY;
+    cfg().getValue(name(), "JITTER_BUFFER_MIN_DELAY", min_delay);
+    unsigned max_delay = DEFAULT_JITTER_BUFFER_MAX_DELAY;
+    cfg().getValue(name(), "JITTER_BUFFER_MAX_DELAY", max_delay);
+    if (max_delay < min_delay)
+    {
+      std::cerr << "*** ERROR[" << name() << "]: JITTER_BUFFER_MAX_DELAY "
+                   "must not be less than JITTER_BUFFER_MIN_DELAY"
+                << std::endl;
+      return false;
+    }
+    if (m_codec_thread)
+    {
+        // The jitter buffer need the decoded audio to be returned directly
+        // when feeding the decoder to be able to time stretch it
+      std::cerr << "*** WARNING[" << name() << "]: CODEC_THREAD is not "
+                   "used for the audio decoder when ADAPTIVE_JITTER_BUFFER "
+                   "is enabled" << std::endl;
+    }
+    m_jitter_buf = new Async::AudioPacketJitterBuffer;
+    m_jitter_buf->setDelayLimits(min_delay, max_delay);
+    m_jitter_buf->setDecoder(m_dec);
+    prev_src->registerSink(m_jitter_buf, true);
+    prev_src = m_jitter_buf;
+  }
+
     // Create jitter buffer
+  AudioLatencyProbe *dec_probe =
+      AudioLatencyProbe::insert(prev_src, name() + ":decoder");
   AudioFifo *fifo = new Async::AudioFifo(2*INTERNAL_SAMPLE_RATE);
   prev_src->registerSink(fifo, true);
   prev_src = fifo;
@@ -532,6 +570,7 @@ bool ReflectorLogic::initialize(Async::Config& cfgobj, const std::string& logic_
   {
     fifo->setPrebufSamples(jitter_buffer_delay * INTERNAL_SAMPLE_RATE / 1000);
   }
+  AudioLatencyProbe::insert(prev_src, name() + ":jitter_fifo", dec_probe);
 
   prev_src->registerSink(m_logic_con_out, true);
   prev_src = 0;
@@ -968,6 +1007,7 @@ ReflectorLogic::~ReflectorLogic(void)
   m_enc = 0;
   delete m_dec;
   m_dec = 0;
+  m_jitter_buf = nullptr;
   delete m_logic_con_in_valve;
   m_logic_con_in_valve = 0;
 } /* ReflectorLogic::~ReflectorLogic */
@@ -1024,7 +1064,7 @@ void ReflectorLogic::onDisconnected(TcpConnection*,
   }
   if (timerisset(&m_last_talker_timestamp))
   {
-    m_dec->flushEncodedSamples();
+    flushReceivedAudio(true);
     timerclear(&m_last_talker_timestamp);
   }
   m_con_state = STATE_DISCONNECTED;
@@ -2139,23 +2179,33 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
   //  return;
   //}
 
-    // Check sequence number
-  if (m_aad.iv_cntr < m_next_udp_rx_seq) // Frame out of sequence (ignore)
+    // Check sequence number. Out of sequence audio frames are passed on to
+    // the jitter buffer, if enabled, since it will sort them out.
+  UdpCipher::IVCntr lost_frames = 0;
+  if (m_aad.iv_cntr < m_next_udp_rx_seq) // Frame out of sequence
   {
-    std::cout << name()
-              << ": Dropping out of sequence UDP frame with seq="
-              << m_aad.iv_cntr << std::endl;
-    return;
+    if ((m_jitter_buf == nullptr) || (header.type() != MsgUdpAudio::TYPE))
+    {
+      std::cout << name()
+                << ": Dropping out of sequence UDP frame with seq="
+                << m_aad.iv_cntr << std::endl;
+      return;
+    }
   }
-  else if (m_aad.iv_cntr > m_next_udp_rx_seq) // Frame lost
+  else
   {
-    std::cout << name() << ": UDP frame(s) lost. Expected seq="
-              << m_next_udp_rx_seq
-              << " but received " << m_aad.iv_cntr
-              << ". Resetting next expected sequence number to "
-              << (m_aad.iv_cntr + 1) << std::endl;
+    if ((m_aad.iv_cntr > m_next_udp_rx_seq) && // Frame lost
+        (m_jitter_buf == nullptr))
+    {
+      lost_frames = m_aad.iv_cntr - m_next_udp_rx_seq;
+      std::cout << name() << ": UDP frame(s) lost. Expected seq="
+                << m_next_udp_rx_seq
+                << " but received " << m_aad.iv_cntr
+                << ". Resetting next expected sequence number to "
+                << (m_aad.iv_cntr + 1) << std::endl;
+    }
+    m_next_udp_rx_seq = m_aad.iv_cntr + 1;
   }
-  m_next_udp_rx_seq = m_aad.iv_cntr + 1;
 
   m_udp_heartbeat_rx_cnt = UDP_HEARTBEAT_RX_CNT_RESET;
 
@@ -2186,6 +2236,11 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
     return;
   }
 
+  if ((m_jitter_buf != nullptr) && (header.type() != MsgUdpAudio::TYPE))
+  {
+    m_jitter_buf->skipSequenceNumber(m_aad.iv_cntr);
+  }
+
   switch (header.type())
   {
     case MsgUdpHeartbeat::TYPE:
@@ -2202,15 +2257,36 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
       }
       if (!msg.audioData().empty())
       {
+        if (m_jitter_buf != nullptr)
+        {
+          m_jitter_buf->writeEncodedSamples(m_aad.iv_cntr,
+              &msg.audioData().front(), msg.audioData().size());
+        }
+        else
+        {
+            // Conceal frames lost during an ongoing talker transmission. The
+            // decoder may use FEC data in this frame to recover the last one.
+          if (timerisset(&m_last_talker_timestamp) &&
+              (lost_frames > 0) && (lost_frames <=
+               Async::AudioPacketJitterBuffer::MAX_CONCEAL_FRAMES))
+          {
+            for (UdpCipher::IVCntr i=1; i<lost_frames; ++i)
+            {
+              m_dec->concealLostSamples(0);
+            }
+            m_dec->concealLostSamples(0, &msg.audioData().front(),
+                                      msg.audioData().size());
+          }
+          m_dec->writeEncodedSamples(
+              &msg.audioData().front(), msg.audioData().size());
+        }
         gettimeofday(&m_last_talker_timestamp, NULL);
-        m_dec->writeEncodedSamples(
-            &msg.audioData().front(), msg.audioData().size());
       }
       break;
     }
 
     case MsgUdpFlushSamples::TYPE:
-      m_dec->flushEncodedSamples();
+      flushReceivedAudio();
       timerclear(&m_last_talker_timestamp);
       break;
 
@@ -2320,9 +2396,34 @@ bool ReflectorLogic::isConnected(void) const
 void ReflectorLogic::allEncodedSamplesFlushed(void)
 {
   sendUdpMsg(MsgUdpAllSamplesFlushed());
+
+  if ((m_jitter_buf != nullptr) && m_verbose &&
+      (m_jitter_buf->stats().received > 0))
+  {
+    std::cout << name() << ": Jitter buffer statistics: "
+              << m_jitter_buf->stats() << std::endl;
+    m_jitter_buf->resetStats();
+  }
 } /* ReflectorLogic::allEncodedSamplesFlushed */
 
 
+void ReflectorLogic::flushReceivedAudio(bool discard)
+{
+  if (m_jitter_buf == nullptr)
+  {
+    m_dec->flushEncodedSamples();
+  }
+  else if (discard)
+  {
+    m_jitter_buf->reset();
+  }
+  else
+  {
+    m_jitter_buf->flushEncodedSamples();
+  }
+} /* ReflectorLogic::flushReceivedAudio */
+
+
 void ReflectorLogic::flushTimeout(Async::Timer *t)
 {
   m_flush_timeout_timer.setEnable(false);
@@ -2340,7 +2441,7 @@ void ReflectorLogic::handleTimerTick(Async::Timer *t)
     if (diff.tv_sec > 3)
     {
       cout << name() << ": Last talker audio timeout" << endl;
-      m_dec->flushEncodedSamples();
+      flushReceivedAudio();
       timerclear(&m_last_talker_timestamp);
     }
   }
@@ -2389,11 +2490,6 @@ bool ReflectorLogic::setAudioCodec(const std::string& codec_name)
     assert(m_enc != 0);
     return false;
   }
-  m_enc->writeEncodedSamples.connect(
-      mem_fun(*this, &ReflectorLogic::sendEncodedAudio));
-  m_enc->flushEncodedSamples.connect(
-      mem_fun(*this, &ReflectorLogic::flushEncodedAudio));
-  m_enc_endpoint->registerSink(m_enc, false);
 
   string opt_prefix(m_enc->name());
   opt_prefix += "_ENC_";
@@ -2410,6 +2506,18 @@ bool ReflectorLogic::setAudioCodec(const std::string& codec_name)
   }
   m_enc->printCodecParams();
 
+    // Options are set before the encoder is moved to the worker thread so
+    // that they are applied, and printed, directly
+  if (m_codec_thread && (codec_name != "DUMMY"))
+  {
+    m_enc = new Async::AudioEncoderWorker(m_enc);
+  }
+  m_enc->writeEncodedSamples.connect(
+      mem_fun(*this, &ReflectorLogic::sendEncodedAudio));
+  m_enc->flushEncodedSamples.connect(
+      mem_fun(*this, &ReflectorLogic::flushEncodedAudio));
+  m_enc_endpoint->registerSink(m_enc, false);
+
   AudioSink *sink = 0;
   if (m_dec != 0)
   {
@@ -2425,14 +2533,12 @@ bool ReflectorLogic::setAudioCodec(const std::string& codec_name)
          << " audio decoder" << endl;
     m_dec = Async::AudioDecoder::create("DUMMY");
     assert(m_dec != 0);
+    if (m_jitter_buf != nullptr)
+    {
+      m_jitter_buf->setDecoder(m_dec);
+    }
     return false;
   }
-  m_dec->allEncodedSamplesFlushed.connect(
-      mem_fun(*this, &ReflectorLogic::allEncodedSamplesFlushed));
-  if (sink != 0)
-  {
-    m_dec->registerSink(sink, true);
-  }
 
   opt_prefix = string(m_dec->name()) + "_DEC_";
   names = cfg().listSection(name());
@@ -2448,6 +2554,22 @@ bool ReflectorLogic::setAudioCodec(const std::string& codec_name)
   }
   m_dec->printCodecParams();
 
+    // The adaptive jitter buffer require the decoder to run synchronously
+  if (m_codec_thread && (codec_name != "DUMMY") && (m_jitter_buf == nullptr))
+  {
+    m_dec = new Async::AudioDecoderWorker(m_dec);
+  }
+  m_dec->allEncodedSamplesFlushed.connect(
+      mem_fun(*this, &ReflectorLogic::allEncodedSamplesFlushed));
+  if (sink != 0)
+  {
+    m_dec->registerSink(sink, true);
+  }
+  if (m_jitter_buf != nullptr)
+  {
+    m_jitter_buf->setDecoder(m_dec);
+  }
+
   return true;
 } /* ReflectorLogic::setAudioCodec */
 
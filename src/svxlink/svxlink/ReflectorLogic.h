@@ -74,6 +74,7 @@ namespace Async
 {
   class EncryptedUdpSocket;
   class AudioValve;
+  class AudioPacketJitterBuffer;
 };
 
 class ReflectorMsg;
@@ -223,6 +224,8 @@ class ReflectorLogic : public LogicBase
     static const unsigned TCP_HEARTBEAT_RX_CNT_RESET          = 15;
     static const unsigned DEFAULT_TG_SELECT_TIMEOUT           = 30;
     static const int      DEFAULT_TMP_MONITOR_TIMEOUT         = 3600;
+    static const unsigned DEFAULT_JITTER_BUFFER_MIN_DELAY     = 40;
+    static const unsigned DEFAULT_JITTER_BUFFER_MAX_DELAY     = 500;
 
     std::string                       m_reflector_host;
     FramedTcpClient                   m_con;
@@ -282,6 +285,8 @@ class ReflectorLogic : public LogicBase
     UdpCipher::IVCntr                 m_udp_cipher_iv_cntr;
     UdpCipher::AAD                    m_aad;
     bool                              m_download_ca_bundle = true;
+    Async::AudioPacketJitterBuffer*   m_jitter_buf = nullptr;
+    bool                              m_codec_thread = false;
 
     ReflectorLogic(const ReflectorLogic&);
     ReflectorLogic& operator=(const ReflectorLogic&);
@@ -326,6 +331,7 @@ class ReflectorLogic : public LogicBase
     bool isConnected(void) const;
     bool isLoggedIn(void) const { return m_con_state == STATE_CONNECTED; }
     void allEncodedSamplesFlushed(void);
+    void flushReceivedAudio(bool discard=false);
     void flushTimeout(Async::Timer *t=0);
     void handleTimerTick(Async::Timer *t);
     bool setAudioCodec(const std::string& codec_name);
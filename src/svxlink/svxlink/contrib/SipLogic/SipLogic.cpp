@@ -35,7 +35,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iomanip>
 #include <algorithm>
 #include <iterator>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <cerrno>
 #include <sigc++/sigc++.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <pjlib.h>
 #include <pjsua-lib/pjsua.h>
 
@@ -50,13 +56,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncSigCAudioSink.h>
 #include <AsyncPty.h>
 #include <AsyncAudioValve.h>
-#include <AsyncAudioReader.h>
 #include <AsyncAudioSelector.h>
 #include <AsyncAudioClipper.h>
 #include <AsyncAudioCompressor.h>
 #include <AsyncAudioAmp.h>
 #include <AsyncAudioFilter.h>
 #include <AsyncTcpClient.h>
+#include <AsyncFdWatch.h>
 #include <common.h>
 #include <config.h>
 
@@ -92,6 +98,8 @@ using namespace pj;
  ****************************************************************************/
 #define DEFAULT_SIPLIMITER_THRESH  -1.0
 #define PJSIP_VERSION "21082025"
+#define FRAME_TIME_LEN  48
+#define AUDIO_RING_SIZE 4096
 
 
 /****************************************************************************
@@ -261,6 +269,232 @@ namespace sip {
 
       } /* _AudioMedia::createMediaPort */
   };
+
+
+  /*
+   * A lock free ring buffer for audio samples with exactly one producer
+   * thread and one consumer thread. The samples are passed between the
+   * pjmedia clock thread and the main thread through two of these, one per
+   * direction. The buffer is allocated once so no memory allocation or
+   * locking is done per audio frame. The size must be a power of two.
+   */
+  class AudioRing
+  {
+    public:
+      explicit AudioRing(size_t size)
+        : buf(size), mask(size - 1), head(0), tail(0), discard_to(0),
+          discard_req(false)
+      {
+        assert((size > 0) && ((size & mask) == 0));
+      }
+
+        // Number of samples available for reading
+      size_t fill(void) const
+      {
+        return head.load(std::memory_order_acquire) -
+               tail.load(std::memory_order_acquire);
+      }
+
+        // Producer: room left for writing
+      size_t space(void) const { return buf.size() - fill(); }
+
+        // Producer: write float samples
+      size_t write(const float *samples, size_t count)
+      {
+        size_t h = head.load(std::memory_order_relaxed);
+        count = std::min(count, space());
+        for (size_t i=0; i<count; ++i)
+        {
+          buf[(h + i) & mask] = samples[i];
+        }
+        head.store(h + count, std::memory_order_release);
+        return count;
+      }
+
+        // Producer: write 16 bit samples, converting them to float
+      size_t write(const pj_int16_t *samples, size_t count)
+      {
+        size_t h = head.load(std::memory_order_relaxed);
+        count = std::min(count, space());
+        for (size_t i=0; i<count; ++i)
+        {
+          buf[(h + i) & mask] = samples[i] / 32768.0f;
+        }
+        head.store(h + count, std::memory_order_release);
+        return count;
+      }
+
+        // Producer: ask the consumer to throw away what has been written
+      void discard(void)
+      {
+        discard_to.store(head.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+        discard_req.store(true, std::memory_order_release);
+      }
+
+        // Consumer: read samples converting them to clipped 16 bit samples
+      size_t read(pj_int16_t *samples, size_t count)
+      {
+        handleDiscard();
+        size_t t = tail.load(std::memory_order_relaxed);
+        count = std::min(count, fill());
+        for (size_t i=0; i<count; ++i)
+        {
+          float sample = buf[(t + i) & mask] * 32768.0f;
+          sample = std::max(-32768.0f, std::min(32767.0f, sample));
+          samples[i] = static_cast<pj_int16_t>(sample);
+        }
+        tail.store(t + count, std::memory_order_release);
+        return count;
+      }
+
+        // Consumer: get a pointer to the contiguous readable samples
+      const float *peek(size_t &count)
+      {
+        handleDiscard();
+        size_t t = tail.load(std::memory_order_relaxed);
+        count = std::min(fill(), buf.size() - (t & mask));
+        return &buf[t & mask];
+      }
+
+        // Consumer: remove samples previously returned by peek
+      void consume(size_t count)
+      {
+        tail.store(tail.load(std::memory_order_relaxed) + count,
+                   std::memory_order_release);
+      }
+
+    private:
+      std::vector<float>  buf;
+      const size_t        mask;
+      std::atomic<size_t> head;
+      std::atomic<size_t> tail;
+      std::atomic<size_t> discard_to;
+      std::atomic<bool>   discard_req;
+
+      void handleDiscard(void)
+      {
+        if (discard_req.exchange(false, std::memory_order_acquire))
+        {
+          size_t t = tail.load(std::memory_order_relaxed);
+          size_t to = discard_to.load(std::memory_order_relaxed);
+          if (static_cast<std::ptrdiff_t>(to - t) > 0)
+          {
+            tail.store(to, std::memory_order_release);
+          }
+        }
+      }
+  };
+
+
+  /*
+   * The main thread end of the audio path to SIP. Samples written to the
+   * sink are put in the ring buffer that the pjmedia clock thread read
+   * from. When the ring is full the source is stopped and it is resumed
+   * when the clock thread have made room for more samples. The clock thread
+   * wake up the main thread, by calling notify, only when the sink has
+   * asked for it.
+   */
+  class AudioRingSink : public Async::AudioSink
+  {
+    public:
+      AudioRingSink(AudioRing &ring, size_t max_fill)
+        : ring(ring), max_fill(max_fill), is_active(false),
+          wait_for_space(false), flush_pending(false), is_streaming(false),
+          notify_req(false)
+      {
+      }
+
+      virtual int writeSamples(const float *samples, int count) override
+      {
+        if (!is_active)
+        {
+          return count;
+        }
+        is_streaming.store(true, std::memory_order_relaxed);
+        size_t fill = ring.fill();
+        size_t room = (fill < max_fill) ? max_fill - fill : 0;
+        int written = ring.write(samples,
+                                 std::min(static_cast<size_t>(count), room));
+        if (written < count)
+        {
+          wait_for_space = true;
+          notify_req.store(true, std::memory_order_release);
+        }
+        return written;
+      }
+
+      virtual void flushSamples(void) override
+      {
+        is_streaming.store(false, std::memory_order_relaxed);
+        if (!is_active || (ring.fill() == 0))
+        {
+          sourceAllSamplesFlushed();
+          return;
+        }
+        flush_pending = true;
+        notify_req.store(true, std::memory_order_release);
+      }
+
+        // Called from the clock thread after reading from the ring
+      bool notifyRequested(void)
+      {
+        return notify_req.exchange(false, std::memory_order_acquire);
+      }
+
+      bool isStreaming(void) const
+      {
+        return is_streaming.load(std::memory_order_relaxed);
+      }
+
+        // Called in the main thread when woken up by the clock thread
+      void consumerActivity(void)
+      {
+        if (wait_for_space || flush_pending)
+        {
+          notify_req.store(true, std::memory_order_release);
+        }
+        if (wait_for_space && (ring.fill() < max_fill))
+        {
+          wait_for_space = false;
+          sourceResumeOutput();
+        }
+        if (flush_pending && (ring.fill() == 0))
+        {
+          flush_pending = false;
+          sourceAllSamplesFlushed();
+        }
+      }
+
+      void setActive(bool active)
+      {
+        is_active = active;
+        if (!active)
+        {
+          ring.discard();
+          is_streaming.store(false, std::memory_order_relaxed);
+          if (wait_for_space)
+          {
+            wait_for_space = false;
+            sourceResumeOutput();
+          }
+          if (flush_pending)
+          {
+            flush_pending = false;
+            sourceAllSamplesFlushed();
+          }
+        }
+      }
+
+    private:
+      AudioRing         &ring;
+      const size_t      max_fill;
+      bool              is_active;
+      bool              wait_for_space;
+      bool              flush_pending;
+      std::atomic<bool> is_streaming;
+      std::atomic<bool> notify_req;
+  };
 }
 
 
@@ -307,7 +541,10 @@ extern "C" {
 
 SipLogic::SipLogic(void)
   : m_logic_con_out(0),
-    m_outto_sip(0), m_infrom_sip(0), m_autoanswer(false),
+    m_outto_sip(0), m_infrom_sip(0), m_from_sip_ring(0), m_to_sip_ring(0),
+    m_to_sip_sink(0), m_audio_evfd(-1), m_audio_watch(0),
+    m_to_sip_running(false), m_to_sip_underruns(0), m_from_sip_overruns(0),
+    m_autoanswer(false),
     m_sip_port(5060), dtmf_ctrl_pty(0),
     m_call_timeout_timer(45000, Timer::TYPE_ONESHOT, false),
     squelch_det(0), accept_incoming_regex(0), reject_incoming_regex(0),
@@ -617,8 +854,27 @@ bool SipLogic::initialize(Async::Config& cfgobj, const std::string& logic_name)
 
   cfg().getValue(name(), "IGNORE_REGISTRATION", ignore_reg);
 
+   // The pjmedia clock thread exchange audio with the main thread through
+   // one lock free ring buffer per direction. The clock thread wake up the
+   // main thread using an eventfd.
+  m_audio_evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_audio_evfd < 0)
+  {
+    cerr << "*** ERROR: Could not create eventfd in " << name() << ": "
+         << strerror(errno) << endl;
+    return false;
+  }
+  m_audio_watch = new FdWatch(m_audio_evfd, FdWatch::FD_WATCH_RD);
+  m_audio_watch->setName("SipLogic");
+  m_audio_watch->activity.connect(mem_fun(*this, &SipLogic::audioNotified));
+  m_from_sip_ring = new sip::AudioRing(AUDIO_RING_SIZE);
+  m_to_sip_ring = new sip::AudioRing(AUDIO_RING_SIZE);
+    // At most two frames are buffered towards SIP
+  m_to_sip_sink = new sip::AudioRingSink(*m_to_sip_ring,
+      2 * INTERNAL_SAMPLE_RATE * FRAME_TIME_LEN / 1000);
+
    // number of samples = INTERNAL_SAMPLE_RATE * frameTimeLen /1000
-  media = new sip::_AudioMedia(*this, 48);
+  media = new sip::_AudioMedia(*this, FRAME_TIME_LEN);
 
   /*************** incoming from sip ****************************/
   // handler for incoming sip audio stream
@@ -846,10 +1102,9 @@ bool SipLogic::initialize(Async::Config& cfgobj, const std::string& logic_name)
   m_outto_sip->setOpen(false);
   sipselector->registerSink(m_outto_sip, true);
 
-   // the Audioreader to get and handle the samples later
+   // the ring buffer sink that the pjmedia clock thread read samples from
    // when connected
-  m_ar = new AudioReader;
-  m_ar->registerSource(m_outto_sip);
+  m_outto_sip->registerSink(m_to_sip_sink);
 
    // auto create an outgoing call
   if (m_autoconnect.length() > 0)
@@ -910,11 +1165,19 @@ SipLogic::~SipLogic(void)
     reject_outgoing_regex = 0;
   }
   delete media;           media = 0;
+  delete m_audio_watch;   m_audio_watch = 0;
+  if (m_audio_evfd >= 0)
+  {
+    close(m_audio_evfd);
+    m_audio_evfd = -1;
+  }
   delete acc;             acc = 0;
   delete m_logic_con_in;  m_logic_con_in = 0;
   delete m_out_src;       m_out_src = 0;
   delete dtmf_ctrl_pty;   dtmf_ctrl_pty = 0;
-  delete m_ar;            m_ar = 0;
+  delete m_to_sip_sink;   m_to_sip_sink = 0;
+  delete m_to_sip_ring;   m_to_sip_ring = 0;
+  delete m_from_sip_ring; m_from_sip_ring = 0;
   delete logic_event_handler;  logic_event_handler = 0;
   delete sip_event_handler;    sip_event_handler = 0;
   delete logic_msg_handler;    logic_msg_handler = 0;
@@ -1125,6 +1388,7 @@ void SipLogic::onMediaState(sip::_Call *call, pj::OnCallMediaStateParam &prm)
         sip_buf = static_cast<pj::AudioMedia *>(call->getMedia(0));
         sip_buf->startTransmit(*media);
         media->startTransmit(*sip_buf);
+        m_to_sip_sink->setActive(true);
         m_outto_sip->setOpen(true);
         m_infrom_sip->setOpen(semi_duplex);
         processSipEvent("remote_greeting");
@@ -1159,45 +1423,37 @@ void SipLogic::onMediaState(sip::_Call *call, pj::OnCallMediaStateParam &prm)
 
 
 /*
- * incoming SvxLink audio stream to SIP client
+ * incoming SvxLink audio stream to SIP client, called from the pjmedia clock
+ * thread
  */
 pj_status_t SipLogic::mediaPortGetFrame(pjmedia_port *port, pjmedia_frame *frame)
 {
-
-  int got = 0;
   int count = frame->size / 2 / PJMEDIA_PIA_CCNT(&port->info);
-  float* smpl = new float[count+1]();
   pj_int16_t *samples = static_cast<pj_int16_t *>(frame->buf);
   frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
 
-  if (!smpl)
+  /*
+    The pjsip framework requests 768 samples on every call. Only full frames
+    are read while SvxLink is sending audio so that a short burst of samples
+    is not spread out over several frames. When the audio has been flushed
+    the last samples are read and the rest of the frame is filled with 0.
+  */
+  int got = 0;
+  if (!m_to_sip_sink->isStreaming() ||
+      (m_to_sip_ring->fill() >= static_cast<size_t>(count)))
   {
-    cout << "*** Race condition smpl-pointer is null\n";
-    return PJ_SUCCESS;
+    got = m_to_sip_ring->read(samples, count);
   }
-
-  if ((got = m_ar->readSamples(smpl, count)) > 0)
+  if ((got < count) && m_to_sip_running && m_to_sip_sink->isStreaming())
   {
-    int i = 0;
-    for (float* s = smpl; s < smpl + sizeof(float)*got; s += sizeof(float))
-    {
-      samples[i] = (pj_int16_t)(smpl[i] * 32768);
-      i++;
-    }
+    ++m_to_sip_underruns;
   }
+  m_to_sip_running = (got == count);
+  std::fill(samples + got, samples + count, 0);
 
-  delete [] smpl;
-
-  /*
-    The pjsip framework requests 768 samples on every call. The SvxLink
-    framework can only deliver samples if the sql isn't closed and
-    m_logic_con_in provides some. Since the documentation of pjsip is poor
-    I can not predict the behaviour if we provide less samples than the
-    requested number. So we will fill the buffer with 0
-  */
-  while (++got < count)
+  if (m_to_sip_sink->notifyRequested())
   {
-    samples[got] = (pj_int16_t) 0;
+    notifyMainThread();
   }
 
   return PJ_SUCCESS;
@@ -1205,27 +1461,20 @@ pj_status_t SipLogic::mediaPortGetFrame(pjmedia_port *port, pjmedia_frame *frame
 
 
 /*
- * incoming SIP audio stream to SvxLink
+ * incoming SIP audio stream to SvxLink, called from the pjmedia clock thread
  */
 pj_status_t SipLogic::mediaPortPutFrame(pjmedia_port *port, pjmedia_frame *frame)
 {
-  int pos = 0;
   int count = frame->size / 2 / PJMEDIA_PIA_CCNT(&port->info);
 
   if (count > 0)
   {
-    pj_int16_t *samples = static_cast<pj_int16_t *>(frame->buf);
-    frame->type = PJMEDIA_FRAME_TYPE_AUDIO;
-    float* smpl = new float[count+1]();
-    for (int i=pos; i < count; i++)
+    const pj_int16_t *samples = static_cast<const pj_int16_t *>(frame->buf);
+    if (m_from_sip_ring->write(samples, count) < static_cast<size_t>(count))
     {
-      smpl[i] = (float) (samples[i] / 32768.0);
+      ++m_from_sip_overruns;
     }
-    do {
-      int ret = m_out_src->writeSamples(smpl + pos, count - pos);
-      pos += ret;
-    } while (pos < count);
-    delete [] smpl;
+    notifyMainThread();
   }
 
   return PJ_SUCCESS;
@@ -1503,6 +1752,61 @@ void SipLogic::onSquelchOpen(bool is_open)
 } /* SipLogic::onSquelchOpen */
 
 
+void SipLogic::notifyMainThread(void)
+{
+  uint64_t cnt = 1;
+  if ((write(m_audio_evfd, &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN))
+  {
+    cerr << "*** ERROR: Could not write to eventfd in " << name() << ": "
+         << strerror(errno) << endl;
+  }
+} /* SipLogic::notifyMainThread */
+
+
+void SipLogic::audioNotified(Async::FdWatch *w)
+{
+  uint64_t cnt;
+  if ((read(w->fd(), &cnt, sizeof(cnt)) < 0) && (errno != EAGAIN))
+  {
+    cerr << "*** ERROR: Could not read from eventfd in " << name() << ": "
+         << strerror(errno) << endl;
+  }
+
+    // Move the samples received from SIP to the audio pipe. If the pipe
+    // does not accept all samples, the rest is kept in the ring until the
+    // next frame arrive.
+  for (;;)
+  {
+    size_t avail;
+    const float *samples = m_from_sip_ring->peek(avail);
+    if (avail == 0)
+    {
+      break;
+    }
+    int ret = m_out_src->writeSamples(samples, avail);
+    if (ret <= 0)
+    {
+      break;
+    }
+    m_from_sip_ring->consume(ret);
+  }
+
+  m_to_sip_sink->consumerActivity();
+} /* SipLogic::audioNotified */
+
+
+void SipLogic::printAudioStats(void)
+{
+  unsigned underruns = m_to_sip_underruns.exchange(0);
+  unsigned overruns = m_from_sip_overruns.exchange(0);
+  if ((underruns > 0) || (overruns > 0))
+  {
+    cout << name() << ": SIP audio underruns=" << underruns
+         << " overruns=" << overruns << endl;
+  }
+} /* SipLogic::printAudioStats */
+
+
 void SipLogic::processLogicEvent(const string& event)
 {
   if (!startup_finished) return;
@@ -1593,6 +1897,8 @@ void SipLogic::unregisterCall(sip::_Call *call)
   {
     m_outto_sip->setOpen(false);
     m_infrom_sip->setOpen(false);
+    m_to_sip_sink->setActive(false);
+    printAudioStats();
     //squelch_det->reset();
   }
 } /* SipLogic::unregisterCall */
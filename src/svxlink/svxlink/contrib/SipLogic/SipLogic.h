@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <sys/time.h>
 #include <string>
 #include <iostream>
+#include <atomic>
 #include <sigc++/sigc++.h>
 #include <regex.h>
 
@@ -54,7 +55,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioFifo.h>
 #include <AsyncAudioPassthrough.h>
 #include <AsyncAudioValve.h>
-#include <AsyncAudioReader.h>
 #include <AsyncDnsLookup.h>
 
 
@@ -86,10 +86,13 @@ namespace sip
   class _Account;
   class _Call;
   class _AudioMedia;
+  class AudioRing;
+  class AudioRingSink;
 };
 namespace Async
 {
   class Pty;
+  class FdWatch;
 };
 class Squelch;
 class MsgHandler;
@@ -178,7 +181,14 @@ class SipLogic : public LogicBase
     Async::AudioPassthrough*  m_out_src;
     Async::AudioValve*        m_outto_sip;
     Async::AudioValve*        m_infrom_sip;
-    Async::AudioReader*       m_ar;
+    sip::AudioRing*           m_from_sip_ring;
+    sip::AudioRing*           m_to_sip_ring;
+    sip::AudioRingSink*       m_to_sip_sink;
+    int                       m_audio_evfd;
+    Async::FdWatch*           m_audio_watch;
+    bool                      m_to_sip_running;
+    std::atomic<unsigned>     m_to_sip_underruns;
+    std::atomic<unsigned>     m_from_sip_overruns;
     bool                      m_autoanswer;
     uint16_t                  m_sip_port;
     sip::_Account             *acc;
@@ -230,6 +240,9 @@ class SipLogic : public LogicBase
     void callTimeout(Async::Timer *t=0);
     void flushTimeout(Async::Timer *t=0);
     void onSquelchOpen(bool is_open);
+    void notifyMainThread(void);
+    void audioNotified(Async::FdWatch *w);
+    void printAudioStats(void);
     void unregisterCall(sip::_Call *call);
     void hangupAllCalls(void);
     std::string getCallerUri(std::string uri);
@@ -58,6 +58,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncTimer.h>
 #include <AsyncFdWatch.h>
 #include <AsyncAudioIO.h>
+#include <AsyncAudioLatencyProbe.h>
 #include <LocationInfo.h>
 #include <common.h>
 #include <config.h>
@@ -73,6 +74,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "version/SVXLINK.h"
 #include "Logic.h"
 #include "LinkManager.h"
+#include "MsgHandler.h"
 
 
 /****************************************************************************
@@ -420,6 +422,26 @@ int main(int argc, char **argv)
   cfg.getValue("GLOBAL", "CARD_CHANNELS", card_channels);
   AudioIO::setChannels(card_channels);
 
+  int audio_thread_prio = 0;
+  cfg.getValue("GLOBAL", "AUDIO_THREAD_PRIO", audio_thread_prio);
+  AudioIO::setRealtimePriority(audio_thread_prio);
+
+  bool audio_latency_stats = false;
+  cfg.getValue("GLOBAL", "AUDIO_LATENCY_STATS", audio_latency_stats);
+  AudioLatencyProbe::setEnabled(audio_latency_stats);
+
+  unsigned msg_clip_cache_size = 0;
+  cfg.getValue("GLOBAL", "MSG_CLIP_CACHE_SIZE", msg_clip_cache_size);
+  MsgHandler::setClipCacheSize(
+      static_cast<size_t>(msg_clip_cache_size) * 1024 * 1024);
+
+  unsigned main_loop_profiling = 0;
+  cfg.getValue("GLOBAL", "MAIN_LOOP_PROFILING", main_loop_profiling);
+  if (main_loop_profiling > 0)
+  {
+    app.enableProfiling(1000 * main_loop_profiling);
+  }
+
     // Init locationinfo
   if (cfg.getValue("GLOBAL", "LOCATION_INFO", value))
   {
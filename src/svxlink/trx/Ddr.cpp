@@ -473,7 +473,16 @@ namespace {
     public:
       virtual ~Demodulator(void) {}
 
-      virtual void iq_received(vector<WbRxRtlSdr::Sample> samples) = 0;
+      virtual void demodulate(vector<float> &audio,
+                              const vector<WbRxRtlSdr::Sample> &samples) = 0;
+
+      void writeAudio(const vector<float> &audio)
+      {
+        if (!audio.empty())
+        {
+          sinkWriteSamples(&audio[0], audio.size());
+        }
+      }
 
       /**
        * @brief Resume audio output to the sink
@@ -553,7 +562,8 @@ namespace {
         dec->setGain(adj_db);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void demodulate(vector<float> &audio,
+                      const vector<WbRxRtlSdr::Sample> &samples)
       {
           // From article-sdr-is-qs.pdf: Watch your Is and Qs:
           //   FM = (Qn.In-1 - In.Qn-1)/(In.In-1 + Qn.Qn-1)
@@ -561,7 +571,8 @@ namespace {
           // A more indepth report:
           //   Implementation of FM demodulator algorithms on a
           //   high performance digital signal processor
-        vector<float> audio;
+        vector<float> demod_audio;
+        demod_audio.reserve(samples.size());
         for (size_t idx=0; idx<samples.size(); ++idx)
         {
           complex<float> samp = samples[idx];
@@ -576,11 +587,9 @@ namespace {
           iold = i;
           qold = q;
 
-          audio.push_back(demod);
+          demod_audio.push_back(demod);
         }
-        vector<float> dec_audio;
-        dec->decimate(dec_audio, audio);
-        sinkWriteSamples(&dec_audio[0], dec_audio.size());
+        dec->decimate(audio, demod_audio);
       }
 
     private:
@@ -602,19 +611,20 @@ namespace {
         agc.setReference(1);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void demodulate(vector<float> &audio,
+                      const vector<WbRxRtlSdr::Sample> &samples)
       {
         vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
 
-        vector<float> audio;
+        audio.clear();
+        audio.reserve(gain_adjusted.size());
         for (size_t idx=0; idx<gain_adjusted.size(); ++idx)
         {
           complex<float> samp = gain_adjusted[idx];
           float demod = abs(samp);
           audio.push_back(demod);
         }
-        sinkWriteSamples(&audio[0], audio.size());
       }
 
     private:
@@ -639,9 +649,10 @@ namespace {
         use_lsb = use;
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void demodulate(vector<float> &audio,
+                      const vector<WbRxRtlSdr::Sample> &samples)
       {
-        vector<float> Q, Qh, audio;
+        vector<float> Q, Qh;
         Q.reserve(samples.size());
         for (vector<WbRxRtlSdr::Sample>::const_iterator it = samples.begin();
              it != samples.end();
@@ -651,6 +662,7 @@ namespace {
           Q.push_back(it->imag());
         }
         hilbert.decimate(Qh, Q);
+        audio.clear();
         audio.reserve(Qh.size());
         for (size_t idx=0; idx<Qh.size(); ++idx)
         {
@@ -666,7 +678,6 @@ namespace {
           audio.push_back(demod);
         }
         I.erase(I.begin(), I.begin() + Qh.size());
-        sinkWriteSamples(&audio[0], audio.size());
       }
 
     private:
@@ -690,7 +701,8 @@ namespace {
         trans.setOffset(lsb ? 2000 : -2000);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void demodulate(vector<float> &audio,
+                      const vector<WbRxRtlSdr::Sample> &samples)
       {
         vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
@@ -698,7 +710,7 @@ namespace {
         vector<WbRxRtlSdr::Sample> translated;
         trans.iq_received(translated, gain_adjusted);
 
-        vector<float> audio;
+        audio.clear();
         audio.reserve(gain_adjusted.size());
         for (vector<WbRxRtlSdr::Sample>::const_iterator it = translated.begin();
              it != translated.end();
@@ -707,7 +719,6 @@ namespace {
           float demod = it->real();
           audio.push_back(demod);
         }
-        sinkWriteSamples(&audio[0], audio.size());
       }
 
     private:
@@ -728,14 +739,15 @@ namespace {
         agc.setReference(0.05);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void demodulate(vector<float> &audio,
+                      const vector<WbRxRtlSdr::Sample> &samples)
       {
         vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
 
         vector<WbRxRtlSdr::Sample> translated;
         trans.iq_received(translated, gain_adjusted);
-        vector<float> audio;
+        audio.clear();
         audio.reserve(translated.size());
         for (vector<WbRxRtlSdr::Sample>::const_iterator it = translated.begin();
              it != translated.end();
@@ -744,7 +756,6 @@ namespace {
           float demod = it->real();
           audio.push_back(demod);
         }
-        sinkWriteSamples(&audio[0], audio.size());
       }
 
     private:
@@ -766,8 +777,6 @@ namespace {
       virtual unsigned chSampRate(void) const = 0;
       virtual void iq_received(vector<WbRxRtlSdr::Sample> &out,
                                const vector<WbRxRtlSdr::Sample> &in) = 0;
-
-      sigc::signal<void(const std::vector<RtlTcp::Sample>&)> preDemod;
   };
 
   class Channelizer960 : public Channelizer
@@ -846,7 +855,6 @@ namespace {
                                const vector<WbRxRtlSdr::Sample> &in)
       {
         dec->decimate(out, in);
-        preDemod(out);
       }
 
     private:
@@ -944,7 +952,6 @@ namespace {
                                const vector<WbRxRtlSdr::Sample> &in)
       {
         dec->decimate(out, in);
-        preDemod(out);
       }
 
     private:
@@ -970,7 +977,7 @@ class Ddr::Channel : public sigc::trackable, public Async::AudioSource
       : sample_rate(sample_rate), channelizer(0),
         fm_demod(32000, 5000.0), ssb_demod(16000), cw_demod(16000), demod(0),
         trans(sample_rate, fq_offset), enabled(true), ch_offset(0),
-        fq_offset(fq_offset)
+        fq_offset(fq_offset), processed(false)
     {
     }
 
@@ -996,7 +1003,6 @@ class Ddr::Channel : public sigc::trackable, public Async::AudioSource
         return false;
       }
       setModulation(Modulation::MOD_FM);
-      channelizer->preDemod.connect(preDemod.make_slot());
       return true;
     }
 
@@ -1076,16 +1082,26 @@ class Ddr::Channel : public sigc::trackable, public Async::AudioSource
       return channelizer->chSampRate();
     }
 
-    void iq_received(vector<WbRxRtlSdr::Sample> samples)
+    void processIq(const vector<WbRxRtlSdr::Sample> &samples)
     {
-      if (enabled)
+      processed = enabled;
+      if (processed)
       {
-        vector<WbRxRtlSdr::Sample> translated, channelized;
         trans.iq_received(translated, samples);
         channelizer->iq_received(channelized, translated);
-        demod->iq_received(channelized);
+        demod->demodulate(audio, channelized);
+      }
+    }
+
+    void deliverProcessedIq(void)
+    {
+      if (processed)
+      {
+        processed = false;
+        preDemod(channelized);
+        demod->writeAudio(audio);
       }
-    };
+    }
 
     void enable(void)
     {
@@ -1113,6 +1129,10 @@ class Ddr::Channel : public sigc::trackable, public Async::AudioSource
     bool enabled;
     int ch_offset;
     int fq_offset;
+    bool processed;
+    vector<WbRxRtlSdr::Sample> translated;
+    vector<WbRxRtlSdr::Sample> channelized;
+    vector<float> audio;
 }; /* Channel */
 
 
@@ -1228,7 +1248,6 @@ bool Ddr::initialize(void)
     return false;
   }
   channel->preDemod.connect(preDemod.make_slot());
-  rtl->iqReceived.connect(mem_fun(*channel, &Channel::iq_received));
   rtl->readyStateChanged.connect(readyStateChanged.make_slot());
 
   string modstr("FM");
@@ -1292,6 +1311,24 @@ void Ddr::setModulation(Modulation::Type mod)
 } /* Ddr::setModulation */
 
 
+void Ddr::processIq(const std::vector<RtlTcp::Sample> &samples)
+{
+  if (channel != 0)
+  {
+    channel->processIq(samples);
+  }
+} /* Ddr::processIq */
+
+
+void Ddr::deliverProcessedIq(void)
+{
+  if (channel != 0)
+  {
+    channel->deliverProcessedIq();
+  }
+} /* Ddr::deliverProcessedIq */
+
+
 
 /****************************************************************************
  *
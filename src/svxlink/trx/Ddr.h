@@ -175,6 +175,26 @@ class Ddr : public LocalRxBase
      */
     virtual void setModulation(Modulation::Type mod);
 
+    /**
+     * @brief   Run the channel signal processing on a block of I/Q samples
+     * @param   samples The wideband I/Q samples from the tuner
+     *
+     * This function run the frequency translation, channel filtering and
+     * demodulation for this DDR and store the result. It only touch state
+     * that belong to this DDR so it may be called from a worker thread, in
+     * parallel with other DDRs on the same tuner. The result is delivered by
+     * calling deliverProcessedIq from the main thread.
+     */
+    void processIq(const std::vector<RtlTcp::Sample>& samples);
+
+    /**
+     * @brief   Deliver the result of the last call to processIq
+     *
+     * This function emit the preDemod signal and write the demodulated
+     * audio to the audio pipe. It must be called from the main thread.
+     */
+    void deliverProcessedIq(void);
+
     /**
      * @brief   A signal that is emitted when new I/Q data is available
      * @param   samples The new samples that are available
@@ -60,6 +60,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioClipper.h>
 #include <AsyncAudioCompressor.h>
 #include <AsyncAudioFifo.h>
+#include <AsyncAudioLatencyProbe.h>
 #include <AsyncAudioStreamStateDetector.h>
 #include <AsyncAudioFsf.h>
 #include <AsyncUdpSocket.h>
@@ -295,10 +296,13 @@ bool LocalRxBase::initialize(void)
   prev_src = mute_valve;
 
     // Create a fifo buffer to handle large audio blocks
+  AudioLatencyProbe *audio_in_probe =
+      AudioLatencyProbe::insert(prev_src, name() + ":audio_in");
   input_fifo = new AudioFifo(1024);
 //  input_fifo->setOverwrite(true);
   prev_src->registerSink(input_fifo);
   prev_src = input_fifo;
+  AudioLatencyProbe::insert(prev_src, name() + ":input_fifo", audio_in_probe);
 
   SvxLink::SepPair<string, uint16_t> raw_audio_fwd_dest;
   if (cfg().getValue(name(), "RAW_AUDIO_UDP_DEST", raw_audio_fwd_dest))
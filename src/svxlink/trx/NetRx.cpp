@@ -47,6 +47,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <AsyncConfig.h>
 #include <AsyncAudioDecoder.h>
+#include <AsyncAudioPacketJitterBuffer.h>
 
 
 /****************************************************************************
@@ -135,7 +136,8 @@ NetRx::NetRx(Config &cfg, const string& name)
   : Rx(cfg, name), cfg(cfg), tcp_con(0),
     log_disconnects_once(false), log_disconnect(true),
     last_signal_strength(0.0), last_sql_rx_id(Rx::ID_UNKNOWN),
-    unflushed_samples(false), sql_is_open(false), audio_dec(0), fq(0),
+    unflushed_samples(false), sql_is_open(false), audio_dec(0),
+    jitter_buf(0), fq(0),
     modulation(Modulation::MOD_UNKNOWN)
 {
 } /* NetRx::NetRx */
@@ -144,6 +146,7 @@ NetRx::NetRx(Config &cfg, const string& name)
 NetRx::~NetRx(void)
 {
   clearHandler();
+  delete jitter_buf;
   delete audio_dec;
   
   tcp_con->deleteInstance();
@@ -175,9 +178,13 @@ bool NetRx::initialize(void)
   string tcp_port(NET_TRX_DEFAULT_TCP_PORT);
   cfg.getValue(name(), "TCP_PORT", tcp_port);
   
-  string udp_port(NET_TRX_DEFAULT_UDP_PORT);
+    // RemoteTrx listen for UDP audio on the same port number as for TCP
+  string udp_port(tcp_port);
   cfg.getValue(name(), "UDP_PORT", udp_port);
 
+  bool udp_audio = false;
+  cfg.getValue(name(), "UDP_AUDIO", udp_audio);
+
   cfg.getValue(name(), "LOG_DISCONNECTS_ONCE", log_disconnects_once);
   
   string audio_dec_name;
@@ -214,7 +221,19 @@ bool NetRx::initialize(void)
     }
   }
   audio_dec->printCodecParams();
-  setHandler(audio_dec);
+  if (udp_audio)
+  {
+      // Audio received over UDP may be reordered or lost so a jitter buffer
+      // is put after the decoder to sort that out
+    jitter_buf = new AudioPacketJitterBuffer;
+    jitter_buf->setDecoder(audio_dec);
+    audio_dec->registerSink(jitter_buf);
+    setHandler(jitter_buf);
+  }
+  else
+  {
+    setHandler(audio_dec);
+  }
   
   tcp_con = NetTrxTcpClient::instance(host, atoi(tcp_port.c_str()));
   if (tcp_con == 0)
@@ -224,6 +243,14 @@ bool NetRx::initialize(void)
   tcp_con->setAuthKey(auth_key);
   tcp_con->isReady.connect(mem_fun(*this, &NetRx::connectionReady));
   tcp_con->msgReceived.connect(mem_fun(*this, &NetRx::handleMsg));
+  tcp_con->udpAudioReceived.connect(
+      mem_fun(*this, &NetRx::udpAudioReceived));
+  tcp_con->udpSequenceSkipped.connect(
+      mem_fun(*this, &NetRx::udpSequenceSkipped));
+  if (udp_audio)
+  {
+    tcp_con->enableUdpAudio(atoi(udp_port.c_str()));
+  }
   tcp_con->connect();
 
   squelchOpen.connect(
@@ -249,7 +276,7 @@ void NetRx::setMuteState(Rx::MuteState new_mute_state)
         case MUTE_CONTENT:  // MUTE_NONE -> MUTE_CONTENT
           if (unflushed_samples)
           {
-            audio_dec->flushEncodedSamples();
+            flushReceivedAudio();
           }
           break;
 
@@ -313,7 +340,7 @@ void NetRx::reset(void)
   if (unflushed_samples)
   {
     last_sql_activity_info = "MUTED";
-    audio_dec->flushEncodedSamples();
+    flushReceivedAudio();
   }
   else
   {
@@ -430,7 +457,7 @@ void NetRx::connectionReady(bool is_ready)
     if (unflushed_samples)
     {
       last_sql_activity_info = "DISCONNECTED";
-      audio_dec->flushEncodedSamples();
+      flushReceivedAudio();
     }
     else
     {
@@ -461,7 +488,7 @@ void NetRx::handleMsg(Msg *msg)
         {
           if (unflushed_samples)
           {
-            audio_dec->flushEncodedSamples();
+            flushReceivedAudio();
           }
           else
           {
@@ -574,6 +601,47 @@ void NetRx::publishSquelchState(void)
 } /* NetRx::publishSquelchState */
 
 
+void NetRx::udpAudioReceived(uint32_t seq, const void *buf, int size)
+{
+  if ((muteState() != Rx::MUTE_NONE) || !sql_is_open)
+  {
+    return;
+  }
+
+  unflushed_samples = true;
+  if (jitter_buf != 0)
+  {
+    jitter_buf->writeEncodedSamples(seq, buf, size);
+  }
+  else
+  {
+    audio_dec->writeEncodedSamples(const_cast<void*>(buf), size);
+  }
+} /* NetRx::udpAudioReceived */
+
+
+void NetRx::udpSequenceSkipped(uint32_t seq)
+{
+  if (jitter_buf != 0)
+  {
+    jitter_buf->skipSequenceNumber(seq);
+  }
+} /* NetRx::udpSequenceSkipped */
+
+
+void NetRx::flushReceivedAudio(void)
+{
+  if (jitter_buf != 0)
+  {
+    jitter_buf->flushEncodedSamples();
+  }
+  else
+  {
+    audio_dec->flushEncodedSamples();
+  }
+} /* NetRx::flushReceivedAudio */
+
+
 
 /*
  * This file has not been truncated
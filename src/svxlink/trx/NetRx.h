@@ -73,6 +73,7 @@ namespace NetTrxMsg
 namespace Async
 {
   class AudioDecoder;
+  class AudioPacketJitterBuffer;
 };
 
 /****************************************************************************
@@ -212,6 +213,7 @@ class NetRx : public Rx
     bool      	      	unflushed_samples;
     bool      	      	sql_is_open;
     Async::AudioDecoder *audio_dec;
+    Async::AudioPacketJitterBuffer *jitter_buf;
     unsigned            fq;
     Modulation::Type    modulation;
     std::string         last_sql_activity_info;
@@ -221,6 +223,9 @@ class NetRx : public Rx
     void sendMsg(NetTrxMsg::Msg *msg);
     void allEncodedSamplesFlushed(void);
     void publishSquelchState(void);
+    void udpAudioReceived(uint32_t seq, const void *buf, int size);
+    void udpSequenceSkipped(uint32_t seq);
+    void flushReceivedAudio(void);
 
 };  /* class NetRx */
 
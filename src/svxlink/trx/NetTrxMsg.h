@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <cassert>
 #include <cstring>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <utility>
@@ -123,6 +124,11 @@ namespace NetTrxMsg
 class Msg
 {
   public:
+    /**
+     * @brief   The maximum size of a message on the wire
+     */
+    static const unsigned MAX_SIZE = 4096;
+
     /**
      * @brief 	Constuctor
      * @param 	type The message type
@@ -421,6 +427,11 @@ class MsgAudio : public Msg
       return m_buf;
     }
     int size(void) const { return m_size; }
+    bool isValid(void) const
+    {
+      return (m_size >= 0) && (m_size <= BUFSIZE) &&
+             (Msg::size() == sizeof(MsgAudio) - (BUFSIZE - m_size));
+    }
   
   private:
     int     m_size;
@@ -429,6 +440,54 @@ class MsgAudio : public Msg
 }; /* MsgAudio */
 
 
+  /*
+   * Sent by the client to ask the remote end to set up a UDP channel for
+   * audio. A remote end that does not support UDP audio ignores the message
+   * and audio continue to be sent as MsgAudio over the TCP connection.
+   */
+class MsgUdpAudioSetup : public Msg
+{
+  public:
+    static const unsigned TYPE      = 103;
+    static const int      NONCE_LEN = 16;
+    static const int      SALT_LEN  = 4;
+    MsgUdpAudioSetup(void)
+      : Msg(TYPE, sizeof(MsgUdpAudioSetup))
+    {
+      gcry_randomize(m_nonce, NONCE_LEN, GCRY_STRONG_RANDOM);
+      gcry_create_nonce(m_salt, SALT_LEN);
+    }
+    const unsigned char *nonce(void) const { return m_nonce; }
+    const unsigned char *salt(void) const { return m_salt; }
+
+  private:
+    unsigned char m_nonce[NONCE_LEN];
+    unsigned char m_salt[SALT_LEN];
+
+}; /* MsgUdpAudioSetup */
+
+
+class MsgUdpAudioSetupAck : public Msg
+{
+  public:
+    static const unsigned TYPE      = 104;
+    static const int      SALT_LEN  = MsgUdpAudioSetup::SALT_LEN;
+    MsgUdpAudioSetupAck(void)
+      : Msg(TYPE, sizeof(MsgUdpAudioSetupAck))
+    {
+      gcry_create_nonce(&m_session_id, sizeof(m_session_id));
+      gcry_create_nonce(m_salt, SALT_LEN);
+    }
+    uint32_t sessionId(void) const { return m_session_id; }
+    const unsigned char *salt(void) const { return m_salt; }
+
+  private:
+    uint32_t      m_session_id;
+    unsigned char m_salt[SALT_LEN];
+
+}; /* MsgUdpAudioSetupAck */
+
+
 
 /******************************** RX Messages ********************************/
 
@@ -753,6 +812,64 @@ class MsgAllSamplesFlushed : public Msg
 #pragma pack(pop)
 
 
+/**
+ * @brief   Parse messages in place from a stream receive buffer
+ * @param   data    The received data
+ * @param   size    The number of bytes in the receive buffer
+ * @param   handler Called with a pointer to each complete message
+ * @return  Returns the number of bytes consumed or -1 on a framing error
+ *
+ * All complete messages in the buffer are handed to the handler without
+ * first being copied to a separate message buffer. A trailing partial
+ * message is not consumed so it will be presented again, with more data
+ * appended, the next time data is received on the connection. The data
+ * pointer should point at the receive buffer of an Async::TcpConnection
+ * which works exactly like that. A message that does not start on a four
+ * byte boundary is copied to an aligned buffer before being handed to the
+ * handler since the audio payload is read as 16 or 32 bit samples.
+ *
+ * The handler is called as handler(Msg *msg) and should return \em true to
+ * continue parsing. If \em false is returned, e.g. because the connection
+ * has been closed, parsing stops after that message.
+ *
+ * A framing error is returned if a message header indicates a size that is
+ * smaller than the header itself or larger than Msg::MAX_SIZE. The stream
+ * cannot be resynchronized after that so the connection should be closed.
+ */
+template <typename Handler>
+int parseMsgs(void *data, int size, Handler handler)
+{
+  char *buf = static_cast<char*>(data);
+  int pos = 0;
+  while (size - pos >= static_cast<int>(sizeof(Msg)))
+  {
+    Msg *msg = reinterpret_cast<Msg*>(buf + pos);
+    const unsigned msg_size = msg->size();
+    if ((msg_size < sizeof(Msg)) || (msg_size > Msg::MAX_SIZE))
+    {
+      return -1;
+    }
+    if (static_cast<unsigned>(size - pos) < msg_size)
+    {
+      break;
+    }
+    pos += msg_size;
+
+    uint32_t aligned_buf[Msg::MAX_SIZE / sizeof(uint32_t)];
+    if ((reinterpret_cast<uintptr_t>(msg) % sizeof(uint32_t)) != 0)
+    {
+      memcpy(aligned_buf, msg, msg_size);
+      msg = reinterpret_cast<Msg*>(aligned_buf);
+    }
+    if (!handler(msg))
+    {
+      break;
+    }
+  }
+  return pos;
+} /* parseMsgs */
+
+
 
 } /* namespace */
 
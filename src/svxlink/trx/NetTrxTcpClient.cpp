@@ -43,6 +43,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncTimer.h>
+#include <AsyncEncryptedUdpSocket.h>
 
 
 /****************************************************************************
@@ -52,6 +53,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include "NetTrxTcpClient.h"
+#include "NetTrxUdpChannel.h"
 
 
 
@@ -196,6 +198,55 @@ void NetTrxTcpClient::sendMsg(Msg *msg)
 } /* NetTrxTcpClient::sendMsg */
 
 
+void NetTrxTcpClient::enableUdpAudio(uint16_t udp_port)
+{
+  this->udp_port = udp_port;
+} /* NetTrxTcpClient::enableUdpAudio */
+
+
+bool NetTrxTcpClient::udpAudioIsActive(void) const
+{
+  return (udp_chan != 0) && udp_chan->isActive();
+} /* NetTrxTcpClient::udpAudioIsActive */
+
+
+void NetTrxTcpClient::sendAudio(const void *buf, int size)
+{
+  if (udpAudioIsActive() && udp_chan->sendAudio(buf, size))
+  {
+    return;
+  }
+
+  const char *ptr = reinterpret_cast<const char *>(buf);
+  while (size > 0)
+  {
+    const int bufsize = MsgAudio::BUFSIZE;
+    int len = min(size, bufsize);
+    if (state != STATE_READY)
+    {
+      return;
+    }
+    MsgAudio msg(ptr, len);
+    writeMsgP(&msg);
+    size -= len;
+    ptr += len;
+  }
+} /* NetTrxTcpClient::sendAudio */
+
+
+void NetTrxTcpClient::sendAudioFlush(void)
+{
+  if (udpAudioIsActive())
+  {
+    udp_chan->sendFlush();
+  }
+  else
+  {
+    sendMsg(new MsgFlush);
+  }
+} /* NetTrxTcpClient::sendAudioFlush */
+
+
 void NetTrxTcpClient::connect(void)
 {
   if (isIdle())
@@ -213,9 +264,10 @@ void NetTrxTcpClient::connect(void)
 
 NetTrxTcpClient::NetTrxTcpClient(const std::string& remote_host,
       	      	      	      	 uint16_t remote_port, size_t recv_buf_len)
-  : TcpClient<>(remote_host, remote_port, recv_buf_len), recv_cnt(0),
-    recv_exp(0), reconnect_timer(0), last_msg_timestamp(), heartbeat_timer(0),
-    user_cnt(0), state(STATE_DISC), disc_reason(DR_SYSTEM_ERROR)
+  : TcpClient<>(remote_host, remote_port, recv_buf_len),
+    reconnect_timer(0), last_msg_timestamp(), heartbeat_timer(0),
+    user_cnt(0), state(STATE_DISC), disc_reason(DR_SYSTEM_ERROR),
+    udp_port(0), udp_sock(0), udp_chan(0), udp_rx_seq(0)
 {
   connected.connect(mem_fun(*this, &NetTrxTcpClient::tcpConnected));
   disconnected.connect(mem_fun(*this, &NetTrxTcpClient::tcpDisconnected));
@@ -234,6 +286,7 @@ NetTrxTcpClient::NetTrxTcpClient(const std::string& remote_host,
 
 NetTrxTcpClient::~NetTrxTcpClient(void)
 {
+  deleteUdpAudio();
   delete reconnect_timer;
   delete heartbeat_timer;
 } /* NetTrxTcpClient::~NetTrxTcpClient */
@@ -250,8 +303,6 @@ NetTrxTcpClient::~NetTrxTcpClient(void)
 
 void NetTrxTcpClient::tcpConnected(void)
 {
-  recv_cnt = 0;
-  recv_exp = sizeof(Msg);
   gettimeofday(&last_msg_timestamp, NULL);
   heartbeat_timer->setEnable(true);
   state = STATE_VER_WAIT;
@@ -262,10 +313,10 @@ void NetTrxTcpClient::tcpDisconnected(TcpConnection *con,
       	      	      	    TcpConnection::DisconnectReason reason)
 {
   disc_reason = reason;
-  recv_exp = 0;
   state = STATE_DISC;
   reconnect_timer->setEnable(true);
   heartbeat_timer->setEnable(false);
+  deleteUdpAudio();
   isReady(false);
 } /* NetTrxTcpClient::tcpDisconnected */
 
@@ -273,66 +324,28 @@ void NetTrxTcpClient::tcpDisconnected(TcpConnection *con,
 int NetTrxTcpClient::tcpDataReceived(TcpConnection *con, void *data, int size)
 {
   //cout << "NetTrxTcpClient::tcpDataReceived: size=" << size << endl;
-  
-  //Msg *msg = reinterpret_cast<Msg*>(data);
-  //cout << "Received a TCP message with type " << msg->type()
-  //     << " and size " << msg->size() << endl;
-  
-  int orig_size = size;
-  
-  char *buf = static_cast<char*>(data);
-  while (size > 0)
-  {
-    unsigned read_cnt = min(static_cast<unsigned>(size), recv_exp-recv_cnt);
-    if (recv_cnt+read_cnt > sizeof(recv_buf))
-    {
-      cerr << "*** ERROR: TCP receive buffer overflow. Disconnecting from "
-           << remoteHost().toString() << ":" << remotePort() << "...\n";
-      con->disconnect();
-      disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
-      return orig_size;
-    }
-    memcpy(recv_buf+recv_cnt, buf, read_cnt);
-    size -= read_cnt;
-    recv_cnt += read_cnt;
-    buf += read_cnt;
-    
-    if (recv_cnt == recv_exp)
-    {
-      if (recv_exp == sizeof(Msg))
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	if (msg->size() == sizeof(Msg))
-	{
-	  handleMsg(msg);
-	  recv_cnt = 0;
-	  recv_exp = sizeof(Msg);
-	}
-	else if (msg->size() > sizeof(Msg))
-	{
-      	  recv_exp = msg->size();
-	}
-	else
-	{
-	  cerr << "*** ERROR: Illegal message header received. Header length "
-	       << "too small (" << msg->size() << "). Disconnecting from "
-               << remoteHost().toString() << ":" << remotePort() << "...\n";
-	  con->disconnect();
-	  disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
-	  return orig_size;
-	}
-      }
-      else
+
+    // Messages are handled directly in the receive buffer of the connection.
+    // A partial message is left in the buffer until the rest of it arrives.
+  int processed = parseMsgs(data, size,
+      [this](Msg *msg)
       {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	handleMsg(msg);
-	recv_cnt = 0;
-	recv_exp = sizeof(Msg);
-      }
-    }
+        handleMsg(msg);
+        return state != STATE_DISC;
+      });
+  if (processed < 0)
+  {
+    cerr << "*** ERROR: Illegal message header received. Disconnecting from "
+         << remoteHost().toString() << ":" << remotePort() << "...\n";
+    con->disconnect();
+    disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
+    return size;
   }
-  
-  return orig_size;
+  if (state == STATE_DISC)
+  {
+    return size;
+  }
+  return processed;
   
 } /* NetTrxTcpClient::tcpDataReceived */
 
@@ -406,6 +419,7 @@ void NetTrxTcpClient::handleMsg(Msg *msg)
           return;
         }
         state = STATE_READY;
+        setupUdpAudio();
         isReady(true);
       }
       return;
@@ -422,6 +436,34 @@ void NetTrxTcpClient::handleMsg(Msg *msg)
     {
       break;
     }
+
+    case MsgUdpAudioSetupAck::TYPE:
+    {
+      if (msg->size() != sizeof(MsgUdpAudioSetupAck))
+      {
+        cerr << "*** ERROR: Protocol error. Wrong length of "
+                "MsgUdpAudioSetupAck message. Disconnecting from "
+             << remoteHost().toString() << ":" << remotePort() << "...\n";
+        localDisconnect();
+        return;
+      }
+      handleUdpAudioSetupAck(reinterpret_cast<MsgUdpAudioSetupAck*>(msg));
+      break;
+    }
+
+    case MsgAudio::TYPE:
+    {
+      if (!reinterpret_cast<MsgAudio*>(msg)->isValid())
+      {
+        cerr << "*** ERROR: Protocol error. Malformed MsgAudio message. "
+                "Disconnecting from "
+             << remoteHost().toString() << ":" << remotePort() << "...\n";
+        localDisconnect();
+        return;
+      }
+      msgReceived(msg);
+      break;
+    }
     
     case MsgProtoVer::TYPE:
     case MsgAuthChallenge::TYPE:
@@ -472,6 +514,13 @@ void NetTrxTcpClient::localDisconnect(void)
 
 
 void NetTrxTcpClient::sendMsgP(Msg *msg)
+{
+  writeMsgP(msg);
+  delete msg;
+} /* NetTrxTcpClient::sendMsgP */
+
+
+void NetTrxTcpClient::writeMsgP(const Msg *msg)
 {
   assert(isConnected());
 
@@ -490,10 +539,100 @@ void NetTrxTcpClient::sendMsgP(Msg *msg)
     disconnect();
     disconnected(this, TcpConnection::DR_ORDERED_DISCONNECT);
   }
-  
-  delete msg;
-  
-} /* NetTrxTcpClient::sendMsgP */
+} /* NetTrxTcpClient::writeMsgP */
+
+
+void NetTrxTcpClient::setupUdpAudio(void)
+{
+  deleteUdpAudio();
+  if (udp_port == 0)
+  {
+    return;
+  }
+
+  udp_sock = new EncryptedUdpSocket;
+  if (!NetTrxUdpChannel::setupSocket(udp_sock))
+  {
+    cerr << "*** WARNING: Could not set up UDP socket for audio to "
+         << remoteHost().toString() << ":" << udp_port
+         << ". Using TCP for audio.\n";
+    delete udp_sock;
+    udp_sock = 0;
+    return;
+  }
+  udp_sock->cipherDataReceived.connect(
+      mem_fun(*this, &NetTrxTcpClient::udpCipherDataReceived));
+  udp_sock->dataReceived.connect(
+      mem_fun(*this, &NetTrxTcpClient::udpDatagramReceived));
+
+  MsgUdpAudioSetup *msg = new MsgUdpAudioSetup;
+  memcpy(udp_nonce, msg->nonce(), MsgUdpAudioSetup::NONCE_LEN);
+  memcpy(udp_tx_salt, msg->salt(), MsgUdpAudioSetup::SALT_LEN);
+  sendMsgP(msg);
+} /* NetTrxTcpClient::setupUdpAudio */
+
+
+void NetTrxTcpClient::handleUdpAudioSetupAck(MsgUdpAudioSetupAck *msg)
+{
+  if ((udp_sock == 0) || (udp_chan != 0))
+  {
+    return;
+  }
+
+  udp_chan = new NetTrxUdpChannel(udp_sock, auth_key, udp_nonce,
+                                  MsgUdpAudioSetup::NONCE_LEN, udp_tx_salt,
+                                  msg->salt(), msg->sessionId());
+  if (!udp_chan->initOk())
+  {
+    delete udp_chan;
+    udp_chan = 0;
+    return;
+  }
+  udp_chan->audioReceived.connect(udpAudioReceived.make_slot());
+  udp_chan->sequenceSkipped.connect(udpSequenceSkipped.make_slot());
+  udp_chan->activeStateChanged.connect(
+      [this](bool is_active)
+      {
+        cout << remoteHost().toString() << ":" << remotePort()
+             << ": Audio is now sent over "
+             << (is_active ? "UDP" : "TCP") << endl;
+      });
+  udp_chan->setRemoteAddr(remoteHost(), udp_port);
+} /* NetTrxTcpClient::handleUdpAudioSetupAck */
+
+
+void NetTrxTcpClient::deleteUdpAudio(void)
+{
+  delete udp_chan;
+  udp_chan = 0;
+  delete udp_sock;
+  udp_sock = 0;
+} /* NetTrxTcpClient::deleteUdpAudio */
+
+
+bool NetTrxTcpClient::udpCipherDataReceived(const IpAddress& ip,
+                                            uint16_t port, void *buf,
+                                            int count)
+{
+  uint32_t session_id = 0;
+  if ((udp_chan == 0) ||
+      !NetTrxUdpChannel::parseAad(buf, count, session_id, udp_rx_seq) ||
+      (session_id != udp_chan->sessionId()))
+  {
+    return true;
+  }
+  return !udp_chan->prepareDecrypt(udp_rx_seq);
+} /* NetTrxTcpClient::udpCipherDataReceived */
+
+
+void NetTrxTcpClient::udpDatagramReceived(const IpAddress& ip, uint16_t port,
+                                          void *aad, void *buf, int count)
+{
+  if (udp_chan != 0)
+  {
+    udp_chan->handleDatagram(ip, port, udp_rx_seq, buf, count);
+  }
+} /* NetTrxTcpClient::udpDatagramReceived */
 
 
 
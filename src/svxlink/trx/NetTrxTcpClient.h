@@ -69,8 +69,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 namespace Async
 {
   class Timer;
+  class EncryptedUdpSocket;
 };
 
+class NetTrxUdpChannel;
+
 
 /****************************************************************************
  *
@@ -152,6 +155,41 @@ class NetTrxTcpClient : public Async::TcpClient<>
      * @param msg The message to send
      */
     void sendMsg(NetTrxMsg::Msg *msg);
+
+    /**
+     * @brief Enable transport of audio over UDP
+     * @param udp_port The UDP port on the remote host
+     *
+     * When enabled, a UDP audio channel will be negotiated with the remote
+     * host each time the TCP connection has been set up. If the remote host
+     * does not support UDP audio, or if no UDP traffic is received, audio
+     * will be sent over the TCP connection as before.
+     */
+    void enableUdpAudio(uint16_t udp_port);
+
+    /**
+     * @brief Check if audio is currently sent over UDP
+     * @return Returns \em true if the UDP audio channel is working
+     */
+    bool udpAudioIsActive(void) const;
+
+    /**
+     * @brief Send encoded audio to the remote host
+     * @param buf   The encoded audio
+     * @param size  The size of the encoded audio
+     *
+     * The audio is sent over the UDP audio channel if it is active or else
+     * over the TCP connection.
+     */
+    void sendAudio(const void *buf, int size);
+
+    /**
+     * @brief Tell the remote host that all audio has been sent
+     *
+     * The flush is sent the same way as the audio so that it cannot
+     * overtake the last audio packets.
+     */
+    void sendAudioFlush(void);
     
     /**
      * @brief Get the reason for the last disconnect
@@ -181,6 +219,21 @@ class NetTrxTcpClient : public Async::TcpClient<>
      */
     sigc::signal<void(NetTrxMsg::Msg*)> msgReceived;
 
+    /**
+     * @brief A signal that is emitted when audio has been received over UDP
+     * @param seq   The sequence number of the datagram
+     * @param buf   The encoded audio
+     * @param size  The size of the encoded audio
+     */
+    sigc::signal<void(uint32_t, const void*, int)> udpAudioReceived;
+
+    /**
+     * @brief A signal that is emitted when a sequence number has been used
+     *        for something else than audio on the UDP channel
+     * @param seq   The sequence number
+     */
+    sigc::signal<void(uint32_t)> udpSequenceSkipped;
+
   protected:
     /**
      * @brief   Constructor
@@ -212,9 +265,6 @@ class NetTrxTcpClient : public Async::TcpClient<>
     static const int RECV_BUF_SIZE = 4096;
     static Clients clients;
 
-    char      	    recv_buf[RECV_BUF_SIZE];
-    unsigned        recv_cnt;
-    unsigned        recv_exp;
     Async::Timer    *reconnect_timer;
     struct timeval  last_msg_timestamp;
     Async::Timer    *heartbeat_timer;
@@ -222,6 +272,12 @@ class NetTrxTcpClient : public Async::TcpClient<>
     std::string     auth_key;
     State           state;
     DiscReason      disc_reason;
+    uint16_t        udp_port;
+    Async::EncryptedUdpSocket *udp_sock;
+    NetTrxUdpChannel *udp_chan;
+    uint32_t        udp_rx_seq;
+    unsigned char   udp_nonce[NetTrxMsg::MsgUdpAudioSetup::NONCE_LEN];
+    unsigned char   udp_tx_salt[NetTrxMsg::MsgUdpAudioSetup::SALT_LEN];
     
     NetTrxTcpClient(const NetTrxTcpClient&);
     using TcpClientBase::operator=;
@@ -236,6 +292,14 @@ class NetTrxTcpClient : public Async::TcpClient<>
     void heartbeat(Async::Timer *t);
     void localDisconnect(void);
     void sendMsgP(NetTrxMsg::Msg *msg);
+    void writeMsgP(const NetTrxMsg::Msg *msg);
+    void setupUdpAudio(void);
+    void handleUdpAudioSetupAck(NetTrxMsg::MsgUdpAudioSetupAck *msg);
+    void deleteUdpAudio(void);
+    bool udpCipherDataReceived(const Async::IpAddress& ip, uint16_t port,
+                               void *buf, int count);
+    void udpDatagramReceived(const Async::IpAddress& ip, uint16_t port,
+                             void *aad, void *buf, int count);
 
 };  /* class NetTrxTcpClient */
 
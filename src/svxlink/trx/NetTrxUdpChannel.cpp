@@ -0,0 +1,404 @@
+/**
+@file	 NetTrxUdpChannel.cpp
+@brief   A UDP audio channel for remote transceivers
+@author  Tobias Blomberg / SM0SVX
+@date	 2025-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <gcrypt.h>
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <iostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncEncryptedUdpSocket.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "NetTrxUdpChannel.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+#define CIPHER_NAME   "AES-128-GCM"
+#define KEY_LEN       16
+#define REPLAY_WINDOW 64
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+bool NetTrxUdpChannel::setupSocket(EncryptedUdpSocket *sock)
+{
+  if (!sock->initOk() || !sock->setCipher(CIPHER_NAME))
+  {
+    return false;
+  }
+  sock->setCipherAADLength(AADLEN);
+  sock->setTagLength(TAGLEN);
+  return true;
+} /* NetTrxUdpChannel::setupSocket */
+
+
+bool NetTrxUdpChannel::parseAad(const void *buf, int count,
+                                uint32_t &session_id, uint32_t &seq)
+{
+  if (count < static_cast<int>(AADLEN + TAGLEN + 1))
+  {
+    return false;
+  }
+  uint32_t val;
+  const char *ptr = static_cast<const char*>(buf);
+  memcpy(&val, ptr, sizeof(val));
+  session_id = ntohl(val);
+  memcpy(&val, ptr + sizeof(val), sizeof(val));
+  seq = ntohl(val);
+  return true;
+} /* NetTrxUdpChannel::parseAad */
+
+
+NetTrxUdpChannel::NetTrxUdpChannel(EncryptedUdpSocket *sock,
+                                   const std::string &auth_key,
+                                   const unsigned char *nonce,
+                                   size_t nonce_len,
+                                   const unsigned char *tx_salt,
+                                   const unsigned char *rx_salt,
+                                   uint32_t session_id)
+  : sock(sock), session_id(session_id), tx_seq(0), max_rx_seq(0),
+    rx_seq_window(0), rx_seq_valid(false), remote_port(0), is_active(false),
+    rx_audio_since_flush(false), last_rx_timestamp(),
+    heartbeat_timer(HEARTBEAT_INTERVAL, Timer::TYPE_PERIODIC, false)
+{
+  memcpy(this->tx_salt, tx_salt, SALT_LEN);
+  memcpy(this->rx_salt, rx_salt, SALT_LEN);
+
+    // The key is derived from the authentication key and the nonce so that
+    // only the two ends of the authenticated TCP connection know it. If no
+    // authentication key is used, the nonce is used as the key. The audio is
+    // then only protected against corruption and not against eavesdropping.
+  if (auth_key.empty())
+  {
+    key.assign(nonce, nonce + min(nonce_len, static_cast<size_t>(KEY_LEN)));
+    key.resize(KEY_LEN, 0);
+  }
+  else
+  {
+    gcry_md_hd_t hd = { 0 };
+    gcry_error_t err = gcry_md_open(&hd, GCRY_MD_SHA256, GCRY_MD_FLAG_HMAC);
+    if (!err)
+    {
+      err = gcry_md_setkey(hd, auth_key.data(), auth_key.size());
+    }
+    if (!err)
+    {
+      gcry_md_write(hd, nonce, nonce_len);
+      const unsigned char *digest = gcry_md_read(hd, 0);
+      key.assign(digest, digest + KEY_LEN);
+    }
+    else
+    {
+      cerr << "*** ERROR: gcrypt error: "
+           << gcry_strsource(err) << "/" << gcry_strerror(err) << endl;
+    }
+    gcry_md_close(hd);
+  }
+
+  heartbeat_timer.expired.connect(
+      mem_fun(*this, &NetTrxUdpChannel::heartbeat));
+} /* NetTrxUdpChannel::NetTrxUdpChannel */
+
+
+NetTrxUdpChannel::~NetTrxUdpChannel(void)
+{
+} /* NetTrxUdpChannel::~NetTrxUdpChannel */
+
+
+void NetTrxUdpChannel::setRemoteAddr(const IpAddress &ip, uint16_t port)
+{
+  bool was_unknown = (remote_port == 0);
+  remote_ip = ip;
+  remote_port = port;
+  if (was_unknown)
+  {
+    heartbeat_timer.setEnable(true);
+    sendDatagram(TYPE_HEARTBEAT, 0, 0);
+  }
+} /* NetTrxUdpChannel::setRemoteAddr */
+
+
+bool NetTrxUdpChannel::sendAudio(const void *buf, int size)
+{
+  if ((size <= 0) || (size > static_cast<int>(MAX_PAYLOAD)))
+  {
+    return false;
+  }
+  return sendDatagram(TYPE_AUDIO, buf, size);
+} /* NetTrxUdpChannel::sendAudio */
+
+
+void NetTrxUdpChannel::sendFlush(void)
+{
+  for (int i=0; i<FLUSH_REPEAT; ++i)
+  {
+    sendDatagram(TYPE_FLUSH, 0, 0);
+  }
+} /* NetTrxUdpChannel::sendFlush */
+
+
+bool NetTrxUdpChannel::prepareDecrypt(uint32_t seq)
+{
+  if (!initOk())
+  {
+    return false;
+  }
+  return sock->setCipherKey(key) && sock->setCipherIV(makeIv(rx_salt, seq));
+} /* NetTrxUdpChannel::prepareDecrypt */
+
+
+void NetTrxUdpChannel::handleDatagram(const IpAddress &ip, uint16_t port,
+                                      uint32_t seq, const void *buf,
+                                      int count)
+{
+  if (count < 1)
+  {
+    return;
+  }
+
+    // Drop datagrams that are too old to be of any use. Datagrams within
+    // the replay window are dropped if they have already been received.
+    // Together this protect against replay of previously captured datagrams.
+  if (rx_seq_valid && (seq + REPLAY_WINDOW <= max_rx_seq))
+  {
+    return;
+  }
+  if (rx_seq_valid && (seq <= max_rx_seq))
+  {
+    const uint64_t mask = uint64_t(1) << (max_rx_seq - seq);
+    if ((rx_seq_window & mask) != 0)
+    {
+      return;
+    }
+    rx_seq_window |= mask;
+  }
+
+    // The address of the remote end is only updated by datagrams that are
+    // newer than any seen before so that a replayed datagram cannot redirect
+    // the audio stream.
+  if (!rx_seq_valid || (seq > max_rx_seq))
+  {
+    const uint32_t shift = seq - max_rx_seq;
+    rx_seq_window = (rx_seq_valid && (shift < REPLAY_WINDOW))
+      ? ((rx_seq_window << shift) | 1) : 1;
+    max_rx_seq = seq;
+    rx_seq_valid = true;
+    if ((ip != remote_ip) || (port != remote_port))
+    {
+      setRemoteAddr(ip, port);
+    }
+  }
+
+  gettimeofday(&last_rx_timestamp, NULL);
+  setActive(true);
+
+  const unsigned char *ptr = static_cast<const unsigned char*>(buf);
+  switch (ptr[0])
+  {
+    case TYPE_AUDIO:
+      rx_audio_since_flush = true;
+      audioReceived(seq, ptr + 1, count - 1);
+      break;
+
+    case TYPE_FLUSH:
+      sequenceSkipped(seq);
+      if (rx_audio_since_flush)
+      {
+        rx_audio_since_flush = false;
+        flushReceived();
+      }
+      break;
+
+    case TYPE_HEARTBEAT:
+    default:
+      sequenceSkipped(seq);
+      break;
+  }
+} /* NetTrxUdpChannel::handleDatagram */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+std::vector<uint8_t> NetTrxUdpChannel::makeIv(const unsigned char *salt,
+                                              uint32_t seq) const
+{
+  std::vector<uint8_t> iv(salt, salt + SALT_LEN);
+  uint32_t val = htonl(session_id);
+  const uint8_t *ptr = reinterpret_cast<const uint8_t*>(&val);
+  iv.insert(iv.end(), ptr, ptr + sizeof(val));
+  val = htonl(seq);
+  iv.insert(iv.end(), ptr, ptr + sizeof(val));
+  return iv;
+} /* NetTrxUdpChannel::makeIv */
+
+
+bool NetTrxUdpChannel::sendDatagram(DatagramType type, const void *buf,
+                                    int size)
+{
+  if (!initOk() || (remote_port == 0))
+  {
+    return false;
+  }
+
+  uint32_t seq = ++tx_seq;
+  uint32_t aad[2] = { htonl(session_id), htonl(seq) };
+  unsigned char payload[1 + MAX_PAYLOAD];
+  payload[0] = type;
+  if (size > 0)
+  {
+    memcpy(payload + 1, buf, size);
+  }
+
+  if (!sock->setCipherKey(key) || !sock->setCipherIV(makeIv(tx_salt, seq)))
+  {
+    return false;
+  }
+  return sock->write(remote_ip, remote_port, aad, sizeof(aad),
+                     payload, size + 1);
+} /* NetTrxUdpChannel::sendDatagram */
+
+
+void NetTrxUdpChannel::heartbeat(Timer *t)
+{
+  sendDatagram(TYPE_HEARTBEAT, 0, 0);
+
+  if (is_active)
+  {
+    struct timeval now, diff_tv;
+    gettimeofday(&now, NULL);
+    timersub(&now, &last_rx_timestamp, &diff_tv);
+    int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
+    if (diff_ms > RX_TIMEOUT)
+    {
+      setActive(false);
+    }
+  }
+} /* NetTrxUdpChannel::heartbeat */
+
+
+void NetTrxUdpChannel::setActive(bool active)
+{
+  if (active != is_active)
+  {
+    is_active = active;
+    activeStateChanged(is_active);
+  }
+} /* NetTrxUdpChannel::setActive */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,332 @@
+/**
+@file	 NetTrxUdpChannel.h
+@brief   A UDP audio channel for remote transceivers
+@author  Tobias Blomberg / SM0SVX
+@date	 2025-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef NET_TRX_UDP_CHANNEL_INCLUDED
+#define NET_TRX_UDP_CHANNEL_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncIpAddress.h>
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+  class EncryptedUdpSocket;
+};
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A UDP audio channel for remote transceivers
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class implement one end of a UDP channel used to carry audio between a
+remote transceiver and its client, in parallel with the TCP connection. The
+channel is negotiated over the TCP connection using the MsgUdpAudioSetup and
+MsgUdpAudioSetupAck messages. Both ends then create a channel object using
+the nonce, salts and session id from those messages.
+
+All datagrams are encrypted and authenticated using AES-128-GCM. The session
+id and a sequence number are sent in the clear as associated data. The key
+is derived from the authentication key and the nonce so if an authentication
+key is used, the audio cannot be read by anyone else. Each end use its own
+salt in the IV so the two directions never use the same IV.
+
+The socket is owned by the user of this class, since the remote transceiver
+server may share one socket between many channels. The owner must connect
+the signals of the socket, use the parseAad function to find the channel
+that a datagram belong to and then call prepareDecrypt and handleDatagram.
+
+The channel is considered active when a valid datagram has been received
+within the last few seconds. Heartbeats are sent once per second to keep
+NAT mappings open and to detect when the channel stop working. The user of
+the class should send audio over TCP when the channel is not active.
+*/
+class NetTrxUdpChannel : public sigc::trackable
+{
+  public:
+    static const size_t AADLEN      = 8;
+    static const size_t TAGLEN      = 8;
+    static const size_t SALT_LEN    = 4;
+    static const size_t MAX_PAYLOAD = 4096;
+
+    /**
+     * @brief   Set up the cipher parameters for a socket
+     * @param   sock The socket to set up
+     * @return  Returns \em true on success or \em false on failure
+     */
+    static bool setupSocket(Async::EncryptedUdpSocket *sock);
+
+    /**
+     * @brief   Unpack the associated data of a received datagram
+     * @param   buf         The received datagram
+     * @param   count       The size of the datagram
+     * @param   session_id  Returns the session id
+     * @param   seq         Returns the sequence number
+     * @return  Returns \em true on success or \em false if the datagram is
+     *          too short to be valid
+     */
+    static bool parseAad(const void *buf, int count, uint32_t &session_id,
+                         uint32_t &seq);
+
+    /**
+     * @brief 	Constuctor
+     * @param 	sock        The socket to use
+     * @param   auth_key    The authentication key for the TCP connection
+     * @param   nonce       The nonce from MsgUdpAudioSetup
+     * @param   nonce_len   The length of the nonce
+     * @param   tx_salt     The salt used by this end
+     * @param   rx_salt     The salt used by the remote end
+     * @param   session_id  The session id from MsgUdpAudioSetupAck
+     */
+    NetTrxUdpChannel(Async::EncryptedUdpSocket *sock,
+                     const std::string &auth_key,
+                     const unsigned char *nonce, size_t nonce_len,
+                     const unsigned char *tx_salt,
+                     const unsigned char *rx_salt, uint32_t session_id);
+  
+    /**
+     * @brief 	Destructor
+     */
+    ~NetTrxUdpChannel(void);
+
+    /**
+     * @brief   Check if the key was successfully set up
+     * @return  Returns \em true if the channel can be used
+     */
+    bool initOk(void) const { return !key.empty(); }
+
+    /**
+     * @brief   Get the session id
+     */
+    uint32_t sessionId(void) const { return session_id; }
+
+    /**
+     * @brief   Set the address of the remote end
+     * @param   ip    The IP address of the remote end
+     * @param   port  The UDP port of the remote end
+     *
+     * If the address of the remote end is not known, it will be learned
+     * from the first valid datagram received. Heartbeats are not sent until
+     * the address is known.
+     */
+    void setRemoteAddr(const Async::IpAddress &ip, uint16_t port);
+
+    /**
+     * @brief   Check if the channel is working
+     * @return  Returns \em true if a valid datagram has been received lately
+     */
+    bool isActive(void) const { return is_active; }
+
+    /**
+     * @brief   Send a block of encoded audio
+     * @param   buf   The encoded audio
+     * @param   size  The size of the encoded audio, max MAX_PAYLOAD bytes
+     * @return  Returns \em true on success or \em false on failure
+     */
+    bool sendAudio(const void *buf, int size);
+
+    /**
+     * @brief   Tell the remote end that a talk spurt has ended
+     *
+     * The flush marker is sent a few times to make it unlikely that it is
+     * lost. The receiving end only act on the first one.
+     */
+    void sendFlush(void);
+
+    /**
+     * @brief   Prepare the socket for decryption of a received datagram
+     * @param   seq The sequence number from the associated data
+     * @return  Returns \em true on success
+     *
+     * Call this function from the cipherDataReceived handler of the socket.
+     */
+    bool prepareDecrypt(uint32_t seq);
+
+    /**
+     * @brief   Handle a decrypted datagram
+     * @param   ip    The source IP address
+     * @param   port  The source UDP port
+     * @param   seq   The sequence number from the associated data
+     * @param   buf   The decrypted payload
+     * @param   count The size of the payload
+     *
+     * Call this function from the dataReceived handler of the socket.
+     */
+    void handleDatagram(const Async::IpAddress &ip, uint16_t port,
+                        uint32_t seq, const void *buf, int count);
+
+    /**
+     * @brief   A signal that is emitted when audio has been received
+     * @param   seq   The sequence number of the datagram
+     * @param   buf   The encoded audio
+     * @param   size  The size of the encoded audio
+     */
+    sigc::signal<void(uint32_t, const void*, int)> audioReceived;
+
+    /**
+     * @brief   A signal that is emitted when a non-audio datagram is received
+     * @param   seq   The sequence number of the datagram
+     *
+     * This is used to tell a jitter buffer that the sequence number is not
+     * a lost audio packet.
+     */
+    sigc::signal<void(uint32_t)> sequenceSkipped;
+
+    /**
+     * @brief   A signal that is emitted when the end of a talk spurt is
+     *          received
+     */
+    sigc::signal<void()> flushReceived;
+
+    /**
+     * @brief   A signal that is emitted when the channel state change
+     * @param   is_active \em true if the channel is working
+     */
+    sigc::signal<void(bool)> activeStateChanged;
+
+  protected:
+
+  private:
+    enum DatagramType
+    {
+      TYPE_HEARTBEAT = 0, TYPE_AUDIO = 1, TYPE_FLUSH = 2
+    };
+
+    static const int HEARTBEAT_INTERVAL = 1000;
+    static const int RX_TIMEOUT         = 5000;
+    static const int FLUSH_REPEAT       = 3;
+
+    Async::EncryptedUdpSocket *sock;
+    std::vector<uint8_t>      key;
+    unsigned char             tx_salt[SALT_LEN];
+    unsigned char             rx_salt[SALT_LEN];
+    uint32_t                  session_id;
+    uint32_t                  tx_seq;
+    uint32_t                  max_rx_seq;
+    uint64_t                  rx_seq_window;
+    bool                      rx_seq_valid;
+    Async::IpAddress          remote_ip;
+    uint16_t                  remote_port;
+    bool                      is_active;
+    bool                      rx_audio_since_flush;
+    struct timeval            last_rx_timestamp;
+    Async::Timer              heartbeat_timer;
+
+    NetTrxUdpChannel(const NetTrxUdpChannel&);
+    NetTrxUdpChannel& operator=(const NetTrxUdpChannel&);
+    std::vector<uint8_t> makeIv(const unsigned char *salt,
+                                uint32_t seq) const;
+    bool sendDatagram(DatagramType type, const void *buf, int size);
+    void heartbeat(Async::Timer *t);
+    void setActive(bool active);
+
+};  /* class NetTrxUdpChannel */
+
+
+//} /* namespace */
+
+#endif /* NET_TRX_UDP_CHANNEL_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
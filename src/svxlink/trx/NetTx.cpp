@@ -155,8 +155,12 @@ bool NetTx::initialize(void)
   string tcp_port(NET_TRX_DEFAULT_TCP_PORT);
   cfg.getValue(name(), "TCP_PORT", tcp_port);
   
-  string udp_port(NET_TRX_DEFAULT_UDP_PORT);
+    // RemoteTrx listen for UDP audio on the same port number as for TCP
+  string udp_port(tcp_port);
   cfg.getValue(name(), "UDP_PORT", udp_port);
+
+  bool udp_audio = false;
+  cfg.getValue(name(), "UDP_AUDIO", udp_audio);
   
   cfg.getValue(name(), "LOG_DISCONNECTS_ONCE", log_disconnects_once);
 
@@ -209,6 +213,10 @@ bool NetTx::initialize(void)
   tcp_con->setAuthKey(auth_key);
   tcp_con->isReady.connect(mem_fun(*this, &NetTx::connectionReady));
   tcp_con->msgReceived.connect(mem_fun(*this, &NetTx::handleMsg));
+  if (udp_audio)
+  {
+    tcp_con->enableUdpAudio(atoi(udp_port.c_str()));
+  }
   tcp_con->connect();
   
   return true;
@@ -425,16 +433,7 @@ void NetTx::writeEncodedSamples(const void *buf, int size)
   
   if (is_connected)
   {
-    const char *ptr = reinterpret_cast<const char *>(buf);
-    while (size > 0)
-    {
-      const int bufsize = MsgAudio::BUFSIZE;
-      int len = min(size, bufsize);
-      MsgAudio *msg = new MsgAudio(ptr, len);
-      sendMsg(msg);
-      size -= len;
-      ptr += len;
-    }
+    tcp_con->sendAudio(buf, size);
   }
   else
   {
@@ -450,8 +449,7 @@ void NetTx::flushEncodedSamples(void)
 {
   if (is_connected)
   {
-    MsgFlush *msg = new MsgFlush;
-    sendMsg(msg);
+    tcp_con->sendAudioFlush();
     pending_flush = true;
   }
   else
@@ -0,0 +1,446 @@
+/**
+@file	 RtlFile.cpp
+@brief   An RtlSdr replaying I/Q samples from a file
+@author  Tobias Blomberg / SM0SVX
+@date	 2025-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <endian.h>
+
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "RtlFile.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+#define BLOCK_INTERVAL    10    // Block interval in milliseconds
+#define MAX_CATCHUP_BLOCKS 10   // Max blocks to send in one go in realtime mode
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+RtlFile::Format RtlFile::formatFromString(const std::string& str)
+{
+  if (str == "U8")
+  {
+    return FMT_U8;
+  }
+  else if (str == "CS16")
+  {
+    return FMT_CS16;
+  }
+  else if (str == "CF32")
+  {
+    return FMT_CF32;
+  }
+  return FMT_UNKNOWN;
+} /* RtlFile::formatFromString */
+
+
+size_t RtlFile::sampleSize(Format fmt)
+{
+  switch (fmt)
+  {
+    case FMT_U8:
+      return 2 * sizeof(uint8_t);
+    case FMT_CS16:
+      return 2 * sizeof(int16_t);
+    case FMT_CF32:
+      return 2 * sizeof(float);
+    default:
+      return 0;
+  }
+} /* RtlFile::sampleSize */
+
+
+void RtlFile::toSamples(std::vector<Sample>& out, const void *buf,
+                        size_t count, Format fmt)
+{
+  out.resize(count);
+  switch (fmt)
+  {
+    case FMT_U8:
+    {
+      const uint8_t *src = static_cast<const uint8_t*>(buf);
+      for (size_t idx=0; idx<count; ++idx)
+      {
+        out[idx] = Sample(src[2*idx] / 127.5f - 1.0f,
+                          src[2*idx+1] / 127.5f - 1.0f);
+      }
+      break;
+    }
+    case FMT_CS16:
+    {
+      const char *src = static_cast<const char*>(buf);
+      for (size_t idx=0; idx<count; ++idx)
+      {
+        uint16_t iq[2];
+        memcpy(iq, src + idx*sizeof(iq), sizeof(iq));
+        out[idx] = Sample(static_cast<int16_t>(le16toh(iq[0])) / 32768.0f,
+                          static_cast<int16_t>(le16toh(iq[1])) / 32768.0f);
+      }
+      break;
+    }
+    case FMT_CF32:
+      memcpy(&out[0], buf, count * sizeof(Sample));
+      break;
+    default:
+      out.clear();
+      break;
+  }
+} /* RtlFile::toSamples */
+
+
+void RtlFile::fromSamples(std::vector<char>& out,
+                          const std::vector<Sample>& samples, Format fmt)
+{
+  out.resize(samples.size() * sampleSize(fmt));
+  switch (fmt)
+  {
+    case FMT_U8:
+      for (size_t idx=0; idx<samples.size(); ++idx)
+      {
+        float i = rintf((samples[idx].real() + 1.0f) * 127.5f);
+        float q = rintf((samples[idx].imag() + 1.0f) * 127.5f);
+        out[2*idx] = static_cast<uint8_t>(min(max(i, 0.0f), 255.0f));
+        out[2*idx+1] = static_cast<uint8_t>(min(max(q, 0.0f), 255.0f));
+      }
+      break;
+    case FMT_CS16:
+      for (size_t idx=0; idx<samples.size(); ++idx)
+      {
+        float i = rintf(samples[idx].real() * 32768.0f);
+        float q = rintf(samples[idx].imag() * 32768.0f);
+        uint16_t iq[2] = {
+          htole16(static_cast<int16_t>(min(max(i, -32768.0f), 32767.0f))),
+          htole16(static_cast<int16_t>(min(max(q, -32768.0f), 32767.0f)))
+        };
+        memcpy(&out[idx*sizeof(iq)], iq, sizeof(iq));
+      }
+      break;
+    case FMT_CF32:
+      if (!samples.empty())
+      {
+        memcpy(&out[0], &samples[0], samples.size() * sizeof(Sample));
+      }
+      break;
+    default:
+      out.clear();
+      break;
+  }
+} /* RtlFile::fromSamples */
+
+
+RtlFile::RtlFile(const std::string& filename, Format fmt, Pacing pacing,
+                 bool loop)
+  : filename(filename), fmt(fmt), pacing(pacing), loop(loop), map_ptr(0),
+    map_size(0), pos(0), is_ready(false), file_fq(0),
+    block_timer((pacing == PACING_FAST) ? 0 : BLOCK_INTERVAL,
+                Timer::TYPE_PERIODIC, false),
+    sent_blocks(0), sent_samples(0)
+{
+  block_timer.expired.connect(mem_fun(*this, &RtlFile::onBlockTimer));
+  if (mapFile())
+  {
+    block_timer.setEnable(true);
+  }
+} /* RtlFile::RtlFile */
+
+
+RtlFile::~RtlFile(void)
+{
+  unmapFile();
+} /* RtlFile::~RtlFile */
+
+
+const std::string RtlFile::displayName(void) const
+{
+  return filename;
+} /* RtlFile::displayName */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+void RtlFile::handleSetCenterFq(uint32_t fq)
+{
+    // The recording was made at a fixed frequency so the first frequency set
+    // is taken to be the recording frequency
+  if (file_fq == 0)
+  {
+    file_fq = fq;
+  }
+  else if (fq != file_fq)
+  {
+    cerr << "*** WARNING: The center frequency cannot be changed when "
+            "replaying the I/Q file " << filename << endl;
+  }
+} /* RtlFile::handleSetCenterFq */
+
+
+void RtlFile::handleSetSampleRate(uint32_t rate)
+{
+  start_time = Clock::now();
+  sent_blocks = 0;
+} /* RtlFile::handleSetSampleRate */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+bool RtlFile::mapFile(void)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    cerr << "*** ERROR: Could not open I/Q file " << filename << ": "
+         << strerror(errno) << endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+  {
+    cerr << "*** ERROR: Could not stat I/Q file " << filename << ": "
+         << strerror(errno) << endl;
+    ::close(fd);
+    return false;
+  }
+  if (static_cast<size_t>(st.st_size) < sampleSize(fmt))
+  {
+    cerr << "*** ERROR: The I/Q file " << filename << " is empty" << endl;
+    ::close(fd);
+    return false;
+  }
+
+  void *ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED)
+  {
+    cerr << "*** ERROR: Could not map I/Q file " << filename << ": "
+         << strerror(errno) << endl;
+    return false;
+  }
+  madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+
+  map_ptr = static_cast<const char*>(ptr);
+  map_size = st.st_size;
+  pos = 0;
+  return true;
+} /* RtlFile::mapFile */
+
+
+void RtlFile::unmapFile(void)
+{
+  if (map_ptr != 0)
+  {
+    munmap(const_cast<char*>(map_ptr), map_size);
+    map_ptr = 0;
+    map_size = 0;
+  }
+} /* RtlFile::unmapFile */
+
+
+void RtlFile::onBlockTimer(Async::Timer *t)
+{
+  if (!is_ready)
+  {
+    is_ready = true;
+    start_time = Clock::now();
+    stats_start = start_time;
+    sent_blocks = 0;
+    sent_samples = 0;
+    readyStateChanged();
+    if (!is_ready)
+    {
+      return;
+    }
+  }
+
+  if (pacing == PACING_FAST)
+  {
+    sendBlock();
+    return;
+  }
+
+    // Send as many blocks as needed to catch up with the wall clock, but not
+    // too many in one go if the main loop have been blocked for a long time
+  uint64_t elapsed_ms = chrono::duration_cast<chrono::milliseconds>(
+      Clock::now() - start_time).count();
+  uint64_t due_blocks = elapsed_ms / BLOCK_INTERVAL;
+  for (int i=0; (i<MAX_CATCHUP_BLOCKS) && (sent_blocks < due_blocks); ++i)
+  {
+    if (!sendBlock())
+    {
+      return;
+    }
+  }
+  if (due_blocks > sent_blocks + MAX_CATCHUP_BLOCKS)
+  {
+    sent_blocks = due_blocks;
+  }
+} /* RtlFile::onBlockTimer */
+
+
+bool RtlFile::sendBlock(void)
+{
+  const size_t samp_size = sampleSize(fmt);
+  size_t count = min(blockSize() / 2, (map_size - pos) / samp_size);
+  if (count == 0)
+  {
+    printStats();
+    pos = 0;
+    if (!loop)
+    {
+      block_timer.setEnable(false);
+      is_ready = false;
+      unmapFile();
+      readyStateChanged();
+      return false;
+    }
+    count = min(blockSize() / 2, map_size / samp_size);
+  }
+
+  vector<Sample> iq;
+  toSamples(iq, map_ptr + pos, count, fmt);
+  pos += count * samp_size;
+  ++sent_blocks;
+  sent_samples += count;
+  iqReceived(iq);
+  return true;
+} /* RtlFile::sendBlock */
+
+
+void RtlFile::printStats(void)
+{
+  Clock::time_point now = Clock::now();
+  double secs = chrono::duration<double>(now - stats_start).count();
+  cout << displayName() << ": Replayed " << sent_samples << " samples in "
+       << secs << "s";
+  if (secs > 0.0)
+  {
+    cout << " (" << (sent_samples / secs / 1.0e6) << " Msps)";
+  }
+  cout << endl;
+  stats_start = now;
+  sent_samples = 0;
+} /* RtlFile::printStats */
+
+
+
+/*
+ * This file has not been truncated
+ */
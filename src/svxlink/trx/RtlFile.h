@@ -0,0 +1,253 @@
+/**
+@file	 RtlFile.h
+@brief   An RtlSdr replaying I/Q samples from a file
+@author  Tobias Blomberg / SM0SVX
+@date	 2025-10-18
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2025 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef RTL_FILE_INCLUDED
+#define RTL_FILE_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "RtlSdr.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	An RtlSdr replaying I/Q samples from a file
+@author Tobias Blomberg / SM0SVX
+@date   2025-10-18
+
+This class can be used instead of a real tuner to feed a WbRx with I/Q
+samples that have been recorded to a file. It is mainly used for benchmarking
+and for testing the DDR signal processing without access to any hardware.
+
+The file contain raw interleaved I/Q samples without any header. The sample
+format can be unsigned 8 bit (as delivered by the RTL2832U), signed 16 bit
+little endian or 32 bit float. The file is memory mapped and the samples are
+emitted in blocks of 10ms, either in real time or as fast as possible. Since
+the recording was done at a fixed frequency, the tuner frequency cannot be
+changed. The sample rate must be set to the rate used when recording.
+*/
+class RtlFile : public RtlSdr
+{
+  public:
+    /**
+     * @brief The sample formats that can be used in I/Q files
+     */
+    typedef enum
+    {
+      FMT_UNKNOWN,  ///< Unknown format
+      FMT_U8,       ///< Unsigned 8 bit, as delivered by the RTL2832U
+      FMT_CS16,     ///< Signed 16 bit little endian
+      FMT_CF32      ///< 32 bit float
+    } Format;
+
+    /**
+     * @brief How fast to replay the samples in the file
+     */
+    typedef enum
+    {
+      PACING_REALTIME,  ///< Replay at the set sample rate
+      PACING_FAST       ///< Replay as fast as the receivers can handle
+    } Pacing;
+
+    /**
+     * @brief   Convert a string to a sample format
+     * @param   str The string to convert (U8, CS16 or CF32)
+     * @return  Returns the sample format or FMT_UNKNOWN
+     */
+    static Format formatFromString(const std::string& str);
+
+    /**
+     * @brief   Get the size of one complex sample in the given format
+     * @param   fmt The sample format
+     * @return  Returns the size in bytes of one I/Q sample pair
+     */
+    static size_t sampleSize(Format fmt);
+
+    /**
+     * @brief   Convert raw samples to complex float samples
+     * @param   out The vector to store the converted samples in
+     * @param   buf The raw samples
+     * @param   count The number of I/Q sample pairs to convert
+     * @param   fmt The format of the raw samples
+     */
+    static void toSamples(std::vector<Sample>& out, const void *buf,
+                          size_t count, Format fmt);
+
+    /**
+     * @brief   Convert complex float samples to raw samples
+     * @param   out The buffer to store the converted samples in
+     * @param   samples The samples to convert
+     * @param   fmt The format of the raw samples
+     */
+    static void fromSamples(std::vector<char>& out,
+                            const std::vector<Sample>& samples, Format fmt);
+
+    /**
+     * @brief 	Constructor
+     * @param   filename The name of the file to replay
+     * @param   fmt The format of the samples in the file
+     * @param   pacing How fast to replay the samples
+     * @param   loop Set to \em true to restart from the beginning at EOF
+     */
+    RtlFile(const std::string& filename, Format fmt,
+            Pacing pacing=PACING_REALTIME, bool loop=true);
+
+    /**
+     * @brief 	Destructor
+     */
+    virtual ~RtlFile(void);
+
+    /**
+     * @brief   Check if the object is ready for operation
+     * @return  Returns \em true if the file is open and not at EOF
+     */
+    virtual bool isReady(void) const { return is_ready; }
+
+    /**
+     * @brief   Return a string which identifies the specific instance
+     * @return  Returns a string which identifies the instance
+     */
+    virtual const std::string displayName(void) const;
+
+  protected:
+    virtual void handleSetTunerIfGain(uint16_t stage, int16_t gain) {}
+    virtual void handleSetCenterFq(uint32_t fq);
+    virtual void handleSetSampleRate(uint32_t rate);
+    virtual void handleSetGainMode(uint32_t mode) {}
+    virtual void handleSetGain(int32_t gain) {}
+    virtual void handleSetFqCorr(int corr) {}
+    virtual void handleEnableTestMode(bool enable) {}
+    virtual void handleEnableDigitalAgc(bool enable) {}
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::string         filename;
+    Format              fmt;
+    Pacing              pacing;
+    bool                loop;
+    const char*         map_ptr;
+    size_t              map_size;
+    size_t              pos;
+    bool                is_ready;
+    uint32_t            file_fq;
+    Async::Timer        block_timer;
+    Clock::time_point   start_time;
+    uint64_t            sent_blocks;
+    uint64_t            sent_samples;
+    Clock::time_point   stats_start;
+
+    RtlFile(const RtlFile&);
+    RtlFile& operator=(const RtlFile&);
+    bool mapFile(void);
+    void unmapFile(void);
+    void onBlockTimer(Async::Timer *t);
+    bool sendBlock(void);
+    void printStats(void);
+
+};  /* class RtlFile */
+
+
+//} /* namespace */
+
+#endif /* RTL_FILE_INCLUDED */
+
+
+/*
+ * This file has not been truncated
+ */
@@ -75,276 +75,6 @@ using namespace std;
  *
  ****************************************************************************/
 
-class SquelchCombine::Node
-{
-  public:
-    typedef std::set<std::string> SquelchStates;
-    Node(const std::string& name) : m_name(name) {}
-    virtual ~Node(void) {}
-    const std::string name(void) const { return m_name; }
-    virtual void print(std::ostream& os) = 0;
-    virtual bool initialize(Async::Config& cfg) = 0;
-    virtual void reset(void) = 0;
-    virtual void restart(void) = 0;
-    virtual void processSamples(const float *samples, int count) = 0;
-    virtual bool isOpen(void) const = 0;
-    virtual std::string activityInfo(void) const = 0;
-    virtual SquelchStates& squelchStates(SquelchStates& states) = 0;
-    sigc::signal<void(bool)> squelchOpen;
-    sigc::signal<void(float)> toneDetected;
-
-  private:
-    std::string m_name;
-}; /* SquelchCombine::Node */
-
-
-class SquelchCombine::LeafNode : public SquelchCombine::Node
-{
-  public:
-    LeafNode(const std::string n) : Node(n) {}
-
-    virtual ~LeafNode(void)
-    {
-      delete m_squelch;
-      m_squelch = nullptr;
-    }
-
-    virtual void print(std::ostream& os) { os << name(); }
-
-    virtual bool initialize(Async::Config& cfg)
-    {
-      string sql_det_str;
-      if (!cfg.getValue(name(), "SQL_DET", sql_det_str))
-      {
-        cerr << "*** ERROR: Config variable " << name() << "/SQL_DET not set\n";
-        return false;
-      }
-      m_squelch = createSquelch(sql_det_str);
-      if ((m_squelch == nullptr) || !m_squelch->initialize(cfg, name()))
-      {
-        std::cerr << "*** ERROR: Squelch detector initialization failed for \""
-                  << name() << "\"\n";
-        return false;
-      }
-      m_squelch->squelchOpen.connect(squelchOpen.make_slot());
-      m_squelch->toneDetected.connect(toneDetected.make_slot());
-      return true;
-    }
-
-    virtual bool isOpen(void) const { return m_squelch->isOpen(); }
-
-    virtual std::string activityInfo(void) const
-    {
-      std::string act_info = name();
-      if (m_squelch->isOpen())
-      {
-        act_info += "*";
-      }
-      if (!m_squelch->activityInfo().empty())
-      {
-        if (!m_squelch->isOpen())
-        {
-          act_info += "=";
-        }
-        act_info += m_squelch->activityInfo();
-      }
-      return act_info;
-    }
-
-    virtual void reset(void) { m_squelch->reset(); }
-
-    virtual void restart(void) { m_squelch->restart(); }
-
-    virtual void processSamples(const float *samples, int count)
-    {
-      int pos = 0;
-      do {
-        int ret = m_squelch->writeSamples(samples, count);
-        if (ret < 1)
-        {
-          std::cout << "*** WARNING: Failed to write samples to squelch "
-                       "detector \"" << name() << "\" in squelch combiner."
-                    << std::endl;
-          break;
-        }
-        pos += ret;
-      } while (pos < count);
-    }
-
-    virtual SquelchStates& squelchStates(SquelchStates& states)
-    {
-      states.emplace(activityInfo());
-      return states;
-    }
-
-  private:
-    Squelch* m_squelch = nullptr;
-}; /* SquelchCombine::LeafNode */
-
-
-class SquelchCombine::UnaryOpNode : public SquelchCombine::Node
-{
-  public:
-    UnaryOpNode(const std::string& name, Node *node)
-      : Node(name), m_node(node)
-    {
-      m_node->squelchOpen.connect(squelchOpen.make_slot());
-      m_node->toneDetected.connect(toneDetected.make_slot());
-    }
-
-    virtual ~UnaryOpNode(void)
-    {
-      delete m_node;
-      m_node = nullptr;
-    }
-
-    virtual void print(std::ostream& os)
-    {
-      os << name() << "(";
-      m_node->print(os);
-      os << ")";
-    }
-
-    virtual bool initialize(Async::Config& cfg)
-    {
-      return m_node->initialize(cfg);
-    }
-
-    virtual void reset(void)
-    {
-      m_node->reset();
-    }
-
-    virtual void restart(void)
-    {
-      m_node->restart();
-    }
-
-    virtual void processSamples(const float *samples, int count)
-    {
-      m_node->processSamples(samples, count);
-    }
-
-    virtual SquelchStates& squelchStates(SquelchStates& states)
-    {
-      return m_node->squelchStates(states);
-    }
-
-    virtual std::string activityInfo(void) const
-    {
-      return name() + "(" + m_node->activityInfo() + ")";
-    }
-
-  protected:
-    Node* m_node;
-}; /* SquelchCombine::UnaryOpNode */
-
-
-struct SquelchCombine::NegationOpNode : public SquelchCombine::UnaryOpNode
-{
-  NegationOpNode(Node* node) : UnaryOpNode("NOT", node) {}
-  virtual bool isOpen(void) const { return !m_node->isOpen(); }
-}; /* SquelchCombine::NegationOpNode */
-
-
-class SquelchCombine::BinaryOpNode : public SquelchCombine::Node
-{
-  public:
-    BinaryOpNode(const std::string& n, Node* l, Node* r)
-      : Node(n), m_left(l), m_right(r)
-    {
-      m_left->squelchOpen.connect(
-          sigc::mem_fun(*this, &BinaryOpNode::onSquelchOpen));
-      m_left->toneDetected.connect(toneDetected.make_slot());
-      m_right->squelchOpen.connect(
-          sigc::mem_fun(*this, &BinaryOpNode::onSquelchOpen));
-      m_right->toneDetected.connect(toneDetected.make_slot());
-    }
-
-    virtual ~BinaryOpNode(void)
-    {
-      delete m_left;
-      m_left = nullptr;
-      delete m_right;
-      m_right = nullptr;
-    }
-
-    virtual void print(std::ostream& os)
-    {
-      os << name() << "(";
-      m_left->print(os);
-      os << ", ";
-      m_right->print(os);
-      os << ")";
-    }
-
-    virtual bool initialize(Async::Config& cfg)
-    {
-      return m_left->initialize(cfg) && m_right->initialize(cfg);
-    }
-
-    virtual void reset(void)
-    {
-      m_left->reset();
-      m_right->reset();
-    }
-
-    virtual void restart(void)
-    {
-      m_left->restart();
-      m_right->restart();
-    }
-
-    virtual void processSamples(const float *samples, int count)
-    {
-      m_left->processSamples(samples, count);
-      m_right->processSamples(samples, count);
-    }
-
-    void onSquelchOpen(bool is_open)
-    {
-      squelchOpen(isOpen());
-    }
-
-    virtual SquelchStates& squelchStates(SquelchStates& states)
-    {
-      m_left->squelchStates(states);
-      m_right->squelchStates(states);
-      return states;
-    }
-
-    virtual std::string activityInfo(void) const
-    {
-      return name() + "(" + m_left->activityInfo() + ", " +
-             m_right->activityInfo() + ")";
-    }
-
-  protected:
-    Node* m_left;
-    Node* m_right;
-}; /* SquelchCombine::BinaryOpNode */
-
-
-struct SquelchCombine::OrOpNode : public SquelchCombine::BinaryOpNode
-{
-  OrOpNode(Node* l, Node* r) : BinaryOpNode("OR", l, r) {}
-
-  virtual bool isOpen(void) const
-  {
-    return m_left->isOpen() || m_right->isOpen();
-  }
-}; /* SquelchCombine::OrOpNode */
-
-
-struct SquelchCombine::AndOpNode : public SquelchCombine::BinaryOpNode
-{
-  AndOpNode(Node* l, Node* r) : BinaryOpNode("AND", l, r) {}
-
-  virtual bool isOpen(void) const
-  {
-    return m_left->isOpen() && m_right->isOpen();
-  }
-}; /* SquelchCombine::AndOpNode */
 
 
 /****************************************************************************
@@ -385,7 +115,11 @@ SquelchCombine::SquelchCombine(void)
 
 SquelchCombine::~SquelchCombine(void)
 {
-  delete m_comb;
+  for (auto& leaf : m_leaves)
+  {
+    delete leaf.squelch;
+    leaf.squelch = nullptr;
+  }
 } /* SquelchCombine::~SquelchCombine */
 
 
@@ -405,46 +139,71 @@ bool SquelchCombine::initialize(Async::Config& cfg,
     return false;
   }
 
-  m_comb = parseExpression();
-  if (!m_tokens.empty())
+  bool success = parseExpression();
+  if (success && !m_tokens.empty())
   {
     std::cout << "*** ERROR: Unparsed extra tokens in malformed squelch "
                  "combiner expression: ";
     copy(m_tokens.begin(), m_tokens.end(),
         std::ostream_iterator<std::string>(std::cout, " "));
     std::cout << std::endl;
-    delete m_comb;
-    m_comb = nullptr;
+    success = false;
   }
-  if (m_comb == nullptr)
+  if (!success || !checkProgram())
   {
     std::cout << "*** ERROR: Failed to create combined squelch for RX \""
               << rx_name << "\"" << std::endl;
+    m_prog.clear();
+    m_leaves.clear();
     return false;
   }
 
-  std::cout << rx_name << ": Combined squelch structure is ";
-  m_comb->print(std::cout);
-  std::cout << std::endl;
+  std::cout << rx_name << ": Combined squelch structure is "
+            << structure() << std::endl;
 
-  m_comb->squelchOpen.connect(
-      sigc::mem_fun(*this, &SquelchCombine::onSquelchOpen));
-  m_comb->toneDetected.connect(toneDetected.make_slot());
+  for (unsigned i=0; i<m_leaves.size(); ++i)
+  {
+    Leaf& leaf = m_leaves[i];
+    string sql_det_str;
+    if (!cfg.getValue(leaf.name, "SQL_DET", sql_det_str))
+    {
+      cerr << "*** ERROR: Config variable " << leaf.name
+           << "/SQL_DET not set\n";
+      return false;
+    }
+    leaf.squelch = createSquelch(sql_det_str);
+    if ((leaf.squelch == nullptr) || !leaf.squelch->initialize(cfg, leaf.name))
+    {
+      std::cerr << "*** ERROR: Squelch detector initialization failed for \""
+                << leaf.name << "\"\n";
+      return false;
+    }
+    leaf.squelch->squelchOpen.connect(sigc::bind(
+          sigc::mem_fun(*this, &SquelchCombine::onLeafSquelchOpen), i));
+    leaf.squelch->toneDetected.connect(toneDetected.make_slot());
+  }
 
-  return m_comb->initialize(cfg) && Squelch::initialize(cfg, rx_name);
+  return Squelch::initialize(cfg, rx_name);
 } /* SquelchCombine::initialize */
 
 
 void SquelchCombine::reset(void)
 {
-  m_comb->reset();
+  for (auto& leaf : m_leaves)
+  {
+    leaf.squelch->reset();
+  }
+  updateLeafStates();
   Squelch::reset();
 } /* SquelchCombine::reset */
 
 
 void SquelchCombine::restart(void)
 {
-  m_comb->restart();
+  for (auto& leaf : m_leaves)
+  {
+    leaf.squelch->restart();
+  }
   Squelch::restart();
 } /* SquelchCombine::restart */
 
@@ -457,7 +216,21 @@ void SquelchCombine::restart(void)
 
 int SquelchCombine::processSamples(const float *samples, int count)
 {
-  m_comb->processSamples(samples, count);
+  for (auto& leaf : m_leaves)
+  {
+    int pos = 0;
+    do {
+      int ret = leaf.squelch->writeSamples(samples + pos, count - pos);
+      if (ret < 1)
+      {
+        std::cout << "*** WARNING: Failed to write samples to squelch "
+                     "detector \"" << leaf.name << "\" in squelch combiner."
+                  << std::endl;
+        break;
+      }
+      pos += ret;
+    } while (pos < count);
+  }
   return count;
 } /* SquelchCombine::processSamples */
 
@@ -468,14 +241,22 @@ int SquelchCombine::processSamples(const float *samples, int count)
  *
  ****************************************************************************/
 
-void SquelchCombine::onSquelchOpen(bool is_open)
+void SquelchCombine::onLeafSquelchOpen(bool is_open, unsigned leaf)
 {
-  if (is_open != signalDetected())
+  const uint64_t mask = uint64_t(1) << leaf;
+  m_leaf_open = is_open ? (m_leaf_open | mask) : (m_leaf_open & ~mask);
+
+  bool comb_is_open = evaluate();
+  if (comb_is_open != signalDetected())
   {
+    std::set<std::string> states;
+    for (const auto& leaf : m_leaves)
+    {
+      states.emplace(leafActivityInfo(leaf));
+    }
     std::string info;
     info.reserve(127);
-    SquelchCombine::Node::SquelchStates states;
-    for (const auto& state : m_comb->squelchStates(states))
+    for (const auto& state : states)
     {
       if (!info.empty())
       {
@@ -483,10 +264,119 @@ void SquelchCombine::onSquelchOpen(bool is_open)
       }
       info += state;
     }
-    setSignalDetected(is_open, info);
-    //setSignalDetected(is_open, m_comb->activityInfo());
+    setSignalDetected(comb_is_open, info);
+  }
+} /* SquelchCombine::onLeafSquelchOpen */
+
+
+bool SquelchCombine::evaluate(void) const
+{
+    // Each bit in the stack word is one stack entry with the top of the
+    // stack in bit 0. The program has been checked to not overflow the stack.
+  uint64_t stack = 0;
+  for (const auto& op : m_prog)
+  {
+    switch (op.code)
+    {
+      case OP_LEAF:
+        stack = (stack << 1) | ((m_leaf_open >> op.leaf) & 1);
+        break;
+      case OP_NOT:
+        stack ^= 1;
+        break;
+      case OP_AND:
+        stack = (stack >> 1) & (stack | ~uint64_t(1));
+        break;
+      case OP_OR:
+        stack = (stack >> 1) | (stack & 1);
+        break;
+    }
+  }
+  return (stack & 1) != 0;
+} /* SquelchCombine::evaluate */
+
+
+void SquelchCombine::updateLeafStates(void)
+{
+  m_leaf_open = 0;
+  for (unsigned i=0; i<m_leaves.size(); ++i)
+  {
+    if (m_leaves[i].squelch->isOpen())
+    {
+      m_leaf_open |= uint64_t(1) << i;
+    }
   }
-} /* SquelchCombine::onSquelchOpen */
+} /* SquelchCombine::updateLeafStates */
+
+
+std::string SquelchCombine::leafActivityInfo(const Leaf& leaf) const
+{
+  std::string act_info = leaf.name;
+  if (leaf.squelch->isOpen())
+  {
+    act_info += "*";
+  }
+  if (!leaf.squelch->activityInfo().empty())
+  {
+    if (!leaf.squelch->isOpen())
+    {
+      act_info += "=";
+    }
+    act_info += leaf.squelch->activityInfo();
+  }
+  return act_info;
+} /* SquelchCombine::leafActivityInfo */
+
+
+std::string SquelchCombine::structure(void) const
+{
+  std::vector<std::string> stack;
+  for (const auto& op : m_prog)
+  {
+    switch (op.code)
+    {
+      case OP_LEAF:
+        stack.push_back(m_leaves[op.leaf].name);
+        break;
+      case OP_NOT:
+        stack.back() = "NOT(" + stack.back() + ")";
+        break;
+      case OP_AND:
+      case OP_OR:
+      {
+        std::string right(stack.back());
+        stack.pop_back();
+        stack.back() = std::string(op.code == OP_AND ? "AND(" : "OR(") +
+                       stack.back() + ", " + right + ")";
+        break;
+      }
+    }
+  }
+  return stack.empty() ? std::string() : stack.back();
+} /* SquelchCombine::structure */
+
+
+bool SquelchCombine::checkProgram(void) const
+{
+  size_t depth = 0;
+  for (const auto& op : m_prog)
+  {
+    if (op.code == OP_LEAF)
+    {
+      if (++depth > MAX_STACK_DEPTH)
+      {
+        std::cout << "*** ERROR: Squelch combiner expression is too deeply "
+                     "nested" << std::endl;
+        return false;
+      }
+    }
+    else if ((op.code == OP_AND) || (op.code == OP_OR))
+    {
+      depth -= 1;
+    }
+  }
+  return depth == 1;
+} /* SquelchCombine::checkProgram */
 
 
 bool SquelchCombine::tokenize(const std::string& expr)
@@ -534,25 +424,23 @@ bool SquelchCombine::tokenize(const std::string& expr)
 } /*SquelchCombine::tokenize */
 
 
-SquelchCombine::Node* SquelchCombine::parseInstExpression(void)
+bool SquelchCombine::parseInstExpression(void)
 {
   if (m_tokens.empty())
   {
     std::cout << "*** ERROR: Empty squelch combiner expression" << std::endl;
-    return nullptr;
+    return false;
   }
 
   if (m_tokens.front() == "(")
   {
     m_tokens.pop_front();
-    Node* expr = parseExpression();
-    if ((expr == nullptr) || (m_tokens.front() != ")"))
+    if (!parseExpression() || m_tokens.empty() || (m_tokens.front() != ")"))
     {
-      delete expr;
-      return nullptr;
+      return false;
     }
     m_tokens.pop_front();
-    return expr;
+    return true;
   }
 
   std::string inst(m_tokens.front());
@@ -560,39 +448,62 @@ SquelchCombine::Node* SquelchCombine::parseInstExpression(void)
   {
     std::cout << "*** ERROR: Cannot use operator '" << inst
               << "' as instance name in squelch combiner" << std::endl;
-    return nullptr;
+    return false;
   }
   m_tokens.pop_front();
 
-  return new LeafNode(inst);
+    // Use the same squelch detector for all occurrences of an instance
+  unsigned leaf = 0;
+  while ((leaf < m_leaves.size()) && (m_leaves[leaf].name != inst))
+  {
+    ++leaf;
+  }
+  if (leaf == m_leaves.size())
+  {
+    if (m_leaves.size() >= MAX_LEAVES)
+    {
+      std::cout << "*** ERROR: Too many squelch detectors in squelch "
+                   "combiner. Max is " << MAX_LEAVES << "." << std::endl;
+      return false;
+    }
+    m_leaves.push_back({inst, nullptr});
+  }
+  m_prog.push_back({OP_LEAF, leaf});
+
+  return true;
 } /* SquelchCombine::parseInstExpression */
 
 
-SquelchCombine::Node* SquelchCombine::parseUnaryOpExpression(void)
+bool SquelchCombine::parseUnaryOpExpression(void)
 {
   bool is_negation_op = false;
-  if (m_tokens.front() == "!")
+  if (!m_tokens.empty() && (m_tokens.front() == "!"))
   {
     is_negation_op = true;
     m_tokens.pop_front();
   }
 
-  Node* node = parseInstExpression();
-  if ((node == nullptr) || !is_negation_op)
+  if (!parseInstExpression())
   {
-    return node;
+    return false;
   }
-
-  return new NegationOpNode(node);
+  if (is_negation_op)
+  {
+    m_prog.push_back({OP_NOT, 0});
+  }
+  return true;
 } /* SquelchCombine::parseUnaryOpExpression */
 
 
-SquelchCombine::Node* SquelchCombine::parseAndExpression(void)
+bool SquelchCombine::parseAndExpression(void)
 {
-  Node* left = parseUnaryOpExpression();
-  if ((left == nullptr) || m_tokens.empty() || (m_tokens.front() != "&"))
+  if (!parseUnaryOpExpression())
   {
-    return left;
+    return false;
+  }
+  if (m_tokens.empty() || (m_tokens.front() != "&"))
+  {
+    return true;
   }
 
   if (m_tokens.size() < 2)
@@ -600,28 +511,28 @@ SquelchCombine::Node* SquelchCombine::parseAndExpression(void)
     std::cout << "*** ERROR: Right hand expression missing in squelch "
                  "combiner AND-expression"
               << std::endl;
-    delete left;
-    return nullptr;
+    return false;
   }
   m_tokens.pop_front();
 
-  Node* right = parseAndExpression();
-  if (right == nullptr)
+  if (!parseAndExpression())
   {
-    delete left;
-    return nullptr;
+    return false;
   }
-
-  return new AndOpNode(left, right);
+  m_prog.push_back({OP_AND, 0});
+  return true;
 } /* SquelchCombine::parseAndExpression */
 
 
-SquelchCombine::Node* SquelchCombine::parseOrExpression(void)
+bool SquelchCombine::parseOrExpression(void)
 {
-  Node* left = parseAndExpression();
-  if ((left == nullptr) || m_tokens.empty() || (m_tokens.front() != "|"))
+  if (!parseAndExpression())
+  {
+    return false;
+  }
+  if (m_tokens.empty() || (m_tokens.front() != "|"))
   {
-    return left;
+    return true;
   }
 
   if (m_tokens.size() < 2)
@@ -629,23 +540,20 @@ SquelchCombine::Node* SquelchCombine::parseOrExpression(void)
     std::cout << "*** ERROR: Right hand expression missing in squelch "
                  "combiner OR-expression"
               << std::endl;
-    delete left;
-    return nullptr;
+    return false;
   }
   m_tokens.pop_front();
 
-  Node* right = parseOrExpression();
-  if (right == nullptr)
+  if (!parseOrExpression())
   {
-    delete left;
-    return nullptr;
+    return false;
   }
-
-  return new OrOpNode(left, right);
+  m_prog.push_back({OP_OR, 0});
+  return true;
 } /* SquelchCombine::parseOrExpression */
 
 
-SquelchCombine::Node* SquelchCombine::parseExpression(void)
+bool SquelchCombine::parseExpression(void)
 {
   return parseOrExpression();
 } /* SquelchCombine::parseExpresseion */
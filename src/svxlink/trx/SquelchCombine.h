@@ -34,8 +34,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <stdint.h>
+
 #include <string>
 #include <deque>
+#include <vector>
 
 
 /****************************************************************************
@@ -135,6 +138,12 @@ SIGLEV_CLOSE_THRESH=2
 SQL_DET=COMBINE
 SQL_COMBINE=Rx1:CTCSS | Rx1:SIGLEV
 ...
+
+The expression is compiled into a flat list of operations in postfix order
+that is evaluated using a bit stack. Each configuration section used in the
+expression is instantiated only once, even if it is used multiple times, so
+the audio is only processed once per squelch detector. The expression is
+only evaluated when one of the squelch detectors change state.
 */
 class SquelchCombine : public Squelch
 {
@@ -199,24 +208,40 @@ class SquelchCombine : public Squelch
 
   private:
     typedef std::deque<std::string> Tokens;
-    class Node;
-    class LeafNode;
-    class UnaryOpNode;
-    struct NegationOpNode;
-    class BinaryOpNode;
-    struct OrOpNode;
-    struct AndOpNode;
-
-    Tokens  m_tokens;
-    Node*   m_comb    = nullptr;
-
-    void onSquelchOpen(bool is_open);
+    enum OpCode { OP_LEAF, OP_NOT, OP_AND, OP_OR };
+    struct Op
+    {
+      OpCode    code;
+      unsigned  leaf;
+    };
+    typedef std::vector<Op> Program;
+    struct Leaf
+    {
+      std::string name;
+      Squelch*    squelch;
+    };
+    typedef std::vector<Leaf> Leaves;
+
+    static const size_t MAX_LEAVES = 64;
+    static const size_t MAX_STACK_DEPTH = 64;
+
+    Tokens    m_tokens;
+    Program   m_prog;
+    Leaves    m_leaves;
+    uint64_t  m_leaf_open   = 0;
+
+    void onLeafSquelchOpen(bool is_open, unsigned leaf);
+    bool evaluate(void) const;
+    void updateLeafStates(void);
+    std::string leafActivityInfo(const Leaf& leaf) const;
+    std::string structure(void) const;
+    bool checkProgram(void) const;
     bool tokenize(const std::string& expr);
-    Node* parseInstExpression(void);
-    Node* parseUnaryOpExpression(void);
-    Node* parseAndExpression(void);
-    Node* parseOrExpression(void);
-    Node* parseExpression(void);
+    bool parseInstExpression(void);
+    bool parseUnaryOpExpression(void);
+    bool parseAndExpression(void);
+    bool parseOrExpression(void);
+    bool parseExpression(void);
 
 };  /* class SquelchCombine */
 
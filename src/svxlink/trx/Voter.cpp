@@ -40,6 +40,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cstdlib>
 #include <utility>
 #include <list>
+#include <limits>
 #include <sigc++/bind.h>
 #include <sys/time.h>
 #include <json/json.h>
@@ -249,6 +250,8 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     
     char id(void) const { return rx->sqlRxId(); }
 
+    size_t index(void) const { return rx_id - 1; }
+
     void setSqlOpenDelay(unsigned new_sql_open_delay)
     {
       sql_open_delay = new_sql_open_delay;
@@ -394,6 +397,9 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
  *
  ****************************************************************************/
 
+  // The signal level cache value for receivers not taking part in the voting
+static const float NO_VOTE = -numeric_limits<float>::infinity();
+
 
 
 /****************************************************************************
@@ -405,7 +411,9 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
 Voter::Voter(Config &cfg, const std::string& name)
   : Rx(cfg, name), cfg(cfg), m_verbose(true), selector(0),
     sm(Macho::State<Top>(this)), is_processing_event(false), command_pty(0),
-    m_print_sat_squelch(false)
+    m_print_sat_squelch(false), siglev_update_pending(false),
+    vote_started(false), siglev_update_cnt(0), siglev_batch_cnt(0),
+    siglev_max_batch_size(0)
 {
 } /* Voter::Voter */
 
@@ -419,7 +427,7 @@ Voter::~Voter(void)
   
     // Mute all receivers before deleting them so that we do not get any
     // unexpected updates during deletion
-  list<SatRx *>::iterator it;
+  std::vector<SatRx *>::iterator it;
   for (it=rxs.begin(); it!=rxs.end(); ++it)
   {
     (*it)->setMuteState(Rx::MUTE_ALL);
@@ -578,6 +586,8 @@ bool Voter::initialize(void)
       selector->enableAutoSelect(srx, 0);
       
       rxs.push_back(srx);
+      sat_siglev.push_back(NO_VOTE);
+      sat_siglev_updated.push_back(0);
     }
     if (comma == receivers.end())
     {
@@ -605,7 +615,7 @@ bool Voter::addToneDetector(float fq, int bw, float thresh,
       	      	      	    int required_duration)
 {
   bool success = true;
-  list<SatRx *>::iterator it;
+  std::vector<SatRx *>::iterator it;
   for (it=rxs.begin(); it!=rxs.end(); ++it)
   {
     success &= (*it)->addToneDetector(fq, bw, thresh, required_duration);
@@ -690,6 +700,7 @@ void Voter::satSquelchOpen(bool is_open, SatRx *srx)
     std::cout << std::endl;
   }
 
+  updateSatSignalLevel(srx);
   if (srx->isEnabled())
   {
     dispatchEvent(Macho::Event(&Top::satSquelchOpen, srx, is_open));
@@ -701,16 +712,109 @@ void Voter::satSquelchOpen(bool is_open, SatRx *srx)
 
 void Voter::satSignalLevelUpdated(float siglev, SatRx *srx)
 {
-  if (srx->isEnabled())
+  if (!srx->isEnabled())
+  {
+    return;
+  }
+
+    // Just record the new signal level here. All updates received during
+    // one main loop iteration are then evaluated in one go.
+  sat_siglev[srx->index()] = siglev;
+  sat_siglev_updated[srx->index()] = 1;
+  ++siglev_update_cnt;
+  if (!siglev_update_pending)
   {
-    dispatchEvent(Macho::Event(&Top::satSignalLevelUpdated, srx, siglev));
+    siglev_update_pending = true;
+    siglev_update_time = Clock::now();
+    Async::Application::app().runTask(
+        mem_fun(*this, &Voter::processSignalLevelUpdates));
   }
 } /* Voter::satSignalLevelUpdated */
 
 
+void Voter::processSignalLevelUpdates(void)
+{
+  if (!siglev_update_pending)
+  {
+    return;
+  }
+  siglev_update_pending = false;
+
+  size_t batch_size = count(sat_siglev_updated.begin(),
+                            sat_siglev_updated.end(), 1);
+  if (batch_size > 0)
+  {
+    dispatchEvent(Macho::Event(&Top::satSignalLevelsUpdated));
+    ++siglev_batch_cnt;
+    siglev_max_batch_size = max(siglev_max_batch_size, batch_size);
+    siglev_latency_hist.add(Clock::now() - siglev_update_time);
+  }
+  fill(sat_siglev_updated.begin(), sat_siglev_updated.end(), 0);
+} /* Voter::processSignalLevelUpdates */
+
+
+void Voter::updateSatSignalLevel(SatRx *srx)
+{
+  size_t idx = srx->index();
+  if (srx->isEnabled() && srx->squelchIsOpen())
+  {
+    sat_siglev[idx] = srx->signalStrength();
+  }
+  else
+  {
+    sat_siglev[idx] = NO_VOTE;
+    sat_siglev_updated[idx] = 0;
+  }
+} /* Voter::updateSatSignalLevel */
+
+
+void Voter::voteStarted(void)
+{
+  if (!vote_started)
+  {
+    vote_started = true;
+    vote_start_time = Clock::now();
+  }
+} /* Voter::voteStarted */
+
+
+void Voter::voteDecided(void)
+{
+  if (vote_started)
+  {
+    vote_started = false;
+    decision_latency_hist.add(Clock::now() - vote_start_time);
+  }
+} /* Voter::voteDecided */
+
+
+void Voter::printStats(std::ostream& os) const
+{
+  os << name() << ": Voter statistics for " << rxs.size()
+     << " receivers\n";
+  os << "  Signal level updates: " << siglev_update_cnt
+     << " in " << siglev_batch_cnt << " batches (max batch size "
+     << siglev_max_batch_size << ")\n";
+  os << "  Signal level evaluation latency: ";
+  siglev_latency_hist.print(os, "    ");
+  os << "  Voting decision latency: ";
+  decision_latency_hist.print(os, "    ");
+} /* Voter::printStats */
+
+
+void Voter::resetStats(void)
+{
+  siglev_update_cnt = 0;
+  siglev_batch_cnt = 0;
+  siglev_max_batch_size = 0;
+  siglev_latency_hist.reset();
+  decision_latency_hist.reset();
+} /* Voter::resetStats */
+
+
 void Voter::muteAllBut(SatRx *srx, Rx::MuteState mute_state)
 {
-  list<SatRx *>::iterator it;
+  std::vector<SatRx *>::iterator it;
   for (it=rxs.begin(); it!=rxs.end(); ++it)
   {
     (*it)->setMuteState(*it == srx ? MUTE_NONE : mute_state);
@@ -720,7 +824,7 @@ void Voter::muteAllBut(SatRx *srx, Rx::MuteState mute_state)
 
 void Voter::unmuteAll(void)
 {
-  list<SatRx *>::iterator it;
+  std::vector<SatRx *>::iterator it;
   for (it=rxs.begin(); it!=rxs.end(); ++it)
   {
     (*it)->setMuteState(MUTE_NONE);
@@ -730,7 +834,7 @@ void Voter::unmuteAll(void)
 
 void Voter::resetAll(void)
 {
-  list<SatRx *>::iterator it;
+  std::vector<SatRx *>::iterator it;
   for (it=rxs.begin(); it!=rxs.end(); ++it)
   {
     (*it)->reset();
@@ -770,23 +874,24 @@ void Voter::publishSquelchState(void)
 
 Voter::SatRx *Voter::findBestRx(void) const
 {
-  float best_rx_siglev = 0.0f;
-  SatRx *best_rx = 0;
-  list<SatRx *>::const_iterator it;
-  for (it=rxs.begin(); it!=rxs.end(); ++it)
+    // The sat_siglev array contain the last known signal level for all
+    // receivers that have an open squelch and that are enabled. All other
+    // receivers have the value NO_VOTE so a plain scan for the maximum
+    // value over the contiguous array is enough.
+  size_t best_idx = 0;
+  float best_rx_siglev = NO_VOTE;
+  for (size_t idx=0; idx<sat_siglev.size(); ++idx)
   {
-    if ((*it)->isEnabled() && (*it)->squelchIsOpen() &&
-	((best_rx == 0) || ((*it)->signalStrength() > best_rx_siglev)))
+    if (sat_siglev[idx] > best_rx_siglev)
     {
-      best_rx = *it;
-      best_rx_siglev = (*it)->signalStrength();
+      best_rx_siglev = sat_siglev[idx];
+      best_idx = idx;
     }
   }
-  
-  return best_rx;
-  
-} /* Voter::findBestRx */
 
+  return (best_rx_siglev > NO_VOTE) ? rxs[best_idx] : 0;
+
+} /* Voter::findBestRx */
 
 
 /****************************************************************************
@@ -867,23 +972,21 @@ void Voter::Top::satSquelchOpen(SatRx *srx, bool is_open)
 } /* Voter::Top::satSquelchOpen */
 
 
-void Voter::Top::satSignalLevelUpdated(SatRx *srx, float siglev)
+void Voter::Top::satSignalLevelsUpdated(void)
 {
-  assert(srx != 0);
-  assert(bestSrx() != 0);
-  assert(srx->squelchIsOpen());
-  
-  if (!bestSrx()->squelchIsOpen() ||
-      (siglev > bestSrx()->signalStrength()))
+  SatRx *best_srx = voter().findBestRx();
+  if (best_srx != 0)
   {
-    box().best_srx = srx;
+    box().best_srx = best_srx;
   }
 
-  if (srx == activeSrx())
+  SatRx *srx = activeSrx();
+  if ((srx != 0) && voter().sat_siglev_updated[srx->index()])
   {
+    float siglev = voter().sat_siglev[srx->index()];
     runTask(sigc::bind(voter().signalLevelUpdated.make_slot(), siglev));
   }
-} /* Voter::Top::satSignalLevelUpdated */
+} /* Voter::Top::satSignalLevelsUpdated */
 
 
 void Voter::Top::runTask(sigc::slot<void()> task)
@@ -960,6 +1063,9 @@ void Voter::Muted::doUnmute(void)
 void Voter::Idle::entry(void)
 {
   //cout << "### Idle::entry\n";
+    // A vote started but not decided before coming back to idle should not
+    // be counted in the decision latency statistics
+  voter().voteAborted();
   if (muteState() == Rx::MUTE_NONE)
   {
     voter().unmuteAll();
@@ -972,6 +1078,7 @@ void Voter::Idle::satSquelchOpen(SatRx *srx, bool is_open)
   SUPER::satSquelchOpen(srx, is_open);
   if (is_open)
   {
+    voter().voteStarted();
     if (srx->signalStrength() * hysteresis() > 100.0f)
     {
       setState<ActiveRxSelected>(bestSrx());
@@ -1050,6 +1157,7 @@ void Voter::VotingDelay::timerExpired(void)
 void Voter::ActiveRxSelected::init(SatRx *srx)
 {
   assert(srx != 0);
+  voter().voteDecided();
   box().active_srx = srx;
   if (muteState() == MUTE_CONTENT)
   {
@@ -1376,13 +1484,26 @@ void Voter::handlePtyCommand(const std::string &full_command)
   std::string rx_name;
   if (!(is >> rx_name))
   {
+    if (command == "STATS") // Print voter statistics
+    {
+      std::ostringstream ss;
+      printStats(ss);
+      std::cout << ss.str() << std::flush;
+      command_pty->write(ss.str());
+      return;
+    }
     std::cerr << "*** WARNING: Malformed voter PTY command "
                  "(missing/illegal rx name): \"" << full_command << "\""
               << std::endl;
     return;
   }
 
-  if (command == "ENABLE") // Enable receiver
+  if ((command == "STATS") && (rx_name == "RESET")) // Reset statistics
+  {
+    resetStats();
+    std::cout << name() << ": Voter statistics reset" << std::endl;
+  }
+  else if (command == "ENABLE") // Enable receiver
   {
     setRxEnabled(rx_name, Rx::MUTE_NONE);
   }
@@ -1414,6 +1535,7 @@ void Voter::setRxEnabled(const std::string &rx_name,
     {
       if (srx->setEnabled(disabled_mute_state))
       {
+        updateSatSignalLevel(srx);
         std::cout << name() << ": " << mute_str << " receiver " << srx->name()
                   << std::endl;
         if (srx->squelchIsOpen())
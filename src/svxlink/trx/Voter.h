@@ -36,6 +36,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <list>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <stdint.h>
 
 
 /****************************************************************************
@@ -45,6 +49,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncConfig.h>
+#include <AsyncLatencyHistogram.h>
 #include <CppStdCompat.h>
 
 
@@ -267,7 +272,7 @@ class Voter : public Rx
       virtual void setMuteState(Rx::MuteState new_mute_state);
       virtual void reset(void);
       virtual void satSquelchOpen(SatRx *srx, bool is_open);
-      virtual void satSignalLevelUpdated(SatRx *srx, float siglev);
+      virtual void satSignalLevelsUpdated(void);
       virtual float signalStrength(void) { return -100.0; }
       virtual char sqlRxId(void) { return Rx::ID_UNKNOWN; }
       virtual SatRx *activeSrx(void) { return 0; }
@@ -408,9 +413,10 @@ class Voter : public Rx
     };
     
     typedef std::list<Macho::IEvent<Top>*> EventQueue;
-    
+    typedef std::chrono::steady_clock Clock;
+
     Async::Config     	  &cfg;
-    std::list<SatRx *>	  rxs;
+    std::vector<SatRx *>  rxs;
     bool	      	  m_verbose;
     Async::AudioSelector  *selector;
     Macho::Machine<Top>   sm;
@@ -419,10 +425,28 @@ class Voter : public Rx
     Async::Pty            *command_pty;
     std::string           command_buf;
     bool                  m_print_sat_squelch;
+    std::vector<float>    sat_siglev;
+    std::vector<char>     sat_siglev_updated;
+    bool                  siglev_update_pending;
+    Clock::time_point     siglev_update_time;
+    Clock::time_point     vote_start_time;
+    bool                  vote_started;
+    uint64_t              siglev_update_cnt;
+    uint64_t              siglev_batch_cnt;
+    size_t                siglev_max_batch_size;
+    Async::LatencyHistogram siglev_latency_hist;
+    Async::LatencyHistogram decision_latency_hist;
 
     void dispatchEvent(Macho::IEvent<Top> *event);
     void satSquelchOpen(bool is_open, SatRx *rx);
     void satSignalLevelUpdated(float siglev, SatRx *srx);
+    void processSignalLevelUpdates(void);
+    void updateSatSignalLevel(SatRx *srx);
+    void voteStarted(void);
+    void voteDecided(void);
+    void voteAborted(void) { vote_started = false; }
+    void printStats(std::ostream& os) const;
+    void resetStats(void);
     void muteAllBut(SatRx *srx, Rx::MuteState mute_state);
     void muteAll(Rx::MuteState mute_state) { muteAllBut(0, mute_state); }
     void unmuteAll(void);
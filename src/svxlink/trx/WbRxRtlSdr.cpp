@@ -33,11 +33,20 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <stdint.h>
+#include <time.h>
 #include <cassert>
+#include <cstring>
+#include <cerrno>
 #include <limits>
 #include <algorithm>
 #include <deque>
 #include <iterator>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iomanip>
+#include <sstream>
 
 
 /****************************************************************************
@@ -57,6 +66,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "WbRxRtlSdr.h"
 #include "RtlTcp.h"
+#include "RtlFile.h"
 #ifdef HAS_RTLSDR_SUPPORT
 #include "RtlUsb.h"
 #endif
@@ -89,6 +99,102 @@ using namespace std::placeholders;
  *
  ****************************************************************************/
 
+/**
+ * @brief A pool of threads running a number of jobs in parallel
+ *
+ * The run function execute the given job function once for each job index
+ * and return when all jobs are done. The calling thread take part in the
+ * work so a pool with N threads will run at most N+1 jobs in parallel.
+ */
+class WbRxRtlSdr::WorkerPool
+{
+  public:
+    typedef std::function<void(size_t)> Job;
+
+    explicit WorkerPool(unsigned thread_cnt)
+    {
+      for (unsigned i=0; i<thread_cnt; ++i)
+      {
+        threads.push_back(std::thread(&WorkerPool::workerFunc, this));
+      }
+    }
+
+    ~WorkerPool(void)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+      }
+      start_cond.notify_all();
+      for (auto& thread : threads)
+      {
+        thread.join();
+      }
+    }
+
+    size_t threadCount(void) const { return threads.size(); }
+
+    void run(const Job& job, size_t job_cnt)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      current_job = &job;
+      this->job_cnt = job_cnt;
+      next_job = 0;
+      done_cnt = 0;
+      ++generation;
+      start_cond.notify_all();
+      runJobs(lock);
+      done_cond.wait(lock, [this]{ return done_cnt == this->job_cnt; });
+      current_job = nullptr;
+    }
+
+  private:
+    std::vector<std::thread>  threads;
+    std::mutex                mutex;
+    std::condition_variable   start_cond;
+    std::condition_variable   done_cond;
+    const Job*                current_job = nullptr;
+    size_t                    job_cnt     = 0;
+    size_t                    next_job    = 0;
+    size_t                    done_cnt    = 0;
+    unsigned                  generation  = 0;
+    bool                      quit        = false;
+
+    void workerFunc(void)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      unsigned seen_generation = generation;
+      for (;;)
+      {
+        start_cond.wait(lock, [&]{
+            return quit || (generation != seen_generation);
+          });
+        if (quit)
+        {
+          break;
+        }
+        seen_generation = generation;
+        runJobs(lock);
+      }
+    }
+
+    void runJobs(std::unique_lock<std::mutex>& lock)
+    {
+      while (next_job < job_cnt)
+      {
+        size_t idx = next_job++;
+        const Job& job = *current_job;
+        lock.unlock();
+        job(idx);
+        lock.lock();
+        if (++done_cnt == job_cnt)
+        {
+          done_cond.notify_all();
+        }
+      }
+    }
+}; /* WbRxRtlSdr::WorkerPool */
+
 
 
 /****************************************************************************
@@ -137,7 +243,9 @@ WbRxRtlSdr *WbRxRtlSdr::instance(Async::Config &cfg, const string &name)
 
 
 WbRxRtlSdr::WbRxRtlSdr(Async::Config &cfg, const string &name)
-  : auto_tune_enabled(true), m_name(name), xvrtr_offset(0)
+  : auto_tune_enabled(true), m_name(name), xvrtr_offset(0), worker_pool(0),
+    stats_timer(0, Async::Timer::TYPE_PERIODIC, false), iq_recorder(0),
+    iq_record_fmt(RtlFile::FMT_CF32)
 {
   //cout << "### Initializing WBRX " << name << endl;
 
@@ -163,6 +271,48 @@ WbRxRtlSdr::WbRxRtlSdr(Async::Config &cfg, const string &name)
     rtl = new RtlUsb(dev_match);
   }
 #endif
+  else if (rtl_type == "RtlFile")
+  {
+    string iq_file;
+    if (!cfg.getValue(name, "IQ_FILE", iq_file))
+    {
+      cerr << "*** ERROR: Config variable " << name << "/IQ_FILE not set\n";
+      exit(1);
+    }
+    string fmt_str("U8");
+    cfg.getValue(name, "IQ_FILE_FORMAT", fmt_str);
+    RtlFile::Format fmt = RtlFile::formatFromString(fmt_str);
+    if (fmt == RtlFile::FMT_UNKNOWN)
+    {
+      cerr << "*** ERROR: Unknown I/Q file format \"" << fmt_str
+           << "\" in " << name << "/IQ_FILE_FORMAT. "
+           << "Legal values are: U8, CS16 and CF32\n";
+      exit(1);
+    }
+    string pacing_str("REALTIME");
+    cfg.getValue(name, "IQ_FILE_PACING", pacing_str);
+    RtlFile::Pacing pacing = RtlFile::PACING_REALTIME;
+    if (pacing_str == "FAST")
+    {
+      pacing = RtlFile::PACING_FAST;
+    }
+    else if (pacing_str != "REALTIME")
+    {
+      cerr << "*** ERROR: Unknown pacing \"" << pacing_str << "\" in "
+           << name << "/IQ_FILE_PACING. Legal values are: REALTIME and FAST\n";
+      exit(1);
+    }
+    bool loop = true;
+    cfg.getValue(name, "IQ_FILE_LOOP", loop);
+    string center_fq_str;
+    if (!cfg.getValue(name, "CENTER_FQ", center_fq_str))
+    {
+      cerr << "*** ERROR: Config variable " << name << "/CENTER_FQ must be "
+              "set to the recording frequency when using an I/Q file\n";
+      exit(1);
+    }
+    rtl = new RtlFile(iq_file, fmt, pacing, loop);
+  }
   else
   {
     cerr << "*** ERROR: Unknown WbRx type: " << rtl_type << endl;
@@ -173,7 +323,7 @@ WbRxRtlSdr::WbRxRtlSdr(Async::Config &cfg, const string &name)
   cfg.getValue(name, "SAMPLE_RATE", sample_rate);
   //cout << "###   SAMPLE_RATE = " << sample_rate << endl;
   rtl->setSampleRate(sample_rate);
-  rtl->iqReceived.connect(iqReceived.make_slot());
+  rtl->iqReceived.connect(mem_fun(*this, &WbRxRtlSdr::onIqReceived));
   rtl->readyStateChanged.connect(
       mem_fun(*this, &WbRxRtlSdr::rtlReadyStateChanged));
 
@@ -206,6 +356,48 @@ WbRxRtlSdr::WbRxRtlSdr(Async::Config &cfg, const string &name)
   bool peak_meter = false;
   cfg.getValue(name, "PEAK_METER", peak_meter);
   rtl->enableDistPrint(peak_meter);
+
+  unsigned worker_threads = 0;
+  cfg.getValue(name, "WORKER_THREADS", worker_threads);
+  if (worker_threads > 0)
+  {
+    worker_pool = new WorkerPool(worker_threads);
+  }
+
+  string iq_record_file;
+  if (cfg.getValue(name, "IQ_RECORD_FILE", iq_record_file))
+  {
+    string fmt_str("CF32");
+    cfg.getValue(name, "IQ_RECORD_FORMAT", fmt_str);
+    iq_record_fmt = RtlFile::formatFromString(fmt_str);
+    if (iq_record_fmt == RtlFile::FMT_UNKNOWN)
+    {
+      cerr << "*** ERROR: Unknown I/Q file format \"" << fmt_str
+           << "\" in " << name << "/IQ_RECORD_FORMAT. "
+           << "Legal values are: U8, CS16 and CF32\n";
+      exit(1);
+    }
+    iq_recorder = new Async::FileWriter(8 * 1024 * 1024);
+    if (!iq_recorder->open(iq_record_file))
+    {
+      cerr << "*** ERROR: Could not open I/Q record file "
+           << iq_record_file << ": " << strerror(errno) << endl;
+      exit(1);
+    }
+    cout << name << ": Recording I/Q samples to " << iq_record_file
+         << " (" << fmt_str << ")" << endl;
+  }
+
+  unsigned stats_interval = 0;
+  cfg.getValue(name, "CHANNEL_STATS_INTERVAL", stats_interval);
+  if (stats_interval > 0)
+  {
+    stats_timer.setTimeout(1000 * stats_interval);
+    stats_timer.expired.connect(
+        mem_fun(*this, &WbRxRtlSdr::printChannelStats));
+    stats_timer.setEnable(true);
+    stats_start = std::chrono::steady_clock::now();
+  }
 } /* WbRxRtlSdr::WbRxRtlSdr */
 
 
@@ -213,6 +405,10 @@ WbRxRtlSdr::~WbRxRtlSdr(void)
 {
   delete rtl;
   rtl = 0;
+  delete worker_pool;
+  worker_pool = 0;
+  delete iq_recorder;
+  iq_recorder = 0;
 } /* WbRxRtlSdr::~WbRxRtlSdr */
 
 
@@ -242,9 +438,10 @@ uint32_t WbRxRtlSdr::sampleRate(void) const
 
 void WbRxRtlSdr::registerDdr(Ddr *ddr)
 {
-  Ddrs::iterator it = ddrs.find(ddr);
+  Ddrs::iterator it = find(ddrs.begin(), ddrs.end(), ddr);
   assert(it == ddrs.end());
-  ddrs.insert(ddr);
+  ddrs.push_back(ddr);
+  ddr_cpu_ns.push_back(0);
   if (auto_tune_enabled)
   {
     findBestCenterFq();
@@ -254,8 +451,9 @@ void WbRxRtlSdr::registerDdr(Ddr *ddr)
 
 void WbRxRtlSdr::unregisterDdr(Ddr *ddr)
 {
-  Ddrs::iterator it = ddrs.find(ddr);
+  Ddrs::iterator it = find(ddrs.begin(), ddrs.end(), ddr);
   assert(it != ddrs.end());
+  ddr_cpu_ns.erase(ddr_cpu_ns.begin() + (it - ddrs.begin()));
   ddrs.erase(it);
   if (auto_tune_enabled)
   {
@@ -406,6 +604,114 @@ void WbRxRtlSdr::rtlReadyStateChanged(void)
 } /* WbRxRtlSdr::rtlReadyStateChanged */
 
 
+void WbRxRtlSdr::onIqReceived(std::vector<Sample> samples)
+{
+  if (iq_recorder != 0)
+  {
+    recordIq(samples);
+  }
+
+  iqReceived(samples);
+
+    // The DDR list may change when the processed audio is delivered so work
+    // on a copy of it
+  Ddrs ddr_list(ddrs);
+  block_cpu_ns.assign(ddr_list.size(), 0);
+  if ((worker_pool != 0) && (ddr_list.size() > 1))
+  {
+    worker_pool->run(
+        [this, &ddr_list, &samples](size_t idx)
+        {
+          processDdr(idx, ddr_list, samples);
+        },
+        ddr_list.size());
+  }
+  else
+  {
+    for (size_t idx=0; idx<ddr_list.size(); ++idx)
+    {
+      processDdr(idx, ddr_list, samples);
+    }
+  }
+
+  for (size_t idx=0; idx<ddr_list.size(); ++idx)
+  {
+    Ddrs::iterator it = find(ddrs.begin(), ddrs.end(), ddr_list[idx]);
+    if (it != ddrs.end())
+    {
+      ddr_cpu_ns[it - ddrs.begin()] += block_cpu_ns[idx];
+      ddr_list[idx]->deliverProcessedIq();
+    }
+  }
+} /* WbRxRtlSdr::onIqReceived */
+
+
+void WbRxRtlSdr::processDdr(size_t idx, const Ddrs& ddr_list,
+                            const std::vector<Sample>& samples)
+{
+  struct timespec start, end;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+  ddr_list[idx]->processIq(samples);
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+  block_cpu_ns[idx] =
+    static_cast<uint64_t>(end.tv_sec - start.tv_sec) * 1000000000ULL +
+    end.tv_nsec - start.tv_nsec;
+} /* WbRxRtlSdr::processDdr */
+
+
+void WbRxRtlSdr::printChannelStats(Async::Timer *t)
+{
+  TimePoint now = std::chrono::steady_clock::now();
+  uint64_t wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - stats_start).count();
+  stats_start = now;
+  if (wall_ns == 0)
+  {
+    return;
+  }
+
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  uint64_t total_ns = 0;
+  for (size_t idx=0; idx<ddrs.size(); ++idx)
+  {
+    ss << " " << ddrs[idx]->name() << "="
+       << (100.0 * ddr_cpu_ns[idx] / wall_ns) << "%";
+    total_ns += ddr_cpu_ns[idx];
+    ddr_cpu_ns[idx] = 0;
+  }
+  std::cout << name() << ": Channel CPU load:" << ss.str()
+            << " (total " << std::fixed << std::setprecision(1)
+            << (100.0 * total_ns / wall_ns) << "%, "
+            << ((worker_pool != 0) ? worker_pool->threadCount() : 0)
+            << " worker threads)" << std::defaultfloat << std::endl;
+} /* WbRxRtlSdr::printChannelStats */
+
+
+void WbRxRtlSdr::recordIq(const std::vector<Sample>& samples)
+{
+  RtlFile::fromSamples(iq_record_buf, samples,
+                       static_cast<RtlFile::Format>(iq_record_fmt));
+  if (!iq_record_buf.empty() &&
+      !iq_recorder->write(&iq_record_buf[0], iq_record_buf.size()))
+  {
+    int err = iq_recorder->error();
+    if (err != 0)
+    {
+      cerr << "*** ERROR: " << name() << ": Failed to write I/Q record file: "
+           << strerror(err) << ". Recording stopped." << endl;
+      delete iq_recorder;
+      iq_recorder = 0;
+    }
+    else if (iq_recorder->stats().drop_cnt == 1)
+    {
+      cerr << "*** WARNING: " << name() << ": Dropping I/Q samples since "
+              "the record file cannot be written fast enough" << endl;
+    }
+  }
+} /* WbRxRtlSdr::recordIq */
+
+
 
 /*
  * This file has not been truncated
@@ -35,12 +35,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <sigc++/sigc++.h>
+#include <stdint.h>
 
 #include <map>
 #include <string>
 #include <vector>
 #include <complex>
-#include <set>
+#include <chrono>
 
 
 /****************************************************************************
@@ -49,6 +50,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncTimer.h>
+#include <AsyncFileWriter.h>
 
 
 /****************************************************************************
@@ -120,6 +123,18 @@ class Ddr;
 
 This class handle a RTL2832U tuner through the RtlSdr class. Configuration
 is read from the given section in the given configuration file.
+
+Each received block of I/Q samples is processed by all registered DDR:s. By
+default that is done sequentially in the main thread. If the WORKER_THREADS
+configuration variable is set, the channels are processed in parallel by a
+pool of worker threads, with the main thread taking part in the work. The main
+thread wait for all channels to finish processing the block and then deliver
+the result from each channel, in registration order, from the main thread.
+
+For testing and benchmarking, the TYPE configuration variable can be set to
+RtlFile to replay I/Q samples from a file instead of using a real tuner. The
+received I/Q samples can also be recorded to a file by setting the
+IQ_RECORD_FILE configuration variable.
 */
 class WbRxRtlSdr : public sigc::trackable
 {
@@ -213,8 +228,10 @@ class WbRxRtlSdr : public sigc::trackable
   protected:
     
   private:
+    class WorkerPool;
     typedef std::map<std::string, WbRxRtlSdr*> InstanceMap;
-    typedef std::set<Ddr*> Ddrs;
+    typedef std::vector<Ddr*> Ddrs;
+    typedef std::chrono::steady_clock::time_point TimePoint;
 
     static InstanceMap instances;
 
@@ -223,11 +240,24 @@ class WbRxRtlSdr : public sigc::trackable
     bool auto_tune_enabled;
     std::string m_name;
     int xvrtr_offset;
+    WorkerPool *worker_pool;
+    std::vector<uint64_t> ddr_cpu_ns;
+    std::vector<uint64_t> block_cpu_ns;
+    Async::Timer stats_timer;
+    TimePoint stats_start;
+    Async::FileWriter *iq_recorder;
+    int iq_record_fmt;
+    std::vector<char> iq_record_buf;
 
     WbRxRtlSdr(const WbRxRtlSdr&);
     WbRxRtlSdr& operator=(const WbRxRtlSdr&);
     void findBestCenterFq(void);
     void rtlReadyStateChanged(void);
+    void onIqReceived(std::vector<Sample> samples);
+    void processDdr(size_t idx, const Ddrs& ddr_list,
+                    const std::vector<Sample>& samples);
+    void printChannelStats(Async::Timer *t);
+    void recordIq(const std::vector<Sample>& samples);
     
 };  /* class WbRxRtlSdr */
 
@@ -0,0 +1,557 @@
+#include <unistd.h>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <complex>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+
+#include <AsyncCppApplication.h>
+#include <AsyncConfig.h>
+#include <AsyncAudioSink.h>
+#include <AsyncAudioSource.h>
+#include <AsyncAudioFilter.h>
+#include <AsyncAudioDecimator.h>
+#include <AsyncAudioInterpolator.h>
+#include <AsyncAudioEncoder.h>
+#include <AfskDemodulator.h>
+
+#include "SvxSwDtmfDecoder.h"
+#include "ToneDetector.h"
+#include "SigLevDetNoise.h"
+#include "SigLevDetTone.h"
+#include "Ddr.h"
+#include "NetTrxMsg.h"
+#include "multirate_filter_coeff.h"
+
+using namespace std;
+using namespace Async;
+
+
+  /*
+   * Benchmark the signal processing blocks used by the transceiver code.
+   * Each block is fed with a synthetic signal, as fast as it will accept it,
+   * and the time spent is reported as nanoseconds per input sample and as
+   * a realtime factor, i.e. how many times faster than realtime the block
+   * runs on this machine. Use --json to get machine readable output that
+   * can be compared between releases.
+   */
+
+class NullSink : public AudioSink
+{
+  public:
+    virtual int writeSamples(const float *samples, int count)
+    {
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      sourceAllSamplesFlushed();
+    }
+};
+
+
+namespace {
+const int BLOCK_SIZE = 256;
+
+struct Result
+{
+  string    name;
+  unsigned  sample_rate;
+  uint64_t  samples;
+  double    ns_per_sample;
+  double    realtime_factor;
+};
+
+double bench_seconds = 10.0;
+string name_filter;
+vector<Result> results;
+
+
+bool isSelected(const string& name)
+{
+  return name_filter.empty() || (name.find(name_filter) != string::npos);
+}
+
+
+  /*
+   * Generate one second of a sum of tones at the given relative amplitudes
+   * with some white noise added. The same pseudo random sequence is used on
+   * each run so that the results are comparable.
+   */
+vector<float> makeSignal(unsigned sample_rate, const vector<float>& tones,
+                         float amp, float noise_amp)
+{
+  vector<float> signal(sample_rate);
+  unsigned rnd = 1;
+  for (unsigned i=0; i<sample_rate; ++i)
+  {
+    float sample = 0.0f;
+    for (vector<float>::const_iterator it=tones.begin(); it!=tones.end(); ++it)
+    {
+      sample += amp * sinf(2.0f * M_PI * *it * i / sample_rate);
+    }
+    rnd = rnd * 1103515245 + 12345;
+    float noise = static_cast<float>((rnd >> 8) & 0xffff) / 32768.0f - 1.0f;
+    signal[i] = sample + noise_amp * noise;
+  }
+  return signal;
+}
+
+
+void addResult(const string& name, unsigned sample_rate, uint64_t samples,
+               chrono::steady_clock::duration elapsed)
+{
+  double ns = chrono::duration<double, nano>(elapsed).count();
+  Result result;
+  result.name = name;
+  result.sample_rate = sample_rate;
+  result.samples = samples;
+  result.ns_per_sample = ns / samples;
+  result.realtime_factor =
+    (static_cast<double>(samples) / sample_rate) / (ns * 1.0e-9);
+  results.push_back(result);
+
+  cout << setw(24) << left << name << right
+       << setw(9) << sample_rate << "Hz"
+       << fixed << setprecision(2)
+       << setw(10) << result.ns_per_sample << " ns/sample"
+       << setprecision(1)
+       << setw(10) << result.realtime_factor << "x realtime" << endl;
+}
+
+
+  /*
+   * Write the signal to the sink in blocks of BLOCK_SIZE samples until the
+   * requested number of seconds of audio has been written.
+   */
+void runAudioBench(const string& name, unsigned sample_rate, AudioSink& sink,
+                   const vector<float>& signal)
+{
+  uint64_t total = static_cast<uint64_t>(bench_seconds * sample_rate);
+  uint64_t written = 0;
+  size_t pos = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  while (written < total)
+  {
+    int count = min(static_cast<size_t>(BLOCK_SIZE), signal.size() - pos);
+    int ret = sink.writeSamples(&signal[pos], count);
+    if (ret <= 0)
+    {
+      cerr << "*** ERROR: Benchmark " << name << " did not accept samples\n";
+      return;
+    }
+    written += ret;
+    pos = (pos + ret) % signal.size();
+  }
+  sink.flushSamples();
+  addResult(name, sample_rate, written,
+            chrono::steady_clock::now() - start);
+}
+
+
+void benchDtmfDecoder(void)
+{
+  if (!isSelected("SvxSwDtmfDecoder"))
+  {
+    return;
+  }
+  Config cfg;
+  cfg.setValue("Bench", "DTMF_DEC_TYPE", "INTERNAL");
+  SvxSwDtmfDecoder dec(cfg, "Bench");
+  if (!dec.initialize())
+  {
+    cerr << "*** WARNING: Could not initialize SvxSwDtmfDecoder\n";
+    return;
+  }
+  vector<float> tones;
+  tones.push_back(770.0f);
+  tones.push_back(1336.0f);
+  runAudioBench("SvxSwDtmfDecoder", INTERNAL_SAMPLE_RATE, dec,
+                makeSignal(INTERNAL_SAMPLE_RATE, tones, 0.3f, 0.05f));
+}
+
+
+void benchToneDetector(void)
+{
+  if (!isSelected("ToneDetector"))
+  {
+    return;
+  }
+  ToneDetector det(1750.0f, 100.0f);
+  vector<float> tones(1, 1750.0f);
+  runAudioBench("ToneDetector", INTERNAL_SAMPLE_RATE, det,
+                makeSignal(INTERNAL_SAMPLE_RATE, tones, 0.5f, 0.05f));
+}
+
+
+void benchSigLevDet(const string& name, SigLevDet& det, unsigned sample_rate)
+{
+  if (!isSelected(name))
+  {
+    return;
+  }
+  Config cfg;
+  if (!det.initialize(cfg, "Bench", sample_rate))
+  {
+    cerr << "*** WARNING: Could not initialize " << name << endl;
+    return;
+  }
+  vector<float> tones(1, 1000.0f);
+  runAudioBench(name, sample_rate, det,
+                makeSignal(sample_rate, tones, 0.3f, 0.1f));
+}
+
+
+void benchAfskDemodulator(void)
+{
+  if (!isSelected("AfskDemodulator"))
+  {
+    return;
+  }
+  AfskDemodulator demod(1200, 2200, 1200, INTERNAL_SAMPLE_RATE);
+  NullSink sink;
+  demod.registerSink(&sink);
+  vector<float> tones;
+  tones.push_back(1200.0f);
+  tones.push_back(2200.0f);
+  runAudioBench("AfskDemodulator", INTERNAL_SAMPLE_RATE, demod,
+                makeSignal(INTERNAL_SAMPLE_RATE, tones, 0.3f, 0.05f));
+}
+
+
+void benchAudioFilter(const string& name, const string& spec)
+{
+  if (!isSelected(name))
+  {
+    return;
+  }
+  AudioFilter filter(spec);
+  NullSink sink;
+  filter.registerSink(&sink);
+  vector<float> tones(1, 1000.0f);
+  runAudioBench(name, INTERNAL_SAMPLE_RATE, filter,
+                makeSignal(INTERNAL_SAMPLE_RATE, tones, 0.5f, 0.1f));
+}
+
+
+void benchMultirate(void)
+{
+  vector<float> tones(1, 1000.0f);
+  if (isSelected("AudioDecimator"))
+  {
+    AudioDecimator decimator(2, coeff_16_8, coeff_16_8_taps);
+    NullSink sink;
+    decimator.registerSink(&sink);
+    runAudioBench("AudioDecimator_16_8", 16000, decimator,
+                  makeSignal(16000, tones, 0.5f, 0.1f));
+  }
+  if (isSelected("AudioInterpolator"))
+  {
+    AudioInterpolator interpolator(2, coeff_16_8, coeff_16_8_taps);
+    NullSink sink;
+    interpolator.registerSink(&sink);
+    runAudioBench("AudioInterpolator_8_16", 8000, interpolator,
+                  makeSignal(8000, tones, 0.5f, 0.1f));
+  }
+}
+
+
+void benchEncoder(const string& codec)
+{
+  string name = "AudioEncoder" + codec;
+  if (!isSelected(name))
+  {
+    return;
+  }
+  if (!AudioEncoder::isAvailable(codec))
+  {
+    cerr << "*** WARNING: Audio codec " << codec << " not available\n";
+    return;
+  }
+  AudioEncoder *enc = AudioEncoder::create(codec);
+  if (enc == 0)
+  {
+    cerr << "*** WARNING: Could not create audio encoder " << codec << endl;
+    return;
+  }
+  vector<float> tones;
+  tones.push_back(440.0f);
+  tones.push_back(1000.0f);
+  runAudioBench(name, INTERNAL_SAMPLE_RATE, *enc,
+                makeSignal(INTERNAL_SAMPLE_RATE, tones, 0.2f, 0.05f));
+  delete enc;
+}
+
+
+  /*
+   * Pack encoded audio frames into MsgAudio messages and parse them back
+   * again, the way audio travels over a NetTrx TCP connection. The frames
+   * are 20ms of audio at an odd size so that most messages end up unaligned
+   * in the stream. The stream is fed to the parser in TCP segment sized
+   * chunks and unparsed bytes are kept, just like TcpConnection does it.
+   */
+void benchNetTrxMsgAudio(void)
+{
+  const string name = "NetTrxMsgAudio";
+  if (!isSelected(name))
+  {
+    return;
+  }
+  const unsigned frame_samples = INTERNAL_SAMPLE_RATE / 50;
+  const int frame_size = 41;
+  const size_t segment_size = 1448;
+  vector<char> frame(frame_size, 0x55);
+  uint64_t total = static_cast<uint64_t>(bench_seconds * INTERNAL_SAMPLE_RATE);
+  uint64_t samples = 0;
+  uint64_t parsed_bytes = 0;
+  vector<char> stream;
+  vector<char> recv_buf;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  while (samples < total)
+  {
+    stream.clear();
+    for (int i=0; i<50; ++i)
+    {
+      NetTrxMsg::MsgAudio msg(&frame[0], frame_size);
+      const char *ptr = reinterpret_cast<const char*>(&msg);
+      stream.insert(stream.end(), ptr, ptr + msg.size());
+    }
+    for (size_t pos=0; pos<stream.size(); pos+=segment_size)
+    {
+      size_t len = min(segment_size, stream.size() - pos);
+      recv_buf.insert(recv_buf.end(), &stream[pos], &stream[pos] + len);
+      int processed = NetTrxMsg::parseMsgs(&recv_buf[0], recv_buf.size(),
+          [&](NetTrxMsg::Msg *msg)
+          {
+            NetTrxMsg::MsgAudio *audio_msg =
+              reinterpret_cast<NetTrxMsg::MsgAudio*>(msg);
+            parsed_bytes += audio_msg->size();
+            return true;
+          });
+      if (processed < 0)
+      {
+        cerr << "*** ERROR: Benchmark " << name << " got a framing error\n";
+        return;
+      }
+      recv_buf.erase(recv_buf.begin(), recv_buf.begin() + processed);
+    }
+    samples += 50 * frame_samples;
+  }
+  if (parsed_bytes != samples / frame_samples * frame_size)
+  {
+    cerr << "*** ERROR: Benchmark " << name << " lost audio frames\n";
+    return;
+  }
+  addResult(name, INTERNAL_SAMPLE_RATE, samples,
+            chrono::steady_clock::now() - start);
+}
+
+
+  /*
+   * The DDR channelizers live inside the Ddr class so they are exercised
+   * through a DDR connected to a file replay tuner. The file is only used
+   * to set up the tuner. The I/Q samples are fed directly to the DDR, just
+   * like the tuner does it, so the time measured is the frequency
+   * translation, channel filtering and demodulation for one channel.
+   */
+void benchDdr(const string& modstr, unsigned sample_rate)
+{
+  string name = "Ddr_" + modstr + "_" + to_string(sample_rate);
+  if (!isSelected(name))
+  {
+    return;
+  }
+
+  char iq_file[] = "/tmp/trx_bench_XXXXXX";
+  int fd = mkstemp(iq_file);
+  if (fd == -1)
+  {
+    cerr << "*** WARNING: Could not create a temporary file for " << name
+         << ": " << strerror(errno) << endl;
+    return;
+  }
+  vector<uint8_t> silence(2 * sample_rate / 100, 127);
+  if (write(fd, &silence[0], silence.size())
+        != static_cast<ssize_t>(silence.size()))
+  {
+    cerr << "*** WARNING: Could not write temporary file " << iq_file
+         << ": " << strerror(errno) << endl;
+  }
+  close(fd);
+
+  const unsigned center_fq = 435000000;
+  const unsigned ch_offset = 50000;
+  string wbrx_name = "BenchWbRx_" + to_string(sample_rate);
+  Config cfg;
+  cfg.setValue(wbrx_name, "TYPE", "RtlFile");
+  cfg.setValue(wbrx_name, "IQ_FILE", iq_file);
+  cfg.setValue(wbrx_name, "IQ_FILE_PACING", "FAST");
+  cfg.setValue(wbrx_name, "CENTER_FQ", center_fq);
+  cfg.setValue(wbrx_name, "SAMPLE_RATE", sample_rate);
+  cfg.setValue(name, "TYPE", "Ddr");
+  cfg.setValue(name, "WBRX", wbrx_name);
+  cfg.setValue(name, "FQ", center_fq + ch_offset);
+  cfg.setValue(name, "MODULATION", modstr);
+  cfg.setValue(name, "SQL_DET", "OPEN");
+
+  Ddr *ddr = new Ddr(cfg, name);
+  if (!ddr->initialize())
+  {
+    cerr << "*** WARNING: Could not initialize " << name << endl;
+    delete ddr;
+    unlink(iq_file);
+    return;
+  }
+  NullSink sink;
+  ddr->registerSink(&sink);
+  ddr->setMuteState(Rx::MUTE_NONE);
+
+    // A carrier in the channel, frequency modulated by a 1kHz tone, plus
+    // some noise and a strong carrier outside of the channel
+  const size_t block_size = sample_rate / 1000;
+  vector<RtlTcp::Sample> signal(sample_rate);
+  unsigned rnd = 1;
+  double phase = 0.0;
+  for (unsigned i=0; i<sample_rate; ++i)
+  {
+    double inst_fq =
+      ch_offset + 3000.0 * sin(2.0 * M_PI * 1000.0 * i / sample_rate);
+    phase += 2.0 * M_PI * inst_fq / sample_rate;
+    rnd = rnd * 1103515245 + 12345;
+    float noise_i = static_cast<float>((rnd >> 8) & 0xffff) / 32768.0f - 1.0f;
+    rnd = rnd * 1103515245 + 12345;
+    float noise_q = static_cast<float>((rnd >> 8) & 0xffff) / 32768.0f - 1.0f;
+    double blocker = 2.0 * M_PI * (ch_offset + 200000.0) * i / sample_rate;
+    signal[i] = RtlTcp::Sample(0.1 * cos(phase) + 0.3 * cos(blocker),
+                               0.1 * sin(phase) + 0.3 * sin(blocker)) +
+                RtlTcp::Sample(0.01f * noise_i, 0.01f * noise_q);
+  }
+
+  uint64_t total = static_cast<uint64_t>(bench_seconds * sample_rate);
+  uint64_t processed = 0;
+  size_t pos = 0;
+  vector<RtlTcp::Sample> block;
+  chrono::steady_clock::duration elapsed(0);
+  while (processed < total)
+  {
+    size_t count = min(block_size, signal.size() - pos);
+    block.assign(signal.begin() + pos, signal.begin() + pos + count);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ddr->processIq(block);
+    ddr->deliverProcessedIq();
+    elapsed += chrono::steady_clock::now() - start;
+    processed += count;
+    pos = (pos + count) % signal.size();
+  }
+  addResult(name, sample_rate, processed, elapsed);
+
+  delete ddr;
+  unlink(iq_file);
+}
+
+
+bool writeJson(ostream& os)
+{
+  os << "{\n  \"seconds\": " << bench_seconds << ",\n  \"results\": [\n";
+  for (size_t i=0; i<results.size(); ++i)
+  {
+    const Result& result = results[i];
+    os << "    { \"name\": \"" << result.name << "\""
+       << ", \"sample_rate\": " << result.sample_rate
+       << ", \"samples\": " << result.samples
+       << setprecision(3) << fixed
+       << ", \"ns_per_sample\": " << result.ns_per_sample
+       << ", \"realtime_factor\": " << result.realtime_factor
+       << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+  return os.good();
+}
+
+
+void usage(const char *prog)
+{
+  cerr << "Usage: " << prog << " [--seconds <s>] [--filter <substring>] "
+          "[--json <file>]\n"
+          "  --seconds  Seconds of signal to process per benchmark "
+          "(default 10)\n"
+          "  --filter   Only run benchmarks with names containing "
+          "<substring>\n"
+          "  --json     Write the results as JSON to <file>\n";
+}
+};
+
+
+int main(int argc, const char **argv)
+{
+  string json_file;
+  for (int i=1; i<argc; ++i)
+  {
+    string arg(argv[i]);
+    if ((arg == "--seconds") && (i + 1 < argc))
+    {
+      bench_seconds = atof(argv[++i]);
+    }
+    else if ((arg == "--filter") && (i + 1 < argc))
+    {
+      name_filter = argv[++i];
+    }
+    else if ((arg == "--json") && (i + 1 < argc))
+    {
+      json_file = argv[++i];
+    }
+    else
+    {
+      usage(argv[0]);
+      exit(1);
+    }
+  }
+  if (bench_seconds <= 0.0)
+  {
+    cerr << "*** ERROR: The number of seconds must be positive\n";
+    exit(1);
+  }
+
+    // Timers used by some of the blocks need an application object
+  CppApplication app;
+
+  benchDtmfDecoder();
+  benchToneDetector();
+  SigLevDetNoise noise_det;
+  benchSigLevDet("SigLevDetNoise", noise_det, INTERNAL_SAMPLE_RATE);
+  SigLevDetTone tone_det;
+  benchSigLevDet("SigLevDetTone", tone_det, 16000);
+  benchAfskDemodulator();
+  benchAudioFilter("AudioFilter_LpCh9", "LpCh9/-0.05/5500");
+  benchAudioFilter("AudioFilter_Preemph", "LpBu3/5500 x HpBu1/3000");
+  benchMultirate();
+  benchEncoder("OPUS");
+  benchEncoder("SPEEX");
+  benchEncoder("GSM");
+  benchNetTrxMsgAudio();
+  benchDdr("FM", 960000);
+  benchDdr("AM", 960000);
+  benchDdr("USB", 960000);
+  benchDdr("FM", 2400000);
+
+  if (!json_file.empty())
+  {
+    ofstream ofs(json_file.c_str());
+    if (!writeJson(ofs))
+    {
+      cerr << "*** ERROR: Could not write JSON output to " << json_file
+           << endl;
+      exit(1);
+    }
+  }
+
+  return 0;
+}